@@ -0,0 +1,425 @@
+/*
+ * Copyright (C) 2026 by Nextcloud GmbH <info@nextcloud.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "common/checksumalgorithms.h"
+
+#include <QtEndian>
+
+#include <openssl/evp.h>
+#include <zlib.h>
+
+#include <array>
+#include <climits>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CHECKSUM_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define CHECKSUM_TARGET(features)
+#else
+#include <immintrin.h>
+#define CHECKSUM_TARGET(features) __attribute__((target(features)))
+#endif
+#endif
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+namespace OCC {
+namespace ChecksumAlgorithms {
+
+namespace {
+
+using ChecksumFunction = quint32 (*)(quint32, const char *, qint64);
+
+struct Implementation
+{
+    ChecksumFunction function;
+    const char *name;
+};
+
+#ifdef CHECKSUM_X86
+bool cpuHasSsse3()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 9)) != 0;
+#else
+    return __builtin_cpu_supports("ssse3");
+#endif
+}
+
+bool cpuHasSse42()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;
+#else
+    return __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+constexpr quint32 adlerBase = 65521;
+// Largest number of bytes that can be added before s2 may overflow, see zlib
+constexpr int adlerNMax = 5552;
+constexpr int adlerBlockSize = 32;
+
+CHECKSUM_TARGET("ssse3")
+quint32 hsum(__m128i vector)
+{
+    vector = _mm_add_epi32(vector, _mm_shuffle_epi32(vector, _MM_SHUFFLE(1, 0, 3, 2)));
+    vector = _mm_add_epi32(vector, _mm_shuffle_epi32(vector, _MM_SHUFFLE(2, 3, 0, 1)));
+    return static_cast<quint32>(_mm_cvtsi128_si32(vector));
+}
+
+CHECKSUM_TARGET("ssse3")
+quint32 adler32Ssse3(quint32 adler, const char *data, qint64 size)
+{
+    quint32 s1 = adler & 0xffff;
+    quint32 s2 = adler >> 16;
+
+    const auto zero = _mm_setzero_si128();
+    const auto ones = _mm_set1_epi16(1);
+    // The weight of each byte of a block for s2
+    const auto tap1 = _mm_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17);
+    const auto tap2 = _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+
+    auto blocks = size / adlerBlockSize;
+    size -= blocks * adlerBlockSize;
+    while (blocks > 0) {
+        auto n = qMin<qint64>(blocks, adlerNMax / adlerBlockSize);
+        blocks -= n;
+
+        // Sum of s1 before each block, s1 contributes to s2 once per byte
+        auto previousS1 = _mm_set_epi32(0, 0, 0, static_cast<int>(s1 * n));
+        auto vectorS1 = zero;
+        auto vectorS2 = _mm_set_epi32(0, 0, 0, static_cast<int>(s2));
+        do {
+            const auto bytes1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+            const auto bytes2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 16));
+            previousS1 = _mm_add_epi32(previousS1, vectorS1);
+            vectorS1 = _mm_add_epi32(vectorS1, _mm_sad_epu8(bytes1, zero));
+            vectorS2 = _mm_add_epi32(vectorS2, _mm_madd_epi16(_mm_maddubs_epi16(bytes1, tap1), ones));
+            vectorS1 = _mm_add_epi32(vectorS1, _mm_sad_epu8(bytes2, zero));
+            vectorS2 = _mm_add_epi32(vectorS2, _mm_madd_epi16(_mm_maddubs_epi16(bytes2, tap2), ones));
+            data += adlerBlockSize;
+        } while (--n);
+        vectorS2 = _mm_add_epi32(vectorS2, _mm_slli_epi32(previousS1, 5));
+
+        s1 = (s1 + hsum(vectorS1)) % adlerBase;
+        s2 = hsum(vectorS2) % adlerBase;
+    }
+
+    return adler32Portable(s1 | (s2 << 16), data, size);
+}
+
+CHECKSUM_TARGET("sse4.2")
+quint32 crc32cSse42(quint32 crc, const char *data, qint64 size)
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    quint64 value = ~crc;
+    for (; size >= 8; size -= 8, data += 8) {
+        value = _mm_crc32_u64(value, qFromLittleEndian<quint64>(data));
+    }
+    auto value32 = static_cast<quint32>(value);
+#else
+    quint32 value32 = ~crc;
+#endif
+    for (; size >= 4; size -= 4, data += 4) {
+        value32 = _mm_crc32_u32(value32, qFromLittleEndian<quint32>(data));
+    }
+    for (; size > 0; --size, ++data) {
+        value32 = _mm_crc32_u8(value32, static_cast<quint8>(*data));
+    }
+    return ~value32;
+}
+#endif
+
+#if defined(__ARM_FEATURE_CRC32)
+quint32 crc32cArm(quint32 crc, const char *data, qint64 size)
+{
+    quint32 value = ~crc;
+    for (; size >= 8; size -= 8, data += 8) {
+        value = __crc32cd(value, qFromLittleEndian<quint64>(data));
+    }
+    for (; size > 0; --size, ++data) {
+        value = __crc32cb(value, static_cast<quint8>(*data));
+    }
+    return ~value;
+}
+#endif
+
+using Crc32cTables = std::array<std::array<quint32, 256>, 8>;
+
+const Crc32cTables &crc32cTables()
+{
+    static const auto tables = [] {
+        Crc32cTables tables{};
+        constexpr quint32 polynomial = 0x82f63b78; // Castagnoli, reflected
+        for (quint32 i = 0; i < 256; ++i) {
+            auto value = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                value = (value & 1) ? (value >> 1) ^ polynomial : value >> 1;
+            }
+            tables[0][i] = value;
+        }
+        for (quint32 i = 0; i < 256; ++i) {
+            for (int slice = 1; slice < 8; ++slice) {
+                const auto previous = tables[slice - 1][i];
+                tables[slice][i] = (previous >> 8) ^ tables[0][previous & 0xff];
+            }
+        }
+        return tables;
+    }();
+    return tables;
+}
+
+const Implementation &adler32Dispatch()
+{
+    static const auto implementation = []() -> Implementation {
+#ifdef CHECKSUM_X86
+        if (cpuHasSsse3()) {
+            return {adler32Ssse3, "SSSE3"};
+        }
+#endif
+        return {adler32Portable, "zlib"};
+    }();
+    return implementation;
+}
+
+const Implementation &crc32cDispatch()
+{
+    static const auto implementation = []() -> Implementation {
+#if defined(__ARM_FEATURE_CRC32)
+        return {crc32cArm, "ARMv8 CRC32"};
+#else
+#ifdef CHECKSUM_X86
+        if (cpuHasSse42()) {
+            return {crc32cSse42, "SSE 4.2"};
+        }
+#endif
+        return {crc32cPortable, "slicing-by-8"};
+#endif
+    }();
+    return implementation;
+}
+
+constexpr quint64 xxhPrime1 = 0x9e3779b185ebca87ULL;
+constexpr quint64 xxhPrime2 = 0xc2b2ae3d27d4eb4fULL;
+constexpr quint64 xxhPrime3 = 0x165667b19e3779f9ULL;
+constexpr quint64 xxhPrime4 = 0x85ebca77c2b2ae63ULL;
+constexpr quint64 xxhPrime5 = 0x27d4eb2f165667c5ULL;
+
+inline quint64 rotateLeft(quint64 value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+inline quint64 xxhRound(quint64 accumulator, quint64 input)
+{
+    accumulator += input * xxhPrime2;
+    accumulator = rotateLeft(accumulator, 31);
+    return accumulator * xxhPrime1;
+}
+
+inline quint64 xxhMergeRound(quint64 accumulator, quint64 value)
+{
+    accumulator ^= xxhRound(0, value);
+    return accumulator * xxhPrime1 + xxhPrime4;
+}
+
+}
+
+quint32 adler32Portable(quint32 adler, const char *data, qint64 size)
+{
+    while (size > 0) {
+        const auto chunk = static_cast<uInt>(qMin<qint64>(size, UINT_MAX));
+        adler = ::adler32(adler, reinterpret_cast<const Bytef *>(data), chunk);
+        data += chunk;
+        size -= chunk;
+    }
+    return adler;
+}
+
+quint32 adler32(quint32 adler, const char *data, qint64 size)
+{
+    return adler32Dispatch().function(adler, data, size);
+}
+
+quint32 crc32cPortable(quint32 crc, const char *data, qint64 size)
+{
+    const auto &tables = crc32cTables();
+    quint32 value = ~crc;
+    for (; size >= 8; size -= 8, data += 8) {
+        const auto low = qFromLittleEndian<quint32>(data) ^ value;
+        const auto high = qFromLittleEndian<quint32>(data + 4);
+        value = tables[7][low & 0xff] ^ tables[6][(low >> 8) & 0xff]
+            ^ tables[5][(low >> 16) & 0xff] ^ tables[4][low >> 24]
+            ^ tables[3][high & 0xff] ^ tables[2][(high >> 8) & 0xff]
+            ^ tables[1][(high >> 16) & 0xff] ^ tables[0][high >> 24];
+    }
+    for (; size > 0; --size, ++data) {
+        value = tables[0][(value ^ static_cast<quint8>(*data)) & 0xff] ^ (value >> 8);
+    }
+    return ~value;
+}
+
+quint32 crc32c(quint32 crc, const char *data, qint64 size)
+{
+    return crc32cDispatch().function(crc, data, size);
+}
+
+QByteArray adler32Implementation()
+{
+    return adler32Dispatch().name;
+}
+
+QByteArray crc32cImplementation()
+{
+    return crc32cDispatch().name;
+}
+
+XxHash64::XxHash64(quint64 seed)
+    : _accumulators{seed + xxhPrime1 + xxhPrime2, seed + xxhPrime2, seed, seed - xxhPrime1}
+    , _seed(seed)
+{
+}
+
+void XxHash64::addData(const char *data, qint64 size)
+{
+    if (size <= 0) {
+        return;
+    }
+    _totalSize += size;
+
+    if (_bufferSize + size < qint64(sizeof(_buffer))) {
+        std::memcpy(_buffer + _bufferSize, data, size);
+        _bufferSize += static_cast<int>(size);
+        return;
+    }
+
+    const auto consumeStripe = [this](const char *stripe) {
+        for (int i = 0; i < 4; ++i) {
+            _accumulators[i] = xxhRound(_accumulators[i], qFromLittleEndian<quint64>(stripe + 8 * i));
+        }
+    };
+
+    if (_bufferSize > 0) {
+        const auto fill = static_cast<int>(sizeof(_buffer)) - _bufferSize;
+        std::memcpy(_buffer + _bufferSize, data, fill);
+        consumeStripe(_buffer);
+        data += fill;
+        size -= fill;
+        _bufferSize = 0;
+    }
+    for (; size >= qint64(sizeof(_buffer)); size -= sizeof(_buffer), data += sizeof(_buffer)) {
+        consumeStripe(data);
+    }
+    if (size > 0) {
+        std::memcpy(_buffer, data, size);
+        _bufferSize = static_cast<int>(size);
+    }
+}
+
+quint64 XxHash64::result() const
+{
+    quint64 hash = 0;
+    if (_totalSize >= sizeof(_buffer)) {
+        hash = rotateLeft(_accumulators[0], 1) + rotateLeft(_accumulators[1], 7)
+            + rotateLeft(_accumulators[2], 12) + rotateLeft(_accumulators[3], 18);
+        for (const auto accumulator : _accumulators) {
+            hash = xxhMergeRound(hash, accumulator);
+        }
+    } else {
+        hash = _seed + xxhPrime5;
+    }
+    hash += _totalSize;
+
+    const char *data = _buffer;
+    auto size = _bufferSize;
+    for (; size >= 8; size -= 8, data += 8) {
+        hash ^= xxhRound(0, qFromLittleEndian<quint64>(data));
+        hash = rotateLeft(hash, 27) * xxhPrime1 + xxhPrime4;
+    }
+    if (size >= 4) {
+        hash ^= quint64(qFromLittleEndian<quint32>(data)) * xxhPrime1;
+        hash = rotateLeft(hash, 23) * xxhPrime2 + xxhPrime3;
+        size -= 4;
+        data += 4;
+    }
+    for (; size > 0; --size, ++data) {
+        hash ^= static_cast<quint8>(*data) * xxhPrime5;
+        hash = rotateLeft(hash, 11) * xxhPrime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= xxhPrime2;
+    hash ^= hash >> 29;
+    hash *= xxhPrime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+OpenSslDigest::OpenSslDigest(const QByteArray &checksumType)
+{
+    const auto digest = EVP_get_digestbyname(checksumType.constData());
+    if (!digest) {
+        return;
+    }
+    _context = EVP_MD_CTX_new();
+    if (_context && EVP_DigestInit_ex(_context, digest, nullptr) != 1) {
+        EVP_MD_CTX_free(_context);
+        _context = nullptr;
+    }
+}
+
+OpenSslDigest::~OpenSslDigest()
+{
+    EVP_MD_CTX_free(_context);
+}
+
+void OpenSslDigest::addData(const char *data, qint64 size)
+{
+    if (_context && size > 0) {
+        EVP_DigestUpdate(_context, data, static_cast<size_t>(size));
+    }
+}
+
+QByteArray OpenSslDigest::result() const
+{
+    if (!_context) {
+        return {};
+    }
+    // Finalize a copy, more data may be added afterwards
+    const auto copy = EVP_MD_CTX_new();
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digestSize = 0;
+    const auto ok = copy && EVP_MD_CTX_copy_ex(copy, _context) == 1 && EVP_DigestFinal_ex(copy, digest, &digestSize) == 1;
+    EVP_MD_CTX_free(copy);
+    if (!ok) {
+        return {};
+    }
+    return QByteArray(reinterpret_cast<const char *>(digest), static_cast<int>(digestSize));
+}
+
+}
+}
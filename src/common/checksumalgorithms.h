@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2026 by Nextcloud GmbH <info@nextcloud.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#pragma once
+
+#include "ocsynclib.h"
+
+#include <QByteArray>
+#include <QtGlobal>
+
+struct evp_md_ctx_st;
+
+namespace OCC {
+
+/**
+ * @brief The checksum functions used by ChecksumCalculator
+ *
+ * The functions pick the fastest implementation the CPU supports when they
+ * are called first. The portable implementations are exported for tests
+ * and benchmarks.
+ *
+ * @ingroup libsync
+ */
+namespace ChecksumAlgorithms {
+
+    /** Continues the Adler-32 checksum adler with data, like zlib's adler32().
+     *
+     * Start with 1. Uses SSSE3 where available.
+     */
+    quint32 OCSYNC_EXPORT adler32(quint32 adler, const char *data, qint64 size);
+    quint32 OCSYNC_EXPORT adler32Portable(quint32 adler, const char *data, qint64 size);
+
+    /** Continues the CRC-32C (Castagnoli) checksum crc with data.
+     *
+     * Start with 0. Uses the CRC32 instructions of SSE 4.2 or ARMv8 where available.
+     */
+    quint32 OCSYNC_EXPORT crc32c(quint32 crc, const char *data, qint64 size);
+    quint32 OCSYNC_EXPORT crc32cPortable(quint32 crc, const char *data, qint64 size);
+
+    /** Names of the implementations chosen for this CPU, for logging */
+    QByteArray OCSYNC_EXPORT adler32Implementation();
+    QByteArray OCSYNC_EXPORT crc32cImplementation();
+
+    /**
+     * @brief Incremental XXH64 hash
+     *
+     * Not a cryptographic hash, but several times faster than any of them
+     * while still detecting changes reliably.
+     */
+    class OCSYNC_EXPORT XxHash64
+    {
+    public:
+        explicit XxHash64(quint64 seed = 0);
+
+        void addData(const char *data, qint64 size);
+        [[nodiscard]] quint64 result() const;
+
+    private:
+        quint64 _accumulators[4];
+        quint64 _seed;
+        quint64 _totalSize = 0;
+        char _buffer[32];
+        int _bufferSize = 0;
+    };
+
+    /**
+     * @brief A message digest computed by OpenSSL
+     *
+     * OpenSSL uses the SHA extensions of the CPU where available.
+     */
+    class OCSYNC_EXPORT OpenSslDigest
+    {
+        Q_DISABLE_COPY(OpenSslDigest)
+
+    public:
+        /// checksumType is one of "MD5", "SHA1", "SHA256" and "SHA3-256"
+        explicit OpenSslDigest(const QByteArray &checksumType);
+        ~OpenSslDigest();
+
+        /// False if OpenSSL doesn't provide the digest
+        [[nodiscard]] bool isValid() const { return _context != nullptr; }
+        void addData(const char *data, qint64 size);
+        /// The digest of the data added so far, not hex encoded
+        [[nodiscard]] QByteArray result() const;
+
+    private:
+        evp_md_ctx_st *_context = nullptr;
+    };
+}
+}
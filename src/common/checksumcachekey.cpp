@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2026 by Nextcloud GmbH <info@nextcloud.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "checksumcachekey.h"
+#include "filesystembase.h"
+
+#include <QFile>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace OCC {
+
+ChecksumCacheKey ChecksumCacheKey::fromFile(const QString &filePath)
+{
+    ChecksumCacheKey key;
+#ifdef Q_OS_WIN
+    const auto handle = CreateFileW(reinterpret_cast<const wchar_t *>(FileSystem::longWinPath(filePath).utf16()), FILE_READ_ATTRIBUTES,
+        FILE_SHARE_WRITE | FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return key;
+    }
+    BY_HANDLE_FILE_INFORMATION fileInfo;
+    FILE_BASIC_INFO basicInfo;
+    if (GetFileInformationByHandle(handle, &fileInfo)
+        && GetFileInformationByHandleEx(handle, FileBasicInfo, &basicInfo, sizeof(basicInfo))) {
+        ULARGE_INTEGER fileIndex;
+        fileIndex.HighPart = fileInfo.nFileIndexHigh;
+        fileIndex.LowPart = fileInfo.nFileIndexLow;
+        // Same inode replacement as csync_vio_local_stat()
+        key._inode = fileIndex.QuadPart & 0x0000FFFFFFFFFFFF;
+        key._size = (static_cast<qint64>(fileInfo.nFileSizeHigh) << 32) + fileInfo.nFileSizeLow;
+        key._modtime = basicInfo.LastWriteTime.QuadPart;
+        key._ctime = basicInfo.ChangeTime.QuadPart;
+    }
+    CloseHandle(handle);
+#else
+    struct stat statBuffer {};
+    if (::stat(QFile::encodeName(filePath).constData(), &statBuffer) != 0 || !S_ISREG(statBuffer.st_mode)) {
+        return key;
+    }
+    key._inode = statBuffer.st_ino;
+    key._size = statBuffer.st_size;
+#if defined(Q_OS_MAC)
+    key._modtime = statBuffer.st_mtimespec.tv_sec * 1000000000LL + statBuffer.st_mtimespec.tv_nsec;
+    key._ctime = statBuffer.st_ctimespec.tv_sec * 1000000000LL + statBuffer.st_ctimespec.tv_nsec;
+#elif defined(Q_OS_LINUX)
+    key._modtime = statBuffer.st_mtim.tv_sec * 1000000000LL + statBuffer.st_mtim.tv_nsec;
+    key._ctime = statBuffer.st_ctim.tv_sec * 1000000000LL + statBuffer.st_ctim.tv_nsec;
+#else
+    key._modtime = statBuffer.st_mtime;
+    key._ctime = statBuffer.st_ctime;
+#endif
+#endif
+    return key;
+}
+
+} // namespace OCC
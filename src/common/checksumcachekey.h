@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2026 by Nextcloud GmbH <info@nextcloud.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#pragma once
+
+#include "ocsynclib.h"
+
+#include <QString>
+#include <QtGlobal>
+
+namespace OCC {
+
+/**
+ * Identifies the content of a local file for the checksum cache of the
+ * sync journal, see SyncJournalDb::getCachedChecksum().
+ *
+ * Any write to the file changes its modtime or at least its ctime, so a
+ * cached checksum is only reused while all four values are unchanged.
+ */
+struct OCSYNC_EXPORT ChecksumCacheKey
+{
+    quint64 _inode = 0;
+    qint64 _size = 0;
+    qint64 _modtime = 0; // at the finest resolution the platform provides
+    qint64 _ctime = 0; // the status change time, same resolution as _modtime
+
+    [[nodiscard]] bool isValid() const { return _inode != 0; }
+
+    bool operator==(const ChecksumCacheKey &other) const
+    {
+        return _inode == other._inode && _size == other._size && _modtime == other._modtime && _ctime == other._ctime;
+    }
+
+    /// Reads the key of the file at filePath, an invalid key on error
+    static ChecksumCacheKey fromFile(const QString &filePath);
+};
+
+} // namespace OCC
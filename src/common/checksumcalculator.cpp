@@ -13,15 +13,32 @@
  */
 #include "checksumcalculator.h"
 
-#include <zlib.h>
+#include "checksumalgorithms.h"
 
 #include <QCryptographicHash>
 #include <QFile>
 #include <QLoggingCategory>
 
+#include <memory>
+#include <new>
+
 namespace
 {
 constexpr qint64 bufSize = 500 * 1024;
+constexpr std::size_t bufAlignment = 4096;
+
+// The read buffer of the calling thread: the threads of ChecksumThreadPool
+// hash one file after the other and don't need a new buffer for each read.
+char *threadReadBuffer()
+{
+    struct AlignedDelete
+    {
+        void operator()(char *buffer) const { ::operator delete(buffer, std::align_val_t(bufAlignment)); }
+    };
+    thread_local const std::unique_ptr<char, AlignedDelete> buffer(
+        static_cast<char *>(::operator new(bufSize, std::align_val_t(bufAlignment))));
+    return buffer.get();
+}
 }
 
 namespace OCC {
@@ -33,6 +50,8 @@ static QCryptographicHash::Algorithm algorithmTypeToQCryptoHashAlgorithm(Checksu
     switch (algorithmType) {
     case ChecksumCalculator::AlgorithmType::Undefined:
     case ChecksumCalculator::AlgorithmType::Adler32:
+    case ChecksumCalculator::AlgorithmType::CRC32C:
+    case ChecksumCalculator::AlgorithmType::XXH64:
         qCWarning(lcChecksumCalculator) << "Invalid algorithm type" << static_cast<int>(algorithmType);
         return static_cast<QCryptographicHash::Algorithm>(-1);
     case ChecksumCalculator::AlgorithmType::MD5:
@@ -50,24 +69,23 @@ static QCryptographicHash::Algorithm algorithmTypeToQCryptoHashAlgorithm(Checksu
 ChecksumCalculator::ChecksumCalculator(const QString &filePath, const QByteArray &checksumTypeName)
     : _device(new QFile(filePath))
 {
-    if (checksumTypeName == checkSumMD5C) {
-        _algorithmType = AlgorithmType::MD5;
-    } else if (checksumTypeName == checkSumSHA1C) {
-        _algorithmType = AlgorithmType::SHA1;
-    } else if (checksumTypeName == checkSumSHA2C) {
-        _algorithmType = AlgorithmType::SHA256;
-    } else if (checksumTypeName == checkSumSHA3C) {
-        _algorithmType = AlgorithmType::SHA3_256;
-    } else if (checksumTypeName == checkSumAdlerC) {
-        _algorithmType = AlgorithmType::Adler32;
-    }
+    initChecksumAlgorithm(checksumTypeName);
+}
 
-    initChecksumAlgorithm();
+ChecksumCalculator::ChecksumCalculator(const QByteArray &checksumTypeName)
+{
+    initChecksumAlgorithm(checksumTypeName);
 }
 
 ChecksumCalculator::~ChecksumCalculator()
+{
+    cancel();
+}
+
+void ChecksumCalculator::cancel()
 {
     QMutexLocker locker(&_deviceMutex);
+    _isCanceled = true;
     if (_device && _device->isOpen()) {
         _device->close();
     }
@@ -77,24 +95,32 @@ QByteArray ChecksumCalculator::calculate()
 {
     QByteArray result;
 
-    if (!_isInitialized) {
+    if (!_isInitialized || !_device) {
         return result;
     }
 
-    Q_ASSERT(!_device->isOpen());
-    if (_device->isOpen()) {
-        qCWarning(lcChecksumCalculator) << "Device already open. Ignoring.";
-    }
+    {
+        QMutexLocker locker(&_deviceMutex);
+        if (_isCanceled) {
+            return result;
+        }
 
-    if (!_device->isOpen() && !_device->open(QIODevice::ReadOnly)) {
-        if (auto file = qobject_cast<QFile *>(_device.data())) {
-            qCWarning(lcChecksumCalculator) << "Could not open file" << file->fileName() << "for reading to compute a checksum" << file->errorString();
-        } else {
-            qCWarning(lcChecksumCalculator) << "Could not open device" << _device.data() << "for reading to compute a checksum" << _device->errorString();
+        Q_ASSERT(!_device->isOpen());
+        if (_device->isOpen()) {
+            qCWarning(lcChecksumCalculator) << "Device already open. Ignoring.";
+        }
+
+        if (!_device->isOpen() && !_device->open(QIODevice::ReadOnly)) {
+            if (auto file = qobject_cast<QFile *>(_device.data())) {
+                qCWarning(lcChecksumCalculator) << "Could not open file" << file->fileName() << "for reading to compute a checksum" << file->errorString();
+            } else {
+                qCWarning(lcChecksumCalculator) << "Could not open device" << _device.data() << "for reading to compute a checksum" << _device->errorString();
+            }
+            return result;
         }
-        return result;
     }
 
+    const auto buffer = threadReadBuffer();
     for (;;) {
         QMutexLocker locker(&_deviceMutex);
         if (!_device->isOpen() || _device->atEnd()) {
@@ -104,12 +130,11 @@ QByteArray ChecksumCalculator::calculate()
         if (toRead <= 0) {
             break;
         }
-        QByteArray buf(toRead, Qt::Uninitialized);
-        const auto sizeRead = _device->read(buf.data(), toRead);
+        const auto sizeRead = _device->read(buffer, toRead);
         if (sizeRead <= 0) {
             break;
         }
-        if (!addChunk(buf, sizeRead)) {
+        if (!addData(buffer, sizeRead)) {
             break;
         }
     }
@@ -121,14 +146,7 @@ QByteArray ChecksumCalculator::calculate()
         }
     }
 
-    if (_algorithmType == AlgorithmType::Adler32) {
-        result = QByteArray::number(_adlerHash, 16);
-    } else {
-        Q_ASSERT(_cryptographicHash);
-        if (_cryptographicHash) {
-            result = _cryptographicHash->result().toHex();
-        }
-    }
+    result = this->result();
 
     {
         QMutexLocker locker(&_deviceMutex);
@@ -140,41 +158,109 @@ QByteArray ChecksumCalculator::calculate()
     return result;
 }
 
-void ChecksumCalculator::initChecksumAlgorithm()
+QByteArray ChecksumCalculator::result() const
 {
-    if (_algorithmType == AlgorithmType::Undefined) {
-        qCWarning(lcChecksumCalculator) << "_algorithmType is Undefined, impossible to init Checksum Algorithm";
-        return;
+    if (!_isInitialized) {
+        return {};
     }
-
-    if (_algorithmType == AlgorithmType::Adler32) {
-        _adlerHash = adler32(0L, Z_NULL, 0);
-    } else {
-        _cryptographicHash.reset(new QCryptographicHash(algorithmTypeToQCryptoHashAlgorithm(_algorithmType)));
+    switch (_algorithmType) {
+    case AlgorithmType::Adler32:
+        return QByteArray::number(_adlerHash, 16);
+    case AlgorithmType::CRC32C:
+        return QByteArray::number(_crc32c, 16).rightJustified(8, '0');
+    case AlgorithmType::XXH64:
+        return QByteArray::number(_xxHash->result(), 16).rightJustified(16, '0');
+    default:
+        break;
+    }
+    if (_openSslDigest) {
+        return _openSslDigest->result().toHex();
+    }
+    Q_ASSERT(_cryptographicHash);
+    if (_cryptographicHash) {
+        return _cryptographicHash->result().toHex();
     }
+    return {};
+}
 
-    _isInitialized = true;
+bool ChecksumCalculator::addData(const char *data, const qint64 size)
+{
+    if (!_isInitialized) {
+        return false;
+    }
+    switch (_algorithmType) {
+    case AlgorithmType::Adler32:
+        _adlerHash = ChecksumAlgorithms::adler32(_adlerHash, data, size);
+        _bytesHashed += size;
+        return true;
+    case AlgorithmType::CRC32C:
+        _crc32c = ChecksumAlgorithms::crc32c(_crc32c, data, size);
+        _bytesHashed += size;
+        return true;
+    case AlgorithmType::XXH64:
+        _xxHash->addData(data, size);
+        _bytesHashed += size;
+        return true;
+    default:
+        break;
+    }
+    if (_openSslDigest) {
+        _openSslDigest->addData(data, size);
+        _bytesHashed += size;
+        return true;
+    }
+    Q_ASSERT(_cryptographicHash);
+    if (_cryptographicHash) {
+        _cryptographicHash->addData(data, size);
+        _bytesHashed += size;
+        return true;
+    }
+    return false;
 }
 
-bool ChecksumCalculator::addChunk(const QByteArray &chunk, const qint64 size)
+void ChecksumCalculator::initChecksumAlgorithm(const QByteArray &checksumTypeName)
 {
-    Q_ASSERT(_algorithmType != AlgorithmType::Undefined);
+    if (checksumTypeName == checkSumMD5C) {
+        _algorithmType = AlgorithmType::MD5;
+    } else if (checksumTypeName == checkSumSHA1C) {
+        _algorithmType = AlgorithmType::SHA1;
+    } else if (checksumTypeName == checkSumSHA2C) {
+        _algorithmType = AlgorithmType::SHA256;
+    } else if (checksumTypeName == checkSumSHA3C) {
+        _algorithmType = AlgorithmType::SHA3_256;
+    } else if (checksumTypeName == checkSumAdlerC) {
+        _algorithmType = AlgorithmType::Adler32;
+    } else if (checksumTypeName == checkSumCrc32cC) {
+        _algorithmType = AlgorithmType::CRC32C;
+    } else if (checksumTypeName == checkSumXxh64C) {
+        _algorithmType = AlgorithmType::XXH64;
+    }
+
     if (_algorithmType == AlgorithmType::Undefined) {
-        qCWarning(lcChecksumCalculator) << "_algorithmType is Undefined, impossible to add a chunk!";
-        return false;
+        qCWarning(lcChecksumCalculator) << "_algorithmType is Undefined, impossible to init Checksum Algorithm";
+        return;
     }
 
-    if (_algorithmType == AlgorithmType::Adler32) {
-        _adlerHash = adler32(_adlerHash, (const Bytef *)chunk.data(), size);
-        return true;
-    } else {
-        Q_ASSERT(_cryptographicHash);
-        if (_cryptographicHash) {
-            _cryptographicHash->addData(chunk.data(), size);
-            return true;
+    switch (_algorithmType) {
+    case AlgorithmType::Adler32:
+        _adlerHash = 1;
+        break;
+    case AlgorithmType::CRC32C:
+        _crc32c = 0;
+        break;
+    case AlgorithmType::XXH64:
+        _xxHash = std::make_unique<ChecksumAlgorithms::XxHash64>();
+        break;
+    default:
+        _openSslDigest = std::make_unique<ChecksumAlgorithms::OpenSslDigest>(checksumTypeName);
+        if (!_openSslDigest->isValid()) {
+            _openSslDigest.reset();
+            _cryptographicHash.reset(new QCryptographicHash(algorithmTypeToQCryptoHashAlgorithm(_algorithmType)));
         }
+        break;
     }
-    return false;
+
+    _isInitialized = true;
 }
 
 }
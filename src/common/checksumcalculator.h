@@ -24,9 +24,17 @@
 #include <QMutex>
 #include <QScopedPointer>
 
+#include <memory>
+
 class QCryptographicHash;
 
 namespace OCC {
+
+namespace ChecksumAlgorithms {
+    class OpenSslDigest;
+    class XxHash64;
+}
+
 class OCSYNC_EXPORT ChecksumCalculator
 {
     Q_DISABLE_COPY(ChecksumCalculator)
@@ -39,19 +47,38 @@ public:
         SHA256,
         SHA3_256,
         Adler32,
+        CRC32C,
+        XXH64,
     };
 
     ChecksumCalculator(const QString &filePath, const QByteArray &checksumTypeName);
+    /// Creates a calculator that is fed with addData() instead of reading a file
+    explicit ChecksumCalculator(const QByteArray &checksumTypeName);
     ~ChecksumCalculator();
     [[nodiscard]] QByteArray calculate();
 
+    [[nodiscard]] bool isValid() const { return _isInitialized; }
+    bool addData(const char *data, const qint64 size);
+    /// The checksum of the data added so far
+    [[nodiscard]] QByteArray result() const;
+    /// Number of bytes hashed so far
+    [[nodiscard]] qint64 bytesHashed() const { return _bytesHashed; }
+
+    /// Stops a running calculate() and prevents a later one from reading the file
+    void cancel();
+
 private:
-    void initChecksumAlgorithm();
-    bool addChunk(const QByteArray &chunk, const qint64 size);
+    void initChecksumAlgorithm(const QByteArray &checksumTypeName);
     QScopedPointer<QIODevice> _device;
+    // OpenSSL is preferred for the cryptographic hashes, it uses the SHA extensions of the CPU
+    std::unique_ptr<ChecksumAlgorithms::OpenSslDigest> _openSslDigest;
     QScopedPointer<QCryptographicHash> _cryptographicHash;
+    std::unique_ptr<ChecksumAlgorithms::XxHash64> _xxHash;
     unsigned int _adlerHash = 0;
+    quint32 _crc32c = 0;
+    qint64 _bytesHashed = 0;
     bool _isInitialized = false;
+    bool _isCanceled = false;
     AlgorithmType _algorithmType = AlgorithmType::Undefined;
     QMutex _deviceMutex;
 };
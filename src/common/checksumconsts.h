@@ -25,4 +25,6 @@ static constexpr auto checkSumSHA1C = "SHA1";
 static constexpr auto checkSumSHA2C = "SHA256";
 static constexpr auto checkSumSHA3C = "SHA3-256";
 static constexpr auto checkSumAdlerC = "Adler32";
+static constexpr auto checkSumCrc32cC = "CRC32C";
+static constexpr auto checkSumXxh64C = "XXH64";
 }
@@ -18,11 +18,12 @@
 #include "config.h"
 #include "filesystembase.h"
 #include "common/checksums.h"
+#include "common/syncjournaldb.h"
 #include "checksumcalculator.h"
+#include "checksumthreadpool.h"
 #include "asserts.h"
 
 #include <QLoggingCategory>
-#include <qtconcurrentrun.h>
 #include <QCryptographicHash>
 
 #ifdef ZLIB_FOUND
@@ -77,12 +78,19 @@
  * Checksum Algorithms
  * -------------------
  *
- * - Adler32 (requires zlib)
+ * - Adler32 (requires zlib, vectorized with SSSE3 where available)
+ * - CRC32C (uses the CRC instructions of the CPU where available)
+ * - XXH64
  * - MD5
  * - SHA1
  * - SHA256
  * - SHA3-256 (requires Qt 5.9)
  *
+ * The cryptographic hashes are computed by OpenSSL if it provides them.
+ * CRC32C and XXH64 are only used if the server prefers them, see
+ * Capabilities::preferredUploadChecksumType(), or if they are forced
+ * with OWNCLOUD_CONTENT_CHECKSUM_TYPE.
+ *
  */
 
 namespace OCC {
@@ -128,6 +136,8 @@ QByteArray findBestChecksum(const QByteArray &_checksums)
         || -1 != (i = checksums.indexOf(QLatin1String("SHA256:"), 0, Qt::CaseInsensitive))
         || -1 != (i = checksums.indexOf(QLatin1String("SHA1:"), 0, Qt::CaseInsensitive))
         || -1 != (i = checksums.indexOf(QLatin1String("MD5:"), 0, Qt::CaseInsensitive))
+        || -1 != (i = checksums.indexOf(QLatin1String("XXH64:"), 0, Qt::CaseInsensitive))
+        || -1 != (i = checksums.indexOf(QLatin1String("CRC32C:"), 0, Qt::CaseInsensitive))
         || -1 != (i = checksums.indexOf(QLatin1String("ADLER32:"), 0, Qt::CaseInsensitive))) {
         // Now i is the start of the best checksum
         // Grab it until the next space or end of xml or end of string.
@@ -187,7 +197,12 @@ ComputeChecksum::ComputeChecksum(QObject *parent)
 {
 }
 
-ComputeChecksum::~ComputeChecksum() = default;
+ComputeChecksum::~ComputeChecksum()
+{
+    if (_checksumCalculator) {
+        _checksumCalculator->cancel();
+    }
+}
 
 void ComputeChecksum::setChecksumType(const QByteArray &type)
 {
@@ -199,8 +214,28 @@ QByteArray ComputeChecksum::checksumType() const
     return _checksumType;
 }
 
+void ComputeChecksum::setChecksumCache(SyncJournalDb *journal)
+{
+    _checksumCache = journal;
+}
+
 void ComputeChecksum::start(const QString &filePath)
 {
+    _filePath = filePath;
+    _checksumCacheKey = {};
+    if (_checksumCache && !_checksumType.isEmpty() && checksumComputationEnabled()) {
+        _checksumCacheKey = ChecksumCacheKey::fromFile(filePath);
+        const auto checksum = _checksumCache->getCachedChecksum(_checksumCacheKey, _checksumType);
+        if (!checksum.isEmpty()) {
+            qCInfo(lcChecksums) << "Using the cached" << checksumType() << "checksum of" << filePath;
+            // done() is always emitted from the event loop, like after a calculation
+            QMetaObject::invokeMethod(this, [this, checksum] {
+                emit done(_checksumType, checksum);
+            }, Qt::QueuedConnection);
+            return;
+        }
+    }
+
     qCInfo(lcChecksums) << "Computing" << checksumType() << "checksum of" << filePath << "in a thread";
     startImpl(filePath);
 }
@@ -211,32 +246,60 @@ void ComputeChecksum::startImpl(const QString &filePath)
         this, &ComputeChecksum::slotCalculationDone,
         Qt::UniqueConnection);
 
-    _checksumCalculator.reset(new ChecksumCalculator(filePath, _checksumType));
-    _watcher.setFuture(QtConcurrent::run([this]() {
-        return _checksumCalculator->calculate();
-    }));
+    if (_checksumCalculator) {
+        _checksumCalculator->cancel();
+    }
+    _checksumCalculator = std::make_shared<ChecksumCalculator>(filePath, _checksumType);
+    _watcher.setFuture(ChecksumThreadPool::instance()->run(filePath, _checksumCalculator));
 }
 
-QByteArray ComputeChecksum::computeNowOnFile(const QString &filePath, const QByteArray &checksumType)
+QByteArray ComputeChecksum::computeNowOnFile(const QString &filePath, const QByteArray &checksumType, SyncJournalDb *journal)
 {
-    return computeNow(filePath, checksumType);
+    return computeNow(filePath, checksumType, journal);
 }
 
-QByteArray ComputeChecksum::computeNow(const QString &filePath, const QByteArray &checksumType)
+QByteArray ComputeChecksum::computeNow(const QString &filePath, const QByteArray &checksumType, SyncJournalDb *journal)
 {
     if (!checksumComputationEnabled()) {
         qCWarning(lcChecksums) << "Checksum computation disabled by environment variable";
         return QByteArray();
     }
 
+    ChecksumCacheKey cacheKey;
+    if (journal && !checksumType.isEmpty()) {
+        cacheKey = ChecksumCacheKey::fromFile(filePath);
+        const auto checksum = journal->getCachedChecksum(cacheKey, checksumType);
+        if (!checksum.isEmpty()) {
+            return checksum;
+        }
+    }
+
     ChecksumCalculator checksumCalculator(filePath, checksumType);
-    return checksumCalculator.calculate();
+    const auto checksum = checksumCalculator.calculate();
+    storeInChecksumCache(journal, filePath, cacheKey, checksumType, checksum);
+    return checksum;
+}
+
+void ComputeChecksum::storeInChecksumCache(SyncJournalDb *journal, const QString &filePath,
+    const ChecksumCacheKey &keyBefore, const QByteArray &checksumType, const QByteArray &checksum)
+{
+    if (!journal || !keyBefore.isValid() || checksum.isEmpty()) {
+        return;
+    }
+    // A file that changed while it was read may have a checksum of neither version
+    const auto keyAfter = ChecksumCacheKey::fromFile(filePath);
+    if (!(keyAfter == keyBefore)) {
+        qCInfo(lcChecksums) << filePath << "changed during the checksum calculation, not caching the checksum";
+        return;
+    }
+    journal->setCachedChecksum(keyBefore, checksumType, checksum);
 }
 
 void ComputeChecksum::slotCalculationDone()
 {
     QByteArray checksum = _watcher.future().result();
     if (!checksum.isNull()) {
+        storeInChecksumCache(_checksumCache, _filePath, _checksumCacheKey, _checksumType, checksum);
         emit done(_checksumType, checksum);
     } else {
         emit done(QByteArray(), QByteArray());
@@ -25,6 +25,8 @@
 #include <QByteArray>
 #include <QFutureWatcher>
 
+#include "common/checksumcachekey.h"
+
 #include <memory>
 
 class QFile;
@@ -60,6 +62,8 @@ OCSYNC_EXPORT QByteArray calcSha256(const QByteArray &data);
 
 /**
  * Computes the checksum of a file.
+ *
+ * The computation runs in the ChecksumThreadPool.
  * \ingroup libsync
  */
 class OCSYNC_EXPORT ComputeChecksum : public QObject
@@ -76,6 +80,13 @@ public:
 
     QByteArray checksumType() const;
 
+    /**
+     * Looks up and stores the checksums in the checksum cache of journal.
+     *
+     * The default is no cache.
+     */
+    void setChecksumCache(SyncJournalDb *journal);
+
     /**
      * Computes the checksum for the given file path.
      *
@@ -84,14 +95,14 @@ public:
     void start(const QString &filePath);
 
     /**
-     * Computes the checksum synchronously.
+     * Computes the checksum synchronously, using the checksum cache of journal if it is set.
      */
-    static QByteArray computeNow(const QString &filePath, const QByteArray &checksumType);
+    static QByteArray computeNow(const QString &filePath, const QByteArray &checksumType, SyncJournalDb *journal = nullptr);
 
     /**
      * Computes the checksum synchronously on file. Convenience wrapper for computeNow().
      */
-    static QByteArray computeNowOnFile(const QString &filePath, const QByteArray &checksumType);
+    static QByteArray computeNowOnFile(const QString &filePath, const QByteArray &checksumType, SyncJournalDb *journal = nullptr);
 
 signals:
     void done(const QByteArray &checksumType, const QByteArray &checksum);
@@ -102,12 +113,21 @@ private slots:
 private:
     void startImpl(const QString &filePath);
 
+    // Stores the checksum if the file still has the key it had before the calculation
+    static void storeInChecksumCache(SyncJournalDb *journal, const QString &filePath,
+        const ChecksumCacheKey &keyBefore, const QByteArray &checksumType, const QByteArray &checksum);
+
     QByteArray _checksumType;
 
+    SyncJournalDb *_checksumCache = nullptr;
+    QString _filePath;
+    ChecksumCacheKey _checksumCacheKey; // of the file before the calculation
+
     // watcher for the checksum calculation thread
     QFutureWatcher<QByteArray> _watcher;
 
-    QScopedPointer<ChecksumCalculator> _checksumCalculator;
+    // shared with the thread, which may outlive this object
+    std::shared_ptr<ChecksumCalculator> _checksumCalculator;
 };
 
 /**
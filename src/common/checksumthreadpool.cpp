@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2026 by Nextcloud GmbH <info@nextcloud.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "common/checksumthreadpool.h"
+#include "common/checksumalgorithms.h"
+#include "common/checksumcalculator.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QLoggingCategory>
+#include <QThreadPool>
+#include <qtconcurrentrun.h>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+namespace OCC {
+
+Q_LOGGING_CATEGORY(lcChecksumThreadPool, "nextcloud.common.checksumthreadpool", QtInfoMsg)
+
+qint64 ChecksumThreadPool::Statistics::bytesPerSecond() const
+{
+    return hashingMsecs > 0 ? bytesHashed * 1000 / hashingMsecs : 0;
+}
+
+ChecksumThreadPool *ChecksumThreadPool::instance()
+{
+    static ChecksumThreadPool pool;
+    return &pool;
+}
+
+ChecksumThreadPool::ChecksumThreadPool()
+{
+    const auto threads = qEnvironmentVariableIntValue("OWNCLOUD_CHECKSUM_THREADS");
+    if (threads > 0) {
+        _maxThreadsPerDevice = threads;
+    }
+    qCInfo(lcChecksumThreadPool) << "Using the" << ChecksumAlgorithms::adler32Implementation() << "Adler32 and the"
+                                 << ChecksumAlgorithms::crc32cImplementation() << "CRC32C implementation";
+}
+
+ChecksumThreadPool::~ChecksumThreadPool()
+{
+    qDeleteAll(_threadPools);
+}
+
+int ChecksumThreadPool::maxThreadsPerDevice() const
+{
+    QMutexLocker locker(&_mutex);
+    return _maxThreadsPerDevice;
+}
+
+void ChecksumThreadPool::setMaxThreadsPerDevice(int count)
+{
+    QMutexLocker locker(&_mutex);
+    _maxThreadsPerDevice = qMax(1, count);
+    for (const auto threadPool : qAsConst(_threadPools)) {
+        threadPool->setMaxThreadCount(_maxThreadsPerDevice);
+    }
+}
+
+QByteArray ChecksumThreadPool::deviceKey(const QString &filePath)
+{
+#ifdef Q_OS_UNIX
+    struct stat statBuffer {};
+    if (::stat(QFile::encodeName(filePath).constData(), &statBuffer) != 0) {
+        return {};
+    }
+    return QByteArray::number(static_cast<quint64>(statBuffer.st_dev));
+#else
+    // The drive, or the share of a UNC path
+    const auto path = QDir::fromNativeSeparators(filePath);
+    if (path.startsWith(QLatin1String("//"))) {
+        const auto shareEnd = path.indexOf(QLatin1Char('/'), path.indexOf(QLatin1Char('/'), 2) + 1);
+        return path.left(shareEnd).toLower().toUtf8();
+    }
+    return path.section(QLatin1Char('/'), 0, 0).toLower().toUtf8();
+#endif
+}
+
+QThreadPool *ChecksumThreadPool::threadPool(const QByteArray &device)
+{
+    auto &threadPool = _threadPools[device];
+    if (!threadPool) {
+        threadPool = new QThreadPool;
+        threadPool->setMaxThreadCount(_maxThreadsPerDevice);
+    }
+    return threadPool;
+}
+
+QFuture<QByteArray> ChecksumThreadPool::run(const QString &filePath, const std::shared_ptr<ChecksumCalculator> &calculator)
+{
+    const auto device = deviceKey(filePath);
+
+    QMutexLocker locker(&_mutex);
+    ++_statistics.queued;
+    return QtConcurrent::run(threadPool(device), [this, device, calculator] {
+        computationStarted(device);
+        QElapsedTimer timer;
+        timer.start();
+        const auto checksum = calculator->calculate();
+        computationFinished(device, calculator->bytesHashed(), timer.elapsed());
+        return checksum;
+    });
+}
+
+void ChecksumThreadPool::computationStarted(const QByteArray &device)
+{
+    QMutexLocker locker(&_mutex);
+    --_statistics.queued;
+    ++_statistics.running;
+    const auto running = ++_runningPerDevice[device];
+    _statistics.peakRunningPerDevice = qMax(_statistics.peakRunningPerDevice, running);
+}
+
+void ChecksumThreadPool::computationFinished(const QByteArray &device, qint64 bytes, qint64 msecs)
+{
+    QMutexLocker locker(&_mutex);
+    --_statistics.running;
+    if (--_runningPerDevice[device] == 0) {
+        _runningPerDevice.remove(device);
+    }
+    ++_statistics.filesHashed;
+    _statistics.bytesHashed += bytes;
+    _statistics.hashingMsecs += msecs;
+
+    if (_statistics.queued == 0 && _statistics.running == 0) {
+        qCInfo(lcChecksumThreadPool) << "Checksum queue drained, hashed" << _statistics.filesHashed << "files,"
+                                     << _statistics.bytesHashed << "bytes at" << _statistics.bytesPerSecond() << "bytes/s per thread";
+    } else {
+        qCDebug(lcChecksumThreadPool) << "Hashed" << bytes << "bytes in" << msecs << "ms," << _statistics.queued << "queued,"
+                                      << _statistics.running << "running";
+    }
+}
+
+ChecksumThreadPool::Statistics ChecksumThreadPool::statistics() const
+{
+    QMutexLocker locker(&_mutex);
+    return _statistics;
+}
+
+}
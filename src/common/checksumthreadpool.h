@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2026 by Nextcloud GmbH <info@nextcloud.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#pragma once
+
+#include "ocsynclib.h"
+
+#include <QByteArray>
+#include <QFuture>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+#include <memory>
+
+class QThreadPool;
+
+namespace OCC {
+
+class ChecksumCalculator;
+
+/**
+ * @brief Runs the checksum computations of ComputeChecksum
+ *
+ * Every storage device gets its own thread pool of maxThreadsPerDevice()
+ * threads, so many changed files don't make dozens of readers compete for
+ * one disk while files on other devices are hashed independently. Further
+ * computations wait in the queue of their device.
+ *
+ * @ingroup libsync
+ */
+class OCSYNC_EXPORT ChecksumThreadPool
+{
+public:
+    struct Statistics
+    {
+        int queued = 0; /// computations waiting for a thread
+        int running = 0; /// computations in progress
+        int peakRunningPerDevice = 0; /// highest number of concurrent computations on one device
+        qint64 filesHashed = 0;
+        qint64 bytesHashed = 0;
+        qint64 hashingMsecs = 0; /// summed up duration of the computations
+
+        /** Average throughput of a single computation. */
+        [[nodiscard]] qint64 bytesPerSecond() const;
+    };
+
+    static ChecksumThreadPool *instance();
+
+    ~ChecksumThreadPool();
+
+    /** Number of files of one storage device that are hashed at the same time.
+     *
+     * Defaults to OWNCLOUD_CHECKSUM_THREADS or 2. Changes apply to all devices.
+     */
+    [[nodiscard]] int maxThreadsPerDevice() const;
+    void setMaxThreadsPerDevice(int count);
+
+    /** Runs calculator->calculate() in the pool of the device of filePath. */
+    QFuture<QByteArray> run(const QString &filePath, const std::shared_ptr<ChecksumCalculator> &calculator);
+
+    [[nodiscard]] Statistics statistics() const;
+
+    /** Identifies the storage device of filePath, empty if unknown. */
+    static QByteArray deviceKey(const QString &filePath);
+
+private:
+    ChecksumThreadPool();
+
+    QThreadPool *threadPool(const QByteArray &device);
+    void computationStarted(const QByteArray &device);
+    void computationFinished(const QByteArray &device, qint64 bytes, qint64 msecs);
+
+    mutable QMutex _mutex;
+    QHash<QByteArray, QThreadPool *> _threadPools;
+    QHash<QByteArray, int> _runningPerDevice;
+    int _maxThreadsPerDevice = 2;
+    Statistics _statistics;
+};
+
+}
@@ -3,12 +3,16 @@
 # help keep track of the different code licenses.
 set(common_SOURCES
     ${CMAKE_CURRENT_LIST_DIR}/checksums.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/checksumcachekey.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/checksumalgorithms.cpp
     ${CMAKE_CURRENT_LIST_DIR}/checksumcalculator.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/checksumthreadpool.cpp
     ${CMAKE_CURRENT_LIST_DIR}/filesystembase.cpp
     ${CMAKE_CURRENT_LIST_DIR}/ownsql.cpp
     ${CMAKE_CURRENT_LIST_DIR}/preparedsqlquerymanager.cpp
     ${CMAKE_CURRENT_LIST_DIR}/syncjournaldb.cpp
     ${CMAKE_CURRENT_LIST_DIR}/syncjournalfilerecord.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/syncjournalsnapshot.cpp
     ${CMAKE_CURRENT_LIST_DIR}/utility.cpp
     ${CMAKE_CURRENT_LIST_DIR}/remotepermissions.cpp
     ${CMAKE_CURRENT_LIST_DIR}/vfs.cpp
@@ -108,6 +108,8 @@ public:
         GetE2EeLockedFoldersQuery,
         DeleteE2EeLockedFolderQuery,
         ListAllTopLevelE2eeFoldersStatusLessThanQuery,
+        GetChecksumCacheQuery,
+        SetChecksumCacheQuery,
 
         PreparedQueryCount
     };
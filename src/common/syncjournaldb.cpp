@@ -24,9 +24,12 @@
 #include <QUrl>
 #include <QDir>
 #include <sqlite3.h>
+#include <algorithm>
 #include <cstring>
+#include <iterator>
 
 #include "common/syncjournaldb.h"
+#include "common/syncjournalsnapshot.h"
 #include "version.h"
 #include "filesystembase.h"
 #include "common/asserts.h"
@@ -79,6 +82,20 @@ static void fillFileRecordFromGetQuery(SyncJournalFileRecord &rec, SqlQuery &que
     rec._sharedByMe = query.intValue(21) > 0;
 }
 
+// What "UPDATE metadata SET md5='_invalid_' WHERE type == 2" does to a record
+static void invalidateDirectoryEtag(SyncJournalFileRecord &record)
+{
+    if (record._type == ItemTypeDirectory) {
+        record._etag = QByteArrayLiteral("_invalid_");
+    }
+}
+
+// Whether path is directory or below it, everything is below the root ""
+static bool isPathOrBelow(const QByteArray &path, const QByteArray &directory)
+{
+    return directory.isEmpty() || path == directory || (path.startsWith(directory) && path.at(directory.size()) == '/');
+}
+
 static QByteArray defaultJournalMode(const QString &dbPath)
 {
 #if defined(Q_OS_WIN)
@@ -452,6 +469,8 @@ bool SyncJournalDb::checkConnect()
                         "tmpfile VARCHAR(4096),"
                         "etag VARCHAR(32),"
                         "errorcount INTEGER,"
+                        "segmented INTEGER,"
+                        "completedRanges TEXT,"
                         "PRIMARY KEY(path)"
                         ");");
 
@@ -516,6 +535,20 @@ bool SyncJournalDb::checkConnect()
         return sqlFail(QStringLiteral("Create table checksumtype"), createQuery);
     }
 
+    // create the checksumcache table.
+    createQuery.prepare("CREATE TABLE IF NOT EXISTS checksumcache("
+                        "inode INTEGER,"
+                        "checksumTypeId INTEGER,"
+                        "size INTEGER,"
+                        "modtime INTEGER,"
+                        "ctime INTEGER,"
+                        "checksum TEXT,"
+                        "PRIMARY KEY(inode, checksumTypeId)"
+                        ");");
+    if (!createQuery.exec()) {
+        return sqlFail(QStringLiteral("Create table checksumcache"), createQuery);
+    }
+
     // create the datafingerprint table.
     createQuery.prepare("CREATE TABLE IF NOT EXISTS datafingerprint("
                         "fingerprint TEXT UNIQUE"
@@ -689,6 +722,7 @@ bool SyncJournalDb::checkConnect()
 void SyncJournalDb::close()
 {
     QMutexLocker locker(&_mutex);
+    applyQueuedWrites();
     qCInfo(lcDb) << "Closing DB" << _dbFile;
 
     commitTransaction();
@@ -696,6 +730,223 @@ void SyncJournalDb::close()
     _db.close();
     clearEtagStorageFilter();
     _metadataTableIsEmpty = false;
+    _metadataSnapshot.reset();
+}
+
+void SyncJournalDb::setMetadataSnapshotEnabled(bool enabled)
+{
+    QMutexLocker locker(&_mutex);
+    _metadataSnapshotEnabled = enabled;
+    if (!enabled) {
+        _metadataSnapshot.reset();
+    }
+}
+
+SyncJournalSnapshot *SyncJournalDb::metadataSnapshot()
+{
+    if (!_metadataSnapshotEnabled || _metadataSnapshot) {
+        return _metadataSnapshot.get();
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    SqlQuery query(_db);
+    query.prepare(GET_FILE_RECORD_QUERY);
+    if (!query.exec()) {
+        qCWarning(lcDb) << "Could not read the metadata table, not using a snapshot:" << query.error();
+        return nullptr;
+    }
+
+    auto snapshot = std::make_unique<SyncJournalSnapshot>();
+    forever {
+        const auto next = query.next();
+        if (!next.ok) {
+            qCWarning(lcDb) << "Could not read the metadata table, not using a snapshot:" << query.error();
+            return nullptr;
+        }
+        if (!next.hasData) {
+            break;
+        }
+        SyncJournalFileRecord rec;
+        fillFileRecordFromGetQuery(rec, query);
+        snapshot->insert(rec);
+    }
+
+    qCInfo(lcDb) << "Loaded metadata snapshot of" << snapshot->size() << "records in" << timer.elapsed() << "ms,"
+                 << "using about" << snapshot->memoryUsage() / 1024 << "KiB";
+    _metadataSnapshot = std::move(snapshot);
+    return _metadataSnapshot.get();
+}
+
+Result<void, QString> SyncJournalDb::setWriteBehindEnabled(bool enabled)
+{
+    if (enabled == _writeBehindEnabled) {
+        return {};
+    }
+
+    if (enabled) {
+        {
+            QMutexLocker queueLocker(&_writeQueueMutex);
+            _stopWriter = false;
+            _writeBehindErrors.clear();
+        }
+        _writerThread.reset(QThread::create([this] { writerThreadLoop(); }));
+        _writerThread->setObjectName(QStringLiteral("SyncJournalDb writer"));
+        _writerThread->start();
+        _writeBehindEnabled = true;
+        qCInfo(lcDb) << "Write-behind enabled for" << _dbFile;
+        return {};
+    }
+
+    _writeBehindEnabled = false;
+    {
+        QMutexLocker queueLocker(&_writeQueueMutex);
+        _stopWriter = true;
+        _writeQueueChanged.wakeAll();
+    }
+    _writerThread->wait();
+    _writerThread.reset();
+
+    // Writes that raced with the shutdown of the writer
+    QMutexLocker locker(&_mutex);
+    applyQueuedWrites();
+    qCInfo(lcDb) << "Write-behind disabled for" << _dbFile;
+
+    QMutexLocker queueLocker(&_writeQueueMutex);
+    if (const auto errors = std::exchange(_writeBehindErrors, {}); !errors.isEmpty()) {
+        // The first failures name their records, the rest is only counted
+        constexpr auto maximumReportedErrors = 3;
+        auto error = errors.mid(0, maximumReportedErrors).join(QStringLiteral("; "));
+        if (errors.size() > maximumReportedErrors) {
+            error += QStringLiteral(" (and %1 more)").arg(errors.size() - maximumReportedErrors);
+        }
+        return error;
+    }
+    return {};
+}
+
+void SyncJournalDb::queueWrite(QueuedWrite::Type type, const SyncJournalFileRecord &record)
+{
+    constexpr size_t maximumQueuedWrites = 10000;
+
+    QMutexLocker queueLocker(&_writeQueueMutex);
+    if (_writeQueue.size() >= maximumQueuedWrites) {
+        // The writer does not keep up: apply a batch on this thread. The queue
+        // mutex is always taken after _mutex, so release it first.
+        queueLocker.unlock();
+        {
+            QMutexLocker locker(&_mutex);
+            applyQueuedWrites(static_cast<int>(maximumQueuedWrites / 2));
+        }
+        queueLocker.relock();
+    }
+
+    const auto sequence = ++_writeSequence;
+    _queuedRecords.insert(getPHash(record._path), {type, record, sequence});
+    _writeQueue.push_back({type, record, sequence});
+    _writeQueueChanged.wakeOne();
+}
+
+void SyncJournalDb::applyQueuedWrites(int maximum)
+{
+    if (_applyingQueuedWrites) {
+        return;
+    }
+
+    std::vector<QueuedWrite> batch;
+    {
+        QMutexLocker queueLocker(&_writeQueueMutex);
+        const auto count = maximum < 0 ? _writeQueue.size() : qMin(_writeQueue.size(), static_cast<size_t>(maximum));
+        batch.reserve(count);
+        std::move(_writeQueue.begin(), _writeQueue.begin() + count, std::back_inserter(batch));
+        _writeQueue.erase(_writeQueue.begin(), _writeQueue.begin() + count);
+    }
+    if (batch.empty()) {
+        return;
+    }
+
+    // The batch is committed in a transaction of its own. One the sync thread
+    // has open is committed before and started again after it.
+    _applyingQueuedWrites = true;
+    const auto connected = checkConnect();
+    const auto restartTransaction = connected && _transaction == 1;
+    if (restartTransaction) {
+        commitTransaction();
+    }
+    if (connected) {
+        startTransaction();
+    }
+
+    QStringList errors;
+    for (const auto &write : batch) {
+        const auto path = QString::fromUtf8(write._record._path);
+        if (write._type == QueuedWrite::SetRecord) {
+            if (const auto result = setFileRecordInternal(write._record); !result) {
+                errors.append(QStringLiteral("Failed to write the record of %1: %2").arg(path, result.error()));
+            }
+        } else if (!deleteFileRecordInternal(path, false)) {
+            errors.append(QStringLiteral("Failed to delete the record of %1").arg(path));
+        }
+    }
+
+    if (connected) {
+        commitTransaction();
+    }
+    if (restartTransaction) {
+        startTransaction();
+    }
+    _applyingQueuedWrites = false;
+
+    QMutexLocker queueLocker(&_writeQueueMutex);
+    for (const auto &write : batch) {
+        const auto phash = getPHash(write._record._path);
+        const auto it = _queuedRecords.constFind(phash);
+        if (it != _queuedRecords.constEnd() && it->_sequence == write._sequence) {
+            _queuedRecords.erase(it);
+        }
+    }
+    for (const auto &error : qAsConst(errors)) {
+        qCWarning(lcDb) << "Write-behind change failed:" << error;
+    }
+    _writeBehindErrors.append(errors);
+}
+
+void SyncJournalDb::applyQueuedWritesIf(const std::function<bool(const QueuedWrite &)> &matches)
+{
+    {
+        QMutexLocker queueLocker(&_writeQueueMutex);
+        if (std::none_of(_queuedRecords.cbegin(), _queuedRecords.cend(), matches)) {
+            return;
+        }
+    }
+    applyQueuedWrites();
+}
+
+bool SyncJournalDb::isWriteQueued(const QByteArray &path)
+{
+    QMutexLocker queueLocker(&_writeQueueMutex);
+    return _queuedRecords.contains(getPHash(path));
+}
+
+void SyncJournalDb::writerThreadLoop()
+{
+    constexpr int maximumBatchSize = 500;
+
+    forever {
+        {
+            QMutexLocker queueLocker(&_writeQueueMutex);
+            while (_writeQueue.empty() && !_stopWriter) {
+                _writeQueueChanged.wait(&_writeQueueMutex);
+            }
+            if (_writeQueue.empty()) {
+                return;
+            }
+        }
+
+        QMutexLocker locker(&_mutex);
+        applyQueuedWrites(maximumBatchSize);
+    }
 }
 
 
@@ -797,6 +1048,24 @@ bool SyncJournalDb::updateMetadataTableStructure()
         commitInternal(QStringLiteral("update database structure: add contentChecksum col for uploadinfo"));
     }
 
+    auto downloadInfoColumns = tableColumns("downloadinfo");
+    if (downloadInfoColumns.isEmpty())
+        return false;
+    if (!downloadInfoColumns.contains("segmented")) {
+        SqlQuery query(_db);
+        query.prepare("ALTER TABLE downloadinfo ADD COLUMN segmented INTEGER;");
+        if (!query.exec()) {
+            sqlFail(QStringLiteral("updateMetadataTableStructure: add segmented column"), query);
+            re = false;
+        }
+        query.prepare("ALTER TABLE downloadinfo ADD COLUMN completedRanges TEXT;");
+        if (!query.exec()) {
+            sqlFail(QStringLiteral("updateMetadataTableStructure: add completedRanges column"), query);
+            re = false;
+        }
+        commitInternal(QStringLiteral("update database structure: add segment cols for downloadinfo"));
+    }
+
     auto conflictsColumns = tableColumns("conflicts");
     if (conflictsColumns.isEmpty())
         return false;
@@ -934,9 +1203,21 @@ qint64 SyncJournalDb::getPHash(const QByteArray &file)
 
 Result<void, QString> SyncJournalDb::setFileRecord(const SyncJournalFileRecord &_record)
 {
-    SyncJournalFileRecord record = _record;
-    QMutexLocker locker(&_mutex);
+    if (_writeBehindEnabled) {
+        SyncJournalFileRecord record = _record;
+        {
+            QMutexLocker locker(&_mutex);
+            applyEtagStorageFilter(record);
+        }
+        queueWrite(QueuedWrite::SetRecord, record);
+        return {};
+    }
 
+    return setFileRecordInternal(_record);
+}
+
+void SyncJournalDb::applyEtagStorageFilter(SyncJournalFileRecord &record) const
+{
     if (!_etagStorageFilter.isEmpty()) {
         // If we are a directory that should not be read from db next time, don't write the etag
         QByteArray prefix = record._path + "/";
@@ -948,6 +1229,14 @@ Result<void, QString> SyncJournalDb::setFileRecord(const SyncJournalFileRecord &
             }
         }
     }
+}
+
+Result<void, QString> SyncJournalDb::setFileRecordInternal(const SyncJournalFileRecord &_record)
+{
+    SyncJournalFileRecord record = _record;
+    QMutexLocker locker(&_mutex);
+
+    applyEtagStorageFilter(record);
 
     qCInfo(lcDb) << "Updating file record for path:" << record.path() << "inode:" << record._inode
                  << "modtime:" << record._modtime << "type:" << record._type << "etag:" << record._etag
@@ -1032,6 +1321,10 @@ Result<void, QString> SyncJournalDb::setFileRecord(const SyncJournalFileRecord &
     // Can't be true anymore.
     _metadataTableIsEmpty = false;
 
+    if (_metadataSnapshot) {
+        _metadataSnapshot->insert(record);
+    }
+
     return {};
 }
 
@@ -1074,6 +1367,9 @@ bool SyncJournalDb::getRootE2eFolderRecord(const QString &remoteFolderPath, Sync
 bool SyncJournalDb::listAllE2eeFoldersWithEncryptionStatusLessThan(const int status, const std::function<void(const SyncJournalFileRecord &)> &rowCallback)
 {
     QMutexLocker locker(&_mutex);
+    applyQueuedWritesIf([](const QueuedWrite &write) {
+        return write._type == QueuedWrite::SetRecord && write._record.isDirectory() && write._record.isE2eEncrypted();
+    });
 
     if (_metadataTableIsEmpty)
         return true;
@@ -1095,6 +1391,7 @@ bool SyncJournalDb::listAllE2eeFoldersWithEncryptionStatusLessThan(const int sta
         return false;
     }
 
+    std::vector<SyncJournalFileRecord> records;
     forever {
         auto next = query->next();
         if (!next.ok) {
@@ -1113,7 +1410,16 @@ bool SyncJournalDb::listAllE2eeFoldersWithEncryptionStatusLessThan(const int sta
             continue;
         }
 
-        rowCallback(rec);
+        records.push_back(rec);
+    }
+
+    if (std::any_of(records.cbegin(), records.cend(), [this](const SyncJournalFileRecord &record) { return isWriteQueued(record._path); })) {
+        // One of the folders found is about to change, look again once it is written
+        applyQueuedWrites();
+        return listAllE2eeFoldersWithEncryptionStatusLessThan(status, rowCallback);
+    }
+    for (const auto &record : records) {
+        rowCallback(record);
     }
 
     return true;
@@ -1191,6 +1497,31 @@ qint64 SyncJournalDb::keyValueStoreGetInt(const QString &key, qint64 defaultValu
     return query->int64Value(0);
 }
 
+QByteArray SyncJournalDb::keyValueStoreGetByteArray(const QString &key, const QByteArray &defaultValue)
+{
+    QMutexLocker locker(&_mutex);
+    if (!checkConnect()) {
+        return defaultValue;
+    }
+
+    const auto query = _queryManager.get(PreparedSqlQueryManager::GetKeyValueStoreQuery, QByteArrayLiteral("SELECT value FROM key_value_store WHERE key=?1"), _db);
+    if (!query) {
+        qCDebug(lcDb) << "database error:" << query->error();
+        return defaultValue;
+    }
+
+    query->bindValue(1, key);
+    query->exec();
+    auto result = query->next();
+
+    if (!result.ok || !result.hasData) {
+        qCDebug(lcDb) << "database error:" << query->error();
+        return defaultValue;
+    }
+
+    return query->baValue(0);
+}
+
 void SyncJournalDb::keyValueStoreDelete(const QString &key)
 {
     const auto query = _queryManager.get(PreparedSqlQueryManager::DeleteKeyValueStoreQuery, QByteArrayLiteral("DELETE FROM key_value_store WHERE key=?1;"), _db);
@@ -1209,6 +1540,23 @@ void SyncJournalDb::keyValueStoreDelete(const QString &key)
 
 // TODO: filename -> QBytearray?
 bool SyncJournalDb::deleteFileRecord(const QString &filename, bool recursively)
+{
+    if (_writeBehindEnabled && !recursively) {
+        SyncJournalFileRecord record;
+        record._path = filename.toUtf8();
+        queueWrite(QueuedWrite::DeleteRecord, record);
+        return true;
+    }
+
+    QMutexLocker locker(&_mutex);
+    const auto path = filename.toUtf8();
+    applyQueuedWritesIf([&path, recursively](const QueuedWrite &write) {
+        return recursively ? isPathOrBelow(write._record._path, path) : write._record._path == path;
+    });
+    return deleteFileRecordInternal(filename, recursively);
+}
+
+bool SyncJournalDb::deleteFileRecordInternal(const QString &filename, bool recursively)
 {
     QMutexLocker locker(&_mutex);
 
@@ -1245,6 +1593,10 @@ bool SyncJournalDb::deleteFileRecord(const QString &filename, bool recursively)
                 return false;
             }
         }
+
+        if (_metadataSnapshot) {
+            _metadataSnapshot->remove(filename.toUtf8(), recursively);
+        }
         return true;
     } else {
         qCWarning(lcDb) << "Failed to connect database.";
@@ -1255,13 +1607,25 @@ bool SyncJournalDb::deleteFileRecord(const QString &filename, bool recursively)
 
 bool SyncJournalDb::getFileRecord(const QByteArray &filename, SyncJournalFileRecord *rec)
 {
-    QMutexLocker locker(&_mutex);
-
     // Reset the output var in case the caller is reusing it.
     Q_ASSERT(rec);
     rec->_path.clear();
     Q_ASSERT(!rec->isValid());
 
+    if (_writeBehindEnabled && !filename.isEmpty()) {
+        // Read your own writes: a queued change wins over the database
+        QMutexLocker queueLocker(&_writeQueueMutex);
+        const auto it = _queuedRecords.constFind(getPHash(filename));
+        if (it != _queuedRecords.constEnd()) {
+            if (it->_type == QueuedWrite::SetRecord) {
+                *rec = it->_record;
+            }
+            return true;
+        }
+    }
+
+    QMutexLocker locker(&_mutex);
+
     if (_metadataTableIsEmpty) {
         return true; // no error, yet nothing found (rec->isValid() == false)
     }
@@ -1270,6 +1634,11 @@ bool SyncJournalDb::getFileRecord(const QByteArray &filename, SyncJournalFileRec
         return false;
     }
 
+    if (const auto snapshot = metadataSnapshot()) {
+        *rec = snapshot->find(filename);
+        return true;
+    }
+
     if (!filename.isEmpty()) {
         const auto query = _queryManager.get(PreparedSqlQueryManager::GetFileRecordQuery, QByteArrayLiteral(GET_FILE_RECORD_QUERY " WHERE phash=?1"), _db);
         if (!query) {
@@ -1302,6 +1671,10 @@ bool SyncJournalDb::getFileRecord(const QByteArray &filename, SyncJournalFileRec
 bool SyncJournalDb::getFileRecordByE2eMangledName(const QString &mangledName, SyncJournalFileRecord *rec)
 {
     QMutexLocker locker(&_mutex);
+    // A queued change may give the mangled name to a record
+    applyQueuedWritesIf([mangledNameUtf8 = mangledName.toUtf8()](const QueuedWrite &write) {
+        return write._type == QueuedWrite::SetRecord && write._record._e2eMangledName == mangledNameUtf8;
+    });
 
     // Reset the output var in case the caller is reusing it.
     Q_ASSERT(rec);
@@ -1342,12 +1715,21 @@ bool SyncJournalDb::getFileRecordByE2eMangledName(const QString &mangledName, Sy
             fillFileRecordFromGetQuery(*rec, *query);
         }
     }
+    if (rec->isValid() && isWriteQueued(rec->_path)) {
+        // The record found is about to change, look again once it is written
+        applyQueuedWrites();
+        return getFileRecordByE2eMangledName(mangledName, rec);
+    }
     return true;
 }
 
 bool SyncJournalDb::getFileRecordByInode(quint64 inode, SyncJournalFileRecord *rec)
 {
     QMutexLocker locker(&_mutex);
+    // A queued change may give the inode to a record
+    applyQueuedWritesIf([inode](const QueuedWrite &write) {
+        return write._type == QueuedWrite::SetRecord && write._record._inode == inode;
+    });
 
     // Reset the output var in case the caller is reusing it.
     Q_ASSERT(rec);
@@ -1362,6 +1744,20 @@ bool SyncJournalDb::getFileRecordByInode(quint64 inode, SyncJournalFileRecord *r
         return false;
     }
 
+    // The record found is about to change, look again once it is written
+    const auto lookAgainIfQueued = [this, inode, rec] {
+        if (rec->isValid() && isWriteQueued(rec->_path)) {
+            applyQueuedWrites();
+            return getFileRecordByInode(inode, rec);
+        }
+        return true;
+    };
+
+    if (const auto snapshot = metadataSnapshot()) {
+        *rec = snapshot->findByInode(inode);
+        return lookAgainIfQueued();
+    }
+
     const auto query = _queryManager.get(PreparedSqlQueryManager::GetFileRecordQueryByInode, QByteArrayLiteral(GET_FILE_RECORD_QUERY " WHERE inode=?1"), _db);
     if (!query) {
         qCDebug(lcDb) << "database error:" << query->error();
@@ -1384,12 +1780,16 @@ bool SyncJournalDb::getFileRecordByInode(quint64 inode, SyncJournalFileRecord *r
         fillFileRecordFromGetQuery(*rec, *query);
     }
 
-    return true;
+    return lookAgainIfQueued();
 }
 
 bool SyncJournalDb::getFileRecordsByFileId(const QByteArray &fileId, const std::function<void(const SyncJournalFileRecord &)> &rowCallback)
 {
     QMutexLocker locker(&_mutex);
+    // A queued change may give the file id to a record
+    applyQueuedWritesIf([&fileId](const QueuedWrite &write) {
+        return write._type == QueuedWrite::SetRecord && write._record._fileId == fileId;
+    });
 
     if (fileId.isEmpty() || _metadataTableIsEmpty) {
         return true; // no error, yet nothing found (rec->isValid() == false)
@@ -1399,33 +1799,47 @@ bool SyncJournalDb::getFileRecordsByFileId(const QByteArray &fileId, const std::
         return false;
     }
 
-    const auto query = _queryManager.get(PreparedSqlQueryManager::GetFileRecordQueryByFileId, QByteArrayLiteral(GET_FILE_RECORD_QUERY " WHERE fileid=?1"), _db);
-    if (!query) {
-        qCDebug(lcDb) << "database error:" << query->error();
-        return false;
-    }
+    std::vector<SyncJournalFileRecord> records;
+    if (const auto snapshot = metadataSnapshot()) {
+        records = snapshot->findByFileId(fileId);
+    } else {
+        const auto query = _queryManager.get(PreparedSqlQueryManager::GetFileRecordQueryByFileId, QByteArrayLiteral(GET_FILE_RECORD_QUERY " WHERE fileid=?1"), _db);
+        if (!query) {
+            qCDebug(lcDb) << "database error:" << query->error();
+            return false;
+        }
 
-    query->bindValue(1, fileId);
+        query->bindValue(1, fileId);
 
-    if (!query->exec()) {
-        qCDebug(lcDb) << "database error:" << query->error();
-        return false;
-    }
-
-    forever {
-        auto next = query->next();
-        if (!next.ok) {
+        if (!query->exec()) {
             qCDebug(lcDb) << "database error:" << query->error();
             return false;
         }
 
-        if (!next.hasData) {
-            break;
+        forever {
+            auto next = query->next();
+            if (!next.ok) {
+                qCDebug(lcDb) << "database error:" << query->error();
+                return false;
+            }
+
+            if (!next.hasData) {
+                break;
+            }
+
+            SyncJournalFileRecord rec;
+            fillFileRecordFromGetQuery(rec, *query);
+            records.push_back(rec);
         }
+    }
 
-        SyncJournalFileRecord rec;
-        fillFileRecordFromGetQuery(rec, *query);
-        rowCallback(rec);
+    if (std::any_of(records.cbegin(), records.cend(), [this](const SyncJournalFileRecord &record) { return isWriteQueued(record._path); })) {
+        // One of the records found is about to change, look again once it is written
+        applyQueuedWrites();
+        return getFileRecordsByFileId(fileId, rowCallback);
+    }
+    for (const auto &record : records) {
+        rowCallback(record);
     }
 
     return true;
@@ -1434,6 +1848,9 @@ bool SyncJournalDb::getFileRecordsByFileId(const QByteArray &fileId, const std::
 bool SyncJournalDb::getFilesBelowPath(const QByteArray &path, const std::function<void(const SyncJournalFileRecord&)> &rowCallback)
 {
     QMutexLocker locker(&_mutex);
+    applyQueuedWritesIf([&path](const QueuedWrite &write) {
+        return isPathOrBelow(write._record._path, path) || isPathOrBelow(write._record._e2eMangledName, path);
+    });
 
     if (_metadataTableIsEmpty)
         return true; // no error, yet nothing found
@@ -1501,6 +1918,10 @@ bool SyncJournalDb::listFilesInPath(const QByteArray& path,
                                     const std::function<void (const SyncJournalFileRecord &)>& rowCallback)
 {
     QMutexLocker locker(&_mutex);
+    applyQueuedWritesIf([&path](const QueuedWrite &write) {
+        const auto slash = write._record._path.lastIndexOf('/');
+        return (slash < 0 ? QByteArray() : write._record._path.left(slash)) == path;
+    });
 
     if (_metadataTableIsEmpty) {
         return true;
@@ -1510,6 +1931,13 @@ bool SyncJournalDb::listFilesInPath(const QByteArray& path,
         return false;
     }
 
+    if (const auto snapshot = metadataSnapshot()) {
+        for (const auto &record : snapshot->listFilesInPath(path)) {
+            rowCallback(record);
+        }
+        return true;
+    }
+
     const auto query = _queryManager.get(PreparedSqlQueryManager::ListFilesInPathQuery, QByteArrayLiteral(GET_FILE_RECORD_QUERY " WHERE parent_hash(path) = ?1 ORDER BY path||'/' ASC"), _db);
     if (!query) {
         qCDebug(lcDb) << "database error:" << query->error();
@@ -1548,6 +1976,7 @@ bool SyncJournalDb::listFilesInPath(const QByteArray& path,
 int SyncJournalDb::getFileRecordCount()
 {
     QMutexLocker locker(&_mutex);
+    applyQueuedWrites();
 
     SqlQuery query(_db);
     query.prepare("SELECT COUNT(*) FROM metadata");
@@ -1569,6 +1998,9 @@ bool SyncJournalDb::updateFileRecordChecksum(const QString &filename,
     const QByteArray &contentChecksumType)
 {
     QMutexLocker locker(&_mutex);
+    if (isWriteQueued(filename.toUtf8())) {
+        applyQueuedWrites();
+    }
 
     qCInfo(lcDb) << "Updating file checksum" << filename << contentChecksum << contentChecksumType;
 
@@ -1596,6 +2028,14 @@ bool SyncJournalDb::updateFileRecordChecksum(const QString &filename,
         return false;
     }
 
+    if (_metadataSnapshot) {
+        auto record = _metadataSnapshot->find(filename.toUtf8());
+        if (record.isValid()) {
+            record._checksumHeader = makeChecksumHeader(contentChecksumType, contentChecksum);
+            _metadataSnapshot->insert(record);
+        }
+    }
+
     return true;
 }
 
@@ -1604,6 +2044,9 @@ bool SyncJournalDb::updateLocalMetadata(const QString &filename,
 
 {
     QMutexLocker locker(&_mutex);
+    if (isWriteQueued(filename.toUtf8())) {
+        applyQueuedWrites();
+    }
 
     qCInfo(lcDb) << "Updating local metadata for:" << filename << modtime << size << inode;
 
@@ -1639,12 +2082,24 @@ bool SyncJournalDb::updateLocalMetadata(const QString &filename,
         qCDebug(lcDb) << "database error:" << query->error();
         return false;
     }
+
+    if (_metadataSnapshot) {
+        auto record = _metadataSnapshot->find(filename.toUtf8());
+        if (record.isValid()) {
+            record._inode = inode;
+            record._modtime = modtime;
+            record._fileSize = size;
+            record._lockstate = lockInfo;
+            _metadataSnapshot->insert(record);
+        }
+    }
     return true;
 }
 
 Optional<SyncJournalDb::HasHydratedDehydrated> SyncJournalDb::hasHydratedOrDehydratedFiles(const QByteArray &filename)
 {
     QMutexLocker locker(&_mutex);
+    applyQueuedWritesIf([&filename](const QueuedWrite &write) { return isPathOrBelow(write._record._path, filename); });
     if (!checkConnect()) {
         return {};
     }
@@ -1685,12 +2140,44 @@ Optional<SyncJournalDb::HasHydratedDehydrated> SyncJournalDb::hasHydratedOrDehyd
     return result;
 }
 
+// Serialized as "start-end,start-end"
+static QByteArray serializeDownloadRanges(const QVector<QPair<qint64, qint64>> &ranges)
+{
+    QByteArrayList parts;
+    parts.reserve(ranges.size());
+    for (const auto &range : ranges) {
+        parts.append(QByteArray::number(range.first) + '-' + QByteArray::number(range.second));
+    }
+    return parts.join(',');
+}
+
+static QVector<QPair<qint64, qint64>> parseDownloadRanges(const QByteArray &serialized)
+{
+    QVector<QPair<qint64, qint64>> ranges;
+    for (const auto &part : serialized.split(',')) {
+        const auto separator = part.indexOf('-');
+        if (separator <= 0) {
+            continue;
+        }
+        bool startOk = false;
+        bool endOk = false;
+        const auto start = part.left(separator).toLongLong(&startOk);
+        const auto end = part.mid(separator + 1).toLongLong(&endOk);
+        if (startOk && endOk && start < end) {
+            ranges.append({start, end});
+        }
+    }
+    return ranges;
+}
+
 static void toDownloadInfo(SqlQuery &query, SyncJournalDb::DownloadInfo *res)
 {
     bool ok = true;
     res->_tmpfile = query.stringValue(0);
     res->_etag = query.baValue(1);
     res->_errorCount = query.intValue(2);
+    res->_segmented = query.intValue(3) != 0;
+    res->_completedRanges = parseDownloadRanges(query.baValue(4));
     res->_valid = ok;
 }
 
@@ -1719,7 +2206,7 @@ SyncJournalDb::DownloadInfo SyncJournalDb::getDownloadInfo(const QString &file)
     DownloadInfo res;
 
     if (checkConnect()) {
-        const auto query = _queryManager.get(PreparedSqlQueryManager::GetDownloadInfoQuery, QByteArrayLiteral("SELECT tmpfile, etag, errorcount FROM downloadinfo WHERE path=?1"), _db);
+        const auto query = _queryManager.get(PreparedSqlQueryManager::GetDownloadInfoQuery, QByteArrayLiteral("SELECT tmpfile, etag, errorcount, segmented, completedRanges FROM downloadinfo WHERE path=?1"), _db);
         if (!query) {
             qCDebug(lcDb) << "database error:" << query->error();
             return res;
@@ -1750,8 +2237,8 @@ void SyncJournalDb::setDownloadInfo(const QString &file, const SyncJournalDb::Do
 
     if (i._valid) {
         const auto query = _queryManager.get(PreparedSqlQueryManager::SetDownloadInfoQuery, QByteArrayLiteral("INSERT OR REPLACE INTO downloadinfo "
-                                                                                                              "(path, tmpfile, etag, errorcount) "
-                                                                                                              "VALUES ( ?1 , ?2, ?3, ?4 )"),
+                                                                                                              "(path, tmpfile, etag, errorcount, segmented, completedRanges) "
+                                                                                                              "VALUES ( ?1 , ?2, ?3, ?4, ?5, ?6 )"),
             _db);
         if (!query) {
             qCDebug(lcDb) << "database error:" << query->error();
@@ -1761,6 +2248,8 @@ void SyncJournalDb::setDownloadInfo(const QString &file, const SyncJournalDb::Do
         query->bindValue(2, i._tmpfile);
         query->bindValue(3, i._etag);
         query->bindValue(4, i._errorCount);
+        query->bindValue(5, i._segmented);
+        query->bindValue(6, serializeDownloadRanges(i._completedRanges));
         if (!query->exec()) {
             qCDebug(lcDb) << "database error:" << query->error();
         }
@@ -1788,7 +2277,7 @@ QVector<SyncJournalDb::DownloadInfo> SyncJournalDb::getAndDeleteStaleDownloadInf
 
     SqlQuery query(_db);
     // The selected values *must* match the ones expected by toDownloadInfo().
-    query.prepare("SELECT tmpfile, etag, errorcount, path FROM downloadinfo");
+    query.prepare("SELECT tmpfile, etag, errorcount, segmented, completedRanges, path FROM downloadinfo");
 
     if (!query.exec()) {
         qCDebug(lcDb) << "database error:" << query.error();
@@ -1799,7 +2288,7 @@ QVector<SyncJournalDb::DownloadInfo> SyncJournalDb::getAndDeleteStaleDownloadInf
     QVector<SyncJournalDb::DownloadInfo> deleted_entries;
 
     while (query.next().hasData) {
-        const QString file = query.stringValue(3); // path
+        const QString file = query.stringValue(5); // path
         if (!keep.contains(file)) {
             superfluousPaths.append(file);
             DownloadInfo info;
@@ -2022,6 +2511,8 @@ bool SyncJournalDb::deleteStaleErrorBlacklistEntries(const QSet<QString> &keep)
 void SyncJournalDb::deleteStaleFlagsEntries()
 {
     QMutexLocker locker(&_mutex);
+    // The flags of a queued record are kept, a queued deletion only keeps a stale entry for longer
+    applyQueuedWritesIf([](const QueuedWrite &write) { return write._type == QueuedWrite::SetRecord; });
     if (!checkConnect())
         return;
 
@@ -2162,6 +2653,95 @@ QVector<SyncJournalDb::PollInfo> SyncJournalDb::getPollInfos()
     return res;
 }
 
+QByteArray SyncJournalDb::getCachedChecksum(const ChecksumCacheKey &key, const QByteArray &checksumType)
+{
+    QMutexLocker locker(&_mutex);
+
+    if (!key.isValid() || checksumType.isEmpty() || !checkConnect()) {
+        return {};
+    }
+
+    const auto query = _queryManager.get(PreparedSqlQueryManager::GetChecksumCacheQuery, QByteArrayLiteral("SELECT checksum FROM checksumcache "
+                                                                                                          "JOIN checksumtype ON checksumcache.checksumTypeId == checksumtype.id "
+                                                                                                          "WHERE inode=?1 AND checksumtype.name=?2 AND size=?3 AND modtime=?4 AND ctime=?5"),
+        _db);
+    if (!query) {
+        qCDebug(lcDb) << "database error:" << query->error();
+        return {};
+    }
+    query->bindValue(1, key._inode);
+    query->bindValue(2, checksumType);
+    query->bindValue(3, key._size);
+    query->bindValue(4, key._modtime);
+    query->bindValue(5, key._ctime);
+
+    if (!query->exec()) {
+        qCDebug(lcDb) << "database error:" << query->error();
+        return {};
+    }
+
+    if (!query->next().hasData) {
+        ++_checksumCacheStatistics._misses;
+        return {};
+    }
+    ++_checksumCacheStatistics._hits;
+    return query->baValue(0);
+}
+
+void SyncJournalDb::setCachedChecksum(const ChecksumCacheKey &key, const QByteArray &checksumType, const QByteArray &checksum)
+{
+    QMutexLocker locker(&_mutex);
+
+    if (!key.isValid() || checksum.isEmpty() || !checkConnect()) {
+        return;
+    }
+
+    const auto checksumTypeId = mapChecksumType(checksumType);
+    if (!checksumTypeId) {
+        return;
+    }
+
+    const auto query = _queryManager.get(PreparedSqlQueryManager::SetChecksumCacheQuery, QByteArrayLiteral("INSERT OR REPLACE INTO checksumcache "
+                                                                                                          "(inode, checksumTypeId, size, modtime, ctime, checksum) "
+                                                                                                          "VALUES (?1, ?2, ?3, ?4, ?5, ?6)"),
+        _db);
+    if (!query) {
+        qCDebug(lcDb) << "database error:" << query->error();
+        return;
+    }
+    query->bindValue(1, key._inode);
+    query->bindValue(2, checksumTypeId);
+    query->bindValue(3, key._size);
+    query->bindValue(4, key._modtime);
+    query->bindValue(5, key._ctime);
+    query->bindValue(6, checksum);
+
+    if (!query->exec()) {
+        qCDebug(lcDb) << "database error:" << query->error();
+    }
+}
+
+void SyncJournalDb::deleteStaleChecksumCacheEntries()
+{
+    QMutexLocker locker(&_mutex);
+    // The checksums of a queued inode are kept, a queued deletion only keeps a stale entry for longer
+    applyQueuedWritesIf([](const QueuedWrite &write) { return write._type == QueuedWrite::SetRecord; });
+    if (!checkConnect())
+        return;
+
+    SqlQuery delQuery("DELETE FROM checksumcache WHERE EXISTS (SELECT 1 FROM metadata) "
+                      "AND inode NOT IN (SELECT inode FROM metadata WHERE inode IS NOT NULL);", _db);
+    if (!delQuery.exec()) {
+        sqlFail(QStringLiteral("deleteStaleChecksumCacheEntries"), delQuery);
+    }
+}
+
+SyncJournalDb::ChecksumCacheStatistics SyncJournalDb::checksumCacheStatistics()
+{
+    QMutexLocker locker(&_mutex);
+    return _checksumCacheStatistics;
+}
+
 void SyncJournalDb::setPollInfo(const SyncJournalDb::PollInfo &info)
 {
     QMutexLocker locker(&_mutex);
@@ -2262,6 +2842,7 @@ void SyncJournalDb::setSelectiveSyncList(SyncJournalDb::SelectiveSyncListType ty
 void SyncJournalDb::avoidRenamesOnNextSync(const QByteArray &path)
 {
     QMutexLocker locker(&_mutex);
+    applyQueuedWritesIf([&path](const QueuedWrite &write) { return isPathOrBelow(write._record._path, path); });
 
     if (!checkConnect()) {
         return;
@@ -2272,7 +2853,13 @@ void SyncJournalDb::avoidRenamesOnNextSync(const QByteArray &path)
     query.bindValue(1, path);
 
     if (!query.exec()) {
+        _metadataSnapshot.reset();
         sqlFail(QStringLiteral("avoidRenamesOnNextSync path: %1").arg(QString::fromUtf8(path)), query);
+    } else if (_metadataSnapshot) {
+        _metadataSnapshot->updateBelow(path, true, [](SyncJournalFileRecord &record) {
+            record._fileId.clear();
+            record._inode = 0;
+        });
     }
 
     // We also need to remove the ETags so the update phase refreshes the directory paths
@@ -2282,6 +2869,8 @@ void SyncJournalDb::avoidRenamesOnNextSync(const QByteArray &path)
 
 void SyncJournalDb::schedulePathForRemoteDiscovery(const QByteArray &fileName)
 {
+    // Queued records don't need to be written first: they pass through the
+    // etag storage filter when they are
     QMutexLocker locker(&_mutex);
 
     if (!checkConnect()) {
@@ -2300,7 +2889,10 @@ void SyncJournalDb::schedulePathForRemoteDiscovery(const QByteArray &fileName)
     query.bindValue(1, argument);
 
     if (!query.exec()) {
+        _metadataSnapshot.reset();
         sqlFail(QStringLiteral("schedulePathForRemoteDiscovery path: %1").arg(QString::fromUtf8(fileName)), query);
+    } else if (_metadataSnapshot) {
+        _metadataSnapshot->updateAncestors(argument, invalidateDirectoryEtag);
     }
 
     // Prevent future overwrite of the etags of this folder and all
@@ -2309,6 +2901,69 @@ void SyncJournalDb::schedulePathForRemoteDiscovery(const QByteArray &fileName)
     _etagStorageFilter.append(argument);
 }
 
+QSet<qint64> SyncJournalDb::scheduleFileIdsForRemoteDiscovery(const QList<qint64> &numericFileIds)
+{
+    QMutexLocker locker(&_mutex);
+
+    QSet<qint64> foundFileIds;
+    QSet<QByteArray> paths;
+    for (const auto numericFileId : numericFileIds) {
+        const auto fileId = fileIdForNumericFileId(numericFileId);
+        if (fileId.isEmpty()) {
+            continue;
+        }
+        const auto ok = getFileRecordsByFileId(fileId, [&](const SyncJournalFileRecord &record) {
+            foundFileIds.insert(numericFileId);
+            if (record.isDirectory()) {
+                paths.insert(record._path);
+            } else {
+                const auto slash = record._path.lastIndexOf('/');
+                paths.insert(slash < 0 ? QByteArray() : record._path.left(slash));
+            }
+        });
+        if (!ok) {
+            break;
+        }
+    }
+
+    // The root folder is discovered by every sync
+    paths.remove(QByteArray());
+    for (const auto &path : qAsConst(paths)) {
+        schedulePathForRemoteDiscovery(path);
+    }
+
+    qCInfo(lcDb) << "Found" << foundFileIds.size() << "of" << numericFileIds.size() << "file ids, scheduled" << paths << "for remote discovery";
+    return foundFileIds;
+}
+
+QByteArray SyncJournalDb::fileIdForNumericFileId(qint64 numericFileId)
+{
+    // A record that is about to lose the file id is caught by getFileRecordsByFileId()
+    applyQueuedWritesIf([numericFileId](const QueuedWrite &write) {
+        return write._type == QueuedWrite::SetRecord && write._record.numericFileId().toLongLong() == numericFileId;
+    });
+
+    if (!checkConnect()) {
+        return {};
+    }
+
+    // The server pads the numeric id to 8 digits and appends its instance id,
+    // see SyncJournalFileRecord::numericFileId()
+    const auto paddedFileId = QByteArray::number(numericFileId).rightJustified(8, '0');
+    SqlQuery query(_db);
+    query.prepare("SELECT fileid FROM metadata WHERE fileid GLOB ?1 OR fileid = ?2 LIMIT 1;");
+    query.bindValue(1, QByteArray(paddedFileId + "[^0-9]*"));
+    query.bindValue(2, paddedFileId);
+    if (!query.exec()) {
+        qCWarning(lcDb) << "database error:" << query.error();
+        return {};
+    }
+    if (!query.next().hasData) {
+        return {};
+    }
+    return query.baValue(0);
+}
+
 void SyncJournalDb::clearEtagStorageFilter()
 {
     _etagStorageFilter.clear();
@@ -2317,6 +2972,7 @@ void SyncJournalDb::clearEtagStorageFilter()
 void SyncJournalDb::forceRemoteDiscoveryNextSync()
 {
     QMutexLocker locker(&_mutex);
+    applyQueuedWritesIf([](const QueuedWrite &write) { return write._type == QueuedWrite::SetRecord && write._record.isDirectory(); });
 
     if (!checkConnect()) {
         return;
@@ -2332,7 +2988,10 @@ void SyncJournalDb::forceRemoteDiscoveryNextSyncLocked()
     deleteRemoteFolderEtagsQuery.prepare("UPDATE metadata SET md5='_invalid_' WHERE type=2;");
 
     if (!deleteRemoteFolderEtagsQuery.exec()) {
+        _metadataSnapshot.reset();
         sqlFail(QStringLiteral("forceRemoteDiscoveryNextSyncLocked"), deleteRemoteFolderEtagsQuery);
+    } else if (_metadataSnapshot) {
+        _metadataSnapshot->updateBelow({}, false, invalidateDirectoryEtag);
     }
 }
 
@@ -2701,6 +3360,15 @@ QByteArray SyncJournalDb::conflictFileBaseName(const QByteArray &conflictName)
 void SyncJournalDb::clearFileTable()
 {
     QMutexLocker lock(&_mutex);
+    {
+        // Nothing that is queued would survive
+        QMutexLocker queueLocker(&_writeQueueMutex);
+        _writeQueue.clear();
+        _queuedRecords.clear();
+    }
+    if (_metadataSnapshot) {
+        _metadataSnapshot = std::make_unique<SyncJournalSnapshot>();
+    }
     SqlQuery query(_db);
     query.prepare("DELETE FROM metadata;");
 
@@ -2713,6 +3381,7 @@ void SyncJournalDb::clearFileTable()
 void SyncJournalDb::markVirtualFileForDownloadRecursively(const QByteArray &path)
 {
     QMutexLocker lock(&_mutex);
+    applyQueuedWritesIf([&path](const QueuedWrite &write) { return isPathOrBelow(write._record._path, path); });
     if (!checkConnect())
         return;
 
@@ -2724,7 +3393,14 @@ void SyncJournalDb::markVirtualFileForDownloadRecursively(const QByteArray &path
 
     if (!query.exec()) {
         qCDebug(lcDb) << "database error:" << query.error();
+        _metadataSnapshot.reset();
         sqlFail(QStringLiteral("markVirtualFileForDownloadRecursively UPDATE metadata SET type=5 path: %1").arg(QString::fromUtf8(path)), query);
+    } else if (_metadataSnapshot) {
+        _metadataSnapshot->updateBelow(path, false, [](SyncJournalFileRecord &record) {
+            if (record._type == ItemTypeVirtualFile) {
+                record._type = ItemTypeVirtualFileDownload;
+            }
+        });
     }
 
     // We also must make sure we do not read the files from the database (same logic as in schedulePathForRemoteDiscovery)
@@ -2736,7 +3412,11 @@ void SyncJournalDb::markVirtualFileForDownloadRecursively(const QByteArray &path
 
     if (!query.exec()) {
         qCDebug(lcDb) << "database error:" << query.error();
+        _metadataSnapshot.reset();
         sqlFail(QStringLiteral("markVirtualFileForDownloadRecursively UPDATE metadata SET md5='_invalid_' path: %1").arg(QString::fromUtf8(path)), query);
+    } else if (_metadataSnapshot) {
+        _metadataSnapshot->updateBelow(path, false, invalidateDirectoryEtag);
+        _metadataSnapshot->updateAncestors(path, invalidateDirectoryEtag);
     }
 }
 
@@ -3065,6 +3745,7 @@ void SyncJournalDb::commitInternal(const QString &context, bool startTrans)
 
 SyncJournalDb::~SyncJournalDb()
 {
+    setWriteBehindEnabled(false);
     if (isOpen()) {
         close();
     }
@@ -3077,7 +3758,9 @@ bool operator==(const SyncJournalDb::DownloadInfo &lhs,
     return lhs._errorCount == rhs._errorCount
         && lhs._etag == rhs._etag
         && lhs._tmpfile == rhs._tmpfile
-        && lhs._valid == rhs._valid;
+        && lhs._valid == rhs._valid
+        && lhs._segmented == rhs._segmented
+        && lhs._completedRanges == rhs._completedRanges;
 }
 
 bool operator==(const SyncJournalDb::UploadInfo &lhs,
@@ -22,11 +22,20 @@
 #include <QObject>
 #include <QDateTime>
 #include <QHash>
+#include <QSet>
+#include <QStringList>
 #include <QMutex>
+#include <QThread>
 #include <QVariant>
+#include <QWaitCondition>
+
+#include <atomic>
+#include <deque>
 #include <functional>
+#include <memory>
 
 #include "common/utility.h"
+#include "common/checksumcachekey.h"
 #include "common/ownsql.h"
 #include "common/preparedsqlquerymanager.h"
 #include "common/syncjournalfilerecord.h"
@@ -35,6 +44,7 @@
 
 namespace OCC {
 class SyncJournalFileRecord;
+class SyncJournalSnapshot;
 
 /**
  * @brief Class that handles the sync database
@@ -76,8 +86,15 @@ public:
 
     void keyValueStoreSet(const QString &key, QVariant value);
     [[nodiscard]] qint64 keyValueStoreGetInt(const QString &key, qint64 defaultValue);
+    [[nodiscard]] QByteArray keyValueStoreGetByteArray(const QString &key, const QByteArray &defaultValue = {});
     void keyValueStoreDelete(const QString &key);
 
+    /**
+     * With write-behind enabled, a non-recursive deletion is only queued and
+     * true means it was accepted. Whether it was applied is reported by a
+     * later setFileRecord() or deleteFileRecord() call, or when write-behind
+     * is disabled, see setWriteBehindEnabled().
+     */
     [[nodiscard]] bool deleteFileRecord(const QString &filename, bool recursively = false);
     [[nodiscard]] bool updateFileRecordChecksum(
         const QString &filename,
@@ -115,6 +132,13 @@ public:
         QByteArray _etag;
         int _errorCount = 0;
         bool _valid = false;
+        /**
+         * Whether the temporary file was preallocated and is filled by several
+         * ranged requests. Such a file has holes and can only be resumed segment-wise.
+         */
+        bool _segmented = false;
+        /// The byte ranges [first, second) of a segmented download that are complete
+        QVector<QPair<qint64, qint64>> _completedRanges;
     };
     struct UploadInfo
     {
@@ -163,6 +187,32 @@ public:
 
     QVector<PollInfo> getPollInfos();
 
+    struct ChecksumCacheStatistics
+    {
+        qint64 _hits = 0;
+        qint64 _misses = 0;
+    };
+
+    /**
+     * The cached content checksum of the given type for the file identified by key.
+     *
+     * Returns an empty checksum if there is none or the file changed since
+     * it was stored. Counts a hit or a miss in checksumCacheStatistics().
+     */
+    QByteArray getCachedChecksum(const ChecksumCacheKey &key, const QByteArray &checksumType);
+    void setCachedChecksum(const ChecksumCacheKey &key, const QByteArray &checksumType, const QByteArray &checksum);
+
+    /**
+     * Delete checksum cache entries of inodes that are not in the metadata table.
+     *
+     * Does nothing while the metadata table is empty, so a rebuild of the
+     * journal can still use the cache.
+     */
+    void deleteStaleChecksumCacheEntries();
+
+    /// Hits and misses of getCachedChecksum() since the journal was created
+    [[nodiscard]] ChecksumCacheStatistics checksumCacheStatistics();
+
     enum SelectiveSyncListType {
         /** The black list is the list of folders that are unselected in the selective sync dialog.
          * For the sync engine, those folders are considered as if they were not there, so the local
@@ -202,6 +252,26 @@ public:
     void schedulePathForRemoteDiscovery(const QString &fileName) { schedulePathForRemoteDiscovery(fileName.toUtf8()); }
     void schedulePathForRemoteDiscovery(const QByteArray &fileName);
 
+    /**
+     * Calls schedulePathForRemoteDiscovery() for the directories of the files
+     * with the given numeric file ids.
+     *
+     * Directories are scheduled themselves, files their parent directory.
+     * The ids are the ones push notifications report, without the instance
+     * id part that SyncJournalFileRecord::_fileId has.
+     *
+     * Returns the ids that were found in the journal.
+     */
+    QSet<qint64> scheduleFileIdsForRemoteDiscovery(const QList<qint64> &numericFileIds);
+
+    /**
+     * The complete file id for a numeric file id, empty if no file has it
+     *
+     * The server pads the numeric id to 8 digits, ids without the instance
+     * id part are matched too.
+     */
+    QByteArray fileIdForNumericFileId(qint64 numericFileId);
+
     /**
      * Wipe _etagStorageFilter. Also done implicitly on close().
      */
@@ -235,6 +305,29 @@ public:
     /** Close the database */
     void close();
 
+    /**
+     * Moves setFileRecord() and non-recursive deleteFileRecord() calls to a
+     * writer thread that applies them in batched transactions.
+     *
+     * Queued changes are visible to getFileRecord() right away; the other
+     * reads of the metadata table flush the queue first if one of the queued
+     * changes could affect their result. A queued change that fails does not fail
+     * later calls: disabling waits until the queue is drained and returns the
+     * failures of all the changes, naming their records.
+     */
+    Result<void, QString> setWriteBehindEnabled(bool enabled);
+    [[nodiscard]] bool isWriteBehindEnabled() const { return _writeBehindEnabled; }
+
+    /**
+     * Serves getFileRecord(), getFileRecordByInode(), getFileRecordsByFileId()
+     * and listFilesInPath() from an in-memory copy of the metadata table.
+     *
+     * The copy is loaded on the first lookup and kept up to date by the
+     * writes of this class. Meant for the discovery phase, where these
+     * lookups are done for every item of the tree. Disabling frees the memory.
+     */
+    void setMetadataSnapshotEnabled(bool enabled);
+
     /**
      * Returns the checksum type for an id.
      */
@@ -415,6 +508,33 @@ private:
     // Same as forceRemoteDiscoveryNextSync but without acquiring the lock
     void forceRemoteDiscoveryNextSyncLocked();
 
+    struct QueuedWrite
+    {
+        enum Type {
+            SetRecord,
+            DeleteRecord,
+        };
+        Type _type;
+        SyncJournalFileRecord _record;
+        quint64 _sequence;
+    };
+
+    [[nodiscard]] Result<void, QString> setFileRecordInternal(const SyncJournalFileRecord &record);
+    [[nodiscard]] bool deleteFileRecordInternal(const QString &filename, bool recursively);
+    void applyEtagStorageFilter(SyncJournalFileRecord &record) const;
+    void queueWrite(QueuedWrite::Type type, const SyncJournalFileRecord &record);
+    // Writes up to maximum queued changes (all if negative) in a transaction of their own,
+    // must be called with _mutex held
+    void applyQueuedWrites(int maximum = -1);
+    // Writes all queued changes if the latest one of a path matches, must be called with _mutex held
+    void applyQueuedWritesIf(const std::function<bool(const QueuedWrite &)> &matches);
+    // Whether a change of the path is queued
+    [[nodiscard]] bool isWriteQueued(const QByteArray &path);
+    void writerThreadLoop();
+
+    // The in-memory metadata if enabled, loading it if needed. Must be called with _mutex held.
+    SyncJournalSnapshot *metadataSnapshot();
+
     // Returns the integer id of the checksum type
     //
     // Returns 0 on failure and for empty checksum types.
@@ -450,6 +570,24 @@ private:
     QByteArray _journalMode;
 
     PreparedSqlQueryManager _queryManager;
+
+    // State of the write-behind queue, see setWriteBehindEnabled()
+    std::atomic<bool> _writeBehindEnabled{false};
+    QMutex _writeQueueMutex; // protects the members below, taken after _mutex
+    QWaitCondition _writeQueueChanged;
+    std::deque<QueuedWrite> _writeQueue;
+    // phash -> the latest queued change per path
+    QHash<qint64, QueuedWrite> _queuedRecords;
+    quint64 _writeSequence = 0;
+    QStringList _writeBehindErrors; // the failed queued changes, reported when disabling
+    bool _stopWriter = false;
+    bool _applyingQueuedWrites = false;
+    std::unique_ptr<QThread> _writerThread;
+
+    bool _metadataSnapshotEnabled = false;
+    std::unique_ptr<SyncJournalSnapshot> _metadataSnapshot;
+
+    ChecksumCacheStatistics _checksumCacheStatistics;
 };
 
 bool OCSYNC_EXPORT
@@ -0,0 +1,372 @@
+/*
+ * Copyright (C) 2026 by Nextcloud GmbH <info@nextcloud.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "common/syncjournalsnapshot.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace OCC {
+
+namespace {
+
+// Rough overhead of one entry in a QHash/QMultiHash on top of key and value
+constexpr qint64 hashEntryOverhead = 2 * sizeof(void *);
+
+qint64 byteArrayUsage(const QByteArray &data)
+{
+    return data.capacity();
+}
+
+qint64 stringUsage(const QString &string)
+{
+    return string.capacity() * static_cast<qint64>(sizeof(QChar));
+}
+
+// Orders names like "ORDER BY path||'/'" orders siblings
+bool lessAsDirectoryName(const QByteArray &lhs, const QByteArray &rhs)
+{
+    const auto common = qMin(lhs.size(), rhs.size());
+    const auto result = std::memcmp(lhs.constData(), rhs.constData(), common);
+    if (result != 0) {
+        return result < 0;
+    }
+    const auto lhsNext = static_cast<uchar>(lhs.size() > common ? lhs.at(common) : '/');
+    const auto rhsNext = static_cast<uchar>(rhs.size() > common ? rhs.at(common) : '/');
+    return lhsNext < rhsNext;
+}
+
+}
+
+SyncJournalSnapshot::SyncJournalSnapshot()
+{
+    _nodes.emplace_back();
+}
+
+int SyncJournalSnapshot::findNode(const QByteArray &path) const
+{
+    auto node = 0;
+    if (path.isEmpty()) {
+        return node;
+    }
+
+    qsizetype start = 0;
+    while (node >= 0) {
+        const auto end = path.indexOf('/', start);
+        const auto name = QByteArray::fromRawData(path.constData() + start, (end < 0 ? path.size() : end) - start);
+        node = _childIndex.value(qMakePair(node, name), -1);
+        if (end < 0) {
+            break;
+        }
+        start = end + 1;
+    }
+    return node;
+}
+
+int SyncJournalSnapshot::findOrCreateNode(const QByteArray &path)
+{
+    auto node = 0;
+    qsizetype start = 0;
+    forever {
+        const auto end = path.indexOf('/', start);
+        const auto name = path.mid(start, end < 0 ? -1 : end - start);
+        const auto key = qMakePair(node, name);
+        auto child = _childIndex.value(key, -1);
+        if (child < 0) {
+            if (!_freeNodes.empty()) {
+                child = _freeNodes.back();
+                _freeNodes.pop_back();
+                _nodes[child] = Node();
+            } else {
+                child = static_cast<int>(_nodes.size());
+                _nodes.emplace_back();
+            }
+            // the name is shared between the node and the index key
+            _nodes[child].name = key.second;
+            _nodes[child].parent = node;
+            _nodes[node].children.push_back(child);
+            _childIndex.insert(key, child);
+        }
+        node = child;
+        if (end < 0) {
+            return node;
+        }
+        start = end + 1;
+    }
+}
+
+QByteArray SyncJournalSnapshot::pathOf(int node) const
+{
+    std::vector<int> components;
+    auto length = qsizetype(-1);
+    for (auto current = node; current > 0; current = _nodes[current].parent) {
+        components.push_back(current);
+        length += _nodes[current].name.size() + 1;
+    }
+
+    QByteArray path;
+    path.reserve(qMax<qsizetype>(0, length));
+    for (auto it = components.crbegin(); it != components.crend(); ++it) {
+        if (!path.isEmpty()) {
+            path += '/';
+        }
+        path += _nodes[*it].name;
+    }
+    return path;
+}
+
+SyncJournalFileRecord SyncJournalSnapshot::recordOf(int node) const
+{
+    if (node <= 0 || !_nodes[node].hasRecord) {
+        return {};
+    }
+    auto record = _nodes[node].record;
+    record._path = pathOf(node);
+    return record;
+}
+
+void SyncJournalSnapshot::insert(const SyncJournalFileRecord &record)
+{
+    if (!record.isValid()) {
+        return;
+    }
+
+    const auto node = findOrCreateNode(record._path);
+    dropRecord(node);
+
+    auto &entry = _nodes[node];
+    entry.record = record;
+    entry.record._path.clear();
+    entry.hasRecord = true;
+    ++_recordCount;
+
+    if (record._inode) {
+        _inodeIndex.insert(record._inode, node);
+    }
+    if (!record._fileId.isEmpty()) {
+        _fileIdIndex.insert(record._fileId, node);
+    }
+}
+
+void SyncJournalSnapshot::dropRecord(int node)
+{
+    auto &entry = _nodes[node];
+    if (!entry.hasRecord) {
+        return;
+    }
+    if (entry.record._inode) {
+        _inodeIndex.remove(entry.record._inode, node);
+    }
+    if (!entry.record._fileId.isEmpty()) {
+        _fileIdIndex.remove(entry.record._fileId, node);
+    }
+    entry.record = SyncJournalFileRecord();
+    entry.hasRecord = false;
+    --_recordCount;
+}
+
+void SyncJournalSnapshot::removeSubtree(int node)
+{
+    dropRecord(node);
+    const auto children = std::exchange(_nodes[node].children, {});
+    for (const auto child : children) {
+        removeSubtree(child);
+        _childIndex.remove(qMakePair(node, _nodes[child].name));
+        _nodes[child] = Node();
+        _freeNodes.push_back(child);
+    }
+}
+
+void SyncJournalSnapshot::releaseIfUnused(int node)
+{
+    // Drop nodes that neither carry a record nor lead to one
+    while (node > 0 && !_nodes[node].hasRecord && _nodes[node].children.empty()) {
+        const auto parent = _nodes[node].parent;
+        auto &siblings = _nodes[parent].children;
+        siblings.erase(std::remove(siblings.begin(), siblings.end(), node), siblings.end());
+        _childIndex.remove(qMakePair(parent, _nodes[node].name));
+        _nodes[node] = Node();
+        _freeNodes.push_back(node);
+        node = parent;
+    }
+}
+
+void SyncJournalSnapshot::remove(const QByteArray &path, bool recursively)
+{
+    const auto node = findNode(path);
+    if (node < 0) {
+        return;
+    }
+
+    if (recursively) {
+        removeSubtree(node);
+    } else {
+        dropRecord(node);
+    }
+    releaseIfUnused(node);
+}
+
+void SyncJournalSnapshot::updateRecord(int node, const RecordUpdate &update)
+{
+    auto &entry = _nodes[node];
+    if (!entry.hasRecord) {
+        return;
+    }
+
+    const auto inode = entry.record._inode;
+    const auto fileId = entry.record._fileId;
+    update(entry.record);
+
+    if (entry.record._inode != inode) {
+        if (inode) {
+            _inodeIndex.remove(inode, node);
+        }
+        if (entry.record._inode) {
+            _inodeIndex.insert(entry.record._inode, node);
+        }
+    }
+    if (entry.record._fileId != fileId) {
+        if (!fileId.isEmpty()) {
+            _fileIdIndex.remove(fileId, node);
+        }
+        if (!entry.record._fileId.isEmpty()) {
+            _fileIdIndex.insert(entry.record._fileId, node);
+        }
+    }
+}
+
+void SyncJournalSnapshot::updateAncestors(const QByteArray &path, const RecordUpdate &update)
+{
+    if (path.isEmpty()) {
+        return;
+    }
+
+    auto node = 0;
+    qsizetype start = 0;
+    forever {
+        const auto end = path.indexOf('/', start);
+        const auto name = QByteArray::fromRawData(path.constData() + start, (end < 0 ? path.size() : end) - start);
+        node = _childIndex.value(qMakePair(node, name), -1);
+        if (node < 0) {
+            return;
+        }
+        updateRecord(node, update);
+        if (end < 0) {
+            return;
+        }
+        start = end + 1;
+    }
+}
+
+void SyncJournalSnapshot::updateBelow(const QByteArray &path, bool includingPath, const RecordUpdate &update)
+{
+    const auto node = findNode(path);
+    if (node < 0) {
+        return;
+    }
+    if (includingPath) {
+        updateRecord(node, update);
+    }
+
+    std::vector<int> pending = _nodes[node].children;
+    while (!pending.empty()) {
+        const auto current = pending.back();
+        pending.pop_back();
+        updateRecord(current, update);
+        const auto &children = _nodes[current].children;
+        pending.insert(pending.end(), children.cbegin(), children.cend());
+    }
+}
+
+SyncJournalFileRecord SyncJournalSnapshot::find(const QByteArray &path) const
+{
+    if (path.isEmpty()) {
+        return {};
+    }
+    return recordOf(findNode(path));
+}
+
+SyncJournalFileRecord SyncJournalSnapshot::findByInode(quint64 inode) const
+{
+    if (!inode) {
+        return {};
+    }
+    return recordOf(_inodeIndex.value(inode, -1));
+}
+
+std::vector<SyncJournalFileRecord> SyncJournalSnapshot::findByFileId(const QByteArray &fileId) const
+{
+    std::vector<SyncJournalFileRecord> records;
+    if (fileId.isEmpty()) {
+        return records;
+    }
+    const auto nodes = _fileIdIndex.values(fileId);
+    records.reserve(nodes.size());
+    for (const auto node : nodes) {
+        records.push_back(recordOf(node));
+    }
+    return records;
+}
+
+std::vector<SyncJournalFileRecord> SyncJournalSnapshot::listFilesInPath(const QByteArray &path) const
+{
+    std::vector<SyncJournalFileRecord> records;
+    const auto node = findNode(path);
+    if (node < 0) {
+        return records;
+    }
+
+    auto children = _nodes[node].children;
+    std::sort(children.begin(), children.end(), [this](int lhs, int rhs) {
+        return lessAsDirectoryName(_nodes[lhs].name, _nodes[rhs].name);
+    });
+
+    records.reserve(children.size());
+    for (const auto child : children) {
+        if (!_nodes[child].hasRecord) {
+            continue;
+        }
+        auto record = _nodes[child].record;
+        record._path = path.isEmpty() ? _nodes[child].name : path + '/' + _nodes[child].name;
+        records.push_back(std::move(record));
+    }
+    return records;
+}
+
+qint64 SyncJournalSnapshot::memoryUsage() const
+{
+    auto usage = static_cast<qint64>(_nodes.capacity() * sizeof(Node) + _freeNodes.capacity() * sizeof(int));
+    for (const auto &node : _nodes) {
+        usage += byteArrayUsage(node.name) + static_cast<qint64>(node.children.capacity() * sizeof(int));
+        if (!node.hasRecord) {
+            continue;
+        }
+        const auto &record = node.record;
+        usage += byteArrayUsage(record._etag) + byteArrayUsage(record._fileId)
+            + byteArrayUsage(record._checksumHeader) + byteArrayUsage(record._e2eMangledName)
+            + stringUsage(record._lockstate._lockOwnerDisplayName) + stringUsage(record._lockstate._lockOwnerId)
+            + stringUsage(record._lockstate._lockEditorApp);
+    }
+    usage += _childIndex.size() * (static_cast<qint64>(sizeof(QPair<int, QByteArray>) + sizeof(int)) + hashEntryOverhead);
+    usage += _inodeIndex.size() * (static_cast<qint64>(sizeof(quint64) + sizeof(int)) + hashEntryOverhead);
+    usage += _fileIdIndex.size() * (static_cast<qint64>(sizeof(QByteArray) + sizeof(int)) + hashEntryOverhead);
+    return usage;
+}
+
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2026 by Nextcloud GmbH <info@nextcloud.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#pragma once
+
+#include "ocsynclib.h"
+#include "common/syncjournalfilerecord.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QMultiHash>
+#include <QPair>
+
+#include <functional>
+#include <vector>
+
+namespace OCC {
+
+/**
+ * @brief In-memory copy of the metadata table of the sync journal
+ *
+ * The records are stored as a tree of path components: every component is
+ * stored once, and a record's path is rebuilt from its ancestors when it is
+ * handed out. Lookups by path, by inode and by file id don't touch SQLite.
+ *
+ * The snapshot is owned by SyncJournalDb which keeps it in sync with the
+ * writes to the metadata table, see SyncJournalDb::setMetadataSnapshotEnabled().
+ * The class itself is not thread safe.
+ *
+ * @ingroup libsync
+ */
+class OCSYNC_EXPORT SyncJournalSnapshot
+{
+public:
+    SyncJournalSnapshot();
+
+    /** Adds the record, replacing an existing one with the same path. */
+    void insert(const SyncJournalFileRecord &record);
+
+    /** Removes the record of path and, if recursively is set, of everything below it. */
+    void remove(const QByteArray &path, bool recursively);
+
+    /// Changes a record in place; its _path is empty and must not be changed
+    using RecordUpdate = std::function<void(SyncJournalFileRecord &)>;
+
+    /** Applies update to the records of path and of its ancestors. */
+    void updateAncestors(const QByteArray &path, const RecordUpdate &update);
+
+    /**
+     * Applies update to the records below path, and to the one of path
+     * itself if includingPath is set. An empty path stands for the root.
+     */
+    void updateBelow(const QByteArray &path, bool includingPath, const RecordUpdate &update);
+
+    /** The record of path, an invalid record if there is none. */
+    [[nodiscard]] SyncJournalFileRecord find(const QByteArray &path) const;
+
+    /** A record with the given inode, an invalid record if there is none or the inode is 0. */
+    [[nodiscard]] SyncJournalFileRecord findByInode(quint64 inode) const;
+
+    /** All records with the given file id. */
+    [[nodiscard]] std::vector<SyncJournalFileRecord> findByFileId(const QByteArray &fileId) const;
+
+    /** The records of the direct children of path, in the order of SyncJournalDb::listFilesInPath(). */
+    [[nodiscard]] std::vector<SyncJournalFileRecord> listFilesInPath(const QByteArray &path) const;
+
+    /** Number of records. */
+    [[nodiscard]] int size() const { return _recordCount; }
+
+    /** Approximate number of bytes used by the records and the indexes. */
+    [[nodiscard]] qint64 memoryUsage() const;
+
+private:
+    struct Node
+    {
+        QByteArray name;
+        int parent = -1;
+        std::vector<int> children;
+        bool hasRecord = false;
+        SyncJournalFileRecord record; // with an empty _path
+    };
+
+    [[nodiscard]] int findNode(const QByteArray &path) const;
+    int findOrCreateNode(const QByteArray &path);
+    [[nodiscard]] SyncJournalFileRecord recordOf(int node) const;
+    [[nodiscard]] QByteArray pathOf(int node) const;
+    void dropRecord(int node);
+    void updateRecord(int node, const RecordUpdate &update);
+    void removeSubtree(int node);
+    void releaseIfUnused(int node);
+
+    std::vector<Node> _nodes; // _nodes[0] is the root of the sync folder
+    std::vector<int> _freeNodes;
+    QHash<QPair<int, QByteArray>, int> _childIndex; // (parent, name) -> node
+    QMultiHash<quint64, int> _inodeIndex;
+    QMultiHash<QByteArray, int> _fileIdIndex;
+    int _recordCount = 0;
+};
+
+}
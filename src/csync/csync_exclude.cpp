@@ -286,6 +286,11 @@ void ExcludedFiles::setWildcardsMatchSlash(bool onoff)
     prepare();
 }
 
+void ExcludedFiles::setNameMatcherEnabled(bool onoff)
+{
+    _nameMatcherEnabled = onoff;
+}
+
 void ExcludedFiles::setClientVersion(ExcludedFiles::Version version)
 {
     _clientVersion = version;
@@ -323,6 +328,8 @@ bool ExcludedFiles::reloadExcludeFiles()
     _fullTraversalRegexDir.clear();
     _fullRegexFile.clear();
     _fullRegexDir.clear();
+    _bnameTraversalMatcherFile.clear();
+    _bnameTraversalMatcherDir.clear();
 
     bool success = true;
     const auto keys = _excludeFiles.keys();
@@ -456,6 +463,28 @@ CSYNC_EXCLUDE_TYPE ExcludedFiles::traversalPatternMatch(const QString &path, Ite
     }
 
     QString basePath(_localPath + path);
+    if (_nameMatcherEnabled && ExcludeNameMatcher::canMatch(bnameStr)
+        && (filetype == ItemTypeDirectory || filetype == ItemTypeFile)) {
+        const auto &matchers = filetype == ItemTypeDirectory ? _bnameTraversalMatcherDir : _bnameTraversalMatcherFile;
+        while (basePath.size() > _localPath.size()) {
+            basePath = leftIncludeLast(basePath, QLatin1Char('/'));
+            const auto matcher = matchers.constFind(basePath);
+            if (matcher == matchers.cend()) {
+                continue;
+            }
+
+            switch (matcher->match(bnameStr)) {
+            case ExcludeNameMatcher::Exclude:
+                return CSYNC_FILE_EXCLUDE_LIST;
+            case ExcludeNameMatcher::ExcludeRemove:
+                return CSYNC_FILE_EXCLUDE_AND_REMOVE;
+            case ExcludeNameMatcher::Trigger:
+                continue;
+            case ExcludeNameMatcher::NoMatch:
+                return CSYNC_NOT_EXCLUDED;
+            }
+        }
+    }
     while (basePath.size() > _localPath.size()) {
         basePath = leftIncludeLast(basePath, QLatin1Char('/'));
         QRegularExpressionMatch m;
@@ -684,6 +713,8 @@ void ExcludedFiles::prepare()
     _fullTraversalRegexDir.clear();
     _fullRegexFile.clear();
     _fullRegexDir.clear();
+    _bnameTraversalMatcherFile.clear();
+    _bnameTraversalMatcherDir.clear();
 
     const auto keys = _allExcludes.keys();
     for (auto const & basePath : keys)
@@ -735,6 +766,16 @@ void ExcludedFiles::prepare(const BasePathString & basePath)
         pattern.append(appendMe);
     };
 
+    // The name matchers get the same patterns as the bname regexes
+    const auto caseInsensitive = OCC::Utility::fsCasePreserving();
+    ExcludeNameMatcher bnameMatcherFile(caseInsensitive);
+    ExcludeNameMatcher bnameMatcherDir(caseInsensitive);
+    auto matcherAdd = [&](const QString &glob, const QString &regex, ExcludeNameMatcher::Match match, bool dirOnly) {
+        if (!dirOnly)
+            bnameMatcherFile.addPattern(glob, regex, match);
+        bnameMatcherDir.addPattern(glob, regex, match);
+    };
+
     for (auto exclude : _allExcludes.value(basePath)) {
         if (exclude[0] == QLatin1Char('\n'))
             continue; // empty line
@@ -769,6 +810,7 @@ void ExcludedFiles::prepare(const BasePathString & basePath)
         auto regexExclude = convertToRegexpSyntax(exclude, _wildcardsMatchSlash);
         if (!fullPath) {
             regexAppend(bnameFileDir, bnameDir, regexExclude, matchDirOnly);
+            matcherAdd(exclude, regexExclude, removeExcluded ? ExcludeNameMatcher::ExcludeRemove : ExcludeNameMatcher::Exclude, matchDirOnly);
         } else {
             regexAppend(fullFileDir, fullDir, regexExclude, matchDirOnly);
 
@@ -776,9 +818,15 @@ void ExcludedFiles::prepare(const BasePathString & basePath)
             QString bnameExclude = extractBnameTrigger(exclude, _wildcardsMatchSlash);
             auto regexBname = convertToRegexpSyntax(bnameExclude, true);
             regexAppend(bnameTriggerFileDir, bnameTriggerDir, regexBname, matchDirOnly);
+            matcherAdd(bnameExclude, regexBname, ExcludeNameMatcher::Trigger, matchDirOnly);
         }
     }
 
+    bnameMatcherFile.finalize();
+    bnameMatcherDir.finalize();
+    _bnameTraversalMatcherFile[basePath] = std::move(bnameMatcherFile);
+    _bnameTraversalMatcherDir[basePath] = std::move(bnameMatcherDir);
+
     // The empty pattern would match everything - change it to match-nothing
     auto emptyMatchNothing = [](QString &pattern) {
         if (pattern.isEmpty())
@@ -24,6 +24,7 @@
 #include "ocsynclib.h"
 
 #include "csync.h"
+#include "csync_exclude_matcher.h"
 
 #include <QObject>
 #include <QSet>
@@ -121,6 +122,14 @@ public:
      */
     void setWildcardsMatchSlash(bool onoff);
 
+    /**
+     * Whether traversalPatternMatch() checks bnames with the compiled
+     * ExcludeNameMatcher instead of the bname regular expressions.
+     *
+     * Defaults to true. Only used for comparing the two in tests and benchmarks.
+     */
+    void setNameMatcherEnabled(bool onoff);
+
     /**
      * Sets the client version, only used for testing.
      */
@@ -223,6 +232,10 @@ private:
      * and only runs a simplified _fullTraversalRegex on the whole path if bname
      * activation for it was triggered.
      *
+     * The bname check is done by _bnameTraversalMatcher, which compiles the same
+     * patterns into tries, so that checking a name doesn't get slower with every
+     * "*.ext" pattern added to the exclude lists.
+     *
      * Note: The traversal matcher will return not-excluded on some paths that the
      * full matcher would exclude. Example: "b" is excluded. traversal("b/c")
      * returns not-excluded because "c" isn't a bname activation pattern.
@@ -253,6 +266,12 @@ private:
     QMap<BasePathString, QRegularExpression> _fullRegexFile;
     QMap<BasePathString, QRegularExpression> _fullRegexDir;
 
+    /// Used instead of _bnameTraversalRegexFile/Dir by traversalPatternMatch(), see prepare()
+    QMap<BasePathString, ExcludeNameMatcher> _bnameTraversalMatcherFile;
+    QMap<BasePathString, ExcludeNameMatcher> _bnameTraversalMatcherDir;
+
+    bool _nameMatcherEnabled = true;
+
     bool _excludeConflictFiles = true;
 
     /**
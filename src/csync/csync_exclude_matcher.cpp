@@ -0,0 +1,354 @@
+/*
+ * Copyright (C) 2026 by Nextcloud GmbH <info@nextcloud.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "csync_exclude_matcher.h"
+
+#include <QVarLengthArray>
+
+#include <algorithm>
+
+namespace {
+
+using FoldedString = QVarLengthArray<char16_t, 256>;
+
+/** Appends the simple case folding of text, code point by code point.
+ *
+ * This is what PCRE compares in caseless UTF mode as well.
+ */
+void appendCaseFolded(QStringView text, FoldedString &output)
+{
+    const auto size = text.size();
+    for (qsizetype i = 0; i < size; ++i) {
+        char32_t ucs4 = text[i].unicode();
+        if (QChar::isHighSurrogate(ucs4) && i + 1 < size && text[i + 1].isLowSurrogate()) {
+            ucs4 = QChar::surrogateToUcs4(text[i], text[i + 1]);
+            ++i;
+        }
+        ucs4 = QChar::toCaseFolded(ucs4);
+        if (QChar::requiresSurrogates(ucs4)) {
+            output.append(QChar::highSurrogate(ucs4));
+            output.append(QChar::lowSurrogate(ucs4));
+        } else {
+            output.append(static_cast<char16_t>(ucs4));
+        }
+    }
+}
+
+quint64 edgeKey(int node, char16_t ch)
+{
+    return (static_cast<quint64>(node) << 16) | ch;
+}
+
+}
+
+ExcludeNameMatcher::Trie::Trie()
+    : nodes(1)
+{
+}
+
+ExcludeNameMatcher::Trie::Node &ExcludeNameMatcher::Trie::insert(const Tokens &tokens, qsizetype begin, qsizetype end, bool reversed)
+{
+    int node = 0;
+    for (auto i = begin; i < end; ++i) {
+        const auto key = edgeKey(node, tokens[reversed ? begin + end - 1 - i : i].ch);
+        auto next = edges.value(key, -1);
+        if (next < 0) {
+            next = nodes.size();
+            nodes.append(Node());
+            edges.insert(key, next);
+        }
+        node = next;
+    }
+    return nodes[node];
+}
+
+int ExcludeNameMatcher::Trie::child(int node, char16_t ch) const
+{
+    return edges.value(edgeKey(node, ch), -1);
+}
+
+ExcludeNameMatcher::ExcludeNameMatcher(bool caseInsensitive)
+    : _caseInsensitive(caseInsensitive)
+{
+}
+
+bool ExcludeNameMatcher::tokenize(const QString &glob, Tokens &tokens) const
+{
+    // Follows ExcludedFiles::convertToRegexpSyntax()
+    QString literal;
+    auto flush = [&]() {
+        FoldedString folded;
+        if (_caseInsensitive) {
+            appendCaseFolded(literal, folded);
+        } else {
+            folded.append(reinterpret_cast<const char16_t *>(literal.constData()), literal.size());
+        }
+        for (const auto ch : qAsConst(folded)) {
+            tokens.append({ Token::Literal, ch });
+        }
+        literal.clear();
+    };
+    const auto len = glob.size();
+    for (qsizetype i = 0; i < len; ++i) {
+        switch (glob[i].unicode()) {
+        case '*':
+            flush();
+            // Consecutive * match the same as a single one
+            if (tokens.isEmpty() || tokens.last().kind != Token::AnyString) {
+                tokens.append({ Token::AnyString, 0 });
+            }
+            break;
+        case '?':
+            flush();
+            tokens.append({ Token::AnyChar, 0 });
+            break;
+        case '[': {
+            auto j = i + 1;
+            for (; j < len; ++j) {
+                if (glob[j] == QLatin1Char(']'))
+                    break;
+                if (j != len - 1 && glob[j] == QLatin1Char('\\') && glob[j + 1] == QLatin1Char(']'))
+                    ++j;
+            }
+            if (j != len) {
+                // A bracket expression, left to the regular expression
+                return false;
+            }
+            literal.append(glob[i]);
+            break;
+        }
+        case '\\':
+            if (i == len - 1) {
+                literal.append(glob[i]);
+                break;
+            }
+            // '\*' is a literal '*', but '\z' is '\z'
+            switch (glob[i + 1].unicode()) {
+            case '*':
+            case '?':
+            case '[':
+            case '\\':
+                break;
+            default:
+                literal.append(glob[i]);
+                break;
+            }
+            literal.append(glob[i + 1]);
+            ++i;
+            break;
+        default:
+            literal.append(glob[i]);
+            break;
+        }
+    }
+    flush();
+    return true;
+}
+
+void ExcludeNameMatcher::addPattern(const QString &glob, const QString &regex, Match match)
+{
+    Q_ASSERT(match != NoMatch);
+
+    Tokens tokens;
+    if (!tokenize(glob, tokens)) {
+        _regexPatterns[match].append(regex);
+        return;
+    }
+
+    qsizetype anyChars = 0;
+    qsizetype anyStrings = 0;
+    for (const auto &token : qAsConst(tokens)) {
+        if (token.kind == Token::AnyChar) {
+            ++anyChars;
+        } else if (token.kind == Token::AnyString) {
+            ++anyStrings;
+        }
+    }
+
+    const auto size = tokens.size();
+    auto setMatch = [match](Match &target) {
+        target = qMin(target, match);
+    };
+    if (anyChars == 0 && anyStrings == 0) {
+        setMatch(_prefixTrie.insert(tokens, 0, size, false).whole);
+    } else if (anyChars == 0 && anyStrings == 1 && tokens.last().kind == Token::AnyString) {
+        // "literal*", and "*" itself
+        setMatch(_prefixTrie.insert(tokens, 0, size - 1, false).wildcard);
+    } else if (anyChars == 0 && anyStrings == 1 && tokens.first().kind == Token::AnyString) {
+        // "*literal"
+        setMatch(_suffixTrie.insert(tokens, 1, size, true).wildcard);
+    } else {
+        _globs.append({ tokens, match, size - anyStrings });
+    }
+}
+
+void ExcludeNameMatcher::finalize()
+{
+    // match() stops at the first glob that can't improve the result
+    std::stable_sort(_globs.begin(), _globs.end(), [](const Glob &a, const Glob &b) {
+        return a.match < b.match;
+    });
+
+    _hasRegex = !_regexPatterns[Exclude].isEmpty() || !_regexPatterns[ExcludeRemove].isEmpty() || !_regexPatterns[Trigger].isEmpty();
+    if (!_hasRegex) {
+        return;
+    }
+
+    // Same structure as the bname regex of ExcludedFiles::prepare()
+    auto alternatives = [this](Match match) {
+        // The empty pattern would match everything - change it to match-nothing
+        if (_regexPatterns[match].isEmpty())
+            return QStringLiteral("a^");
+        return _regexPatterns[match].join(QLatin1Char('|'));
+    };
+    _regex.setPattern(QStringLiteral("^(?P<exclude>%1)$|"
+                                     "^(?P<excluderemove>%2)$|"
+                                     "^(?P<trigger>%3)$")
+                          .arg(alternatives(Exclude), alternatives(ExcludeRemove), alternatives(Trigger)));
+    _regex.setPatternOptions(_caseInsensitive ? QRegularExpression::CaseInsensitiveOption : QRegularExpression::NoPatternOption);
+    _regex.optimize();
+}
+
+bool ExcludeNameMatcher::canMatch(QStringView name)
+{
+    // $ also matches before a trailing newline, and ? has to skip whole code points
+    const auto size = name.size();
+    for (qsizetype i = 0; i < size; ++i) {
+        const auto ch = name[i];
+        if (ch == QLatin1Char('\n') || ch == QLatin1Char('\r')) {
+            return false;
+        }
+        if (ch.isHighSurrogate()) {
+            if (i + 1 == size || !name[i + 1].isLowSurrogate()) {
+                return false;
+            }
+            ++i;
+        } else if (ch.isLowSurrogate()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ExcludeNameMatcher::globMatch(const Tokens &tokens, QStringView name)
+{
+    // The usual wildcard matching with backtracking to the last *
+    const auto patternSize = tokens.size();
+    const auto nameSize = name.size();
+    auto charLength = [&](qsizetype i) {
+        return (name[i].isHighSurrogate() && i + 1 < nameSize) ? 2 : 1;
+    };
+
+    qsizetype p = 0;
+    qsizetype n = 0;
+    qsizetype starP = -1;
+    qsizetype starN = 0;
+    while (n < nameSize) {
+        if (p < patternSize) {
+            const auto &token = tokens[p];
+            if (token.kind == Token::AnyString) {
+                starP = p++;
+                starN = n;
+                continue;
+            }
+            if (token.kind == Token::AnyChar) {
+                n += charLength(n);
+                ++p;
+                continue;
+            }
+            if (token.ch == name[n].unicode()) {
+                ++n;
+                ++p;
+                continue;
+            }
+        }
+        if (starP < 0) {
+            return false;
+        }
+        p = starP + 1;
+        starN += charLength(starN);
+        n = starN;
+    }
+    while (p < patternSize && tokens[p].kind == Token::AnyString) {
+        ++p;
+    }
+    return p == patternSize;
+}
+
+ExcludeNameMatcher::Match ExcludeNameMatcher::match(QStringView name) const
+{
+    Q_ASSERT(canMatch(name));
+
+    const auto originalName = name;
+    FoldedString folded;
+    if (_caseInsensitive) {
+        appendCaseFolded(name, folded);
+        name = QStringView(folded.constData(), folded.size());
+    }
+    const auto size = name.size();
+    auto best = NoMatch;
+
+    // Literal names and "literal*"
+    for (qsizetype i = 0, node = 0; node >= 0; ++i) {
+        const auto &trieNode = _prefixTrie.nodes[node];
+        best = qMin(best, trieNode.wildcard);
+        if (i == size) {
+            best = qMin(best, trieNode.whole);
+            break;
+        }
+        node = _prefixTrie.child(node, name[i].unicode());
+    }
+    if (best == Exclude) {
+        return best;
+    }
+
+    // "*literal", walking backwards from the end of the name
+    for (qsizetype i = size, node = 0; node >= 0; --i) {
+        best = qMin(best, _suffixTrie.nodes[node].wildcard);
+        if (i == 0) {
+            break;
+        }
+        node = _suffixTrie.child(node, name[i - 1].unicode());
+    }
+    if (best == Exclude) {
+        return best;
+    }
+
+    for (const auto &glob : _globs) {
+        if (glob.match >= best) {
+            break;
+        }
+        if (glob.minimumLength <= size && globMatch(glob.tokens, name)) {
+            best = glob.match;
+        }
+    }
+
+    if (_hasRegex && best != Exclude) {
+        const auto m = _regex.match(originalName);
+        if (m.hasMatch()) {
+            if (m.capturedStart(QStringLiteral("exclude")) != -1) {
+                best = Exclude;
+            } else if (m.capturedStart(QStringLiteral("excluderemove")) != -1) {
+                best = qMin(best, ExcludeRemove);
+            } else {
+                best = qMin(best, Trigger);
+            }
+        }
+    }
+    return best;
+}
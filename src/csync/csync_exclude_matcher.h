@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2026 by Nextcloud GmbH <info@nextcloud.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _CSYNC_EXCLUDE_MATCHER_H
+#define _CSYNC_EXCLUDE_MATCHER_H
+
+#include "ocsynclib.h"
+
+#include <QHash>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * @brief Matches file names against the bname exclude patterns of a base path
+ *
+ * Gives the same results as the anchored bname regular expression that
+ * ExcludedFiles::prepare() builds from the same patterns, but compiles the
+ * glob patterns into tries instead of trying every alternative of one large
+ * regular expression:
+ *
+ * - Literal names ("Thumbs.db") and "literal*" patterns ("~$*") share a
+ *   prefix trie.
+ * - "*literal" patterns ("*.tmp", "*~") are kept in a trie of the reversed
+ *   literals, so all of them are checked by a single walk from the end of
+ *   the name.
+ * - The remaining patterns with * and ? wildcards are matched by a
+ *   backtracking glob matcher.
+ * - Only patterns with bracket expressions are left to a regular expression.
+ *
+ * Names containing line breaks or invalid UTF-16 must be matched with the
+ * regular expression, see canMatch().
+ */
+class OCSYNC_EXPORT ExcludeNameMatcher
+{
+public:
+    /// The kind of pattern that matched, by descending priority
+    enum Match {
+        Exclude,
+        ExcludeRemove,
+        Trigger,
+        NoMatch
+    };
+
+    explicit ExcludeNameMatcher(bool caseInsensitive = false);
+
+    /**
+     * Adds a glob pattern.
+     *
+     * regex is the pattern in ExcludedFiles::convertToRegexpSyntax() form.
+     * It is used for patterns the tries can't represent.
+     */
+    void addPattern(const QString &glob, const QString &regex, Match match);
+
+    /// Has to be called after the last addPattern() and before match()
+    void finalize();
+
+    /// Whether match() gives the same result as the regular expression for name
+    static bool canMatch(QStringView name);
+
+    /// The highest priority kind of pattern matching name
+    [[nodiscard]] Match match(QStringView name) const;
+
+private:
+    struct Token
+    {
+        enum Kind : quint8 {
+            Literal,
+            AnyChar,
+            AnyString
+        };
+        Kind kind;
+        char16_t ch;
+    };
+    using Tokens = QVector<Token>;
+
+    /// Characters are edges of the nodes, each node records the patterns ending there
+    struct Trie
+    {
+        struct Node
+        {
+            /// A literal pattern ends here, the name has to end here as well
+            Match whole = NoMatch;
+            /// The literal part of a pattern ends here, its * matches the rest of the name
+            Match wildcard = NoMatch;
+        };
+
+        Trie();
+        Node &insert(const Tokens &tokens, qsizetype begin, qsizetype end, bool reversed);
+        [[nodiscard]] int child(int node, char16_t ch) const;
+
+        QVector<Node> nodes;
+        QHash<quint64, int> edges;
+    };
+
+    struct Glob
+    {
+        Tokens tokens;
+        Match match;
+        qsizetype minimumLength;
+    };
+
+    /// Splits glob into tokens, false if it has a bracket expression
+    bool tokenize(const QString &glob, Tokens &tokens) const;
+    static bool globMatch(const Tokens &tokens, QStringView name);
+
+    bool _caseInsensitive;
+    Trie _prefixTrie;
+    Trie _suffixTrie;
+    QVector<Glob> _globs;
+
+    QStringList _regexPatterns[NoMatch];
+    QRegularExpression _regex;
+    bool _hasRegex = false;
+};
+
+#endif /* _CSYNC_EXCLUDE_MATCHER_H */
@@ -45,6 +45,7 @@
 #include "owncloudsetupwizard.h"
 #include "version.h"
 #include "csync_exclude.h"
+#include "common/checksumthreadpool.h"
 #include "common/vfs.h"
 
 #include "config.h"
@@ -366,6 +367,11 @@ Application::Application(int &argc, char **argv)
         AbstractNetworkJob::httpTimeout = cfg.timeout();
     }
 
+    // The checksum threads are initialized with an environment variable, if not, override with the value from the config
+    if (qEnvironmentVariableIsEmpty("OWNCLOUD_CHECKSUM_THREADS")) {
+        ChecksumThreadPool::instance()->setMaxThreadsPerDevice(cfg.checksumThreadsPerDevice());
+    }
+
     // Check vfs plugins
     if (Theme::instance()->showVirtualFilesOption() && bestAvailableVfsMode() == Vfs::Off) {
         qCWarning(lcApplication) << "Theme wants to show vfs mode, but no vfs plugins are available";
@@ -473,6 +479,9 @@ Application::~Application()
     disconnect(AccountManager::instance(), &AccountManager::accountRemoved,
         this, &Application::slotAccountStateRemoved);
     AccountManager::instance()->shutdown();
+
+    // Stop the log writer thread while the application still exists
+    Logger::instance()->setAsyncLogging(false);
 }
 
 void Application::setupAccountsAndFolders()
@@ -710,6 +719,7 @@ void Application::setupLogging()
     if (!logger->isLoggingToFile() && ConfigFile().automaticLogDir()) {
         logger->setupTemporaryFolderLogDir();
     }
+    logger->setAsyncLogging(ConfigFile().asyncLogging());
 
 #if defined QT_DEBUG
     logger->setLogFlush(true);
@@ -559,27 +559,36 @@ int Folder::slotWipeErrorBlacklist()
 }
 
 void Folder::slotWatchedPathChanged(const QStringView &path, const ChangeReason reason)
+{
+    // The entries of a coalesced directory were filtered by the folder watcher
+    if (reason != ChangeReason::DirectoryContent && !filterWatchedPath(path.toString())) {
+        return;
+    }
+    processWatchedPathChange(path, reason);
+}
+
+bool Folder::filterWatchedPath(const QString &path)
 {
     if (!path.startsWith(this->path())) {
         qCDebug(lcFolder) << "Changed path is not contained in folder, ignoring:" << path;
-        return;
+        return false;
     }
 
-    auto relativePath = path.mid(this->path().size());
+    const auto relativePath = path.mid(this->path().size());
 
     if (_vfs) {
-        if (pathIsIgnored(path.toString())) {
-            const auto pinState = _vfs->pinState(relativePath.toString());
+        if (pathIsIgnored(path)) {
+            const auto pinState = _vfs->pinState(relativePath);
             if (!pinState || *pinState != PinState::Excluded) {
-                if (!_vfs->setPinState(relativePath.toString(), PinState::Excluded)) {
+                if (!_vfs->setPinState(relativePath, PinState::Excluded)) {
                     qCWarning(lcFolder) << "Could not set pin state of" << relativePath << "to excluded";
                 }
             }
-            return;
+            return false;
         } else {
-            const auto pinState = _vfs->pinState(relativePath.toString());
+            const auto pinState = _vfs->pinState(relativePath);
             if (pinState && *pinState == PinState::Excluded) {
-                if (!_vfs->setPinState(relativePath.toString(), PinState::Inherited)) {
+                if (!_vfs->setPinState(relativePath, PinState::Inherited)) {
                     qCWarning(lcFolder) << "Could not switch pin state of" << relativePath << "from" << *pinState << "to inherited";
                 }
             }
@@ -590,8 +599,7 @@ void Folder::slotWatchedPathChanged(const QStringView &path, const ChangeReason
     //
     // We do this before checking for our own sync-related changes to make
     // extra sure to not miss relevant changes.
-    auto relativePathBytes = relativePath.toUtf8();
-    _localDiscoveryTracker->addTouchedPath(relativePathBytes);
+    _localDiscoveryTracker->addTouchedPath(relativePath.toUtf8());
 
 // The folder watcher fires a lot of bogus notifications during
 // a sync operation, both for actual user files and the database
@@ -602,18 +610,34 @@ void Folder::slotWatchedPathChanged(const QStringView &path, const ChangeReason
 // own process. Therefore nothing needs to be done here!
 #else
     // Use the path to figure out whether it was our own change
-    if (_engine->wasFileTouched(path.toString())) {
+    if (_engine->wasFileTouched(path)) {
         qCDebug(lcFolder) << "Changed path was touched by SyncEngine, ignoring:" << path;
-        return;
+        return false;
     }
 #endif
 
+    return true;
+}
+
+void Folder::processWatchedPathChange(const QStringView &path, const ChangeReason reason)
+{
+    if (!path.startsWith(this->path())) {
+        qCDebug(lcFolder) << "Changed path is not contained in folder, ignoring:" << path;
+        return;
+    }
+
+    auto relativePath = path.mid(this->path().size());
+    auto relativePathBytes = relativePath.toUtf8();
+    if (reason == ChangeReason::DirectoryContent) {
+        // everything below the directory is discovered again
+        _localDiscoveryTracker->addTouchedPath(relativePathBytes);
+    }
 
     SyncJournalFileRecord record;
     if (!_journal.getFileRecord(relativePathBytes, &record)) {
         qCWarning(lcFolder) << "could not get file from local DB" << relativePathBytes;
     }
-    if (reason != ChangeReason::UnLock) {
+    if (reason == ChangeReason::Other) {
         // Check that the mtime/size actually changed or there was
         // an attribute change (pin state) that caused the notification
         bool spurious = false;
@@ -1023,7 +1047,7 @@ bool Folder::reloadExcludes()
     return _engine->excludedFiles().reloadExcludeFiles();
 }
 
-void Folder::startSync(const QStringList &pathList)
+bool Folder::startSync(const QStringList &pathList)
 {
     Q_UNUSED(pathList);
     setSilenceErrorsUntilNextSync(false);
@@ -1034,7 +1058,7 @@ void Folder::startSync(const QStringList &pathList)
     }
     if (isBusy()) {
         qCCritical(lcFolder) << "ERROR csync is still running and new sync requested.";
-        return;
+        return false;
     }
 
     _timeSinceLastSyncStart.start();
@@ -1044,12 +1068,17 @@ void Folder::startSync(const QStringList &pathList)
     qCInfo(lcFolder) << "*** Start syncing " << remoteUrl().toString() << " -" << APPLICATION_NAME << "client version"
                      << qPrintable(Theme::instance()->version());
 
+    {
+        ConfigFile cfg;
+        _fileLog->setBuffered(cfg.bufferedSyncRunLog());
+        _fileLog->setFormat(cfg.compactSyncRunLog() ? SyncRunFileLog::Compact : SyncRunFileLog::Text);
+    }
     _fileLog->start(path());
 
     if (!reloadExcludes()) {
         slotSyncError(tr("Could not read system exclude file"), ErrorCategory::GenericError);
         QMetaObject::invokeMethod(this, "slotSyncFinished", Qt::QueuedConnection, Q_ARG(bool, false));
-        return;
+        return true;
     }
 
     setDirtyNetworkLimits();
@@ -1093,6 +1122,7 @@ void Folder::startSync(const QStringList &pathList)
     QMetaObject::invokeMethod(_engine.data(), "startSync", Qt::QueuedConnection);
 
     emit syncStarted();
+    return true;
 }
 
 void Folder::correctPlaceholderFiles()
@@ -1126,13 +1156,39 @@ SyncOptions Folder::initializeSyncOptions() const
     opt.setMaxChunkSize(cfgFile.maxChunkSize());
     opt._initialChunkSize = ::qBound(opt.minChunkSize(), cfgFile.chunkSize(), opt.maxChunkSize());
     opt._targetChunkUploadDuration = cfgFile.targetChunkUploadDuration();
+    opt._maxParallelChunkUploads = cfgFile.maxParallelChunkUploads();
+    opt._maxParallelDownloadSegments = cfgFile.maxParallelDownloadSegments();
+    opt._pipelinedPropagation = cfgFile.pipelinedSync();
+    opt._journalWriteBehind = cfgFile.journalWriteBehind();
+    opt._discoveryMetadataSnapshot = cfgFile.discoveryMetadataSnapshot();
+    opt._remoteDeltaDiscovery = cfgFile.remoteDeltaDiscovery();
+    opt._checksumWhileUploading = cfgFile.checksumWhileUploading();
+    opt._checksumCache = cfgFile.checksumCache();
 
     opt.fillFromEnvironmentVariables();
     opt.verifyChunkSizes();
 
+    // concurrently syncing folders split the requests of one sync between them
+    opt._parallelNetworkJobs = qMax(1, opt._parallelNetworkJobs / _networkBudgetShares);
+
     return opt;
 }
 
+void Folder::setNetworkBudgetShares(int shares)
+{
+    shares = qMax(1, shares);
+    if (shares == _networkBudgetShares) {
+        return;
+    }
+    _networkBudgetShares = shares;
+
+    if (isSyncRunning()) {
+        const auto parallelNetworkJobs = initializeSyncOptions()._parallelNetworkJobs;
+        qCInfo(lcFolder) << "Sharing the network with" << (shares - 1) << "other syncs, using" << parallelNetworkJobs << "parallel network jobs";
+        _engine->setParallelNetworkJobs(parallelNetworkJobs);
+    }
+}
+
 void Folder::setDirtyNetworkLimits()
 {
     const auto account = _accountState->account();
@@ -1601,8 +1657,11 @@ void Folder::registerFolderWatcher()
         return;
 
     _folderWatcher.reset(new FolderWatcher(this));
+    // the watcher runs filterWatchedPath() on every path it reports
     connect(_folderWatcher.data(), &FolderWatcher::pathChanged,
-        this, [this](const QString &path) { slotWatchedPathChanged(path, Folder::ChangeReason::Other); });
+        this, [this](const QString &path) { processWatchedPathChange(path, Folder::ChangeReason::Other); });
+    connect(_folderWatcher.data(), &FolderWatcher::directoryContentChanged,
+        this, [this](const QString &path) { processWatchedPathChange(path, Folder::ChangeReason::DirectoryContent); });
     connect(_folderWatcher.data(), &FolderWatcher::lostChanges,
         this, &Folder::slotNextSyncFullLocalDiscovery);
     connect(_folderWatcher.data(), &FolderWatcher::becameUnreliable,
@@ -1623,6 +1682,7 @@ void Folder::disconnectFolderWatcher()
         return;
     }
     disconnect(_folderWatcher.data(), &FolderWatcher::pathChanged, nullptr, nullptr);
+    disconnect(_folderWatcher.data(), &FolderWatcher::directoryContentChanged, nullptr, nullptr);
     disconnect(_folderWatcher.data(), &FolderWatcher::lostChanges, this, &Folder::slotNextSyncFullLocalDiscovery);
     disconnect(_folderWatcher.data(), &FolderWatcher::becameUnreliable, this, &Folder::slotWatcherUnreliable);
     if (_accountState->account()->capabilities().filesLockAvailable()) {
@@ -112,7 +112,9 @@ class Folder : public QObject
 public:
     enum class ChangeReason {
         Other,
-        UnLock
+        UnLock,
+        /// Many entries of the directory changed, see FolderWatcher::directoryContentChanged()
+        DirectoryContent
     };
     Q_ENUM(ChangeReason)
 
@@ -215,6 +217,15 @@ public:
 
     void setDirtyNetworkLimits();
 
+    /**
+     * The number of syncs that share the network budget of a single sync
+     * with this folder's sync, including itself.
+     *
+     * Divides the number of parallel network jobs of the next and the
+     * running sync.
+     */
+    void setNetworkBudgetShares(int shares);
+
     /**
       * Ignore syncing of hidden files or not. This is defined in the
       * folder definition
@@ -241,6 +252,16 @@ public:
     /* Check if the path is ignored. */
     [[nodiscard]] bool pathIsIgnored(const QString &path) const;
 
+    /**
+      * Checks a path reported by the folder watcher before it can be
+      * coalesced with others.
+      *
+      * Updates the pin state of ignored files and the touched paths of the
+      * local discovery. Returns false if the change was made by this folder's
+      * own sync or the path is ignored, so no sync is needed for it.
+      */
+    bool filterWatchedPath(const QString &path);
+
     /**
       * Returns whether a file inside this folder should be excluded.
       */
@@ -339,8 +360,11 @@ public slots:
       * Starts a sync operation
       *
       * If the list of changed files is known, it is passed.
+      *
+      * Returns false if the sync is not started because the folder is busy.
+      * syncStarted() and syncFinished() are only emitted when it returns true.
       */
-    void startSync(const QStringList &pathList = QStringList());
+    bool startSync(const QStringList &pathList = QStringList());
 
     int slotDiscardDownloadProgress();
     int downloadInfoCount();
@@ -474,6 +498,9 @@ private:
 
     SyncOptions initializeSyncOptions() const;
 
+    /// slotWatchedPathChanged() for a path that passed filterWatchedPath()
+    void processWatchedPathChange(const QStringView &path, const ChangeReason reason);
+
     enum LogStatus {
         LogStatusRemove,
         LogStatusRename,
@@ -519,6 +546,9 @@ private:
     /// Reset when no follow-up is requested.
     int _consecutiveFollowUpSyncs = 0;
 
+    /// See setNetworkBudgetShares()
+    int _networkBudgetShares = 1;
+
     mutable SyncJournalDb _journal;
 
     QScopedPointer<SyncRunFileLog> _fileLog;
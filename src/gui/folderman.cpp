@@ -44,6 +44,7 @@ constexpr auto settingsAccountsC = "Accounts";
 constexpr auto settingsFoldersC = "Folders";
 constexpr auto settingsVersionC = "version";
 constexpr auto maxFoldersVersion = 1;
+constexpr auto maxParallelEtagJobsPerAccount = 4;
 }
 
 namespace OCC {
@@ -69,6 +70,13 @@ FolderMan::FolderMan(QObject *parent)
     QObject::connect(&_etagPollTimer, &QTimer::timeout, this, &FolderMan::slotEtagPollTimerTimeout);
     _etagPollTimer.start();
 
+    _maxConcurrentSyncs = cfg.maxConcurrentSyncs();
+    if (const auto maxConcurrentSyncs = qEnvironmentVariableIntValue("OWNCLOUD_MAX_CONCURRENT_SYNCS"); maxConcurrentSyncs > 0) {
+        _maxConcurrentSyncs = maxConcurrentSyncs;
+    }
+    _maxConcurrentSyncs = qMax(1, _maxConcurrentSyncs);
+    qCInfo(lcFolderMan) << "Syncing up to" << _maxConcurrentSyncs << "folders at the same time";
+
     _startScheduledSyncTimer.setSingleShot(true);
     connect(&_startScheduledSyncTimer, &QTimer::timeout,
         this, &FolderMan::slotStartScheduledFolderSync);
@@ -117,6 +125,11 @@ void FolderMan::unloadFolder(Folder *f)
 
     _folderMap.remove(f->alias());
 
+    // the finished signal is disconnected below
+    if (_runningSyncFolders.removeAll(f) > 0) {
+        rebalanceNetworkBudget();
+    }
+
     disconnect(f, &Folder::syncStarted,
         this, &FolderMan::slotFolderSyncStarted);
     disconnect(f, &Folder::syncFinished,
@@ -147,7 +160,7 @@ int FolderMan::unloadAndDeleteAllFolders()
     ASSERT(_folderMap.isEmpty());
 
     _lastSyncFolder = nullptr;
-    _currentSyncFolder = nullptr;
+    _runningSyncFolders.clear();
     _scheduledFolders.clear();
     emit folderListChanged(_folderMap);
     emit scheduleQueueChanged();
@@ -651,13 +664,29 @@ void FolderMan::scheduleAllFolders()
 
 void FolderMan::forceSyncForFolder(Folder *folder)
 {
-    // Terminate and reschedule any running sync
+    // Terminate and reschedule the running syncs that would keep the folder
+    // from starting: its own one and those of overlapping folders. The
+    // others continue, unless all sync slots are taken; then one of them
+    // makes room.
+    QList<Folder *> preempted;
+    QList<Folder *> others;
     for (const auto folderInMap : map()) {
-        if (folderInMap->isSyncRunning()) {
-            folderInMap->slotTerminateSync();
-            scheduleFolder(folderInMap);
+        if (!folderInMap->isSyncRunning()) {
+            continue;
+        }
+        if (folderInMap == folder || remotePathsOverlap(folderInMap, folder)) {
+            preempted.append(folderInMap);
+        } else {
+            others.append(folderInMap);
         }
     }
+    if (preempted.isEmpty() && !others.isEmpty() && runningSyncCount() >= _maxConcurrentSyncs) {
+        preempted.append(others.last());
+    }
+    for (const auto runningFolder : qAsConst(preempted)) {
+        runningFolder->slotTerminateSync();
+        scheduleFolder(runningFolder);
+    }
 
     folder->slotWipeErrorBlacklist(); // issue #6757
     folder->setSyncPaused(false);
@@ -747,39 +776,68 @@ void FolderMan::scheduleFolderNext(Folder *f)
 void FolderMan::slotScheduleETagJob(const QString & /*alias*/, RequestEtagJob *job)
 {
     QObject::connect(job, &QObject::destroyed, this, &FolderMan::slotEtagJobDestroyed);
-    QMetaObject::invokeMethod(this, "slotRunOneEtagJob", Qt::QueuedConnection);
-    // maybe: add to queue
+    QMetaObject::invokeMethod(this, "slotRunEtagJobs", Qt::QueuedConnection);
 }
 
 void FolderMan::slotEtagJobDestroyed(QObject * /*o*/)
 {
-    // _currentEtagJob is automatically cleared
-    // maybe: remove from queue
-    QMetaObject::invokeMethod(this, "slotRunOneEtagJob", Qt::QueuedConnection);
+    // _startedEtagJobs is automatically cleared
+    QMetaObject::invokeMethod(this, "slotRunEtagJobs", Qt::QueuedConnection);
 }
 
-void FolderMan::slotRunOneEtagJob()
+void FolderMan::slotRunEtagJobs()
 {
-    if (_currentEtagJob.isNull()) {
-        Folder *folder = nullptr;
-        for (Folder *f : qAsConst(_folderMap)) {
-            if (f->etagJob()) {
-                // Caveat: always grabs the first folder with a job, but we think this is Ok for now and avoids us having a separate queue.
-                _currentEtagJob = f->etagJob();
-                folder = f;
-                break;
-            }
+    _startedEtagJobs.removeAll(nullptr);
+
+    // Only started jobs have a reply, the shared ones don't. A job whose reply
+    // finished already emitted etagRetrieved and is only waiting to be destroyed,
+    // so it neither counts as running nor can it share its response anymore.
+    const auto isRunning = [](const QPointer<RequestEtagJob> &job) {
+        return job->reply() && !job->reply()->isFinished();
+    };
+    const auto runningJobs = [this, &isRunning](const AccountPtr &account) {
+        return std::count_if(_startedEtagJobs.cbegin(), _startedEtagJobs.cend(), [&isRunning, &account](const QPointer<RequestEtagJob> &job) {
+            return isRunning(job) && job->account() == account;
+        });
+    };
+
+    auto pendingJobs = false;
+    for (Folder *f : qAsConst(_folderMap)) {
+        const auto job = f->etagJob();
+        if (!job || _startedEtagJobs.contains(job)) {
+            continue;
         }
-        if (_currentEtagJob.isNull()) {
-            //qCDebug(lcFolderMan) << "No more remote ETag check jobs to schedule.";
 
-            /* now it might be a good time to check for restarting... */
-            if (!isAnySyncRunning() && _appRestartRequired) {
-                restartApplication();
-            }
-        } else {
-            qCDebug(lcFolderMan) << "Scheduling" << folder->remoteUrl().toString() << "to check remote ETag";
-            _currentEtagJob->start(); // on destroy/end it will continue the queue via slotEtagJobDestroyed
+        // Folders with the same remote folder share the request and its response
+        const auto account = job->account();
+        const auto sameRequest = std::find_if(_startedEtagJobs.cbegin(), _startedEtagJobs.cend(), [&isRunning, &job, &account](const QPointer<RequestEtagJob> &started) {
+            return isRunning(started) && started->account() == account && started->path() == job->path();
+        });
+        if (sameRequest != _startedEtagJobs.cend()) {
+            qCDebug(lcFolderMan) << f->remoteUrl().toString() << "shares the running ETag check of the same remote folder";
+            connect(sameRequest->data(), &RequestEtagJob::etagRetrieved, job, &RequestEtagJob::etagRetrieved);
+            connect(sameRequest->data(), &QObject::destroyed, job, &QObject::deleteLater);
+            _startedEtagJobs.append(job);
+            continue;
+        }
+
+        // The folders of an account are checked in parallel, up to a limit
+        if (runningJobs(account) >= maxParallelEtagJobsPerAccount) {
+            pendingJobs = true;
+            continue;
+        }
+
+        qCDebug(lcFolderMan) << "Scheduling" << f->remoteUrl().toString() << "to check remote ETag";
+        _startedEtagJobs.append(job);
+        job->start(); // on destroy/end it will continue the queue via slotEtagJobDestroyed
+    }
+
+    if (_startedEtagJobs.isEmpty() && !pendingJobs) {
+        //qCDebug(lcFolderMan) << "No more remote ETag check jobs to schedule.";
+
+        /* now it might be a good time to check for restarting... */
+        if (!isAnySyncRunning() && _appRestartRequired) {
+            restartApplication();
         }
     }
 }
@@ -847,7 +905,7 @@ void FolderMan::startScheduledSyncSoon()
     if (_scheduledFolders.empty()) {
         return;
     }
-    if (isAnySyncRunning()) {
+    if (runningSyncCount() >= _maxConcurrentSyncs) {
         return;
     }
 
@@ -891,14 +949,6 @@ void FolderMan::startScheduledSyncSoon()
   */
 void FolderMan::slotStartScheduledFolderSync()
 {
-    if (isAnySyncRunning()) {
-        for (auto f : qAsConst(_folderMap)) {
-            if (f->isSyncRunning())
-                qCInfo(lcFolderMan) << "Currently folder " << f->remoteUrl().toString() << " is running, wait for finish!";
-        }
-        return;
-    }
-
     if (!_syncEnabled) {
         qCInfo(lcFolderMan) << "FolderMan: Syncing is disabled, no scheduling.";
         return;
@@ -909,27 +959,106 @@ void FolderMan::slotStartScheduledFolderSync()
         return;
     }
 
-    // Find the first folder in the queue that can be synced.
-    Folder *folder = nullptr;
-    while (!_scheduledFolders.isEmpty()) {
-        Folder *g = _scheduledFolders.dequeue();
-        if (g->canSync()) {
-            folder = g;
-            break;
+    // Folders that can't be synced anymore leave the queue.
+    QMutableListIterator<Folder *> it(_scheduledFolders);
+    while (it.hasNext()) {
+        if (!it.next()->canSync()) {
+            it.remove();
         }
     }
 
-    emit scheduleQueueChanged();
+    // Start syncing as many folders as allowed!
+    while (runningSyncCount() < _maxConcurrentSyncs) {
+        const auto folder = dequeueNextSyncFolder();
+        if (!folder) {
+            break;
+        }
 
-    // Start syncing this folder!
-    if (folder) {
         // Safe to call several times, and necessary to try again if
         // the folder path didn't exist previously.
         folder->registerFolderWatcher();
         registerFolderWithSocketApi(folder);
 
-        _currentSyncFolder = folder;
-        folder->startSync(QStringList());
+        _runningSyncFolders.append(folder);
+        rebalanceNetworkBudget();
+        if (!folder->startSync(QStringList())) {
+            // no syncFinished() will arrive for it
+            qCWarning(lcFolderMan) << "Folder" << folder->alias() << "refused to start syncing";
+            _runningSyncFolders.removeAll(folder);
+            folder->setNetworkBudgetShares(1);
+            rebalanceNetworkBudget();
+        }
+    }
+
+    if (!_scheduledFolders.isEmpty()) {
+        for (auto f : qAsConst(_folderMap)) {
+            if (f->isSyncRunning())
+                qCInfo(lcFolderMan) << "Currently folder " << f->remoteUrl().toString() << " is running, wait for finish!";
+        }
+    }
+
+    emit scheduleQueueChanged();
+}
+
+int FolderMan::runningSyncCount() const
+{
+    int count = _runningSyncFolders.size();
+    for (auto f : _folderMap) {
+        if (f->isSyncRunning() && !_runningSyncFolders.contains(f)) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+bool FolderMan::canSyncConcurrently(Folder *folder) const
+{
+    if (folder->isSyncRunning() || _runningSyncFolders.contains(folder)) {
+        return false;
+    }
+
+    return std::none_of(_runningSyncFolders.cbegin(), _runningSyncFolders.cend(), [folder](Folder *running) {
+        return remotePathsOverlap(folder, running);
+    });
+}
+
+bool FolderMan::remotePathsOverlap(const Folder *folder, const Folder *other)
+{
+    if (folder->accountState() != other->accountState()) {
+        return false;
+    }
+    const auto remotePath = Utility::trailingSlashPath(folder->remotePath());
+    const auto otherRemotePath = Utility::trailingSlashPath(other->remotePath());
+    return remotePath.startsWith(otherRemotePath) || otherRemotePath.startsWith(remotePath);
+}
+
+Folder *FolderMan::dequeueNextSyncFolder()
+{
+    auto next = -1;
+    auto nextRunningOfAccount = 0;
+    for (int i = 0; i < _scheduledFolders.size(); ++i) {
+        const auto folder = _scheduledFolders.at(i);
+        if (!canSyncConcurrently(folder)) {
+            continue;
+        }
+        const auto runningOfAccount = static_cast<int>(std::count_if(_runningSyncFolders.cbegin(), _runningSyncFolders.cend(), [folder](Folder *running) {
+            return running->accountState() == folder->accountState();
+        }));
+        if (next < 0 || runningOfAccount < nextRunningOfAccount) {
+            next = i;
+            nextRunningOfAccount = runningOfAccount;
+        }
+        if (runningOfAccount == 0) {
+            break;
+        }
+    }
+    return next < 0 ? nullptr : _scheduledFolders.takeAt(next);
+}
+
+void FolderMan::rebalanceNetworkBudget()
+{
+    for (const auto folder : qAsConst(_runningSyncFolders)) {
+        folder->setNetworkBudgetShares(_runningSyncFolders.size());
     }
 }
 
@@ -1126,7 +1255,7 @@ void FolderMan::slotScheduleFolderByTime()
 
 bool FolderMan::isAnySyncRunning() const
 {
-    if (_currentSyncFolder)
+    if (!_runningSyncFolders.isEmpty())
         return true;
 
     for (auto f : _folderMap) {
@@ -1167,12 +1296,12 @@ void FolderMan::slotFolderSyncFinished(const SyncResult &)
         qPrintable(f->accountState()->account()->displayName()),
         qPrintable(f->remoteUrl().toString()));
 
-    if (f == _currentSyncFolder) {
-        _lastSyncFolder = _currentSyncFolder;
-        _currentSyncFolder = nullptr;
+    if (_runningSyncFolders.removeAll(f) > 0) {
+        _lastSyncFolder = f;
+        f->setNetworkBudgetShares(1);
+        rebalanceNetworkBudget();
     }
-    if (!isAnySyncRunning())
-        startScheduledSyncSoon();
+    startScheduledSyncSoon();
 }
 
 Folder *FolderMan::addFolder(AccountState *accountState, const FolderDefinition &folderDefinition)
@@ -1461,10 +1590,10 @@ void FolderMan::slotWipeFolderForAccount(AccountState *accountState)
 
         qCInfo(lcFolderMan) << "Removing " << f->alias();
 
-        const bool currentlyRunning = (_currentSyncFolder == f);
+        const bool currentlyRunning = f->isSyncRunning();
         if (currentlyRunning) {
             // abort the sync now
-            _currentSyncFolder->slotTerminateSync();
+            f->slotTerminateSync();
         }
 
         if (_scheduledFolders.removeAll(f) > 0) {
@@ -1966,9 +2095,9 @@ QQueue<Folder *> FolderMan::scheduleQueue() const
     return _scheduledFolders;
 }
 
-Folder *FolderMan::currentSyncFolder() const
+QList<Folder *> FolderMan::runningSyncFolders() const
 {
-    return _currentSyncFolder;
+    return _runningSyncFolders;
 }
 
 void FolderMan::restartApplication()
@@ -2014,6 +2143,39 @@ void FolderMan::slotProcessFilesPushNotification(Account *account)
     }
 }
 
+void FolderMan::slotProcessFileIdsPushNotification(Account *account, const QList<qint64> &fileIds)
+{
+    qCInfo(lcFolderMan) << "Got files push notification for" << fileIds.size() << "file ids of account" << account;
+
+    // Only the folders that know the files are synced. Their discovery still
+    // starts at the root, the etags of the directories of the files are only
+    // invalidated so that it doesn't stop above them.
+    QSet<qint64> foundFileIds;
+    QList<Folder *> foldersToSchedule;
+    for (auto folder : qAsConst(_folderMap)) {
+        if (folder->accountState()->account() != account) {
+            continue;
+        }
+        const auto folderFileIds = folder->journalDb()->scheduleFileIdsForRemoteDiscovery(fileIds);
+        if (!folderFileIds.isEmpty()) {
+            foundFileIds.unite(folderFileIds);
+            foldersToSchedule.append(folder);
+        }
+    }
+
+    // New files and files outside of the sync folders are not in any journal
+    if (foundFileIds.size() < QSet<qint64>(fileIds.cbegin(), fileIds.cend()).size()) {
+        qCInfo(lcFolderMan) << "Not all file ids are known, scheduling all folders of the account";
+        slotProcessFilesPushNotification(account);
+        return;
+    }
+
+    for (const auto folder : qAsConst(foldersToSchedule)) {
+        qCInfo(lcFolderMan) << "Schedule folder" << folder << "for sync";
+        scheduleFolder(folder);
+    }
+}
+
 void FolderMan::slotConnectToPushNotifications(Account *account)
 {
     const auto pushNotifications = account->pushNotifications();
@@ -2021,6 +2183,7 @@ void FolderMan::slotConnectToPushNotifications(Account *account)
     if (pushNotificationsFilesReady(account)) {
         qCInfo(lcFolderMan) << "Push notifications ready";
         connect(pushNotifications, &PushNotifications::filesChanged, this, &FolderMan::slotProcessFilesPushNotification, Qt::UniqueConnection);
+        connect(pushNotifications, &PushNotifications::fileIdsChanged, this, &FolderMan::slotProcessFileIdsPushNotification, Qt::UniqueConnection);
     }
 }
 
@@ -32,6 +32,7 @@ class TestShareModel;
 class ShareTestHelper;
 class EndToEndTestHelper;
 class TestSyncConflictsModel;
+class TestSocketApi;
 
 namespace OCC {
 
@@ -56,7 +57,7 @@ class UpdateE2eeFolderUsersMetadataJob;
  *   (_folderWatchers and Folder::slotWatchedPathChanged())
  *
  * - The folder etag on the server has changed
- *   (_etagPollTimer)
+ *   (_etagPollTimer and slotRunEtagJobs())
  *
  * - The locks of a monitored file are released
  *   (_lockWatcher and slotWatchedFileUnlocked())
@@ -64,6 +65,10 @@ class UpdateE2eeFolderUsersMetadataJob;
  * - There was a sync error or a follow-up sync is requested
  *   (_timeScheduler and slotScheduleFolderByTime()
  *    and Folder::slotSyncFinished())
+ *
+ * Up to maxConcurrentSyncs scheduled folders sync at the same time and
+ * share the number of parallel network jobs of a single sync
+ * (_runningSyncFolders and slotStartScheduledFolderSync()).
  */
 class FolderMan : public QObject
 {
@@ -186,14 +191,14 @@ public:
     [[nodiscard]] QQueue<Folder *> scheduleQueue() const;
 
     /**
-     * Access to the currently syncing folder.
+     * Access to the currently syncing folders.
      *
-     * Note: This is only the folder that's currently syncing *as-scheduled*. There
-     * may be externally-managed syncs such as from placeholder hydrations.
+     * Note: These are only the folders that are currently syncing *as-scheduled*.
+     * There may be externally-managed syncs such as from placeholder hydrations.
      *
      * See also isAnySyncRunning()
      */
-    [[nodiscard]] Folder *currentSyncFolder() const;
+    [[nodiscard]] QList<Folder *> runningSyncFolders() const;
 
     /**
      * Returns true if any folder is currently syncing.
@@ -291,7 +296,7 @@ private slots:
     void slotFolderSyncStarted();
     void slotFolderSyncFinished(const OCC::SyncResult &);
 
-    void slotRunOneEtagJob();
+    void slotRunEtagJobs();
     void slotEtagJobDestroyed(QObject *);
 
     // slot to take the next folder from queue and start syncing.
@@ -326,6 +331,7 @@ private slots:
 
     void slotSetupPushNotifications(const OCC::Folder::Map &);
     void slotProcessFilesPushNotification(OCC::Account *account);
+    void slotProcessFileIdsPushNotification(OCC::Account *account, const QList<qint64> &fileIds);
     void slotConnectToPushNotifications(OCC::Account *account);
 
     void slotLeaveShare(const QString &localFile, const QByteArray &folderToken = {});
@@ -343,6 +349,32 @@ private:
     /** Will start a sync after a bit of delay. */
     void startScheduledSyncSoon();
 
+    /** The number of running syncs, including externally-managed ones */
+    [[nodiscard]] int runningSyncCount() const;
+
+    /**
+     * Whether the folder may start syncing while the running syncs continue.
+     *
+     * Folders of the same account whose remote paths contain each other
+     * are synced one after the other.
+     */
+    [[nodiscard]] bool canSyncConcurrently(Folder *folder) const;
+
+    /** Whether the two folders belong to the same account and one remote path contains the other */
+    [[nodiscard]] static bool remotePathsOverlap(const Folder *folder, const Folder *other);
+
+    /**
+     * Removes the next folder to sync from the queue.
+     *
+     * Prefers the folders of accounts with the fewest running syncs, so one
+     * account with many folders does not delay the folders of the others.
+     * Returns nullptr if no queued folder can start now.
+     */
+    Folder *dequeueNextSyncFolder();
+
+    /** Splits the network budget of a single sync between the running syncs */
+    void rebalanceNetworkBudget();
+
     // finds all folder configuration files
     // and create the folders
     [[nodiscard]] QString getBackupName(QString fullPathName) const;
@@ -367,8 +399,11 @@ private:
     QSet<Folder *> _disabledFolders;
     Folder::Map _folderMap;
     QString _folderConfigPath;
-    Folder *_currentSyncFolder = nullptr;
+    /// The folders whose scheduled syncs are running
+    QList<Folder *> _runningSyncFolders;
     QPointer<Folder> _lastSyncFolder;
+    /// Maximum number of scheduled syncs that run at the same time
+    int _maxConcurrentSyncs = 1;
     bool _syncEnabled = true;
 
     /// Folder aliases from the settings that weren't read
@@ -376,8 +411,8 @@ private:
 
     /// Starts regular etag query jobs
     QTimer _etagPollTimer;
-    /// The currently running etag query
-    QPointer<RequestEtagJob> _currentEtagJob;
+    /// The started etag queries, and the ones sharing the request of a started one
+    QList<QPointer<RequestEtagJob>> _startedEtagJobs;
 
     /// Watches files that couldn't be synced due to locks
     QScopedPointer<LockWatcher> _lockWatcher;
@@ -405,6 +440,7 @@ private:
     friend class OCC::Application;
     friend class ::TestFolderMan;
     friend class ::TestSyncConflictsModel;
+    friend class ::TestSocketApi;
     friend class ::TestCfApiShellExtensionsIPC;
     friend class ::ShareTestHelper;
     friend class ::EndToEndTestHelper;
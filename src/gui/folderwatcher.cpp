@@ -42,6 +42,11 @@
 namespace
 {
 constexpr auto lockChangeDebouncingTimerIntervalMs = 500;
+
+// After a change was emitted, further changed paths are collected for this long
+constexpr auto coalescingIntervalMs = 200;
+// A directory with more changed entries than this is reported as a whole
+constexpr auto coalescingChildThreshold = 32;
 }
 
 namespace OCC {
@@ -54,6 +59,10 @@ FolderWatcher::FolderWatcher(Folder *folder)
 {
     _lockChangeDebouncingTimer.setInterval(lockChangeDebouncingTimerIntervalMs);
 
+    _coalescingTimer.setSingleShot(true);
+    _coalescingTimer.setInterval(coalescingIntervalMs);
+    connect(&_coalescingTimer, &QTimer::timeout, this, &FolderWatcher::flushChangedPaths);
+
     if (_folder && _folder->accountState() && _folder->accountState()->account()) {
         connect(_folder->accountState()->account().data(), &Account::capabilitiesChanged, this, &FolderWatcher::folderAccountCapabilitiesChanged);
         folderAccountCapabilitiesChanged();
@@ -64,6 +73,10 @@ FolderWatcher::~FolderWatcher() = default;
 
 void FolderWatcher::init(const QString &root)
 {
+    _root = root;
+    if (_root.endsWith(QLatin1Char('/'))) {
+        _root.chop(1);
+    }
     _d.reset(new FolderWatcherPrivate(this, root));
     _timer.start();
 }
@@ -174,6 +187,11 @@ int FolderWatcher::lockChangeDebouncingTimout() const
     return _lockChangeDebouncingTimer.interval();
 }
 
+FolderWatcher::CoalescingStatistics FolderWatcher::coalescingStatistics() const
+{
+    return _coalescingStatistics;
+}
+
 void FolderWatcher::changeDetected(const QString &path)
 {
     QStringList paths(path);
@@ -191,6 +209,8 @@ void FolderWatcher::changeDetected(const QStringList &paths)
     //   - what if there is more than one file being updated frequently?
     //   - why do we skip the file altogether instead of e.g. reducing the upload frequency?
 
+    _coalescingStatistics.receivedPaths += paths.size();
+
     // Check if the same path was reported within the last second.
     const auto pathsSet = QSet<QString>{paths.begin(), paths.end()};
     if (pathsSet == _lastPaths && _timer.elapsed() < 1000) {
@@ -230,6 +250,12 @@ void FolderWatcher::changeDetected(const QStringList &paths)
             continue;
         }
 
+        // ------- and the changes of the folder's own sync,
+        // before they can be hidden in a coalesced directory
+        if (_folder && !_folder->filterWatchedPath(path)) {
+            continue;
+        }
+
         changedPaths.insert(path);
     }
 
@@ -250,9 +276,86 @@ void FolderWatcher::changeDetected(const QStringList &paths)
     }
 
     qCInfo(lcFolderWatcher) << "Detected changes in paths:" << changedPaths;
-    for (const auto &path : changedPaths) {
+    if (!_coalescingTimer.isActive() && changedPaths.size() <= coalescingChildThreshold) {
+        // No burst going on: report the change right away, and collect what follows
+        _coalescingStatistics.emittedPaths += changedPaths.size();
+        for (const auto &path : qAsConst(changedPaths)) {
+            emit pathChanged(path);
+        }
+    } else {
+        for (const auto &path : qAsConst(changedPaths)) {
+            addChangedPath(path);
+        }
+    }
+    if (!_coalescingTimer.isActive()) {
+        _coalescingTimer.start();
+    }
+}
+
+void FolderWatcher::addChangedPath(const QString &path)
+{
+    if (_changedPaths.isEmpty()) {
+        _changedPaths.append(ChangedPathNode());
+    }
+
+    auto node = 0;
+    const auto components = path.split(QLatin1Char('/'));
+    for (const auto &component : components) {
+        auto child = _changedPaths.at(node).children.value(component, -1);
+        if (child < 0) {
+            child = _changedPaths.size();
+            _changedPaths[node].children.insert(component, child);
+            _changedPaths.append(ChangedPathNode());
+        }
+        node = child;
+    }
+    _changedPaths[node].changed = true;
+}
+
+void FolderWatcher::collectChangedPaths(int node, const QString &path, QStringList &paths, QStringList &directories) const
+{
+    const auto &pathNode = _changedPaths.at(node);
+
+    // Only directories inside of the folder can be reported as a whole
+    if (pathNode.children.size() > coalescingChildThreshold && !_root.isEmpty() && path.startsWith(_root + QLatin1Char('/'))) {
+        directories.append(path);
+        return;
+    }
+
+    if (pathNode.changed) {
+        paths.append(path);
+    }
+    for (auto it = pathNode.children.cbegin(); it != pathNode.children.cend(); ++it) {
+        collectChangedPaths(it.value(), node == 0 ? it.key() : path + QLatin1Char('/') + it.key(), paths, directories);
+    }
+}
+
+void FolderWatcher::flushChangedPaths()
+{
+    if (_changedPaths.isEmpty()) {
+        // the burst is over
+        return;
+    }
+
+    QStringList paths;
+    QStringList directories;
+    collectChangedPaths(0, QString(), paths, directories);
+    _changedPaths.clear();
+    _coalescingStatistics.emittedPaths += paths.size() + directories.size();
+
+    if (!directories.isEmpty()) {
+        qCInfo(lcFolderWatcher) << "Coalesced the changes below" << directories << "," << _coalescingStatistics.receivedPaths << "paths received and"
+                                << _coalescingStatistics.emittedPaths << "emitted so far";
+    }
+    for (const auto &path : qAsConst(paths)) {
         emit pathChanged(path);
     }
+    for (const auto &directory : qAsConst(directories)) {
+        emit directoryContentChanged(directory);
+    }
+
+    // keep collecting while the burst goes on
+    _coalescingTimer.start();
 }
 
 void FolderWatcher::folderAccountCapabilitiesChanged()
@@ -85,11 +85,28 @@ public:
     void setShouldWatchForFileUnlocking(bool shouldWatchForFileUnlocking);
     [[nodiscard]] int lockChangeDebouncingTimout() const;
 
+    /// Counts of the changed paths the watcher got and of the notifications it emitted for them
+    struct CoalescingStatistics
+    {
+        qint64 receivedPaths = 0;
+        qint64 emittedPaths = 0;
+    };
+    [[nodiscard]] CoalescingStatistics coalescingStatistics() const;
+
 signals:
     /** Emitted when one of the watched directories or one
      *  of the contained files is changed. */
     void pathChanged(const QString &path);
 
+    /**
+     * Emitted for a directory instead of pathChanged() for each of its entries
+     * when many of them changed at once, like during a checkout or a build.
+     * Everything below the directory has to be discovered again.
+     *
+     * Only entries that passed Folder::filterWatchedPath() are counted.
+     */
+    void directoryContentChanged(const QString &path);
+
     /*
     * Emitted when lock files were removed
     */
@@ -127,6 +144,7 @@ protected slots:
 private slots:
     void startNotificationTestWhenReady();
     void lockChangeDebouncingTimerTimedOut();
+    void flushChangedPaths();
 
 protected:
     QHash<QString, int> _pendingPathes;
@@ -142,6 +160,15 @@ private:
 
     void appendSubPaths(QDir dir, QStringList& subPaths);
 
+    /// A path component of the changed paths collected by changeDetected()
+    struct ChangedPathNode
+    {
+        QHash<QString, int> children;
+        bool changed = false;
+    };
+    void addChangedPath(const QString &path);
+    void collectChangedPaths(int node, const QString &path, QStringList &paths, QStringList &directories) const;
+
     /* Check if the path should be ignored by the FolderWatcher. */
     [[nodiscard]] bool pathIsIgnored(const QString &path) const;
 
@@ -153,6 +180,14 @@ private:
 
     QTimer _lockChangeDebouncingTimer;
 
+    /// The root of the folder, without a trailing slash
+    QString _root;
+
+    /// The changed paths since the last flushChangedPaths(), as a tree of path components
+    QVector<ChangedPathNode> _changedPaths;
+    QTimer _coalescingTimer;
+    CoalescingStatistics _coalescingStatistics;
+
     friend class FolderWatcherPrivate;
 };
 }
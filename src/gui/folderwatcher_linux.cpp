@@ -14,16 +14,38 @@
 
 #include "config.h"
 
+#include <sys/fanotify.h>
 #include <sys/inotify.h>
+#include <sys/vfs.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "folder.h"
 #include "folderwatcher_linux.h"
 
 #include <cerrno>
+#include <climits>
+#include <cstring>
+#include <utility>
+#include <QElapsedTimer>
 #include <QStringList>
 #include <QObject>
 #include <QVarLengthArray>
 
+namespace {
+#ifdef FAN_REPORT_DFID_NAME
+constexpr auto fanotifyMask = FAN_CLOSE_WRITE | FAN_ATTRIB | FAN_MOVED_FROM | FAN_MOVED_TO | FAN_CREATE | FAN_DELETE | FAN_ONDIR;
+#endif
+constexpr auto maximumCachedFanotifyHandles = 10000;
+
+constexpr uint32_t inotifyMask = IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVE | IN_CREATE | IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF | IN_UNMOUNT | IN_ONLYDIR;
+
+// The registrar hands over the new watches in batches of this size, or at this interval
+constexpr auto registrationBatchSize = 256;
+constexpr auto registrationBatchIntervalMsecs = 100;
+constexpr auto registrationProgressInterval = 10000;
+}
+
 namespace OCC {
 
 FolderWatcherPrivate::FolderWatcherPrivate(FolderWatcher *p, const QString &path)
@@ -31,6 +53,11 @@ FolderWatcherPrivate::FolderWatcherPrivate(FolderWatcher *p, const QString &path
     , _parent(p)
     , _folder(path)
 {
+    if (fanotifyInit()) {
+        qCInfo(lcFolderWatcher) << "Watching" << path << "with the fanotify mark of its file system";
+        return;
+    }
+
     _fd = inotify_init();
     if (_fd != -1) {
         _socket.reset(new QSocketNotifier(_fd, QSocketNotifier::Read));
@@ -39,34 +66,389 @@ FolderWatcherPrivate::FolderWatcherPrivate(FolderWatcher *p, const QString &path
         qCWarning(lcFolderWatcher) << "notify_init() failed: " << strerror(errno);
     }
 
+    if (_fd != -1) {
+        _registrar = new InotifyWatchRegistrar(_fd, [p](const QString &path) { return p->pathIsIgnored(path); });
+        _registrar->moveToThread(&_registrarThread);
+        connect(&_registrarThread, &QThread::finished, _registrar, &QObject::deleteLater);
+        connect(_registrar, &InotifyWatchRegistrar::watchesAdded, this, &FolderWatcherPrivate::slotWatchesAdded);
+        connect(_registrar, &InotifyWatchRegistrar::treeRegistered, this, &FolderWatcherPrivate::slotTreeRegistered);
+        connect(_registrar, &InotifyWatchRegistrar::watchLimitReached, this, &FolderWatcherPrivate::slotWatchLimitReached);
+        _registrarThread.setObjectName(QStringLiteral("FolderWatcher registration"));
+        _registrarThread.start();
+        _ready = false;
+    }
+
     QMetaObject::invokeMethod(this, "slotAddFolderRecursive", Q_ARG(QString, path));
 }
 
-FolderWatcherPrivate::~FolderWatcherPrivate() = default;
+FolderWatcherPrivate::~FolderWatcherPrivate()
+{
+    if (_registrar) {
+        _registrar->cancel();
+    }
+    _registrarThread.quit();
+    _registrarThread.wait();
 
-// attention: result list passed by reference!
-bool FolderWatcherPrivate::findFoldersBelow(const QDir &dir, QStringList &fullList)
+    if (_fanotify) {
+        _fanotify->removeRoot(_canonicalFolder);
+    }
+}
+
+bool FolderWatcherPrivate::fanotifyInit()
 {
-    bool ok = true;
-    if (!(dir.exists() && dir.isReadable())) {
-        qCDebug(lcFolderWatcher) << "Non existing path coming in: " << dir.absolutePath();
-        ok = false;
+    bool ok = false;
+    if (qEnvironmentVariableIntValue("OWNCLOUD_FANOTIFY_WATCHER", &ok) == 0 && ok) {
+        return false;
+    }
+
+    auto fanotify = FanotifyWatcher::instance();
+    const auto canonicalFolder = QFileInfo(_folder).canonicalFilePath();
+    if (!fanotify || canonicalFolder.isEmpty() || !fanotify->addRoot(canonicalFolder)) {
+        return false;
+    }
+
+    _fanotify = std::move(fanotify);
+    _canonicalFolder = canonicalFolder;
+    connect(_fanotify.data(), &FanotifyWatcher::changed, this, &FolderWatcherPrivate::slotFanotifyChanged);
+    connect(_fanotify.data(), &FanotifyWatcher::lostChanges, _parent, &FolderWatcher::lostChanges);
+    return true;
+}
+
+void FolderWatcherPrivate::slotFanotifyChanged(const QString &canonicalRoot, const QString &relativePath)
+{
+    if (canonicalRoot != _canonicalFolder) {
+        return;
+    }
+
+    // Filter out journal changes - redundant with filtering in
+    // FolderWatcher::pathIsIgnored.
+    const auto fileName = QStringView(relativePath).mid(relativePath.lastIndexOf(QLatin1Char('/')) + 1);
+    if (fileName.startsWith(QLatin1String("._sync_"))
+        || fileName.startsWith(QLatin1String(".csync_journal.db"))
+        || fileName.startsWith(QLatin1String(".sync_"))) {
+        return;
+    }
+    _parent->changeDetected(_folder + relativePath);
+}
+
+QSharedPointer<FanotifyWatcher> FanotifyWatcher::instance()
+{
+    static QWeakPointer<FanotifyWatcher> sharedWatcher;
+    auto watcher = sharedWatcher.toStrongRef();
+    if (watcher) {
+        return watcher;
+    }
+
+#ifdef FAN_REPORT_DFID_NAME
+    const auto fd = fanotify_init(FAN_CLASS_NOTIF | FAN_CLOEXEC | FAN_NONBLOCK | FAN_REPORT_DFID_NAME, O_RDONLY | O_LARGEFILE);
+    if (fd == -1) {
+        qCDebug(lcFolderWatcher) << "fanotify_init() failed, using inotify:" << strerror(errno);
+        return {};
+    }
+    watcher.reset(new FanotifyWatcher(fd));
+    sharedWatcher = watcher;
+#endif
+    return watcher;
+}
+
+FanotifyWatcher::FanotifyWatcher(int fd)
+    : _reader(new FanotifyEventReader(fd))
+{
+    _reader->moveToThread(&_thread);
+    connect(&_thread, &QThread::finished, _reader, &QObject::deleteLater);
+    connect(_reader, &FanotifyEventReader::changed, this, &FanotifyWatcher::changed);
+    connect(_reader, &FanotifyEventReader::lostChanges, this, &FanotifyWatcher::lostChanges);
+    _thread.setObjectName(QStringLiteral("FolderWatcher fanotify"));
+    _thread.start();
+    QMetaObject::invokeMethod(_reader, &FanotifyEventReader::start);
+}
+
+FanotifyWatcher::~FanotifyWatcher()
+{
+    _thread.quit();
+    _thread.wait();
+}
+
+FanotifyEventReader::FanotifyEventReader(int fd)
+    : _fd(fd)
+{
+}
+
+FanotifyEventReader::~FanotifyEventReader()
+{
+    _socket.reset();
+    for (const auto &fileSystem : qAsConst(_fileSystems)) {
+        close(fileSystem.fd);
+    }
+    close(_fd);
+}
+
+void FanotifyEventReader::start()
+{
+    _socket.reset(new QSocketNotifier(_fd, QSocketNotifier::Read));
+    connect(_socket.data(), &QSocketNotifier::activated, this, &FanotifyEventReader::slotReceivedNotification);
+}
+
+bool FanotifyEventReader::addRoot(const QString &canonicalRoot)
+{
+#ifdef FAN_REPORT_DFID_NAME
+    QMutexLocker locker(&_mutex);
+    const auto root = _roots.find(canonicalRoot);
+    if (root != _roots.end()) {
+        ++root->watchers;
+        return true;
+    }
+
+    const auto encodedPath = QFile::encodeName(canonicalRoot);
+    const auto rootFd = open(encodedPath.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    auto fail = [&](const char *what) {
+        qCInfo(lcFolderWatcher) << what << "failed, using inotify:" << strerror(errno);
+        if (rootFd != -1) {
+            close(rootFd);
+        }
+        return false;
+    };
+    if (rootFd == -1) {
+        return fail("Opening the folder");
+    }
+    struct statfs fileSystemStats {};
+    if (fstatfs(rootFd, &fileSystemStats) == -1) {
+        return fail("fstatfs()");
+    }
+    quint64 fileSystemId = 0;
+    static_assert(sizeof(fileSystemStats.f_fsid) == sizeof(fileSystemId), "the events identify the file system with the same id");
+    memcpy(&fileSystemId, &fileSystemStats.f_fsid, sizeof(fileSystemId));
+
+    auto fileSystem = _fileSystems.find(fileSystemId);
+    if (fileSystem == _fileSystems.end()) {
+        // The events only carry the file handle of the directory, resolving
+        // it needs CAP_DAC_READ_SEARCH. Try with the folder itself.
+        QByteArray handleData(sizeof(struct file_handle) + MAX_HANDLE_SZ, Qt::Uninitialized);
+        auto handle = reinterpret_cast<struct file_handle *>(handleData.data());
+        handle->handle_bytes = MAX_HANDLE_SZ;
+        int mountId = 0;
+        if (name_to_handle_at(rootFd, "", handle, &mountId, AT_EMPTY_PATH) == -1) {
+            return fail("name_to_handle_at()");
+        }
+        const auto handleFd = open_by_handle_at(rootFd, handle, O_PATH | O_CLOEXEC);
+        if (handleFd == -1) {
+            return fail("open_by_handle_at()");
+        }
+        close(handleFd);
+
+        // Needs CAP_SYS_ADMIN, and a file system that supports file handles
+        if (fanotify_mark(_fd, FAN_MARK_ADD | FAN_MARK_FILESYSTEM, fanotifyMask, rootFd, nullptr) == -1) {
+            return fail("fanotify_mark()");
+        }
+        fileSystem = _fileSystems.insert(fileSystemId, { rootFd, 0 });
     } else {
-        QStringList nameFilter;
-        nameFilter << QLatin1String("*");
-        QDir::Filters filter = QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks | QDir::Hidden;
-        const QStringList paths = dir.entryList(nameFilter, filter);
+        close(rootFd);
+    }
+    ++fileSystem->roots;
+    _roots.insert(canonicalRoot, { fileSystemId, 1 });
+    return true;
+#else
+    Q_UNUSED(canonicalRoot)
+    return false;
+#endif
+}
+
+void FanotifyEventReader::removeRoot(const QString &canonicalRoot)
+{
+#ifdef FAN_REPORT_DFID_NAME
+    QMutexLocker locker(&_mutex);
+    const auto root = _roots.find(canonicalRoot);
+    if (root == _roots.end() || --root->watchers > 0) {
+        return;
+    }
+    const auto fileSystemId = root->fileSystemId;
+    _roots.erase(root);
+
+    const auto fileSystem = _fileSystems.find(fileSystemId);
+    if (fileSystem == _fileSystems.end() || --fileSystem->roots > 0) {
+        return;
+    }
+    fanotify_mark(_fd, FAN_MARK_REMOVE | FAN_MARK_FILESYSTEM, fanotifyMask, fileSystem->fd, nullptr);
+    close(fileSystem->fd);
+    _fileSystems.erase(fileSystem);
+    _handleToPath.clear();
+    _pathToHandle.clear();
+#else
+    Q_UNUSED(canonicalRoot)
+#endif
+}
+
+void FanotifyEventReader::slotReceivedNotification()
+{
+#ifdef FAN_REPORT_DFID_NAME
+    alignas(struct fanotify_event_metadata) char buffer[8192];
+    auto len = read(_fd, buffer, sizeof(buffer));
+    if (len <= 0) {
+        return;
+    }
+
+    QMutexLocker locker(&_mutex);
+    for (auto metadata = reinterpret_cast<const struct fanotify_event_metadata *>(buffer); FAN_EVENT_OK(metadata, len);
+         metadata = FAN_EVENT_NEXT(metadata, len)) {
+        if (metadata->vers != FANOTIFY_METADATA_VERSION) {
+            qCWarning(lcFolderWatcher) << "Unexpected fanotify metadata version" << metadata->vers;
+            return;
+        }
+        if (metadata->mask & FAN_Q_OVERFLOW) {
+            qCWarning(lcFolderWatcher) << "fanotify queue overflow, changes were lost";
+            emit lostChanges();
+            continue;
+        }
+
+        const auto info = reinterpret_cast<const struct fanotify_event_info_fid *>(metadata + 1);
+        if (metadata->event_len < sizeof(*metadata) + sizeof(*info) || info->hdr.info_type != FAN_EVENT_INFO_TYPE_DFID_NAME) {
+            continue;
+        }
+        const auto handle = reinterpret_cast<const struct file_handle *>(info->handle);
+        const auto name = reinterpret_cast<const char *>(handle->f_handle + handle->handle_bytes);
+        // Events of the directory itself, its parent reports them too
+        if (qstrcmp(name, ".") == 0) {
+            continue;
+        }
 
-        QStringList::const_iterator constIterator;
-        for (constIterator = paths.constBegin(); constIterator != paths.constEnd();
-             ++constIterator) {
-            const QString fullPath(dir.path() + QLatin1String("/") + (*constIterator));
-            fullList.append(fullPath);
-            ok = findFoldersBelow(QDir(fullPath), fullList);
+        quint64 fileSystemId = 0;
+        static_assert(sizeof(info->fsid) == sizeof(fileSystemId), "the file systems are identified by their statfs id");
+        memcpy(&fileSystemId, &info->fsid, sizeof(fileSystemId));
+        const auto directory = directoryPath(fileSystemId, QByteArray::fromRawData(reinterpret_cast<const char *>(handle), sizeof(*handle) + handle->handle_bytes));
+        if (directory.isEmpty()) {
+            continue;
+        }
+        const auto path = directory + QLatin1Char('/') + QFile::decodeName(name);
+
+        // The cached paths of a moved or removed directory are stale now, and
+        // a directory moved in replaces whatever was cached for its new path
+        if ((metadata->mask & FAN_ONDIR) && (metadata->mask & (FAN_MOVED_FROM | FAN_MOVED_TO | FAN_DELETE))) {
+            invalidateCachedPaths(path);
+        }
+
+        // The mark covers the whole file system, most events are for other directories
+        for (auto root = _roots.cbegin(); root != _roots.cend(); ++root) {
+            if (path.size() > root.key().size() && path.startsWith(root.key()) && path.at(root.key().size()) == QLatin1Char('/')) {
+                emit changed(root.key(), path.mid(root.key().size()));
+            }
         }
     }
+#endif
+}
 
-    return ok;
+QString FanotifyEventReader::directoryPath(quint64 fileSystemId, const QByteArray &handle)
+{
+    const auto fileSystem = _fileSystems.constFind(fileSystemId);
+    if (fileSystem == _fileSystems.cend()) {
+        return {};
+    }
+
+    const auto key = QByteArray(reinterpret_cast<const char *>(&fileSystemId), sizeof(fileSystemId)) + handle;
+    const auto cached = _handleToPath.constFind(key);
+    if (cached != _handleToPath.cend()) {
+        return *cached;
+    }
+
+    auto handleCopy = handle;
+    const auto fd = open_by_handle_at(fileSystem->fd, reinterpret_cast<struct file_handle *>(handleCopy.data()), O_PATH | O_CLOEXEC);
+    if (fd == -1) {
+        // Most likely removed already
+        return {};
+    }
+    char target[PATH_MAX];
+    const auto length = readlink(QByteArray("/proc/self/fd/" + QByteArray::number(fd)).constData(), target, sizeof(target));
+    close(fd);
+    if (length <= 0) {
+        return {};
+    }
+    const auto path = QFile::decodeName(QByteArray(target, length));
+
+    if (_handleToPath.size() >= maximumCachedFanotifyHandles) {
+        _handleToPath.clear();
+        _pathToHandle.clear();
+    }
+    const auto previousHandle = _pathToHandle.constFind(path);
+    if (previousHandle != _pathToHandle.cend()) {
+        _handleToPath.remove(*previousHandle);
+    }
+    _handleToPath.insert(key, path);
+    _pathToHandle.insert(path, key);
+    return path;
+}
+
+void FanotifyEventReader::invalidateCachedPaths(const QString &path)
+{
+    const QString pathSlash = path + QLatin1Char('/');
+    auto it = _pathToHandle.lowerBound(path);
+    while (it != _pathToHandle.end() && it.key().startsWith(path)) {
+        if (it.key() != path && !it.key().startsWith(pathSlash)) {
+            // order is 'foo', 'foo bar', 'foo/bar'
+            ++it;
+            continue;
+        }
+        _handleToPath.remove(it.value());
+        it = _pathToHandle.erase(it);
+    }
+}
+
+InotifyWatchRegistrar::InotifyWatchRegistrar(int fd, std::function<bool(const QString &)> isIgnored)
+    : _fd(fd)
+    , _isIgnored(std::move(isIgnored))
+{
+}
+
+void InotifyWatchRegistrar::registerTree(const QString &path)
+{
+    QElapsedTimer timer;
+    timer.start();
+    QElapsedTimer batchTimer;
+    batchTimer.start();
+    QVector<QPair<int, QString>> batch;
+    auto directories = 0;
+    auto nextProgress = registrationProgressInterval;
+
+    // Each directory is watched before it is listed, so that no sub directory
+    // created in between goes unnoticed
+    QStringList pending(path);
+    while (!pending.isEmpty() && !_cancelled) {
+        const QDir dir(pending.takeLast());
+        const auto subdirs = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks | QDir::Hidden);
+        for (const auto &subdir : subdirs) {
+            const QString fullPath(dir.path() + QLatin1Char('/') + subdir);
+            if (_isIgnored(fullPath)) {
+                qCDebug(lcFolderWatcher) << "* Not adding" << fullPath;
+                continue;
+            }
+            const auto wd = inotify_add_watch(_fd, fullPath.toUtf8().constData(), inotifyMask);
+            if (wd < 0) {
+                if (errno == ENOMEM || errno == ENOSPC) {
+                    emit watchLimitReached();
+                    pending.clear();
+                    break;
+                }
+                continue;
+            }
+            batch.append({ wd, fullPath });
+            pending.append(fullPath);
+            ++directories;
+        }
+
+        if (batch.size() >= registrationBatchSize || (!batch.isEmpty() && batchTimer.elapsed() >= registrationBatchIntervalMsecs)) {
+            emit watchesAdded(batch);
+            batch.clear();
+            batchTimer.restart();
+        }
+        if (directories >= nextProgress) {
+            qCInfo(lcFolderWatcher) << "Added" << directories << "watches below" << path << "so far";
+            nextProgress += registrationProgressInterval;
+        }
+    }
+
+    if (!batch.isEmpty()) {
+        emit watchesAdded(batch);
+    }
+    qCDebug(lcFolderWatcher) << "    `-> added" << directories << "watches below" << path << "in" << timer.elapsed() << "ms";
+    emit treeRegistered(path);
 }
 
 void FolderWatcherPrivate::inotifyRegisterPath(const QString &path)
@@ -74,20 +456,24 @@ void FolderWatcherPrivate::inotifyRegisterPath(const QString &path)
     if (path.isEmpty())
         return;
 
-    int wd = inotify_add_watch(_fd, path.toUtf8().constData(),
-        IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVE | IN_CREATE | IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF | IN_UNMOUNT | IN_ONLYDIR);
+    int wd = inotify_add_watch(_fd, path.toUtf8().constData(), inotifyMask);
     if (wd > -1) {
         _watchToPath.insert(wd, path);
         _pathToWatch.insert(path, wd);
-    } else {
-        // If we're running out of memory or inotify watches, become
-        // unreliable.
-        if (_parent->_isReliable && (errno == ENOMEM || errno == ENOSPC)) {
-            _parent->_isReliable = false;
-            emit _parent->becameUnreliable(
-                tr("This problem usually happens when the inotify watches are exhausted. "
-                   "Check the FAQ for details."));
-        }
+    } else if (errno == ENOMEM || errno == ENOSPC) {
+        slotWatchLimitReached();
+    }
+}
+
+void FolderWatcherPrivate::slotWatchLimitReached()
+{
+    // If we're running out of memory or inotify watches, become
+    // unreliable.
+    if (_parent->_isReliable) {
+        _parent->_isReliable = false;
+        emit _parent->becameUnreliable(
+            tr("This problem usually happens when the inotify watches are exhausted. "
+               "Check the FAQ for details."));
     }
 }
 
@@ -96,34 +482,62 @@ void FolderWatcherPrivate::slotAddFolderRecursive(const QString &path)
     if (_pathToWatch.contains(path))
         return;
 
-    int subdirs = 0;
     qCDebug(lcFolderWatcher) << "(+) Watcher:" << path;
 
-    QDir inPath(path);
-    inotifyRegisterPath(inPath.absolutePath());
-
-    QStringList allSubfolders;
-    if (!findFoldersBelow(QDir(path), allSubfolders)) {
-        qCWarning(lcFolderWatcher) << "Could not traverse all sub folders";
-    }
-    QStringListIterator subfoldersIt(allSubfolders);
-    while (subfoldersIt.hasNext()) {
-        QString subfolder = subfoldersIt.next();
-        QDir folder(subfolder);
-        if (folder.exists() && !_pathToWatch.contains(folder.absolutePath())) {
-            subdirs++;
-            if (_parent->pathIsIgnored(subfolder)) {
-                qCDebug(lcFolderWatcher) << "* Not adding" << folder.path();
-                continue;
-            }
-            inotifyRegisterPath(folder.absolutePath());
-        } else {
-            qCDebug(lcFolderWatcher) << "    `-> discarded:" << folder.path();
+    // The folder itself is watched right away, the registrar adds the
+    // watches below it without blocking the GUI thread
+    const auto absolutePath = QDir(path).absolutePath();
+    inotifyRegisterPath(absolutePath);
+    if (!_registrar) {
+        return;
+    }
+    ++_registeringTrees[absolutePath];
+    QMetaObject::invokeMethod(_registrar, [registrar = _registrar, absolutePath] {
+        registrar->registerTree(absolutePath);
+    });
+}
+
+void FolderWatcherPrivate::slotWatchesAdded(const QVector<QPair<int, QString>> &watches)
+{
+    for (const auto &watch : watches) {
+        _watchToPath.insert(watch.first, watch.second);
+        _pathToWatch.insert(watch.second, watch.first);
+    }
+
+    // Handle the events that arrived before the paths of their watches
+    const auto bufferedEvents = std::exchange(_bufferedEvents, {});
+    for (const auto &event : bufferedEvents) {
+        const auto directory = _watchToPath.constFind(event.wd);
+        if (directory == _watchToPath.cend()) {
+            _bufferedEvents.append(event);
+            continue;
+        }
+        processInotifyEvent(QString(*directory), event.mask, event.fileName);
+    }
+}
+
+void FolderWatcherPrivate::slotTreeRegistered(const QString &path)
+{
+    if (--_registeringTrees[path] <= 0) {
+        _registeringTrees.remove(path);
+
+        // Changes in directories that weren't watched yet are lost, make
+        // sure the next sync discovers the whole tree
+        if (_racedTrees.remove(path)) {
+            qCInfo(lcFolderWatcher) << "Changes happened while adding the watches below" << path << ", rediscovering it";
+            _parent->changeDetected(QStringList(path));
         }
     }
 
-    if (subdirs > 0) {
-        qCDebug(lcFolderWatcher) << "    `-> and" << subdirs << "subdirectories";
+    if (_registeringTrees.isEmpty()) {
+        if (!_bufferedEvents.isEmpty()) {
+            qCDebug(lcFolderWatcher) << "Dropping" << _bufferedEvents.size() << "events of removed watches";
+            _bufferedEvents.clear();
+        }
+        if (!_ready) {
+            qCInfo(lcFolderWatcher) << "Watching" << _pathToWatch.size() << "folders of" << _folder;
+            _ready = true;
+        }
     }
 }
 
@@ -168,26 +582,43 @@ void FolderWatcherPrivate::slotReceivedNotification(int fd)
         // Fire event for the path that was changed.
         if (event->len == 0 || event->wd <= -1)
             continue;
-        QByteArray fileName(event->name);
-        // Filter out journal changes - redundant with filtering in
-        // FolderWatcher::pathIsIgnored.
-        if (fileName.startsWith("._sync_")
-            || fileName.startsWith(".csync_journal.db")
-            || fileName.startsWith(".sync_")) {
+        const auto directory = _watchToPath.constFind(event->wd);
+        if (directory == _watchToPath.cend()) {
+            // A new watch of the registrar, its path arrives with the next batch
+            if (!_registeringTrees.isEmpty()) {
+                _bufferedEvents.append({ event->wd, event->mask, QByteArray(event->name) });
+            }
             continue;
         }
-        const QString p = _watchToPath[event->wd] + '/' + fileName;
-        _parent->changeDetected(p);
+        processInotifyEvent(QString(*directory), event->mask, QByteArray(event->name));
+    }
+}
 
-        if ((event->mask & (IN_MOVED_TO | IN_CREATE))
-            && QFileInfo(p).isDir()
-            && !_parent->pathIsIgnored(p)) {
-            slotAddFolderRecursive(p);
-        }
-        if (event->mask & (IN_MOVED_FROM | IN_DELETE)) {
-            removeFoldersBelow(p);
+void FolderWatcherPrivate::processInotifyEvent(const QString &directory, quint32 mask, const QByteArray &fileName)
+{
+    // Filter out journal changes - redundant with filtering in
+    // FolderWatcher::pathIsIgnored.
+    if (fileName.startsWith("._sync_")
+        || fileName.startsWith(".csync_journal.db")
+        || fileName.startsWith(".sync_")) {
+        return;
+    }
+    const QString p = directory + '/' + fileName;
+    for (auto it = _registeringTrees.cbegin(); it != _registeringTrees.cend(); ++it) {
+        if (p.startsWith(it.key() + QLatin1Char('/'))) {
+            _racedTrees.insert(it.key());
         }
     }
+    _parent->changeDetected(p);
+
+    if ((mask & (IN_MOVED_TO | IN_CREATE))
+        && QFileInfo(p).isDir()
+        && !_parent->pathIsIgnored(p)) {
+        slotAddFolderRecursive(p);
+    }
+    if (mask & (IN_MOVED_FROM | IN_DELETE)) {
+        removeFoldersBelow(p);
+    }
 }
 
 void FolderWatcherPrivate::removeFoldersBelow(const QString &path)
@@ -20,15 +20,153 @@
 #include <QSocketNotifier>
 #include <QHash>
 #include <QDir>
+#include <QMap>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QThread>
 
 #include "folderwatcher.h"
 
+#include <atomic>
+#include <functional>
+
 class QTimer;
 
 namespace OCC {
 
 /**
- * @brief Linux (inotify) API implementation of FolderWatcher
+ * @brief Adds the inotify watches of directory trees in a worker thread
+ *
+ * Enumerating a large tree that was moved into the folder takes long, so
+ * FolderWatcherPrivate leaves it to this object in its own thread and receives
+ * the new watches in batches.
+ *
+ * @ingroup gui
+ */
+class InotifyWatchRegistrar : public QObject
+{
+    Q_OBJECT
+public:
+    InotifyWatchRegistrar(int fd, std::function<bool(const QString &)> isIgnored);
+
+    /// Stops the registration of the current tree, can be called from any thread
+    void cancel() { _cancelled = true; }
+
+public slots:
+    /// Adds watches for all directories below path, which is watched already
+    void registerTree(const QString &path);
+
+signals:
+    void watchesAdded(const QVector<QPair<int, QString>> &watches);
+    void treeRegistered(const QString &path);
+    void watchLimitReached();
+
+private:
+    int _fd;
+    std::function<bool(const QString &)> _isIgnored;
+    std::atomic<bool> _cancelled = false;
+};
+
+/**
+ * @brief Reads the events of the fanotify marks in a worker thread
+ *
+ * The events only carry the file handle of the directory, resolving one to
+ * a path takes two system calls. The reader resolves and caches them off the
+ * GUI thread and only hands over the changes below a sync root.
+ *
+ * @ingroup gui
+ */
+class FanotifyEventReader : public QObject
+{
+    Q_OBJECT
+public:
+    explicit FanotifyEventReader(int fd);
+    ~FanotifyEventReader() override;
+
+    /// Marks the file system of the root unless another root is on it already, can be called from any thread
+    bool addRoot(const QString &canonicalRoot);
+    /// Can be called from any thread
+    void removeRoot(const QString &canonicalRoot);
+
+public slots:
+    void start();
+
+signals:
+    /// relativePath starts with a slash
+    void changed(const QString &canonicalRoot, const QString &relativePath);
+    void lostChanges();
+
+private slots:
+    void slotReceivedNotification();
+
+private:
+    /// The canonical path of the directory with the file handle, empty if it can't be resolved
+    QString directoryPath(quint64 fileSystemId, const QByteArray &handle);
+    /// Drops the cached paths of the directory and everything below it
+    void invalidateCachedPaths(const QString &path);
+
+    int _fd;
+    QScopedPointer<QSocketNotifier> _socket;
+
+    struct FileSystem
+    {
+        int fd; // of the first root, for resolving the file handles
+        int roots;
+    };
+    struct Root
+    {
+        quint64 fileSystemId;
+        int watchers;
+    };
+
+    /// Guards the members below, the roots are added from the GUI thread
+    QMutex _mutex;
+    QHash<quint64, FileSystem> _fileSystems;
+    QHash<QString, Root> _roots;
+    /// The cached directory paths, by file system id and file handle
+    QHash<QByteArray, QString> _handleToPath;
+    QMap<QString, QByteArray> _pathToHandle;
+};
+
+/**
+ * @brief The fanotify marks shared by all folders
+ *
+ * A mark on the file system is the only kind of fanotify mark that reports
+ * the changes of a whole directory tree, it needs CAP_SYS_ADMIN and a file
+ * system that supports file handles. Each file system with a sync root is
+ * marked once, and the reader filters the events by the paths of the roots.
+ *
+ * @ingroup gui
+ */
+class FanotifyWatcher : public QObject
+{
+    Q_OBJECT
+public:
+    /// The watcher of all folders, null if fanotify isn't available
+    static QSharedPointer<FanotifyWatcher> instance();
+    ~FanotifyWatcher() override;
+
+    bool addRoot(const QString &canonicalRoot) { return _reader->addRoot(canonicalRoot); }
+    void removeRoot(const QString &canonicalRoot) { _reader->removeRoot(canonicalRoot); }
+
+signals:
+    void changed(const QString &canonicalRoot, const QString &relativePath);
+    void lostChanges();
+
+private:
+    explicit FanotifyWatcher(int fd);
+
+    QThread _thread;
+    FanotifyEventReader *_reader;
+};
+
+/**
+ * @brief Linux (fanotify or inotify) API implementation of FolderWatcher
+ *
+ * Where the process may mark the file system of the folder with fanotify,
+ * the shared FanotifyWatcher reports the changes of all directories.
+ * Otherwise every directory gets an inotify watch.
+ *
  * @ingroup gui
  */
 class FolderWatcherPrivate : public QObject
@@ -39,20 +177,28 @@ public:
     FolderWatcherPrivate(FolderWatcher *p, const QString &path);
     ~FolderWatcherPrivate() override;
 
-    [[nodiscard]] int testWatchCount() const { return _pathToWatch.size(); }
+    /// The number of inotify watches, or 1 for the fanotify mark
+    [[nodiscard]] int testWatchCount() const { return _fanotify ? 1 : _pathToWatch.size(); }
 
-    /// On linux the watcher is ready when the ctor finished.
+    /// With inotify, the watcher is ready once the watches of the folder are added
     bool _ready = true;
 
 protected slots:
     void slotReceivedNotification(int fd);
     void slotAddFolderRecursive(const QString &path);
+    void slotFanotifyChanged(const QString &canonicalRoot, const QString &relativePath);
+    void slotWatchesAdded(const QVector<QPair<int, QString>> &watches);
+    void slotTreeRegistered(const QString &path);
+    void slotWatchLimitReached();
 
 protected:
-    bool findFoldersBelow(const QDir &dir, QStringList &fullList);
     void inotifyRegisterPath(const QString &path);
+    void processInotifyEvent(const QString &directory, quint32 mask, const QByteArray &fileName);
     void removeFoldersBelow(const QString &path);
 
+    /// Watches the folder with the shared fanotify marks, false if that isn't possible
+    bool fanotifyInit();
+
 private:
     FolderWatcher *_parent = nullptr;
 
@@ -61,6 +207,25 @@ private:
     QMap<QString, int> _pathToWatch;
     QScopedPointer<QSocketNotifier> _socket;
     int _fd = 0;
+
+    struct BufferedEvent
+    {
+        int wd;
+        quint32 mask;
+        QByteArray fileName;
+    };
+
+    QThread _registrarThread;
+    InotifyWatchRegistrar *_registrar = nullptr;
+    /// Trees the registrar adds watches for, and how often each was requested
+    QHash<QString, int> _registeringTrees;
+    /// Trees that changed while their watches were added
+    QSet<QString> _racedTrees;
+    /// Events of new watches whose paths the registrar didn't deliver yet
+    QVector<BufferedEvent> _bufferedEvents;
+
+    QSharedPointer<FanotifyWatcher> _fanotify;
+    QString _canonicalFolder;
 };
 }
 
@@ -34,6 +34,7 @@
 #include "ignorelisteditor.h"
 #include "common/utility.h"
 #include "logger.h"
+#include "syncrunfilelog.h"
 
 #include "legalnotice.h"
 
@@ -43,6 +44,7 @@
 #include <QDir>
 #include <QScopedValueRollback>
 #include <QMessageBox>
+#include <QStandardPaths>
 
 #include <KZip>
 
@@ -138,6 +140,21 @@ bool createDebugArchive(const QString &filename)
         zip.addLocalFile(entry.localFilename, entry.zipFilename);
     }
 
+    // Compact sync run logs go in the text format support reads
+    const QDir syncRunLogDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
+    const auto compactLogs = syncRunLogDir.entryInfoList({QStringLiteral("*_sync.csv"), QStringLiteral("*_sync.csv.1")}, QDir::Files | QDir::Hidden);
+    for (const auto &info : compactLogs) {
+        QFile compactLog(info.absoluteFilePath());
+        if (!compactLog.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+        const auto syncRunLog = OCC::SyncRunFileLog::compactLogToText(compactLog.readAll());
+        const auto zipFilename = QStringLiteral("logs/") + info.fileName().replace(QStringLiteral("_sync.csv"), QStringLiteral("_sync.log"));
+        zip.prepareWriting(zipFilename, {}, {}, syncRunLog.size());
+        zip.writeData(syncRunLog, syncRunLog.size());
+        zip.finishWriting(syncRunLog.size());
+    }
+
     const auto clientParameters = QCoreApplication::arguments().join(' ').toUtf8();
     zip.prepareWriting("__nextcloud_client_parameters.txt", {}, {}, clientParameters.size());
     zip.writeData(clientParameters, clientParameters.size());
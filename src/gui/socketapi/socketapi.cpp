@@ -86,11 +86,14 @@
 // This is the version that is returned when the client asks for the VERSION.
 // The first number should be changed if there is an incompatible change that breaks old clients.
 // The second number should be changed when there are new features.
-#define MIRALL_SOCKET_API_VERSION "1.1"
+#define MIRALL_SOCKET_API_VERSION "1.2"
 
 namespace {
 constexpr auto encryptJobPropertyFolder = "folder";
 constexpr auto encryptJobPropertyPath = "path";
+
+// Status pushes of bursts within this interval are sent together, only the latest one of each path
+constexpr auto statusPushInterval = std::chrono::milliseconds(100);
 }
 
 namespace {
@@ -312,6 +315,10 @@ SocketApi::SocketApi(QObject *parent)
 
     connect(&_localServer, &QLocalServer::newConnection, this, &SocketApi::slotNewConnection);
 
+    _statusPushTimer.setSingleShot(true);
+    _statusPushTimer.setInterval(statusPushInterval);
+    connect(&_statusPushTimer, &QTimer::timeout, this, &SocketApi::flushStatusPushMessages);
+
     // folder watcher
     connect(FolderMan::instance(), &FolderMan::folderSyncStateChange, this, &SocketApi::slotUpdateFolderView);
 }
@@ -486,6 +493,8 @@ void SocketApi::slotUnregisterPath(const QString &alias)
     if (!_registeredAliases.contains(alias))
         return;
 
+    flushStatusPushMessages();
+
     Folder *f = FolderMan::instance()->folder(alias);
     if (f)
         broadcastMessage(buildMessage(QLatin1String("UNREGISTER_PATH"), removeTrailingSlash(f->path()), QString()), true);
@@ -509,6 +518,7 @@ void SocketApi::slotUpdateFolderView(Folder *f)
             || f->syncResult().status() == SyncResult::SetupError) {
             QString rootPath = removeTrailingSlash(f->path());
             broadcastStatusPushMessage(rootPath, f->syncEngine().syncFileStatusTracker().fileStatus(""));
+            flushStatusPushMessages();
 
             broadcastMessage(buildMessage(QLatin1String("UPDATE_VIEW"), rootPath));
         } else {
@@ -636,11 +646,57 @@ void SocketApi::processLeaveShareRequest(const QString &localFile, SocketListene
 
 void SocketApi::broadcastStatusPushMessage(const QString &systemPath, SyncFileStatus fileStatus)
 {
-    QString msg = buildMessage(QLatin1String("STATUS"), systemPath, fileStatus.toSocketAPIString());
     Q_ASSERT(!systemPath.endsWith('/'));
-    uint directoryHash = qHash(systemPath.left(systemPath.lastIndexOf('/')));
+    if (_listeners.isEmpty()) {
+        return;
+    }
+
+    // A newer status replaces the pending one of the same path and is moved to the back,
+    // so children still get their status pushed before their parents do.
+    const auto index = _pendingStatusPushIndex.value(systemPath, -1);
+    if (index != -1) {
+        _pendingStatusPushes[index].first.clear();
+    }
+    _pendingStatusPushIndex.insert(systemPath, _pendingStatusPushes.size());
+    _pendingStatusPushes.append({ systemPath, fileStatus });
+
+    if (!_statusPushTimer.isActive()) {
+        _statusPushTimer.start();
+    }
+}
+
+void SocketApi::flushStatusPushMessages()
+{
+    _statusPushTimer.stop();
+    if (_pendingStatusPushes.isEmpty()) {
+        return;
+    }
+
+    QVector<QPair<QString, uint>> messages;
+    messages.reserve(_pendingStatusPushIndex.size());
+    for (const auto &statusPush : qAsConst(_pendingStatusPushes)) {
+        const auto &systemPath = statusPush.first;
+        if (systemPath.isEmpty()) {
+            continue;
+        }
+        const auto directoryHash = qHash(systemPath.left(systemPath.lastIndexOf('/')));
+        messages.append({ buildMessage(QLatin1String("STATUS"), systemPath, statusPush.second.toSocketAPIString()), directoryHash });
+    }
+    _pendingStatusPushes.clear();
+    _pendingStatusPushIndex.clear();
+
+    // One write per listener, with the lines of the directories it asked about
     for (const auto &listener : qAsConst(_listeners)) {
-        listener->sendMessageIfDirectoryMonitored(msg, directoryHash);
+        QString lines;
+        for (const auto &message : qAsConst(messages)) {
+            if (listener->isDirectoryMonitored(message.second)) {
+                lines.append(message.first);
+                lines.append(QLatin1Char('\n'));
+            }
+        }
+        if (!lines.isEmpty()) {
+            listener->sendMessage(lines);
+        }
     }
 }
 
@@ -672,6 +728,50 @@ void SocketApi::command_RETRIEVE_FILE_STATUS(const QString &argument, SocketList
     listener->sendMessage(message);
 }
 
+void SocketApi::command_RETRIEVE_FILES_STATUS(const QString &argument, SocketListener *listener)
+{
+    // The argument is the directory, optionally followed by the names of the entries to report.
+    // The reply is FILES_STATUS:<directory> followed by <status>:<name> for every entry,
+    // all separated by the record separator.
+    auto names = split(argument);
+    const auto directory = names.takeFirst();
+    const auto directoryData = FileData::get(directory);
+
+    QString message = QLatin1String("FILES_STATUS:") % QDir::toNativeSeparators(directory);
+    if (!directoryData.folder) {
+        // this can happen in offline mode e.g.: nothing to worry about
+        for (const auto &name : qAsConst(names)) {
+            message.append(RecordSeparator() % QLatin1String("NOP:") % name);
+        }
+        listener->sendMessage(message);
+        return;
+    }
+
+    // Same as for RETRIEVE_FILE_STATUS of one of the entries
+    listener->registerMonitoredDirectory(qHash(directoryData.localPath));
+
+    // Without names the entries of the directory are listed, except for the
+    // excluded ones like the sync journal: the shell shows no status for them
+    const auto listEntries = names.isEmpty();
+    if (listEntries) {
+        names = QDir(directoryData.localPath).entryList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System);
+    }
+
+    auto &statusTracker = directoryData.folder->syncEngine().syncFileStatusTracker();
+    const auto &relativeDirectory = directoryData.folderRelativePath;
+    for (const auto &name : qAsConst(names)) {
+        if (name.isEmpty() || name.contains(QLatin1Char('/'))) {
+            continue;
+        }
+        const auto relativePath = relativeDirectory.isEmpty() ? name : QString(relativeDirectory % QLatin1Char('/') % name);
+        if (listEntries && directoryData.folder->isFileExcludedRelative(relativePath)) {
+            continue;
+        }
+        message.append(RecordSeparator() % statusTracker.fileStatus(relativePath).toSocketAPIString() % QLatin1Char(':') % name);
+    }
+    listener->sendMessage(message);
+}
+
 void SocketApi::command_SHARE(const QString &localFile, SocketListener *listener)
 {
     processShareRequest(localFile, listener);
@@ -22,6 +22,7 @@
 #include "config.h"
 
 #include <QLocalServer>
+#include <QTimer>
 
 class QUrl;
 class QLocalSocket;
@@ -79,6 +80,7 @@ private slots:
     void onLostConnection();
     void slotSocketDestroyed(QObject *obj);
     void slotReadSocket();
+    void flushStatusPushMessages();
 
     static void copyUrlToClipboard(const QString &link);
     static void emailPrivateLink(const QString &link);
@@ -119,6 +121,8 @@ private:
 
     Q_INVOKABLE void command_RETRIEVE_FOLDER_STATUS(const QString &argument, OCC::SocketListener *listener);
     Q_INVOKABLE void command_RETRIEVE_FILE_STATUS(const QString &argument, OCC::SocketListener *listener);
+    // The status of the entries of a directory in one reply, of the given names or of everything in it that is not excluded
+    Q_INVOKABLE void command_RETRIEVE_FILES_STATUS(const QString &argument, OCC::SocketListener *listener);
 
     Q_INVOKABLE void command_VERSION(const QString &argument, OCC::SocketListener *listener);
 
@@ -209,6 +213,11 @@ private:
     QSet<QString> _registeredAliases;
     QMap<QIODevice *, QSharedPointer<SocketListener>> _listeners;
     QLocalServer _localServer;
+
+    // Status pushes waiting for _statusPushTimer, the latest one of each path is sent
+    QVector<QPair<QString, SyncFileStatus>> _pendingStatusPushes;
+    QHash<QString, int> _pendingStatusPushIndex;
+    QTimer _statusPushTimer;
 };
 }
 
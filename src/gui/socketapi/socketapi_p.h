@@ -77,10 +77,9 @@ public:
         sendMessage(QStringLiteral("ERROR:") + message, doWait);
     }
 
-    void sendMessageIfDirectoryMonitored(const QString &message, uint systemDirectoryHash) const
+    [[nodiscard]] bool isDirectoryMonitored(uint systemDirectoryHash) const
     {
-        if (_monitoredDirectoriesBloomFilter.isHashMaybeStored(systemDirectoryHash))
-            sendMessage(message, false);
+        return _monitoredDirectoriesBloomFilter.isHashMaybeStored(systemDirectoryHash);
     }
 
     void registerMonitoredDirectory(uint systemDirectoryHash)
@@ -12,26 +12,142 @@
  * for more details.
  */
 
+#include <QLoggingCategory>
 #include <QRegularExpression>
+#include <QThreadPool>
+#include <QtConcurrent>
 
 #include "syncrunfilelog.h"
 #include "common/utility.h"
 #include "filesystem.h"
 #include <qfileinfo.h>
 
+namespace {
+
+// Lines collected in buffered mode before they are handed to the writer
+constexpr int MaxBufferedLines = 1000;
+// How often the buffered lines are written while a sync runs
+constexpr int WriteIntervalMs = 1000;
+
+const auto textHeader = QStringLiteral("# timestamp | duration | file | instruction | dir | modtime | etag | "
+                                       "size | fileId | status | errorString | http result code | "
+                                       "other size | other modtime | X-Request-ID");
+const auto compactHeader = QStringLiteral("# kind,timestamp,duration,file,instruction,dir,modtime,etag,"
+                                          "size,fileId,status,errorString,http result code,"
+                                          "other size,other modtime,X-Request-ID");
+
+QThreadPool *writerThreadPool()
+{
+    static QThreadPool pool;
+    // The writes of a log file have to stay in order
+    pool.setMaxThreadCount(1);
+    return &pool;
+}
+
+QString csvField(const QString &field)
+{
+    if (!field.contains(QLatin1Char(',')) && !field.contains(QLatin1Char('"'))
+        && !field.contains(QLatin1Char('\n')) && !field.contains(QLatin1Char('\r'))) {
+        return field;
+    }
+    auto quoted = field;
+    quoted.replace(QLatin1Char('"'), QLatin1String("\"\""));
+    return QLatin1Char('"') + quoted + QLatin1Char('"');
+}
+
+QString lapText(const QString &dateTime, const QString &lapMsecs, const QString &totalMsecs)
+{
+    return QStringLiteral("%1 (last step: %2 msec, total: %3 msec)").arg(dateTime, lapMsecs, totalMsecs);
+}
+
+}
+
 namespace OCC {
 
-SyncRunFileLog::SyncRunFileLog() = default;
+Q_LOGGING_CATEGORY(lcSyncRunFileLog, "nextcloud.gui.syncrunfilelog", QtInfoMsg)
+
+SyncRunFileLog::SyncRunFileLog()
+{
+    _writeTimer.setInterval(WriteIntervalMs);
+    QObject::connect(&_writeTimer, &QTimer::timeout, &_writeTimer, [this] {
+        writeBuffer();
+    });
+}
+
+SyncRunFileLog::~SyncRunFileLog()
+{
+    // A sync run that never finished, keep what it logged
+    if (_file && _file->isOpen()) {
+        writeBuffer();
+        _pendingWrite.waitForFinished();
+    }
+}
+
+void SyncRunFileLog::setBuffered(bool buffered)
+{
+    _buffered = buffered;
+}
+
+void SyncRunFileLog::setFormat(Format format)
+{
+    _format = format;
+}
+
+QString SyncRunFileLog::fileName() const
+{
+    return _file ? _file->fileName() : QString();
+}
 
 QString SyncRunFileLog::dateTimeStr(const QDateTime &dt)
 {
     return dt.toString(Qt::ISODate);
 }
 
+void SyncRunFileLog::endLine()
+{
+    if (!_runBuffered) {
+        _out << Qt::endl;
+        return;
+    }
+    _out << '\n';
+    if (++_bufferedLines >= MaxBufferedLines) {
+        writeBuffer();
+    }
+}
+
+void SyncRunFileLog::writeBuffer()
+{
+    if (!_runBuffered) {
+        return;
+    }
+    _out.flush();
+    if (_buffer.isEmpty()) {
+        return;
+    }
+
+    const auto data = _buffer.toUtf8();
+    _buffer.clear();
+    _bufferedLines = 0;
+    _pendingWrite = QtConcurrent::run(writerThreadPool(), [file = _file, data] {
+        if (file->write(data) != data.size()) {
+            qCWarning(lcSyncRunFileLog) << "Could not write to" << file->fileName() << file->errorString();
+        }
+        file->flush();
+    });
+}
+
 void SyncRunFileLog::start(const QString &folderPath)
 {
     const qint64 logfileMaxSize = 10 * 1024 * 1024; // 10MiB
 
+    if (_file && _file->isOpen()) {
+        writeBuffer();
+        _pendingWrite.waitForFinished();
+    }
+    _runBuffered = _buffered;
+    _runFormat = _format;
+    const auto suffix = _runFormat == Compact ? QLatin1String("_sync.csv") : QLatin1String("_sync.log");
+
     const QString logpath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
     if(!QDir(logpath).exists()) {
         QDir().mkdir(logpath);
@@ -39,7 +155,7 @@ void SyncRunFileLog::start(const QString &folderPath)
 
     int length = folderPath.split(QLatin1String("/")).length();
     QString filenameSingle = folderPath.split(QLatin1String("/")).at(length - 2);
-    QString filename = logpath + QLatin1String("/") + filenameSingle + QLatin1String("_sync.log");
+    QString filename = logpath + QLatin1String("/") + filenameSingle + suffix;
 
     int depthIndex = 2;
     while (FileSystem::fileExists(filename)) {
@@ -54,11 +170,11 @@ void SyncRunFileLog::start(const QString &folderPath)
             if(depthIndex <= length) {
                 filenameSingle = folderPath.split(QLatin1String("/")).at(length - depthIndex) + QString("_") ///
                         + filenameSingle;
-                filename = logpath+ QLatin1String("/") + filenameSingle + QLatin1String("_sync.log");
+                filename = logpath+ QLatin1String("/") + filenameSingle + suffix;
             }
             else {
                 filenameSingle = filenameSingle + QLatin1String("_1");
-                filename = logpath + QLatin1String("/") + filenameSingle + QLatin1String("_sync.log");
+                filename = logpath + QLatin1String("/") + filenameSingle + suffix;
             }
         }
         else break;
@@ -72,19 +188,30 @@ void SyncRunFileLog::start(const QString &folderPath)
         QFile::remove(newFilename);
         QFile::rename(filename, newFilename);
     }
-    _file.reset(new QFile(filename));
+    _file = std::make_shared<QFile>(filename);
 
-    _file->open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text);
-    _out.setDevice(_file.data());
+    // Line breaks in quoted CSV fields must stay as they are
+    auto openMode = QIODevice::WriteOnly | QIODevice::Append;
+    if (_runFormat == Text) {
+        openMode |= QIODevice::Text;
+    }
+    _file->open(openMode);
+    if (_runBuffered) {
+        _buffer.clear();
+        _bufferedLines = 0;
+        _out.setString(&_buffer);
+        _writeTimer.start();
+    } else {
+        _out.setDevice(_file.get());
+    }
 
 
     if (!exists) {
-        _out << folderPath << Qt::endl;
+        _out << folderPath;
+        endLine();
         // We are creating a new file, add the note.
-        _out << "# timestamp | duration | file | instruction | dir | modtime | etag | "
-                "size | fileId | status | errorString | http result code | "
-                "other size | other modtime | X-Request-ID"
-             << Qt::endl;
+        _out << (_runFormat == Compact ? compactHeader : textHeader);
+        endLine();
 
         FileSystem::setFileHidden(filename, true);
     }
@@ -92,7 +219,12 @@ void SyncRunFileLog::start(const QString &folderPath)
 
     _totalDuration.start();
     _lapDuration.start();
-    _out << "#=#=#=# Syncrun started " << dateTimeStr(QDateTime::currentDateTimeUtc()) << Qt::endl;
+    if (_runFormat == Compact) {
+        _out << "S," << dateTimeStr(QDateTime::currentDateTimeUtc());
+    } else {
+        _out << "#=#=#=# Syncrun started " << dateTimeStr(QDateTime::currentDateTimeUtc());
+    }
+    endLine();
 }
 void SyncRunFileLog::logItem(const SyncFileItem &item)
 {
@@ -110,42 +242,140 @@ void SyncRunFileLog::logItem(const SyncFileItem &item)
         }
     }
 
-    const QChar L = QLatin1Char('|');
-    _out << ts << L;
-    _out << L;
-    if (item._instruction != CSYNC_INSTRUCTION_RENAME) {
-        _out << item.destination() << L;
+    const QString fields[] = {
+        ts,
+        QString(),
+        item._instruction != CSYNC_INSTRUCTION_RENAME ? item.destination() : item._file + QLatin1String(" -> ") + item._renameTarget,
+        QString::number(item._instruction),
+        QString::number(item._direction),
+        QString::number(item._modtime),
+        QString::fromUtf8(item._etag),
+        QString::number(item._size),
+        QString::fromUtf8(item._fileId),
+        QString::number(item._status),
+        item._errorString,
+        QString::number(item._httpErrorCode),
+        QString::number(item._previousSize),
+        QString::number(item._previousModtime),
+        QString::fromUtf8(item._requestId),
+    };
+
+    if (_runFormat == Compact) {
+        _out << 'I';
+        for (const auto &field : fields) {
+            _out << ',' << csvField(field);
+        }
     } else {
-        _out << item._file << QLatin1String(" -> ") << item._renameTarget << L;
+        const QChar L = QLatin1Char('|');
+        for (const auto &field : fields) {
+            _out << field << L;
+        }
     }
-    _out << item._instruction << L;
-    _out << item._direction << L;
-    _out << QString::number(item._modtime) << L;
-    _out << item._etag << L;
-    _out << QString::number(item._size) << L;
-    _out << item._fileId << L;
-    _out << item._status << L;
-    _out << item._errorString << L;
-    _out << QString::number(item._httpErrorCode) << L;
-    _out << QString::number(item._previousSize) << L;
-    _out << QString::number(item._previousModtime) << L;
-    _out << item._requestId << L;
-
-    _out << Qt::endl;
+    endLine();
 }
 
 void SyncRunFileLog::logLap(const QString &name)
 {
-    _out << "#=#=#=#=# " << name << " " << dateTimeStr(QDateTime::currentDateTimeUtc())
-         << " (last step: " << _lapDuration.restart() << " msec"
-         << ", total: " << _totalDuration.elapsed() << " msec)" << Qt::endl;
+    const auto dateTime = dateTimeStr(QDateTime::currentDateTimeUtc());
+    const auto lapMsecs = QString::number(_lapDuration.restart());
+    const auto totalMsecs = QString::number(_totalDuration.elapsed());
+    if (_runFormat == Compact) {
+        _out << "L," << csvField(name) << ',' << dateTime << ',' << lapMsecs << ',' << totalMsecs;
+    } else {
+        _out << "#=#=#=#=# " << name << " " << lapText(dateTime, lapMsecs, totalMsecs);
+    }
+    endLine();
 }
 
 void SyncRunFileLog::finish()
 {
-    _out << "#=#=#=# Syncrun finished " << dateTimeStr(QDateTime::currentDateTimeUtc())
-         << " (last step: " << _lapDuration.elapsed() << " msec"
-         << ", total: " << _totalDuration.elapsed() << " msec)" << Qt::endl;
+    const auto dateTime = dateTimeStr(QDateTime::currentDateTimeUtc());
+    const auto lapMsecs = QString::number(_lapDuration.elapsed());
+    const auto totalMsecs = QString::number(_totalDuration.elapsed());
+    if (_runFormat == Compact) {
+        _out << "F," << dateTime << ',' << lapMsecs << ',' << totalMsecs;
+    } else {
+        _out << "#=#=#=# Syncrun finished " << lapText(dateTime, lapMsecs, totalMsecs);
+    }
+    endLine();
+
+    _writeTimer.stop();
+    writeBuffer();
+    _pendingWrite.waitForFinished();
     _file->close();
 }
+
+QByteArray SyncRunFileLog::compactLogToText(const QByteArray &compactLog)
+{
+    const auto input = QString::fromUtf8(compactLog);
+    const auto firstLineEnd = input.indexOf(QLatin1Char('\n'));
+    if (firstLineEnd < 0) {
+        return compactLog;
+    }
+
+    // The folder path stays the first line, it is not a CSV record
+    QString output = input.left(firstLineEnd);
+    if (output.endsWith(QLatin1Char('\r'))) {
+        output.chop(1);
+    }
+    output += QLatin1Char('\n') + textHeader + QLatin1Char('\n');
+
+    auto writeRecord = [&output](const QStringList &record) {
+        const auto &kind = record.first();
+        if (kind.startsWith(QLatin1Char('#'))) {
+            return;
+        }
+        if (kind == QLatin1String("I")) {
+            for (qsizetype i = 1; i < record.size(); ++i) {
+                output += record.at(i) + QLatin1Char('|');
+            }
+        } else if (kind == QLatin1String("S") && record.size() == 2) {
+            output += QLatin1String("#=#=#=# Syncrun started ") + record.at(1);
+        } else if (kind == QLatin1String("L") && record.size() == 5) {
+            output += QLatin1String("#=#=#=#=# ") + record.at(1) + QLatin1Char(' ') + lapText(record.at(2), record.at(3), record.at(4));
+        } else if (kind == QLatin1String("F") && record.size() == 4) {
+            output += QLatin1String("#=#=#=# Syncrun finished ") + lapText(record.at(1), record.at(2), record.at(3));
+        } else {
+            qCWarning(lcSyncRunFileLog) << "Unknown record in compact sync run log" << record;
+            return;
+        }
+        output += QLatin1Char('\n');
+    };
+
+    QStringList record;
+    QString field;
+    auto quoted = false;
+    const auto size = input.size();
+    for (auto i = firstLineEnd + 1; i < size; ++i) {
+        const auto ch = input.at(i);
+        if (quoted) {
+            if (ch != QLatin1Char('"')) {
+                field += ch;
+            } else if (i + 1 < size && input.at(i + 1) == QLatin1Char('"')) {
+                field += ch;
+                ++i;
+            } else {
+                quoted = false;
+            }
+        } else if (ch == QLatin1Char('"') && field.isEmpty()) {
+            quoted = true;
+        } else if (ch == QLatin1Char(',')) {
+            record.append(field);
+            field.clear();
+        } else if (ch == QLatin1Char('\n')) {
+            record.append(field);
+            field.clear();
+            writeRecord(record);
+            record.clear();
+        } else if (ch != QLatin1Char('\r')) {
+            field += ch;
+        }
+    }
+    if (!record.isEmpty() || !field.isEmpty()) {
+        record.append(field);
+        writeRecord(record);
+    }
+
+    return output.toUtf8();
+}
 }
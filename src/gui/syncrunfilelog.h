@@ -16,11 +16,15 @@
 #define SYNCRUNFILELOG_H
 
 #include <QFile>
+#include <QFuture>
 #include <QTextStream>
 #include <QScopedPointer>
 #include <QElapsedTimer>
 #include <QStandardPaths>
 #include <QDir>
+#include <QTimer>
+
+#include <memory>
 
 #include "syncfileitem.h"
 
@@ -30,24 +34,63 @@ class SyncFileItem;
 /**
  * @brief The SyncRunFileLog class
  * @ingroup gui
+ *
+ * Writes the items of each sync run of a folder to a hidden log file in the
+ * application data directory.
+ *
+ * In buffered mode the lines are collected in memory and written by a
+ * background thread once enough of them came together, at least every
+ * second, and at the end of the sync run.
+ *
+ * The compact format is CSV with one record per line of the text format.
+ * compactLogToText() converts it back for support.
  */
 class SyncRunFileLog
 {
 public:
+    enum Format {
+        Text,
+        Compact
+    };
+
     SyncRunFileLog();
+    ~SyncRunFileLog();
+
+    /// Takes effect with the next start()
+    void setBuffered(bool buffered);
+    void setFormat(Format format);
+
     void start(const QString &folderPath);
     void logItem(const SyncFileItem &item);
     void logLap(const QString &name);
     void finish();
 
+    /// The log file of the current or last sync run
+    [[nodiscard]] QString fileName() const;
+
+    /// Converts a log in the compact format to the text format
+    static QByteArray compactLogToText(const QByteArray &compactLog);
+
 protected:
 private:
     QString dateTimeStr(const QDateTime &dt);
+    void endLine();
+    void writeBuffer();
 
-    QScopedPointer<QFile> _file;
+    std::shared_ptr<QFile> _file;
     QTextStream _out;
     QElapsedTimer _totalDuration;
     QElapsedTimer _lapDuration;
+
+    bool _buffered = false;
+    Format _format = Text;
+    bool _runBuffered = false;
+    Format _runFormat = Text;
+
+    QString _buffer;
+    int _bufferedLines = 0;
+    QTimer _writeTimer;
+    QFuture<void> _pendingWrite;
 };
 }
 
@@ -130,6 +130,21 @@ void SyncStatusSummary::setSyncStateForFolder(const Folder *folder)
 
     const auto state = determineSyncStatus(folder->syncResult());
 
+    if (state != SyncResult::SyncRunning && state != SyncResult::NotYetStarted) {
+        _folderProgress.remove(folder->alias());
+
+        // Folders sync concurrently: keep showing the ones that are still running
+        if (otherFolderSyncing(folder)) {
+            if (state == SyncResult::Success) {
+                markFolderAsSuccess(folder);
+            } else if (state != SyncResult::Paused && state != SyncResult::SyncAbortRequested) {
+                markFolderAsError(folder);
+            }
+            showSyncProgress();
+            return;
+        }
+    }
+
     switch (state) {
     case SyncResult::Success:
     case SyncResult::SyncPrepare:
@@ -183,6 +198,14 @@ void SyncStatusSummary::setSyncStateForFolder(const Folder *folder)
     }
 }
 
+bool SyncStatusSummary::otherFolderSyncing(const Folder *folder) const
+{
+    const auto folders = FolderMan::instance()->map();
+    return std::any_of(folders.cbegin(), folders.cend(), [folder](const Folder *other) {
+        return other != folder && other->accountState() == folder->accountState() && other->isSyncRunning();
+    });
+}
+
 void SyncStatusSummary::onFolderSyncStateChanged(const Folder *folder)
 {
     if (!folder) {
@@ -210,11 +233,48 @@ constexpr double calculateOverallPercent(
 
 void SyncStatusSummary::onFolderProgressInfo(const ProgressInfo &progress)
 {
-    const qint64 completedSize = progress.completedSize();
-    const qint64 currentFile = progress.currentFile();
-    const qint64 completedFile = progress.completedFiles();
-    const qint64 totalSize = qMax(completedSize, progress.totalSize());
-    const qint64 numFilesInProgress = qMax(currentFile, progress.totalFiles());
+    const auto folder = qobject_cast<Folder *>(sender());
+    const auto alias = folder ? folder->alias() : QString();
+    if (progress.status() == ProgressInfo::Done) {
+        _folderProgress.remove(alias);
+        return;
+    }
+
+    auto &folderProgress = _folderProgress[alias];
+    folderProgress.completedSize = progress.completedSize();
+    folderProgress.currentFile = progress.currentFile();
+    folderProgress.completedFiles = progress.completedFiles();
+    folderProgress.totalSize = qMax(folderProgress.completedSize, progress.totalSize());
+    folderProgress.totalFiles = qMax(folderProgress.currentFile, progress.totalFiles());
+    folderProgress.trustEta = progress.trustEta();
+    folderProgress.estimatedEta = progress.trustEta() ? progress.totalProgress().estimatedEta : 0;
+
+    showSyncProgress();
+}
+
+void SyncStatusSummary::showSyncProgress()
+{
+    if (_folderProgress.isEmpty()) {
+        return;
+    }
+
+    // The running syncs of all folders of the account are summed up
+    qint64 completedSize = 0;
+    qint64 currentFile = 0;
+    qint64 completedFile = 0;
+    qint64 totalSize = 0;
+    qint64 numFilesInProgress = 0;
+    auto trustEta = true;
+    quint64 estimatedEta = 0;
+    for (const auto &folderProgress : qAsConst(_folderProgress)) {
+        completedSize += folderProgress.completedSize;
+        currentFile += folderProgress.currentFile;
+        completedFile += folderProgress.completedFiles;
+        totalSize += folderProgress.totalSize;
+        numFilesInProgress += folderProgress.totalFiles;
+        trustEta = trustEta && folderProgress.trustEta;
+        estimatedEta = qMax(estimatedEta, folderProgress.estimatedEta);
+    }
 
     if (_totalFiles <= 0 && numFilesInProgress > 0) {
         setSyncStatusString(tr("Syncing"));
@@ -228,11 +288,11 @@ void SyncStatusSummary::onFolderProgressInfo(const ProgressInfo &progress)
         const auto completedSizeString = Utility::octetsToString(completedSize);
         const auto totalSizeString = Utility::octetsToString(totalSize);
 
-        if (progress.trustEta()) {
+        if (trustEta) {
             setSyncStatusDetailString(
                 tr("%1 of %2 · %3 left")
                     .arg(completedSizeString, totalSizeString)
-                    .arg(Utility::durationToDescriptiveString1(progress.totalProgress().estimatedEta)));
+                    .arg(Utility::durationToDescriptiveString1(estimatedEta)));
         } else {
             setSyncStatusDetailString(tr("%1 of %2").arg(completedSizeString, totalSizeString));
         }
@@ -357,6 +417,7 @@ void SyncStatusSummary::setAccountState(AccountStatePtr accountState)
             _accountState.data(), &AccountState::isConnectedChanged, this, &SyncStatusSummary::onIsConnectedChanged);
     }
     _accountState = accountState;
+    _folderProgress.clear();
     connect(_accountState.data(), &AccountState::isConnectedChanged, this, &SyncStatusSummary::onIsConnectedChanged);
 }
 
@@ -67,6 +67,8 @@ private:
     void onIsConnectedChanged();
 
     void setSyncStateForFolder(const Folder *folder);
+    [[nodiscard]] bool otherFolderSyncing(const Folder *folder) const;
+    void showSyncProgress();
     void markFolderAsError(const Folder *folder);
     void markFolderAsSuccess(const Folder *folder);
     [[nodiscard]] bool folderErrors() const;
@@ -87,6 +89,19 @@ private:
     AccountStatePtr _accountState;
     std::set<QString> _foldersWithErrors;
 
+    /// The progress of the running syncs of the account's folders
+    struct FolderProgress
+    {
+        qint64 completedSize = 0;
+        qint64 currentFile = 0;
+        qint64 completedFiles = 0;
+        qint64 totalSize = 0;
+        qint64 totalFiles = 0;
+        bool trustEta = false;
+        quint64 estimatedEta = 0;
+    };
+    QHash<QString, FolderProgress> _folderProgress;
+
     QUrl _syncIcon = Theme::instance()->syncStatusOk();
     double _progress = 1.0;
     bool _isSyncing = false;
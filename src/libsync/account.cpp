@@ -15,6 +15,7 @@
 #include "account.h"
 #include "accessmanager.h"
 #include "accountfwd.h"
+#include "bandwidthmanager.h"
 #include "capabilities.h"
 #include "clientsideencryptionjobs.h"
 #include "configfile.h"
@@ -298,6 +299,14 @@ void Account::trySetupClientStatusReporting()
     }
 }
 
+BandwidthManager *Account::bandwidthManager()
+{
+    if (!_bandwidthManager) {
+        _bandwidthManager = std::make_unique<BandwidthManager>();
+    }
+    return _bandwidthManager.get();
+}
+
 void Account::reportClientStatus(const ClientStatusReportingStatus status) const
 {
     if (_clientStatusReporting) {
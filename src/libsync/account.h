@@ -58,6 +58,7 @@ namespace OCC {
 
 class AbstractCredentials;
 class AccessManager;
+class BandwidthManager;
 class SimpleNetworkJob;
 class PushNotifications;
 class UserStatusConnector;
@@ -341,6 +342,9 @@ public:
 
     void reportClientStatus(const ClientStatusReportingStatus status) const;
 
+    /// Limits the transfers of all the sync engines of the account together
+    BandwidthManager *bandwidthManager();
+
     [[nodiscard]] std::shared_ptr<UserStatusConnector> userStatusConnector() const;
 
     void setLockFileState(const QString &serverRelativePath,
@@ -536,6 +540,8 @@ private:
 
     std::unique_ptr<ClientStatusReporting> _clientStatusReporting;
 
+    std::unique_ptr<BandwidthManager> _bandwidthManager;
+
     std::shared_ptr<UserStatusConnector> _userStatusConnector;
 
     QHash<QString, QVector<SyncFileItem::LockStatus>> _lockStatusChangeInprogress;
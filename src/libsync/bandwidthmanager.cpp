@@ -12,403 +12,224 @@
  * for more details.
  */
 
-#include "owncloudpropagator.h"
+#include "bandwidthmanager.h"
 #include "propagatedownload.h"
 #include "propagateupload.h"
-#include "propagatorjobs.h"
-#include "common/utility.h"
-
-#ifdef Q_OS_WIN
-#include <windef.h>
-#include <winbase.h>
-#endif
 
 #include <QLoggingCategory>
-#include <QTimer>
-#include <QObject>
+
+#include <algorithm>
 
 namespace OCC {
 
 Q_LOGGING_CATEGORY(lcBandwidthManager, "nextcloud.sync.bandwidthmanager", QtInfoMsg)
 
+namespace {
 // Because of the many layers of buffering inside Qt (and probably the OS and the network)
-// we cannot lower this value much more. If we do, the estimated bw will be very high
-// because the buffers fill fast while the actual network algorithms are not relevant yet.
-static qint64 relativeLimitMeasuringTimerIntervalMsec = 1000 * 2;
+// the throughput can't be measured in much less time: the buffers fill fast while the
+// actual network algorithms are not relevant yet.
 // See also WritingState in http://code.woboq.org/qt5/qtbase/src/network/access/qhttpprotocolhandler.cpp.html#_ZN20QHttpProtocolHandler11sendRequestEv
+constexpr std::chrono::milliseconds relativeLimitMeasuringDuration{2000};
+// How long the rate derived from a measurement is used
+constexpr std::chrono::milliseconds relativeLimitDuration{20000};
+// Lower bound of the rate used for relative limits, in bytes per second
+constexpr qint64 relativeLimitMinimumRate = 1024;
+// Queued transfers are woken up at most that often, unless the bucket is small
+constexpr qint64 wakeUpsPerSecond = 100;
+}
 
-// FIXME At some point:
-//  * Register device only after the QNR received its metaDataChanged() signal
-//  * Incorporate Qt buffer fill state (it's a negative absolute delta).
-//  * Incorporate SSL overhead (percentage)
-//  * For relative limiting, do less measuring and more delaying+giving quota
-//  * For relative limiting, smoothen measurements
-
-BandwidthManager::BandwidthManager(OwncloudPropagator *p)
-    : QObject()
-    , _propagator(p)
+BandwidthManager::Direction::Direction(const char *name, const char *wakeMethod)
+    : name(name)
+    , wakeMethod(wakeMethod)
 {
-    _currentUploadLimit = _propagator->_uploadLimit;
-    _currentDownloadLimit = _propagator->_downloadLimit;
-
-    QObject::connect(&_switchingTimer, &QTimer::timeout, this, &BandwidthManager::switchingTimerExpired);
-    _switchingTimer.setInterval(10 * 1000);
-    _switchingTimer.start();
-    QMetaObject::invokeMethod(this, "switchingTimerExpired", Qt::QueuedConnection);
-
-    // absolute uploads/downloads
-    QObject::connect(&_absoluteLimitTimer, &QTimer::timeout, this, &BandwidthManager::absoluteLimitTimerExpired);
-    _absoluteLimitTimer.setInterval(1000);
-    _absoluteLimitTimer.start();
-
-    // Relative uploads
-    QObject::connect(&_relativeUploadMeasuringTimer, &QTimer::timeout,
-        this, &BandwidthManager::relativeUploadMeasuringTimerExpired);
-    _relativeUploadMeasuringTimer.setInterval(relativeLimitMeasuringTimerIntervalMsec);
-    _relativeUploadMeasuringTimer.start();
-    _relativeUploadMeasuringTimer.setSingleShot(true); // will be restarted from the delay timer
-    QObject::connect(&_relativeUploadDelayTimer, &QTimer::timeout,
-        this, &BandwidthManager::relativeUploadDelayTimerExpired);
-    _relativeUploadDelayTimer.setSingleShot(true); // will be restarted from the measuring timer
-
-    // Relative downloads
-    QObject::connect(&_relativeDownloadMeasuringTimer, &QTimer::timeout,
-        this, &BandwidthManager::relativeDownloadMeasuringTimerExpired);
-    _relativeDownloadMeasuringTimer.setInterval(relativeLimitMeasuringTimerIntervalMsec);
-    _relativeDownloadMeasuringTimer.start();
-    _relativeDownloadMeasuringTimer.setSingleShot(true); // will be restarted from the delay timer
-    QObject::connect(&_relativeDownloadDelayTimer, &QTimer::timeout,
-        this, &BandwidthManager::relativeDownloadDelayTimerExpired);
-    _relativeDownloadDelayTimer.setSingleShot(true); // will be restarted from the measuring timer
+    wakeTimer.setSingleShot(true);
+    wakeTimer.setTimerType(Qt::PreciseTimer);
+    relativeLimitTimer.setSingleShot(true);
 }
 
-BandwidthManager::~BandwidthManager() = default;
-
-void BandwidthManager::registerUploadDevice(UploadDevice *p)
+BandwidthManager::BandwidthManager()
+    : QObject()
+    , _upload("Upload", "readyRead")
+    , _download("Download", "slotReadyRead")
 {
-    _absoluteUploadDeviceList.push_back(p);
-    _relativeUploadDeviceList.push_back(p);
-    QObject::connect(p, &QObject::destroyed, this, &BandwidthManager::unregisterUploadDevice);
-
-    if (usingAbsoluteUploadLimit()) {
-        p->setBandwidthLimited(true);
-        p->setChoked(false);
-    } else if (usingRelativeUploadLimit()) {
-        p->setBandwidthLimited(true);
-        p->setChoked(true);
-    } else {
-        p->setBandwidthLimited(false);
-        p->setChoked(false);
+    _clock.start();
+
+    for (auto direction : { &_upload, &_download }) {
+        QObject::connect(&direction->wakeTimer, &QTimer::timeout, this, [this, direction] {
+            wakeUp(*direction);
+        });
+        QObject::connect(&direction->relativeLimitTimer, &QTimer::timeout, this, [this, direction] {
+            relativeLimitTimerExpired(*direction);
+        });
     }
 }
 
-void BandwidthManager::unregisterUploadDevice(QObject *o)
+BandwidthManager::~BandwidthManager() = default;
+
+std::chrono::milliseconds BandwidthManager::now() const
 {
-    auto p = reinterpret_cast<UploadDevice *>(o); // note, we might already be in the ~QObject
-    _absoluteUploadDeviceList.remove(p);
-    _relativeUploadDeviceList.remove(p);
-    if (p == _relativeLimitCurrentMeasuredDevice) {
-        _relativeLimitCurrentMeasuredDevice = nullptr;
-        _relativeUploadLimitProgressAtMeasuringRestart = 0;
-    }
+    return std::chrono::milliseconds(_clock.elapsed());
 }
 
-void BandwidthManager::registerDownloadJob(GETFileJob *j)
+void BandwidthManager::setUploadLimit(qint64 limit)
 {
-    _downloadJobList.push_back(j);
-    QObject::connect(j, &QObject::destroyed, this, &BandwidthManager::unregisterDownloadJob);
-
-    if (usingAbsoluteDownloadLimit()) {
-        j->setBandwidthLimited(true);
-        j->setChoked(false);
-    } else if (usingRelativeDownloadLimit()) {
-        j->setBandwidthLimited(true);
-        j->setChoked(true);
-    } else {
-        j->setBandwidthLimited(false);
-        j->setChoked(false);
-    }
+    setLimit(_upload, limit);
 }
 
-void BandwidthManager::unregisterDownloadJob(QObject *o)
+void BandwidthManager::setDownloadLimit(qint64 limit)
 {
-    auto *j = reinterpret_cast<GETFileJob *>(o); // note, we might already be in the ~QObject
-    _downloadJobList.remove(j);
-    if (_relativeLimitCurrentMeasuredJob == j) {
-        _relativeLimitCurrentMeasuredJob = nullptr;
-        _relativeDownloadLimitProgressAtMeasuringRestart = 0;
-    }
+    setLimit(_download, limit);
 }
 
-void BandwidthManager::relativeUploadMeasuringTimerExpired()
+void BandwidthManager::setLimit(Direction &direction, qint64 limit)
 {
-    if (!usingRelativeUploadLimit() || _relativeUploadDeviceList.empty()) {
-        // Not in this limiting mode, just wait 1 sec to continue the cycle
-        _relativeUploadDelayTimer.setInterval(1000);
-        _relativeUploadDelayTimer.start();
+    if (limit == direction.limit) {
         return;
     }
+    qCInfo(lcBandwidthManager) << direction.name << "bandwidth limit changed" << direction.limit << limit;
+    direction.limit = limit;
 
-    if (!_relativeLimitCurrentMeasuredDevice) {
-        qCDebug(lcBandwidthManager) << "No device set, just waiting 1 sec";
-        _relativeUploadDelayTimer.setInterval(1000);
-        _relativeUploadDelayTimer.start();
+    direction.relativeLimitTimer.stop();
+    direction.measuring = false;
+    if (limit < 0) {
+        // Starts with measuring the throughput without limit
+        relativeLimitTimerExpired(direction);
         return;
     }
 
-    qCDebug(lcBandwidthManager) << _relativeUploadDeviceList.size() << "Starting Delay";
-
-    const auto currentReadWithProgress = _relativeLimitCurrentMeasuredDevice->_readWithProgress;
-    const auto currentRead = _relativeLimitCurrentMeasuredDevice->_read;
-    const auto relativeLimitProgressMeasured = (currentReadWithProgress + currentRead) / 2;
-    const auto relativeLimitProgressDifference = relativeLimitProgressMeasured - _relativeUploadLimitProgressAtMeasuringRestart;
-
-    qCDebug(lcBandwidthManager) << _relativeUploadLimitProgressAtMeasuringRestart
-                                << relativeLimitProgressMeasured
-                                << relativeLimitProgressDifference;
-
-    const auto speedkBPerSec = (relativeLimitProgressDifference / relativeLimitMeasuringTimerIntervalMsec * 1000) / 1024;
-
-    qCDebug(lcBandwidthManager) << relativeLimitProgressDifference / 1024 << "kB =>" << speedkBPerSec << "kB/sec on full speed ("
-                                << currentReadWithProgress << currentRead
-                                << qAbs(currentReadWithProgress - currentRead)
-                                << ")";
-
-    const auto uploadLimitPercent = qMax( qMin(-_currentUploadLimit, qint64(90)), qint64(10) ); // Clamp value
-    const auto wholeTimeMsec = (100.0 / uploadLimitPercent) * relativeLimitMeasuringTimerIntervalMsec;
-    const auto waitTimeMsec = wholeTimeMsec - relativeLimitMeasuringTimerIntervalMsec;
-    const auto realWaitTimeMsec = waitTimeMsec + wholeTimeMsec;
-
-    qCDebug(lcBandwidthManager) << waitTimeMsec << " - " << realWaitTimeMsec << " msec for " << uploadLimitPercent << "%";
-
-    // We want to wait twice as long since we want to give all
-    // devices the same quota we used now since we don't want
-    // any upload to timeout
-    _relativeUploadDelayTimer.setInterval(realWaitTimeMsec);
-    _relativeUploadDelayTimer.start();
-
-    const auto deviceCount = _relativeUploadDeviceList.size();
-    const auto  quotaPerDevice = relativeLimitProgressDifference * (uploadLimitPercent / 100.0) / deviceCount + 1.0;
-
-    for (const auto uploadDevice : _relativeUploadDeviceList) {
-        uploadDevice->setBandwidthLimited(true);
-        uploadDevice->setChoked(false);
-        uploadDevice->giveBandwidthQuota(quotaPerDevice);
-        qCDebug(lcBandwidthManager) << "Gave" << quotaPerDevice / 1024.0 << "kB to" << uploadDevice;
+    direction.bucket.setRate(limit, now());
+    direction.woken.clear();
+    direction.wakeTimer.stop();
+    if (direction.bucket.isLimited()) {
+        scheduleWakeUp(direction);
+    } else {
+        wakeUp(direction);
     }
-
-    _relativeLimitCurrentMeasuredDevice = nullptr;
 }
 
-void BandwidthManager::relativeUploadDelayTimerExpired()
+void BandwidthManager::relativeLimitTimerExpired(Direction &direction)
 {
-    // Switch to measuring state
-    _relativeUploadMeasuringTimer.start(); // always start to continue the cycle
-
-    if (!usingRelativeUploadLimit()) {
-        return; // oh, not actually needed
+    if (direction.limit >= 0) {
+        return;
     }
 
-    if (_relativeUploadDeviceList.empty()) {
+    const auto measuredBytes = direction.bucket.bytesTaken() - direction.bytesAtMeasuringStart;
+    if (!direction.measuring || measuredBytes <= 0) {
+        // (Re)start measuring: the queued transfers may go on at full speed
+        direction.measuring = true;
+        direction.bytesAtMeasuringStart = direction.bucket.bytesTaken();
+        direction.bucket.setRate(0, now());
+        direction.wakeTimer.stop();
+        wakeUp(direction);
+        direction.relativeLimitTimer.start(relativeLimitMeasuringDuration);
         return;
     }
 
-    qCDebug(lcBandwidthManager) << _relativeUploadDeviceList.size() << "Starting measuring";
-
-    // Take first device and then append it again (= we round robin all devices)
-    _relativeLimitCurrentMeasuredDevice = _relativeUploadDeviceList.front();
-    _relativeUploadDeviceList.pop_front();
-    _relativeUploadDeviceList.push_back(_relativeLimitCurrentMeasuredDevice);
-
-    const auto currentReadWithProgress = _relativeLimitCurrentMeasuredDevice->_readWithProgress;
-    const auto currentRead =  _relativeLimitCurrentMeasuredDevice->_read;
-    _relativeUploadLimitProgressAtMeasuringRestart = (currentReadWithProgress + currentRead) / 2;
+    // Pick the rate that gives the percentage on average over the measuring
+    // and the limited time: 100 * (M * full + L * rate) = percent * full * (M + L)
+    const auto percent = qBound<qint64>(10, -direction.limit, 90);
+    const auto measuring = relativeLimitMeasuringDuration.count();
+    const auto limited = relativeLimitDuration.count();
+    const auto fullRate = measuredBytes * 1000 / measuring;
+    const auto rate = qMax(relativeLimitMinimumRate, fullRate * (percent * (measuring + limited) - 100 * measuring) / (100 * limited));
 
-    _relativeLimitCurrentMeasuredDevice->setBandwidthLimited(false);
-    _relativeLimitCurrentMeasuredDevice->setChoked(false);
+    qCDebug(lcBandwidthManager) << direction.name << "throughput" << fullRate / 1024 << "kB/s, limiting to" << rate / 1024 << "kB/s for" << percent << "%";
 
-    // choke all other UploadDevices
-    for (const auto uploadDevice : _relativeUploadDeviceList) {
-        if (uploadDevice == _relativeLimitCurrentMeasuredDevice) {
-            continue;
-        }
+    direction.measuring = false;
+    direction.bucket.setRate(rate, now());
+    direction.relativeLimitTimer.start(relativeLimitDuration);
+}
 
-        uploadDevice->setBandwidthLimited(true);
-        uploadDevice->setChoked(true);
-    }
+qint64 BandwidthManager::takeUploadQuota(UploadDevice *device, qint64 maxBytes)
+{
+    return takeQuota(_upload, device, maxBytes);
+}
 
-    // now we're in measuring state
+qint64 BandwidthManager::takeDownloadQuota(GETFileJob *job, qint64 maxBytes)
+{
+    return takeQuota(_download, job, maxBytes);
 }
 
-// for downloads:
-void BandwidthManager::relativeDownloadMeasuringTimerExpired()
+qint64 BandwidthManager::takeQuota(Direction &direction, QObject *transfer, qint64 maxBytes)
 {
-    if (!usingRelativeDownloadLimit() || _downloadJobList.empty()) {
-        // Not in this limiting mode, just wait 1 sec to continue the cycle
-        _relativeDownloadDelayTimer.setInterval(1000);
-        _relativeDownloadDelayTimer.start();
-        return;
+    if (maxBytes <= 0) {
+        return 0;
     }
-    if (!_relativeLimitCurrentMeasuredJob) {
-        qCDebug(lcBandwidthManager) << "No job set, just waiting 1 sec";
-        _relativeDownloadDelayTimer.setInterval(1000);
-        _relativeDownloadDelayTimer.start();
-        return;
+    if (!direction.bucket.isLimited()) {
+        return direction.bucket.take(maxBytes, now());
     }
 
-    qCDebug(lcBandwidthManager) << _downloadJobList.size() << "Starting Delay";
-
-    const auto relativeLimitProgressMeasured = _relativeLimitCurrentMeasuredJob->currentDownloadPosition();
-    const auto relativeLimitProgressDifference = relativeLimitProgressMeasured - _relativeDownloadLimitProgressAtMeasuringRestart;
-
-    qCDebug(lcBandwidthManager) << _relativeDownloadLimitProgressAtMeasuringRestart
-                                << relativeLimitProgressMeasured << relativeLimitProgressDifference;
-
-    const auto speedkBPerSec = (relativeLimitProgressDifference / relativeLimitMeasuringTimerIntervalMsec * 1000) / 1024;
-
-    qCDebug(lcBandwidthManager) << relativeLimitProgressDifference / 1024 << "kB =>" << speedkBPerSec << "kB/sec on full speed ("
-                                << _relativeLimitCurrentMeasuredJob->currentDownloadPosition();
-
-    const auto downloadLimitPercent = qMax( qMin(-_currentDownloadLimit, qint64(90)), qint64(10));
-    const auto wholeTimeMsec = (100.0 / downloadLimitPercent) * relativeLimitMeasuringTimerIntervalMsec;
-    const auto waitTimeMsec = wholeTimeMsec - relativeLimitMeasuringTimerIntervalMsec;
-    const auto realWaitTimeMsec = waitTimeMsec + wholeTimeMsec;
-
-    qCDebug(lcBandwidthManager) << waitTimeMsec << " - " << realWaitTimeMsec << " msec for " << downloadLimitPercent << "%";
-
-    // We want to wait twice as long since we want to give all
-    // devices the same quota we used now since we don't want
-    // any download to timeout
-    _relativeDownloadDelayTimer.setInterval(realWaitTimeMsec);
-    _relativeDownloadDelayTimer.start();
-
-    const auto jobCount = _downloadJobList.size();
-    auto quota = relativeLimitProgressDifference * (downloadLimitPercent / 100.0);
-
-    if (quota > 20 * 1024) {
-        qCDebug(lcBandwidthManager) << "ADJUSTING QUOTA FROM " << quota << " TO " << quota - 20 * 1024;
-        quota -= 20 * 1024;
+    // Queued transfers come first, unless this one was just woken up
+    if (!direction.woken.contains(transfer) && !direction.waiting.empty()) {
+        enqueue(direction, transfer);
+        return 0;
     }
 
-    const auto quotaPerJob = quota / jobCount + 1;
-    for (const auto getFileJob : _downloadJobList) {
-        getFileJob->setBandwidthLimited(true);
-        getFileJob->setChoked(false);
-        getFileJob->giveBandwidthQuota(quotaPerJob);
-
-        qCDebug(lcBandwidthManager) << "Gave" << quotaPerJob / 1024.0 << "kB to" << getFileJob;
+    const auto granted = direction.bucket.take(maxBytes, now());
+    if (granted == 0) {
+        direction.woken.remove(transfer);
+        enqueue(direction, transfer);
     }
-    _relativeLimitCurrentMeasuredDevice = nullptr;
+    return granted;
 }
 
-void BandwidthManager::relativeDownloadDelayTimerExpired()
+void BandwidthManager::enqueue(Direction &direction, QObject *transfer)
 {
-    // Switch to measuring state
-    _relativeDownloadMeasuringTimer.start(); // always start to continue the cycle
-
-    if (!usingRelativeDownloadLimit()) {
-        return; // oh, not actually needed
+    if (std::find(direction.waiting.cbegin(), direction.waiting.cend(), transfer) == direction.waiting.cend()) {
+        direction.waiting.push_back(transfer);
     }
+    scheduleWakeUp(direction);
+}
 
-    if (_downloadJobList.empty()) {
-        qCDebug(lcBandwidthManager) << _downloadJobList.size() << "No jobs?";
+void BandwidthManager::scheduleWakeUp(Direction &direction)
+{
+    if (direction.waiting.empty() || direction.wakeTimer.isActive()) {
         return;
     }
-
-    qCDebug(lcBandwidthManager) << _downloadJobList.size() << "Starting measuring";
-
-    // Take first device and then append it again (= we round robin all devices)
-    _relativeLimitCurrentMeasuredJob = _downloadJobList.front();
-    _downloadJobList.pop_front();
-    _downloadJobList.push_back(_relativeLimitCurrentMeasuredJob);
-
-    _relativeDownloadLimitProgressAtMeasuringRestart = _relativeLimitCurrentMeasuredJob->currentDownloadPosition();
-    _relativeLimitCurrentMeasuredJob->setBandwidthLimited(false);
-    _relativeLimitCurrentMeasuredJob->setChoked(false);
-
-    // choke all other download jobs
-    for (const auto getFileJob : _downloadJobList) {
-        if (getFileJob == _relativeLimitCurrentMeasuredJob) {
-            continue;
-        }
-
-        getFileJob->setBandwidthLimited(true);
-        getFileJob->setChoked(true);
-    }
-
-    // now we're in measuring state
+    const auto &bucket = direction.bucket;
+    const auto threshold = qMin(bucket.capacity(), qMax(TokenBucket::minimumCapacity, bucket.rate() / wakeUpsPerSecond));
+    direction.wakeTimer.start(bucket.timeUntilAvailable(threshold, now()));
 }
 
-// end downloads
-
-void BandwidthManager::switchingTimerExpired()
+void BandwidthManager::wakeUp(Direction &direction)
 {
-    const auto newUploadLimit = _propagator->_uploadLimit;
-    if (newUploadLimit != _currentUploadLimit) {
-        qCInfo(lcBandwidthManager) << "Upload Bandwidth limit changed" << _currentUploadLimit << newUploadLimit;
-        _currentUploadLimit = newUploadLimit;
-
-        for (const auto uploadDevice : _relativeUploadDeviceList) {
-            Q_ASSERT(uploadDevice);
-
-            if (usingAbsoluteUploadLimit()) {
-                uploadDevice->setBandwidthLimited(true);
-                uploadDevice->setChoked(false);
-            } else if (usingRelativeUploadLimit()) {
-                uploadDevice->setBandwidthLimited(true);
-                uploadDevice->setChoked(true);
-            } else {
-                uploadDevice->setBandwidthLimited(false);
-                uploadDevice->setChoked(false);
-            }
-        }
+    if (direction.waiting.empty()) {
+        return;
     }
 
-    const auto newDownloadLimit = _propagator->_downloadLimit;
-    if (newDownloadLimit != _currentDownloadLimit) {
-        qCInfo(lcBandwidthManager) << "Download Bandwidth limit changed" << _currentDownloadLimit << newDownloadLimit;
-        _currentDownloadLimit = newDownloadLimit;
-
-        for (const auto getJob : _downloadJobList) {
-            Q_ASSERT(getJob);
-
-            if (usingAbsoluteDownloadLimit()) {
-                getJob->setBandwidthLimited(true);
-                getJob->setChoked(false);
-            } else if (usingRelativeDownloadLimit()) {
-                getJob->setBandwidthLimited(true);
-                getJob->setChoked(true);
-            } else {
-                getJob->setBandwidthLimited(false);
-                getJob->setChoked(false);
-            }
-        }
+    // Wake up as many transfers as there are tokens for a read each
+    auto count = direction.waiting.size();
+    if (direction.bucket.isLimited()) {
+        const auto reads = static_cast<size_t>(direction.bucket.available(now()) / TokenBucket::minimumCapacity);
+        count = qBound<size_t>(1, reads, count);
     }
-}
-
-void BandwidthManager::absoluteLimitTimerExpired()
-{
-    if (usingAbsoluteUploadLimit() && !_absoluteUploadDeviceList.empty()) {
-        const auto quotaPerDevice = _currentUploadLimit / qMax((std::list<UploadDevice *>::size_type)1, _absoluteUploadDeviceList.size());
-
-        qCDebug(lcBandwidthManager) << quotaPerDevice << _absoluteUploadDeviceList.size() << _currentUploadLimit;
 
-        for (const auto device : _absoluteUploadDeviceList) {
-            device->giveBandwidthQuota(quotaPerDevice);
-            qCDebug(lcBandwidthManager) << "Gave " << quotaPerDevice / 1024.0 << " kB to" << device;
+    qCDebug(lcBandwidthManager) << direction.name << "waking up" << count << "of" << direction.waiting.size() << "transfers";
+    for (; count > 0; --count) {
+        const auto transfer = direction.waiting.front();
+        direction.waiting.pop_front();
+        if (direction.bucket.isLimited()) {
+            direction.woken.insert(transfer);
         }
+        QMetaObject::invokeMethod(transfer, direction.wakeMethod, Qt::QueuedConnection);
     }
+    scheduleWakeUp(direction);
+}
 
-    if (usingAbsoluteDownloadLimit() && !_downloadJobList.empty()) {
-        const auto quotaPerJob = _currentDownloadLimit / qMax((std::list<GETFileJob *>::size_type)1, _downloadJobList.size());
+void BandwidthManager::unregister(Direction &direction, QObject *transfer)
+{
+    direction.waiting.remove(transfer);
+    direction.woken.remove(transfer);
+}
 
-        qCDebug(lcBandwidthManager) << quotaPerJob << _downloadJobList.size() << _currentDownloadLimit;
+void BandwidthManager::unregisterUploadDevice(QObject *o)
+{
+    unregister(_upload, o); // note, we might already be in the ~QObject
+}
 
-        for (const auto job : _downloadJobList) {
-            job->giveBandwidthQuota(quotaPerJob);
-            qCDebug(lcBandwidthManager) << "Gave " << quotaPerJob / 1024.0 << " kB to" << job;
-        }
-    }
+void BandwidthManager::unregisterDownloadJob(QObject *o)
+{
+    unregister(_download, o); // note, we might already be in the ~QObject
 }
 
 } // namespace OCC
@@ -15,90 +15,110 @@
 #ifndef BANDWIDTHMANAGER_H
 #define BANDWIDTHMANAGER_H
 
+#include "owncloudlib.h"
+#include "tokenbucket.h"
+
+#include <QElapsedTimer>
 #include <QObject>
+#include <QSet>
 #include <QTimer>
-#include <QIODevice>
 #include <list>
 
 namespace OCC {
 
 class UploadDevice;
 class GETFileJob;
-class OwncloudPropagator;
 
 /**
  * @brief The BandwidthManager class
+ *
+ * Limits the upload and the download rate of all the transfers of an
+ * account, Account::bandwidthManager() is shared by the sync engines of all
+ * its folders. Each direction has one TokenBucket that is shared by all its
+ * transfers: UploadDevice::readData() and GETFileJob take tokens for every
+ * block they read, so any number of transfers can run in parallel while
+ * their sum honors the limit.
+ *
+ * A transfer that gets no tokens stops reading and is queued. Once enough
+ * tokens were refilled, the queued transfers are woken up in the order they
+ * were queued in.
+ *
+ * Positive limits are in bytes per second. Negative limits are a percentage
+ * of the throughput: it is measured for a short time without a limit every
+ * now and then, in between the bucket is set to the rate that gives the
+ * percentage on average.
+ *
  * @ingroup libsync
  */
-class BandwidthManager : public QObject
+class OWNCLOUDSYNC_EXPORT BandwidthManager : public QObject
 {
     Q_OBJECT
 public:
-    BandwidthManager(OwncloudPropagator *p);
+    BandwidthManager();
     ~BandwidthManager() override;
 
-    bool usingAbsoluteUploadLimit() { return _currentUploadLimit > 0; }
-    bool usingRelativeUploadLimit() { return _currentUploadLimit < 0; }
-    bool usingAbsoluteDownloadLimit() { return _currentDownloadLimit > 0; }
-    bool usingRelativeDownloadLimit() { return _currentDownloadLimit < 0; }
+    /** Positive values are bytes per second, negative ones percent, 0 means no limit. */
+    void setUploadLimit(qint64 limit);
+    void setDownloadLimit(qint64 limit);
+
+    bool usingAbsoluteUploadLimit() { return _upload.limit > 0; }
+    bool usingRelativeUploadLimit() { return _upload.limit < 0; }
+    bool usingAbsoluteDownloadLimit() { return _download.limit > 0; }
+    bool usingRelativeDownloadLimit() { return _download.limit < 0; }
 
+    /** Returns how many of maxBytes the device may read now.
+     *
+     * If that is 0 the device gets a readyRead() once it may continue.
+     */
+    qint64 takeUploadQuota(OCC::UploadDevice *device, qint64 maxBytes);
+
+    /** Returns how many of maxBytes the job may read now.
+     *
+     * If that is 0 the job reads again once it may continue.
+     */
+    qint64 takeDownloadQuota(OCC::GETFileJob *job, qint64 maxBytes);
 
 public slots:
-    void registerUploadDevice(OCC::UploadDevice *);
     void unregisterUploadDevice(QObject *);
-
-    void registerDownloadJob(OCC::GETFileJob *);
     void unregisterDownloadJob(QObject *);
 
-    void absoluteLimitTimerExpired();
-    void switchingTimerExpired();
-
-    void relativeUploadMeasuringTimerExpired();
-    void relativeUploadDelayTimerExpired();
-
-    void relativeDownloadMeasuringTimerExpired();
-    void relativeDownloadDelayTimerExpired();
-
 private:
-    // for switching between absolute and relative bw limiting
-    QTimer _switchingTimer;
-
-    // FIXME this timer and this variable should be replaced
-    // by the propagator emitting the changed limit values to us as signal
-    OwncloudPropagator *_propagator;
-
-    // for absolute up/down bw limiting
-    QTimer _absoluteLimitTimer;
-
-    // FIXME merge these two lists
-    std::list<UploadDevice *> _absoluteUploadDeviceList;
-    std::list<UploadDevice *> _relativeUploadDeviceList;
-
-    QTimer _relativeUploadMeasuringTimer;
-
-    // for relative bw limiting, we need to wait this amount before measuring again
-    QTimer _relativeUploadDelayTimer;
-
-    // the device measured
-    UploadDevice *_relativeLimitCurrentMeasuredDevice = nullptr;
-
-    // for measuring how much progress we made at start
-    qint64 _relativeUploadLimitProgressAtMeasuringRestart = 0;
-    qint64 _currentUploadLimit = 0;
-
-    std::list<GETFileJob *> _downloadJobList;
-    QTimer _relativeDownloadMeasuringTimer;
-
-    // for relative bw limiting, we need to wait this amount before measuring again
-    QTimer _relativeDownloadDelayTimer;
-
-    // the device measured
-    GETFileJob *_relativeLimitCurrentMeasuredJob = nullptr;
-
-    // for measuring how much progress we made at start
-    qint64 _relativeDownloadLimitProgressAtMeasuringRestart = 0LL;
-
-    qint64 _currentDownloadLimit = 0;
+    struct Direction
+    {
+        Direction(const char *name, const char *wakeMethod);
+
+        const char *name;
+        // The slot or signal the transfers that were queued get invoked
+        const char *wakeMethod;
+
+        qint64 limit = 0;
+        TokenBucket bucket;
+
+        // Transfers waiting for tokens, in the order they will be woken up
+        std::list<QObject *> waiting;
+        // Transfers that were woken up and may take tokens before the queued ones
+        QSet<QObject *> woken;
+        QTimer wakeTimer;
+
+        // For relative limits: true while the throughput is measured
+        bool measuring = false;
+        qint64 bytesAtMeasuringStart = 0;
+        QTimer relativeLimitTimer;
+    };
+
+    void setLimit(Direction &direction, qint64 limit);
+    qint64 takeQuota(Direction &direction, QObject *transfer, qint64 maxBytes);
+    void enqueue(Direction &direction, QObject *transfer);
+    void unregister(Direction &direction, QObject *transfer);
+    void scheduleWakeUp(Direction &direction);
+    void wakeUp(Direction &direction);
+    void relativeLimitTimerExpired(Direction &direction);
+
+    [[nodiscard]] std::chrono::milliseconds now() const;
+
+    QElapsedTimer _clock;
+    Direction _upload;
+    Direction _download;
 };
 
 } // namespace OCC
@@ -58,9 +58,6 @@ QByteArray getHeaderFromJsonReply(const QJsonObject &reply, const QByteArray &he
     return reply.value(headerName).toString().toLatin1();
 }
 
-constexpr auto batchSize = 100;
-constexpr auto parallelJobsMaximumCount = 1;
-
 }
 
 namespace OCC {
@@ -71,28 +68,39 @@ BulkPropagatorJob::BulkPropagatorJob(OwncloudPropagator *propagator, const std::
     : PropagatorJob(propagator)
     , _items(items)
 {
-    _filesToUpload.reserve(batchSize);
-    _pendingChecksumFiles.reserve(batchSize);
 }
 
 bool BulkPropagatorJob::scheduleSelfOrChild()
 {
-    if (_items.empty() || !_pendingChecksumFiles.empty()) {
+    // Every batch is one request, as many run at the same time as other transfers would
+    if (_items.empty() || _batches.size() >= static_cast<size_t>(propagator()->maximumActiveTransferJob())) {
         return false;
     }
 
     _state = Running;
+    if (!_uploadDuration.isValid()) {
+        _uploadDuration.start();
+    }
 
-    for(auto i = 0; i < batchSize && !_items.empty(); ++i) {
+    const auto &batchController = propagator()->bulkUploadBatchController();
+    const auto batchId = _nextBatchId++;
+    auto &batch = _batches[batchId];
+    qint64 batchBytes = 0;
+    while (!_items.empty() && batch._pendingChecksumItems.size() < batchController.batchFiles()) {
         const auto currentItem = _items.front();
+        if (!batch._pendingChecksumItems.isEmpty() && batchBytes + currentItem->_size > batchController.batchBytes()) {
+            break;
+        }
         _items.pop_front();
-        _pendingChecksumFiles.insert(currentItem->_file);
+        batchBytes += currentItem->_size;
+        batch._pendingChecksumItems.insert(currentItem);
 
-        QMetaObject::invokeMethod(this, [this, currentItem] {
+        QMetaObject::invokeMethod(this, [this, currentItem, batchId] {
             UploadFileInfo fileToUpload;
             fileToUpload._file = currentItem->_file;
             fileToUpload._size = currentItem->_size;
             fileToUpload._path = propagator()->fullLocalPath(fileToUpload._file);
+            fileToUpload._batchId = batchId;
 
             qCDebug(lcBulkPropagatorJob) << "Scheduling bulk propagator job:" << this
                                          << "and starting upload of item"
@@ -104,7 +112,10 @@ bool BulkPropagatorJob::scheduleSelfOrChild()
         }); // We could be in a different thread (neon jobs)
     }
 
-    return _items.empty() && _filesToUpload.empty();
+    _maximumBatchesInFlight = qMax(_maximumBatchesInFlight, static_cast<int>(_batches.size()));
+    qCDebug(lcBulkPropagatorJob) << "Scheduled batch" << batchId << "with" << batch._pendingChecksumItems.size() << "files and" << batchBytes
+                                 << "bytes," << _batches.size() << "batches in flight";
+    return true;
 }
 
 PropagatorJob::JobParallelism BulkPropagatorJob::parallelism() const
@@ -121,6 +132,7 @@ void BulkPropagatorJob::startUploadFile(SyncFileItemPtr item, UploadFileInfo fil
     // Check if the specific file can be accessed
     if (propagator()->hasCaseClashAccessibilityProblem(fileToUpload._file)) {
         done(item, SyncFileItem::NormalError, tr("File %1 cannot be uploaded because another file with the same name, differing only in case, exists").arg(QDir::toNativeSeparators(item->_file)), ErrorCategory::GenericError);
+        preparationFinished(fileToUpload._batchId, item);
         return;
     }
 
@@ -161,6 +173,7 @@ void BulkPropagatorJob::doStartUpload(SyncFileItemPtr item,
 
         if (!renameSuccess) {
             done(item, SyncFileItem::NormalError, "File contains trailing spaces and couldn't be renamed", ErrorCategory::GenericError);
+            preparationFinished(fileToUpload._batchId, item);
             return;
         }
 
@@ -171,9 +184,8 @@ void BulkPropagatorJob::doStartUpload(SyncFileItemPtr item,
 
         item->_modtime = FileSystem::getModTime(newFilePathAbsolute);
         if (item->_modtime <= 0) {
-            _pendingChecksumFiles.remove(item->_file);
             slotOnErrorStartFolderUnlock(item, SyncFileItem::NormalError, tr("File %1 has invalid modified time. Do not upload to the server.").arg(QDir::toNativeSeparators(item->_file)), ErrorCategory::GenericError);
-            checkPropagationIsDone();
+            preparationFinished(fileToUpload._batchId, item);
             return;
         }
     }
@@ -187,26 +199,44 @@ void BulkPropagatorJob::doStartUpload(SyncFileItemPtr item,
                 fileToUpload._size, currentHeaders};
 
     qCInfo(lcBulkPropagatorJob) << remotePath << "transmission checksum" << transmissionChecksumHeader << fileToUpload._path;
-    _filesToUpload.push_back(std::move(newUploadFile));
-    _pendingChecksumFiles.remove(item->_file);
+    _batches[fileToUpload._batchId]._filesToUpload.push_back(std::move(newUploadFile));
+    preparationFinished(fileToUpload._batchId, item);
+}
+
+void BulkPropagatorJob::preparationFinished(quint64 batchId, const SyncFileItemPtr &item)
+{
+    const auto batchIt = _batches.find(batchId);
+    if (batchIt == _batches.end()) {
+        return;
+    }
+    auto &batch = batchIt->second;
+    batch._pendingChecksumItems.remove(item);
+    if (!batch._pendingChecksumItems.isEmpty()) {
+        return;
+    }
 
-    if (_pendingChecksumFiles.empty()) {
-        triggerUpload();
+    if (batch._filesToUpload.empty()) {
+        // Nothing of this batch is left to upload
+        _batches.erase(batchIt);
+        checkPropagationIsDone();
+        return;
     }
+    triggerUpload(batchId);
 }
 
-void BulkPropagatorJob::triggerUpload()
+void BulkPropagatorJob::triggerUpload(quint64 batchId)
 {
+    auto &batch = _batches[batchId];
     auto uploadParametersData = std::vector<SingleUploadFileData>{};
-    uploadParametersData.reserve(_filesToUpload.size());
+    uploadParametersData.reserve(batch._filesToUpload.size());
 
-    int timeout = 0;
-    for(auto &singleFile : _filesToUpload) {
+    qint64 timeout = 0;
+    for(auto &singleFile : batch._filesToUpload) {
         // job takes ownership of device via a QScopedPointer. Job deletes itself when finishing
         auto device = std::make_unique<UploadDevice>(singleFile._localPath,
                                                      0,
                                                      singleFile._fileSize,
-                                                     &propagator()->_bandwidthManager);
+                                                     propagator()->bandwidthManager());
 
         if (!device->open(QIODevice::ReadOnly)) {
             qCWarning(lcBulkPropagatorJob) << "Could not prepare upload device: " << device->errorString();
@@ -217,9 +247,17 @@ void BulkPropagatorJob::triggerUpload()
                 emit propagator()->seenLockedFile(singleFile._localPath);
             }
 
-            abortWithError(singleFile._item, SyncFileItem::NormalError, device->errorString());
-            emit finished(SyncFileItem::NormalError);
-
+            // Other batches may still be uploading: only this batch fails,
+            // and checkPropagationIsDone() reports the end of the job
+            for (const auto &batchFile : batch._filesToUpload) {
+                if (batchFile._item == singleFile._item) {
+                    done(batchFile._item, SyncFileItem::NormalError, device->errorString(), ErrorCategory::GenericError);
+                } else {
+                    done(batchFile._item, SyncFileItem::SoftError, tr("The upload of another file in the same request failed."), ErrorCategory::GenericError);
+                }
+            }
+            _batches.erase(batchId);
+            checkPropagationIsDone();
             return;
         }
 
@@ -232,7 +270,7 @@ void BulkPropagatorJob::triggerUpload()
     auto job = new PutMultiFileJob(propagator()->account(), bulkUploadUrl, std::move(uploadParametersData), this);
     connect(job, &PutMultiFileJob::finishedSignal, this, &BulkPropagatorJob::slotPutFinished);
 
-    for(auto &singleFile : _filesToUpload) {
+    for(auto &singleFile : batch._filesToUpload) {
         connect(job, &PutMultiFileJob::uploadProgress, this, [this, singleFile] (const qint64 sent, const qint64 total) {
             slotUploadProgress(singleFile._item, sent, total);
         });
@@ -240,26 +278,35 @@ void BulkPropagatorJob::triggerUpload()
 
     adjustLastJobTimeout(job, timeout);
     _jobs.append(job);
+    batch._job = job;
+    batch._duration.start();
     job->start();
 
-    if (parallelism() == PropagatorJob::JobParallelism::FullParallelism && _jobs.size() < parallelJobsMaximumCount) {
-        scheduleSelfOrChild();
+    // Prepare the next batches while this one is in transit
+    while (scheduleSelfOrChild()) {
     }
 }
 
 void BulkPropagatorJob::checkPropagationIsDone()
 {
     if (_items.empty()) {
-        if (!_jobs.empty() || !_pendingChecksumFiles.empty()) {
+        if (!_jobs.empty() || !_batches.empty()) {
             // just wait for the other job to finish.
             return;
         }
 
+        if (_uploadedFiles > 0) {
+            const auto msecs = qMax<qint64>(1, _uploadDuration.elapsed());
+            qCInfo(lcBulkPropagatorJob) << "Bulk upload of" << _uploadedFiles << "files took" << msecs << "ms:" << _uploadedFiles * 1000 / msecs
+                                        << "files/s with up to" << _maximumBatchesInFlight << "batches in flight,"
+                                        << propagator()->bulkUploadBatchController().filesPerSecond() << "files/s per request";
+        }
         qCInfo(lcBulkPropagatorJob) << "final status" << _finalStatus;
         emit finished(_finalStatus);
         propagator()->scheduleNextJob();
     } else {
-        scheduleSelfOrChild();
+        while (scheduleSelfOrChild()) {
+        }
     }
 }
 
@@ -270,6 +317,9 @@ void BulkPropagatorJob::slotComputeTransmissionChecksum(SyncFileItemPtr item,
     const auto computeChecksum = new ComputeChecksum(this);
     const auto checksumType = uploadChecksumEnabled() ? "MD5" : "";
     computeChecksum->setChecksumType(checksumType);
+    if (propagator()->syncOptions()._checksumCache) {
+        computeChecksum->setChecksumCache(propagator()->_journal);
+    }
 
     connect(computeChecksum, &ComputeChecksum::done, this, [this, item, fileToUpload] (const QByteArray &contentChecksumType, const QByteArray &contentChecksum) {
         slotStartUpload(item, fileToUpload, contentChecksumType, contentChecksum);
@@ -292,9 +342,8 @@ void BulkPropagatorJob::slotStartUpload(SyncFileItemPtr item,
     const auto originalFilePath = propagator()->fullLocalPath(item->_file);
 
     if (!FileSystem::fileExists(fullFilePath)) {
-        _pendingChecksumFiles.remove(item->_file);
         slotOnErrorStartFolderUnlock(item, SyncFileItem::SoftError, tr("File Removed (start upload) %1").arg(fullFilePath), ErrorCategory::GenericError);
-        checkPropagationIsDone();
+        preparationFinished(fileToUpload._batchId, item);
         return;
     }
 
@@ -304,21 +353,19 @@ void BulkPropagatorJob::slotStartUpload(SyncFileItemPtr item,
 
     item->_modtime = FileSystem::getModTime(originalFilePath);
     if (item->_modtime <= 0) {
-        _pendingChecksumFiles.remove(item->_file);
         slotOnErrorStartFolderUnlock(item, SyncFileItem::NormalError, tr("File %1 has invalid modification time. Do not upload to the server.").arg(QDir::toNativeSeparators(item->_file)), ErrorCategory::GenericError);
-        checkPropagationIsDone();
+        preparationFinished(fileToUpload._batchId, item);
         return;
     }
     if (prevModtime != item->_modtime) {
         propagator()->_anotherSyncNeeded = true;
-        _pendingChecksumFiles.remove(item->_file);
 
         qCDebug(lcBulkPropagatorJob) << "trigger another sync after checking modified time of item" << item->_file
                                      << "prevModtime" << prevModtime
                                      << "Curr" << item->_modtime;
 
         slotOnErrorStartFolderUnlock(item, SyncFileItem::SoftError, tr("Local file changed during syncing. It will be resumed."), ErrorCategory::GenericError);
-        checkPropagationIsDone();
+        preparationFinished(fileToUpload._batchId, item);
         return;
     }
 
@@ -330,9 +377,8 @@ void BulkPropagatorJob::slotStartUpload(SyncFileItemPtr item,
     // or not yet fully copied to the destination.
     if (fileIsStillChanging(*item)) {
         propagator()->_anotherSyncNeeded = true;
-        _pendingChecksumFiles.remove(item->_file);
         slotOnErrorStartFolderUnlock(item, SyncFileItem::SoftError, tr("Local file changed during sync."), ErrorCategory::GenericError);
-        checkPropagationIsDone();
+        preparationFinished(fileToUpload._batchId, item);
         return;
     }
 
@@ -428,13 +474,38 @@ void BulkPropagatorJob::slotPutFinished()
 
     slotJobDestroyed(job); // remove it from the _jobs list
 
+    const auto batchIt = std::find_if(_batches.begin(), _batches.end(), [job](const auto &batch) {
+        return batch.second._job == job;
+    });
+    if (batchIt == _batches.end()) {
+        qCWarning(lcBulkPropagatorJob) << "Finished bulk upload job without a batch" << job;
+        checkPropagationIsDone();
+        return;
+    }
+    const auto batchId = batchIt->first;
+    const auto &batch = batchIt->second;
+
     const auto jobError = job->reply()->error();
+    const auto httpCode = job->reply()->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    qint64 batchBytes = 0;
+    for (const auto &singleFile : batch._filesToUpload) {
+        batchBytes += singleFile._fileSize;
+    }
+    const auto batchFiles = static_cast<int>(batch._filesToUpload.size());
+    const auto duration = std::chrono::milliseconds(batch._duration.elapsed());
+    propagator()->bulkUploadBatchController().addBatch(batchFiles, batchBytes, duration, httpCode);
+    if (jobError == QNetworkReply::NoError) {
+        _uploadedFiles += batchFiles;
+    }
+    qCInfo(lcBulkPropagatorJob) << "Batch" << batchId << "of" << batchFiles << "files," << batchBytes << "bytes finished in" << duration.count()
+                                << "ms with http code" << httpCode << ":" << batchFiles * 1000 / qMax<qint64>(1, duration.count()) << "files/s";
 
     const auto replyData = job->reply()->readAll();
     const auto replyJson = QJsonDocument::fromJson(replyData);
     const auto fullReplyObject = replyJson.object();
 
-    for (const auto &singleFile : _filesToUpload) {
+    for (const auto &singleFile : batch._filesToUpload) {
         if (!fullReplyObject.contains(singleFile._remotePath)) {
             if (jobError != QNetworkReply::NoError) {
                 singleFile._item->_status = SyncFileItem::NormalError;
@@ -446,7 +517,7 @@ void BulkPropagatorJob::slotPutFinished()
         slotPutFinishedOneFile(singleFile, job, singleReplyObject);
     }
 
-    finalize(fullReplyObject);
+    finalize(batchId, fullReplyObject);
 }
 
 void BulkPropagatorJob::slotUploadProgress(SyncFileItemPtr item, qint64 sent, qint64 total)
@@ -507,11 +578,12 @@ void BulkPropagatorJob::finalizeOneFile(const BulkUploadItem &oneFile)
     propagator()->_journal->commit("upload file start");
 }
 
-void BulkPropagatorJob::finalize(const QJsonObject &fullReply)
+void BulkPropagatorJob::finalize(quint64 batchId, const QJsonObject &fullReply)
 {
     qCDebug(lcBulkPropagatorJob) << "Received a full reply" << fullReply;
 
-    for(auto singleFileIt = std::begin(_filesToUpload); singleFileIt != std::end(_filesToUpload); ) {
+    auto &filesToUpload = _batches[batchId]._filesToUpload;
+    for(auto singleFileIt = std::begin(filesToUpload); singleFileIt != std::end(filesToUpload); ) {
         const auto &singleFile = *singleFileIt;
 
         if (!fullReply.contains(singleFile._remotePath)) {
@@ -524,9 +596,11 @@ void BulkPropagatorJob::finalize(const QJsonObject &fullReply)
 
         done(singleFile._item, singleFile._item->_status, {}, ErrorCategory::GenericError);
 
-        singleFileIt = _filesToUpload.erase(singleFileIt);
+        singleFileIt = filesToUpload.erase(singleFileIt);
     }
 
+    // Files the reply does not mention were handled as errors by slotPutFinished()
+    _batches.erase(batchId);
     checkPropagationIsDone();
 }
 
@@ -21,7 +21,9 @@
 #include <QVector>
 #include <QMap>
 #include <QByteArray>
+#include <QElapsedTimer>
 #include <deque>
+#include <map>
 
 namespace OCC {
 
@@ -45,6 +47,7 @@ class BulkPropagatorJob : public PropagatorJob
       QString _file; /// I'm still unsure if I should use a SyncFilePtr here.
       QString _path; /// the full path on disk.
       qint64 _size = 0LL;
+      quint64 _batchId = 0; /// the batch the file is uploaded with
     };
 
     struct BulkUploadItem
@@ -58,6 +61,17 @@ class BulkPropagatorJob : public PropagatorJob
         QMap<QByteArray, QByteArray> _headers;
     };
 
+    /* The files of one PutMultiFileJob. Several batches can be
+     * prepared and uploaded at the same time.
+     */
+    struct UploadBatch
+    {
+        QSet<SyncFileItemPtr> _pendingChecksumItems; /// items still being prepared for the upload
+        std::vector<BulkUploadItem> _filesToUpload;
+        PutMultiFileJob *_job = nullptr;
+        QElapsedTimer _duration; /// running while the request is in transit
+    };
+
 public:
     explicit BulkPropagatorJob(OwncloudPropagator *propagator,
                                const std::deque<SyncFileItemPtr> &items);
@@ -99,7 +113,7 @@ private:
     void adjustLastJobTimeout(AbstractNetworkJob *job,
                               qint64 fileSize) const;
 
-    void finalize(const QJsonObject &fullReply);
+    void finalize(quint64 batchId, const QJsonObject &fullReply);
 
     void finalizeOneFile(const BulkUploadItem &oneFile);
 
@@ -151,7 +165,12 @@ private:
     void handleJobDoneErrors(SyncFileItemPtr item,
                              SyncFileItem::Status status);
 
-    void triggerUpload();
+    /** The preparation of item is done, either successfully or with an error.
+     * Uploads the batch once all of its files are prepared.
+     */
+    void preparationFinished(quint64 batchId, const SyncFileItemPtr &item);
+
+    void triggerUpload(quint64 batchId);
 
     void checkPropagationIsDone();
 
@@ -159,12 +178,17 @@ private:
 
     QVector<AbstractNetworkJob *> _jobs; /// network jobs that are currently in transit
 
-    QSet<QString> _pendingChecksumFiles;
+    std::map<quint64, UploadBatch> _batches; /// batches being prepared or uploaded
 
-    std::vector<BulkUploadItem> _filesToUpload;
+    quint64 _nextBatchId = 0;
 
     qint64 _sentTotal = 0;
 
+    // For the files per second of the whole bulk upload
+    QElapsedTimer _uploadDuration;
+    qint64 _uploadedFiles = 0;
+    int _maximumBatchesInFlight = 0;
+
     SyncFileItem::Status _finalStatus = SyncFileItem::Status::NoStatus;
 };
 
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2026 by Nextcloud GmbH <info@nextcloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "bulkuploadbatchcontroller.h"
+#include "concurrencycontroller.h"
+
+#include <QLoggingCategory>
+
+namespace OCC {
+
+Q_LOGGING_CATEGORY(lcBulkUploadBatchController, "nextcloud.sync.propagator.bulkupload.batch", QtInfoMsg)
+
+BulkUploadBatchController::BulkUploadBatchController(qint64 initialBytes, qint64 minimumBytes, qint64 maximumBytes, std::chrono::milliseconds targetDuration)
+    : _minimumBytes(qMax<qint64>(1, minimumBytes))
+    , _maximumBytes(qMax(_minimumBytes, maximumBytes))
+    , _targetDuration(targetDuration)
+{
+    _bytes = qBound(_minimumBytes, initialBytes, _maximumBytes);
+}
+
+void BulkUploadBatchController::addBatch(int files, qint64 bytes, std::chrono::milliseconds duration, int httpCode)
+{
+    if (files <= 0) {
+        return;
+    }
+
+    const auto oldFiles = _files;
+    const auto oldBytes = _bytes;
+
+    if (httpCode == 413) {
+        // Request Entity Too Large: stay below what the server refused
+        _maximumBytes = qBound(_minimumBytes, bytes / 2, _maximumBytes);
+        _files = qMax(minimumBatchFiles, qMin(_files, files) / 2);
+        _bytes = qMin(_bytes, _maximumBytes);
+    } else if (ConcurrencyController::isCongestionSignal(httpCode)) {
+        _files = qMax(minimumBatchFiles, _files / 2);
+        _bytes = qMax(_minimumBytes, _bytes / 2);
+    } else if (httpCode >= 200 && httpCode < 300) {
+        _uploadedFiles += files;
+        _uploadDuration += duration;
+
+        if (_targetDuration.count() > 0 && duration.count() > 0) {
+            // The whole targeting is heuristic, like the chunk size of chunking NG:
+            // move half way towards the size that would have matched the target.
+            const auto scale = static_cast<double>(_targetDuration.count()) / static_cast<double>(duration.count());
+            const auto predictedFiles = qMin<double>(maximumBatchFiles, files * scale);
+            const auto predictedBytes = qMin<double>(static_cast<double>(_maximumBytes), static_cast<double>(bytes) * scale);
+            _files = qBound(minimumBatchFiles, qRound((_files + predictedFiles) / 2), maximumBatchFiles);
+            _bytes = qBound(_minimumBytes, qRound64((static_cast<double>(_bytes) + predictedBytes) / 2), _maximumBytes);
+        }
+    }
+
+    if (_files != oldFiles || _bytes != oldBytes) {
+        qCInfo(lcBulkUploadBatchController) << "Batch of" << files << "files," << bytes << "bytes took" << duration.count() << "ms with http code" << httpCode
+                                            << "- next batches have up to" << _files << "files and" << _bytes << "bytes";
+    }
+}
+
+double BulkUploadBatchController::filesPerSecond() const
+{
+    return _uploadDuration.count() > 0 ? _uploadedFiles * 1000.0 / static_cast<double>(_uploadDuration.count()) : 0.0;
+}
+
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2026 by Nextcloud GmbH <info@nextcloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#pragma once
+
+#include "owncloudlib.h"
+
+#include <QtGlobal>
+
+#include <chrono>
+
+namespace OCC {
+
+/**
+ * @brief Adaptive size of the batches of a bulk upload
+ *
+ * Each finished batch predicts the number of files and bytes that would
+ * have taken the target duration to upload. Like the dynamic chunk size of
+ * chunking NG, the next batch moves half way towards that prediction:
+ *
+ * - small files on a fast connection quickly lead to large batches, so the
+ *   round trip per request is shared by more files,
+ * - slow batches get smaller, so a failed request costs less,
+ * - a 5xx or 429 reply halves the batch,
+ * - a 413 reply also lowers the byte limit to what the server accepted.
+ *
+ * A batch always has room for at least one file, even if that file is
+ * larger than batchBytes().
+ *
+ * @ingroup libsync
+ */
+class OWNCLOUDSYNC_EXPORT BulkUploadBatchController
+{
+public:
+    /// The size used before any batch finished
+    static constexpr int defaultBatchFiles = 100;
+    static constexpr int minimumBatchFiles = 10;
+    static constexpr int maximumBatchFiles = 1000;
+
+    /** A target duration of 0 keeps the initial batch size. */
+    BulkUploadBatchController(qint64 initialBytes, qint64 minimumBytes, qint64 maximumBytes, std::chrono::milliseconds targetDuration);
+
+    /** The maximum number of files in the next batch. */
+    [[nodiscard]] int batchFiles() const { return _files; }
+
+    /** The maximum size of the files in the next batch. */
+    [[nodiscard]] qint64 batchBytes() const { return _bytes; }
+
+    [[nodiscard]] qint64 maximumBytes() const { return _maximumBytes; }
+
+    /** Records the outcome of one batch request.
+     *
+     * httpCode is the status of the whole request, 0 if there was no reply.
+     */
+    void addBatch(int files, qint64 bytes, std::chrono::milliseconds duration, int httpCode);
+
+    /** Number of files of all successful batches. */
+    [[nodiscard]] qint64 uploadedFiles() const { return _uploadedFiles; }
+
+    /** Files per second of all successful batches, by the time their requests took. */
+    [[nodiscard]] double filesPerSecond() const;
+
+private:
+    int _files = defaultBatchFiles;
+    qint64 _bytes;
+    qint64 _minimumBytes;
+    qint64 _maximumBytes;
+    std::chrono::milliseconds _targetDuration;
+
+    qint64 _uploadedFiles = 0;
+    std::chrono::milliseconds _uploadDuration{0};
+};
+
+}
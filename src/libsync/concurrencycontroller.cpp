@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2026 by Nextcloud GmbH <info@nextcloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "concurrencycontroller.h"
+
+#include <QLoggingCategory>
+#include <QtMath>
+
+namespace OCC {
+
+Q_LOGGING_CATEGORY(lcConcurrencyController, "nextcloud.sync.propagator.concurrency", QtInfoMsg)
+
+namespace {
+// Multiplicative decrease when the server tells us it is overloaded
+constexpr auto congestionDecreaseFactor = 0.5;
+// Multiplicative decrease when latency explodes without throughput gains
+constexpr auto latencyDecreaseFactor = 0.75;
+// Latency is considered exploded when it exceeds the baseline by this factor
+constexpr auto latencyToleranceFactor = 3.0;
+// Throughput may fluctuate by that much and still count as "not worse"
+constexpr auto throughputTolerance = 0.95;
+// Smoothing of the baseline latency towards higher values
+constexpr auto baselineSmoothing = 0.9;
+}
+
+ConcurrencyController::ConcurrencyController(int initialWindow, int minimumWindow, int maximumWindow)
+    : _window(initialWindow)
+    , _minimumWindow(qMax(1, minimumWindow))
+    , _maximumWindow(qMax(_minimumWindow, maximumWindow))
+{
+    _window = qBound<double>(_minimumWindow, _window, _maximumWindow);
+}
+
+int ConcurrencyController::defaultWindow(int parallelNetworkJobs)
+{
+    return qMax(1, qMin(3, qCeil(parallelNetworkJobs / 2.)));
+}
+
+void ConcurrencyController::setBounds(int minimumWindow, int maximumWindow)
+{
+    _minimumWindow = qMax(1, minimumWindow);
+    _maximumWindow = qMax(_minimumWindow, maximumWindow);
+    _window = qBound<double>(_minimumWindow, _window, _maximumWindow);
+}
+
+int ConcurrencyController::window() const
+{
+    return qFloor(_window);
+}
+
+bool ConcurrencyController::isCongestionSignal(int httpCode)
+{
+    return httpCode == 429 || (httpCode >= 500 && httpCode < 600);
+}
+
+void ConcurrencyController::addSample(qint64 bytes, std::chrono::milliseconds latency, int httpCode)
+{
+    ++_samples;
+    if (isCongestionSignal(httpCode)) {
+        ++_congestionSamples;
+        return;
+    }
+    _bytes += qMax<qint64>(0, bytes);
+    _totalLatency += latency;
+}
+
+void ConcurrencyController::markSaturated()
+{
+    _saturated = true;
+}
+
+ConcurrencyController::Decision ConcurrencyController::evaluate(std::chrono::milliseconds interval)
+{
+    const auto oldWindow = window();
+    auto decision = Decision::Hold;
+
+    const auto successfulSamples = _samples - _congestionSamples;
+    const auto throughput = interval.count() > 0 ? _bytes * 1000.0 / static_cast<double>(interval.count()) : 0.0;
+    const auto averageLatency = successfulSamples > 0 ? static_cast<double>(_totalLatency.count()) / successfulSamples : 0.0;
+
+    if (_congestionSamples > 0) {
+        _window *= congestionDecreaseFactor;
+        decision = Decision::Decrease;
+    } else if (successfulSamples > 0) {
+        const auto throughputNotWorse = throughput >= _previousThroughput * throughputTolerance;
+        const auto latencyExploded = _baselineLatency > 0 && averageLatency > _baselineLatency * latencyToleranceFactor;
+
+        if (latencyExploded && throughput <= _previousThroughput) {
+            _window *= latencyDecreaseFactor;
+            decision = Decision::Decrease;
+        } else if (throughputNotWorse && _saturated) {
+            _window += 1.0;
+            decision = Decision::Increase;
+        }
+
+        // The baseline follows decreases immediately and increases slowly,
+        // so it approximates the latency of an unloaded connection.
+        if (_baselineLatency <= 0 || averageLatency < _baselineLatency) {
+            _baselineLatency = averageLatency;
+        } else {
+            _baselineLatency = baselineSmoothing * _baselineLatency + (1.0 - baselineSmoothing) * averageLatency;
+        }
+        _previousThroughput = throughput;
+    }
+
+    _window = qBound<double>(_minimumWindow, _window, _maximumWindow);
+    if (window() == oldWindow && decision != Decision::Hold) {
+        // clamped: nothing changed in effect
+        decision = Decision::Hold;
+    }
+
+    if (decision != Decision::Hold) {
+        qCInfo(lcConcurrencyController) << "Transfer window" << decision << "from" << oldWindow << "to" << window()
+                                        << "throughput" << qRound64(throughput) << "B/s"
+                                        << "average latency" << qRound64(averageLatency) << "ms"
+                                        << "samples" << _samples << "congested" << _congestionSamples;
+    } else {
+        qCDebug(lcConcurrencyController) << "Transfer window kept at" << window()
+                                         << "throughput" << qRound64(throughput) << "B/s"
+                                         << "average latency" << qRound64(averageLatency) << "ms"
+                                         << "samples" << _samples << "saturated" << _saturated;
+    }
+
+    _lastDecision = decision;
+    resetInterval();
+    return decision;
+}
+
+void ConcurrencyController::resetInterval()
+{
+    _bytes = 0;
+    _totalLatency = std::chrono::milliseconds(0);
+    _samples = 0;
+    _congestionSamples = 0;
+    _saturated = false;
+}
+
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2026 by Nextcloud GmbH <info@nextcloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#pragma once
+
+#include "owncloudlib.h"
+
+#include <QObject>
+
+#include <chrono>
+
+namespace OCC {
+
+/**
+ * @brief Adaptive window for the number of parallel transfer jobs
+ *
+ * Implements additive-increase/multiplicative-decrease on the samples
+ * that are fed to it by the propagator:
+ *
+ * - a 5xx or 429 reply during a measurement interval halves the window,
+ * - a latency blow-up without any throughput gain shrinks it by a quarter,
+ * - a stable or increasing throughput while the window was actually
+ *   saturated grows it by one,
+ * - everything else keeps the window as is.
+ *
+ * The class has no notion of time on its own: the caller closes a
+ * measurement interval by calling evaluate() with its duration. That keeps
+ * the decisions deterministic and testable.
+ *
+ * @ingroup libsync
+ */
+class OWNCLOUDSYNC_EXPORT ConcurrencyController
+{
+    Q_GADGET
+public:
+    enum class Decision {
+        Hold,
+        Increase,
+        Decrease,
+    };
+    Q_ENUM(Decision)
+
+    ConcurrencyController(int initialWindow, int minimumWindow, int maximumWindow);
+
+    /** The window used before any sample was seen, derived from the
+     * configured number of parallel network jobs.
+     */
+    static int defaultWindow(int parallelNetworkJobs);
+
+    /** Changes the bounds, clamping the current window into them. */
+    void setBounds(int minimumWindow, int maximumWindow);
+
+    /** The number of transfer jobs that may currently run in parallel. */
+    [[nodiscard]] int window() const;
+
+    [[nodiscard]] int minimumWindow() const { return _minimumWindow; }
+    [[nodiscard]] int maximumWindow() const { return _maximumWindow; }
+
+    [[nodiscard]] Decision lastDecision() const { return _lastDecision; }
+
+    /** Records the outcome of one finished job.
+     *
+     * bytes is the amount of payload that was transferred, latency is the
+     * time the job was running and httpCode the last HTTP status it got
+     * (0 if unknown).
+     */
+    void addSample(qint64 bytes, std::chrono::milliseconds latency, int httpCode);
+
+    /** To be called whenever the scheduler could not start another transfer
+     * because the window was full. Only saturated windows are grown.
+     */
+    void markSaturated();
+
+    /** Number of samples collected in the current interval. */
+    [[nodiscard]] int pendingSamples() const { return _samples; }
+
+    /** Closes the current measurement interval and adapts the window. */
+    Decision evaluate(std::chrono::milliseconds interval);
+
+    /** Whether the http code indicates an overloaded server. */
+    static bool isCongestionSignal(int httpCode);
+
+private:
+    void resetInterval();
+
+    double _window;
+    int _minimumWindow;
+    int _maximumWindow;
+
+    // Data of the current measurement interval
+    qint64 _bytes = 0;
+    std::chrono::milliseconds _totalLatency{0};
+    int _samples = 0;
+    int _congestionSamples = 0;
+    bool _saturated = false;
+
+    // Data of the previous intervals
+    double _previousThroughput = 0.0;
+    double _baselineLatency = 0.0;
+
+    Decision _lastDecision = Decision::Hold;
+};
+
+}
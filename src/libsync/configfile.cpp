@@ -72,11 +72,24 @@ static constexpr char chunkSizeC[] = "chunkSize";
 static constexpr char minChunkSizeC[] = "minChunkSize";
 static constexpr char maxChunkSizeC[] = "maxChunkSize";
 static constexpr char targetChunkUploadDurationC[] = "targetChunkUploadDuration";
+static constexpr char maxParallelChunkUploadsC[] = "maxParallelChunkUploads";
+static constexpr char maxParallelDownloadSegmentsC[] = "maxParallelDownloadSegments";
+static constexpr char pipelinedSyncC[] = "pipelinedSync";
+static constexpr char journalWriteBehindC[] = "journalWriteBehind";
+static constexpr char discoveryMetadataSnapshotC[] = "discoveryMetadataSnapshot";
+static constexpr char remoteDeltaDiscoveryC[] = "remoteDeltaDiscovery";
+static constexpr char checksumWhileUploadingC[] = "checksumWhileUploading";
+static constexpr char checksumCacheC[] = "checksumCache";
+static constexpr char checksumThreadsPerDeviceC[] = "checksumThreadsPerDevice";
+static constexpr char maxConcurrentSyncsC[] = "maxConcurrentSyncs";
 static constexpr char automaticLogDirC[] = "logToTemporaryLogDir";
 static constexpr char logDirC[] = "logDir";
 static constexpr char logDebugC[] = "logDebug";
 static constexpr char logExpireC[] = "logExpire";
 static constexpr char logFlushC[] = "logFlush";
+static constexpr char asyncLoggingC[] = "asyncLogging";
+static constexpr char bufferedSyncRunLogC[] = "bufferedSyncRunLog";
+static constexpr char compactSyncRunLogC[] = "compactSyncRunLog";
 static constexpr char showExperimentalOptionsC[] = "showExperimentalOptions";
 static constexpr char clientVersionC[] = "clientVersion";
 static constexpr char launchOnSystemStartupC[] = "launchOnSystemStartup";
@@ -265,6 +278,66 @@ chrono::milliseconds ConfigFile::targetChunkUploadDuration() const
     return millisecondsValue(settings, targetChunkUploadDurationC, chrono::minutes(1));
 }
 
+int ConfigFile::maxParallelChunkUploads() const
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    return settings.value(QLatin1String(maxParallelChunkUploadsC), 3).toInt(); // default to 3 chunks of a file in flight
+}
+
+int ConfigFile::maxParallelDownloadSegments() const
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    return settings.value(QLatin1String(maxParallelDownloadSegmentsC), 3).toInt(); // default to 3 ranges of a file in flight
+}
+
+bool ConfigFile::pipelinedSync() const
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    return settings.value(QLatin1String(pipelinedSyncC), true).toBool();
+}
+
+bool ConfigFile::journalWriteBehind() const
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    return settings.value(QLatin1String(journalWriteBehindC), false).toBool();
+}
+
+bool ConfigFile::discoveryMetadataSnapshot() const
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    return settings.value(QLatin1String(discoveryMetadataSnapshotC), true).toBool();
+}
+
+bool ConfigFile::remoteDeltaDiscovery() const
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    return settings.value(QLatin1String(remoteDeltaDiscoveryC), false).toBool();
+}
+
+bool ConfigFile::checksumWhileUploading() const
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    return settings.value(QLatin1String(checksumWhileUploadingC), false).toBool();
+}
+
+bool ConfigFile::checksumCache() const
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    return settings.value(QLatin1String(checksumCacheC), true).toBool();
+}
+
+int ConfigFile::checksumThreadsPerDevice() const
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    return settings.value(QLatin1String(checksumThreadsPerDeviceC), 2).toInt(); // default to 2 files hashed per disk
+}
+
+int ConfigFile::maxConcurrentSyncs() const
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    return settings.value(QLatin1String(maxConcurrentSyncsC), 3).toInt(); // default to 3 sync folders syncing at the same time
+}
+
 void ConfigFile::setOptionalServerNotifications(bool show)
 {
     QSettings settings(configFile(), QSettings::IniFormat);
@@ -1138,6 +1211,30 @@ void ConfigFile::setLogFlush(bool enabled)
     settings.setValue(QLatin1String(logFlushC), enabled);
 }
 
+bool ConfigFile::asyncLogging() const
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    return settings.value(QLatin1String(asyncLoggingC), false).toBool();
+}
+
+void ConfigFile::setAsyncLogging(bool enabled)
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    settings.setValue(QLatin1String(asyncLoggingC), enabled);
+}
+
+bool ConfigFile::bufferedSyncRunLog() const
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    return settings.value(QLatin1String(bufferedSyncRunLogC), false).toBool();
+}
+
+bool ConfigFile::compactSyncRunLog() const
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    return settings.value(QLatin1String(compactSyncRunLogC), false).toBool();
+}
+
 bool ConfigFile::showExperimentalOptions() const
 {
     QSettings settings(configFile(), QSettings::IniFormat);
@@ -111,6 +111,15 @@ public:
     [[nodiscard]] bool logFlush() const;
     void setLogFlush(bool enabled);
 
+    /// Whether the log is written by a background thread, see Logger::setAsyncLogging()
+    [[nodiscard]] bool asyncLogging() const;
+    void setAsyncLogging(bool enabled);
+
+    /// Whether the sync run log of the folders is written in batches by a background thread
+    [[nodiscard]] bool bufferedSyncRunLog() const;
+    /// Whether the sync run log of the folders is written as CSV, see SyncRunFileLog::compactLogToText()
+    [[nodiscard]] bool compactSyncRunLog() const;
+
     // Whether experimental UI options should be shown
     [[nodiscard]] bool showExperimentalOptions() const;
 
@@ -175,6 +184,16 @@ public:
     [[nodiscard]] qint64 maxChunkSize() const;
     [[nodiscard]] qint64 minChunkSize() const;
     [[nodiscard]] std::chrono::milliseconds targetChunkUploadDuration() const;
+    [[nodiscard]] int maxParallelChunkUploads() const;
+    [[nodiscard]] int maxParallelDownloadSegments() const;
+    [[nodiscard]] bool pipelinedSync() const;
+    [[nodiscard]] bool journalWriteBehind() const;
+    [[nodiscard]] bool discoveryMetadataSnapshot() const;
+    [[nodiscard]] bool remoteDeltaDiscovery() const;
+    [[nodiscard]] bool checksumWhileUploading() const;
+    [[nodiscard]] bool checksumCache() const;
+    [[nodiscard]] int checksumThreadsPerDevice() const;
+    [[nodiscard]] int maxConcurrentSyncs() const;
 
     void saveGeometry(QWidget *w);
     void restoreGeometry(QWidget *w);
@@ -39,6 +39,31 @@ namespace
 constexpr const char *editorNamesForDelayedUpload[] = {"PowerPDF"};
 constexpr const char *fileExtensionsToCheckIfOpenForSigning[] = {".pdf"};
 constexpr auto delayIntervalForSyncRetryForOpenedForSigningFilesSeconds = 60;
+
+// The server entry the journal record was created from
+OCC::RemoteInfo remoteInfoFromDbRecord(const QString &name, const OCC::SyncJournalFileRecord &record)
+{
+    OCC::RemoteInfo info;
+    info.name = name;
+    info.etag = record._etag;
+    info.fileId = record._fileId;
+    info.checksumHeader = record._checksumHeader;
+    info.remotePerm = record._remotePerm;
+    info.modtime = record._modtime;
+    info.isDirectory = record.isDirectory();
+    info.size = info.isDirectory ? 0 : record._fileSize;
+    info._isE2eEncrypted = record.isE2eEncrypted();
+    info.e2eMangledName = record.e2eMangledName();
+    info.sharedByMe = record._sharedByMe;
+    info.locked = record._lockstate._locked ? OCC::SyncFileItem::LockStatus::LockedItem : OCC::SyncFileItem::LockStatus::UnlockedItem;
+    info.lockOwnerDisplayName = record._lockstate._lockOwnerDisplayName;
+    info.lockOwnerId = record._lockstate._lockOwnerId;
+    info.lockOwnerType = static_cast<OCC::SyncFileItem::LockOwnerType>(record._lockstate._lockOwnerType);
+    info.lockEditorApp = record._lockstate._lockEditorApp;
+    info.lockTime = record._lockstate._lockTime;
+    info.lockTimeout = record._lockstate._lockTimeout;
+    return info;
+}
 }
 
 namespace OCC {
@@ -86,7 +111,7 @@ void ProcessDirectoryJob::start()
 
     _discoveryData->_noCaseConflictRecordsInDb = _discoveryData->_statedb->caseClashConflictRecordPaths().isEmpty();
 
-    if (_queryServer == NormalQuery) {
+    if (_queryServer == NormalQuery && !serverEntriesFromRemoteDelta()) {
         _serverJob = startAsyncServerQuery();
     } else {
         _serverQueryDone = true;
@@ -611,12 +636,12 @@ void ProcessDirectoryJob::processFile(PathTuple path,
 
 // Compute the checksum of the given file and assign the result in item->_checksumHeader
 // Returns true if the checksum was successfully computed
-static bool computeLocalChecksum(const QByteArray &header, const QString &path, const SyncFileItemPtr &item)
+static bool computeLocalChecksum(const QByteArray &header, const QString &path, const SyncFileItemPtr &item, SyncJournalDb *checksumCache)
 {
     auto type = parseChecksumHeaderType(header);
     if (!type.isEmpty()) {
         // TODO: compute async?
-        QByteArray checksum = ComputeChecksum::computeNowOnFile(path, type);
+        QByteArray checksum = ComputeChecksum::computeNowOnFile(path, type, checksumCache);
         if (!checksum.isEmpty()) {
             item->_checksumHeader = makeChecksumHeader(type, checksum);
             return true;
@@ -827,7 +852,7 @@ void ProcessDirectoryJob::processFileAnalyzeRemoteInfo(const SyncFileItemPtr &it
             // if (is virtual mode enabled and folder is encrypted - check if the size is the same as on the server and then - trigger server query
             // to update a placeholder with corrected size (-16 Bytes)
             // or, maybe, add a flag to the database - vfsE2eeSizeCorrected? if it is not set - subtract it from the placeholder's size and re-create/update a placeholder?
-            const QueryMode serverQueryMode = [this, &dbEntry, &serverEntry]() {
+            const QueryMode serverQueryMode = [this, &dbEntry, &serverEntry, &path]() {
                 const auto isVfsModeOn = _discoveryData && _discoveryData->_syncOptions._vfs && _discoveryData->_syncOptions._vfs->mode() != Vfs::Off;
                 if (isVfsModeOn && dbEntry.isDirectory() && dbEntry.isE2eEncrypted()) {
                     qint64 localFolderSize = 0;
@@ -848,6 +873,10 @@ void ProcessDirectoryJob::processFileAnalyzeRemoteInfo(const SyncFileItemPtr &it
                         return NormalQuery;
                     }
                 }
+                // The etags of the parents of a change may have been stored by a sync that didn't see it
+                if (_discoveryData->_remoteDelta && _discoveryData->_remoteDelta->affectedDirectories.contains(path._server)) {
+                    return NormalQuery;
+                }
                 return ParentNotChanged;
             }();
 
@@ -1260,7 +1289,7 @@ void ProcessDirectoryJob::processFileAnalyzeLocalInfo(
             // check #4754 #4755
             bool isEmlFile = path._original.endsWith(QLatin1String(".eml"), Qt::CaseInsensitive);
             if (isEmlFile && dbEntry._fileSize == localEntry.size && !dbEntry._checksumHeader.isEmpty()) {
-                if (computeLocalChecksum(dbEntry._checksumHeader, _discoveryData->_localDir + path._local, item)
+                if (computeLocalChecksum(dbEntry._checksumHeader, _discoveryData->_localDir + path._local, item, checksumCache())
                         && item->_checksumHeader == dbEntry._checksumHeader) {
                     qCInfo(lcDisco) << "NOTE: Checksums are identical, file did not actually change: " << path._local;
                     item->_instruction = CSYNC_INSTRUCTION_UPDATE_METADATA;
@@ -1428,7 +1457,7 @@ void ProcessDirectoryJob::processFileAnalyzeLocalInfo(
 
         // Verify the checksum where possible
         if (!base._checksumHeader.isEmpty() && item->_type == ItemTypeFile && base._type == ItemTypeFile) {
-            if (computeLocalChecksum(base._checksumHeader, _discoveryData->_localDir + path._original, item)) {
+            if (computeLocalChecksum(base._checksumHeader, _discoveryData->_localDir + path._original, item, checksumCache())) {
                 qCInfo(lcDisco) << "checking checksum of potential rename " << path._original << item->_checksumHeader << base._checksumHeader;
                 if (item->_checksumHeader != base._checksumHeader) {
                     qCInfo(lcDisco) << "Not a move, checksums differ";
@@ -2112,6 +2141,9 @@ DiscoverySingleDirectoryJob *ProcessDirectoryJob::startAsyncServerQuery()
                                                      this);
     if (!_dirItem) {
         serverJob->setIsRootPath(); // query the fingerprint on the root
+        if (_discoveryData->_syncOptions._remoteDeltaDiscovery) {
+            serverJob->setQuerySyncToken();
+        }
     }
 
     connect(serverJob, &DiscoverySingleDirectoryJob::etag, this, &ProcessDirectoryJob::etag);
@@ -2140,6 +2172,8 @@ DiscoverySingleDirectoryJob *ProcessDirectoryJob::startAsyncServerQuery()
             _serverQueryDone = true;
             if (!serverJob->_dataFingerprint.isEmpty() && _discoveryData->_dataFingerprint.isEmpty())
                 _discoveryData->_dataFingerprint = serverJob->_dataFingerprint;
+            if (!serverJob->_syncToken.isEmpty() && _discoveryData->_syncToken.isEmpty())
+                _discoveryData->_syncToken = serverJob->_syncToken;
             if (_localQueryDone)
                 this->process();
         } else {
@@ -2170,6 +2204,53 @@ DiscoverySingleDirectoryJob *ProcessDirectoryJob::startAsyncServerQuery()
     return serverJob;
 }
 
+bool ProcessDirectoryJob::serverEntriesFromRemoteDelta()
+{
+    const auto &delta = _discoveryData->_remoteDelta;
+    // The root is always listed: it provides the root etag, permissions and data-fingerprint
+    if (!delta || !_dirItem || _currentFolder._server != _currentFolder._original || _dirItem->isEncrypted()) {
+        return false;
+    }
+
+    // Only directories that were synced before and weren't replaced or scheduled for remote discovery
+    SyncJournalFileRecord dirRecord;
+    if (!_discoveryData->_statedb->getFileRecord(_currentFolder._original, &dirRecord) || !dirRecord.isValid()
+        || !dirRecord.isDirectory() || dirRecord.isE2eEncrypted() || dirRecord._etag == "_invalid_"
+        || (!_dirItem->_fileId.isEmpty() && dirRecord._fileId != _dirItem->_fileId)) {
+        return false;
+    }
+
+    const auto changedEntries = delta->changedEntries.value(_currentFolder._server);
+    const auto removedEntries = delta->removedEntries.value(_currentFolder._server);
+    const auto pathU8 = _currentFolder._original.toUtf8();
+    QVector<RemoteInfo> entries;
+    auto complete = true;
+    const auto listed = _discoveryData->_statedb->listFilesInPath(pathU8, [&](const SyncJournalFileRecord &record) {
+        auto name = QString::fromUtf8(record._path.constData() + (pathU8.size() + 1));
+        if (record.isVirtualFile() && isVfsWithSuffix())
+            chopVirtualFileSuffix(name);
+        if (changedEntries.contains(name) || removedEntries.contains(name)) {
+            return;
+        }
+        if (record._etag.isEmpty() || record._fileId.isEmpty() || record._remotePerm.isNull()) {
+            complete = false;
+            return;
+        }
+        entries.push_back(remoteInfoFromDbRecord(name, record));
+    });
+    if (!listed || !complete) {
+        return false;
+    }
+
+    for (const auto &entry : changedEntries) {
+        entries.push_back(entry);
+    }
+    qCInfo(lcDisco) << "Listing of" << _currentFolder._server << "built from the journal with" << changedEntries.size()
+                    << "changed and" << removedEntries.size() << "removed remote entries";
+    _serverNormalQueryEntries = std::move(entries);
+    return true;
+}
+
 void ProcessDirectoryJob::startAsyncLocalQuery()
 {
     QString localPath = _discoveryData->_localDir + _currentFolder._local;
@@ -2228,6 +2309,11 @@ bool ProcessDirectoryJob::isVfsWithSuffix() const
     return _discoveryData->_syncOptions._vfs->mode() == Vfs::WithSuffix;
 }
 
+SyncJournalDb *ProcessDirectoryJob::checksumCache() const
+{
+    return _discoveryData->_syncOptions._checksumCache ? _discoveryData->_statedb : nullptr;
+}
+
 void ProcessDirectoryJob::computePinState(PinState parentState)
 {
     _pinState = parentState;
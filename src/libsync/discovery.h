@@ -223,12 +223,22 @@ private:
     /** Convenience to detect suffix-vfs modes */
     [[nodiscard]] bool isVfsWithSuffix() const;
 
+    /** The journal to use as checksum cache for local checksums, null if disabled */
+    [[nodiscard]] SyncJournalDb *checksumCache() const;
+
     /** Start a remote discovery network job
      *
      * It fills _serverNormalQueryEntries and sets _serverQueryDone when done.
      */
     DiscoverySingleDirectoryJob *startAsyncServerQuery();
 
+    /** Build the remote listing from the journal and DiscoveryPhase::_remoteDelta
+     *
+     * Fills _serverNormalQueryEntries and returns true if the directory's
+     * journal entries can be trusted, otherwise startAsyncServerQuery() is needed.
+     */
+    bool serverEntriesFromRemoteDelta();
+
     /** Discover the local directory
       *
       * Fills _localNormalQueryEntries.
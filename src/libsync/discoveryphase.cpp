@@ -383,11 +383,8 @@ DiscoverySingleDirectoryJob::DiscoverySingleDirectoryJob(const AccountPtr &accou
     Q_ASSERT(!_remoteRootFolderPath.isEmpty());
 }
 
-void DiscoverySingleDirectoryJob::start()
+static QList<QByteArray> remoteInfoProperties(const AccountPtr &account)
 {
-    // Start the actual HTTP job
-    auto *lsColJob = new LsColJob(_account, _subPath);
-
     QList<QByteArray> props;
     props << "resourcetype"
           << "getlastmodified"
@@ -402,13 +399,11 @@ void DiscoverySingleDirectoryJob::start()
           << "http://owncloud.org/ns:checksums"
           << "http://nextcloud.org/ns:is-encrypted";
 
-    if (_isRootPath)
-        props << "http://owncloud.org/ns:data-fingerprint";
-    if (_account->serverVersionInt() >= Account::makeServerVersion(10, 0, 0)) {
+    if (account->serverVersionInt() >= Account::makeServerVersion(10, 0, 0)) {
         // Server older than 10.0 have performances issue if we ask for the share-types on every PROPFIND
         props << "http://owncloud.org/ns:share-types";
     }
-    if (_account->capabilities().filesLockAvailable()) {
+    if (account->capabilities().filesLockAvailable()) {
         props << "http://nextcloud.org/ns:lock"
               << "http://nextcloud.org/ns:lock-owner-displayname"
               << "http://nextcloud.org/ns:lock-owner"
@@ -418,6 +413,19 @@ void DiscoverySingleDirectoryJob::start()
               << "http://nextcloud.org/ns:lock-timeout";
     }
     props << "http://nextcloud.org/ns:is-mount-root";
+    return props;
+}
+
+void DiscoverySingleDirectoryJob::start()
+{
+    // Start the actual HTTP job
+    auto *lsColJob = new LsColJob(_account, _subPath);
+
+    auto props = remoteInfoProperties(_account);
+    if (_isRootPath)
+        props << "http://owncloud.org/ns:data-fingerprint";
+    if (_isRootPath && _querySyncToken)
+        props << "sync-token";
 
     lsColJob->setProperties(props);
 
@@ -575,6 +583,9 @@ void DiscoverySingleDirectoryJob::directoryListingIteratedSlot(const QString &fi
                 _dataFingerprint = "[empty]";
             }
         }
+        if (map.contains(QStringLiteral("sync-token"))) {
+            _syncToken = map.value(QStringLiteral("sync-token")).trimmed().toUtf8();
+        }
         if (map.contains(QStringLiteral("fileid"))) {
             _localFileId = map.value(QStringLiteral("fileid")).toUtf8();
         }
@@ -748,4 +759,131 @@ void DiscoverySingleDirectoryJob::metadataError(const QByteArray &fileId, int ht
     emit finished(_results);
     deleteLater();
 }
+
+DiscoveryRemoteDeltaJob::DiscoveryRemoteDeltaJob(const AccountPtr &account,
+                                                 const QString &remoteRootFolderPath,
+                                                 const QByteArray &syncToken,
+                                                 QObject *parent)
+    : QObject(parent)
+    , _account(account)
+    , _remoteRootFolderPath(remoteRootFolderPath)
+    , _syncToken(syncToken)
+{
+    Q_ASSERT(!_remoteRootFolderPath.isEmpty());
+}
+
+void DiscoveryRemoteDeltaJob::start()
+{
+    auto *lsColJob = new LsColJob(_account, _remoteRootFolderPath);
+    lsColJob->setProperties(remoteInfoProperties(_account));
+    lsColJob->setSyncCollection(_syncToken);
+
+    QObject::connect(lsColJob, &LsColJob::directoryListingIterated,
+        this, &DiscoveryRemoteDeltaJob::directoryListingIteratedSlot);
+    QObject::connect(lsColJob, &LsColJob::directoryListingRemoved,
+        this, &DiscoveryRemoteDeltaJob::directoryListingRemovedSlot);
+    QObject::connect(lsColJob, &LsColJob::syncTokenReceived, this, [this](const QByteArray &syncToken) {
+        _delta.syncToken = syncToken;
+    });
+    QObject::connect(lsColJob, &LsColJob::finishedWithError, this, &DiscoveryRemoteDeltaJob::lsJobFinishedWithErrorSlot);
+    QObject::connect(lsColJob, &LsColJob::finishedWithoutError, this, &DiscoveryRemoteDeltaJob::lsJobFinishedWithoutErrorSlot);
+    lsColJob->start();
+
+    _lsColJob = lsColJob;
+}
+
+void DiscoveryRemoteDeltaJob::abort()
+{
+    if (_lsColJob && _lsColJob->reply()) {
+        _lsColJob->reply()->abort();
+    }
+}
+
+bool DiscoveryRemoteDeltaJob::splitPath(const QString &file, QString *directory, QString *name)
+{
+    // file is the full path of the member, e.g. /remote.php/dav/files/admin/Photos/a.jpg
+    const auto basePath = Utility::trailingSlashPath(_lsColJob->reply()->request().url().path());
+    if (!file.startsWith(basePath) || file.size() == basePath.size()) {
+        return false;
+    }
+    const auto path = file.mid(basePath.size());
+    const auto slash = path.lastIndexOf(QLatin1Char('/'));
+    *directory = slash < 0 ? QString() : path.left(slash);
+    *name = path.mid(slash + 1);
+    return true;
+}
+
+void DiscoveryRemoteDeltaJob::markAffected(QString directory)
+{
+    forever {
+        if (_delta.affectedDirectories.contains(directory)) {
+            return;
+        }
+        _delta.affectedDirectories.insert(directory);
+        if (directory.isEmpty()) {
+            return;
+        }
+        const auto slash = directory.lastIndexOf(QLatin1Char('/'));
+        directory = slash < 0 ? QString() : directory.left(slash);
+    }
+}
+
+void DiscoveryRemoteDeltaJob::directoryListingIteratedSlot(const QString &file, const QMap<QString, QString> &map)
+{
+    QString directory;
+    QString name;
+    if (!splitPath(file, &directory, &name)) {
+        // The sync folder itself
+        return;
+    }
+
+    RemoteInfo result;
+    result.name = name;
+    result.size = -1;
+    propertyMapToRemoteInfo(map,
+                            _account->serverHasMountRootProperty() ? RemotePermissions::MountedPermissionAlgorithm::UseMountRootProperty : RemotePermissions::MountedPermissionAlgorithm::WildGuessMountedSubProperty,
+                            result);
+    if (result.isDirectory)
+        result.size = 0;
+
+    _delta.removedEntries[directory].remove(name);
+    _delta.changedEntries[directory].insert(name, result);
+    markAffected(directory);
+}
+
+void DiscoveryRemoteDeltaJob::directoryListingRemovedSlot(const QString &file)
+{
+    QString directory;
+    QString name;
+    if (!splitPath(file, &directory, &name)) {
+        return;
+    }
+
+    _delta.changedEntries[directory].remove(name);
+    _delta.removedEntries[directory].insert(name);
+    markAffected(directory);
+}
+
+void DiscoveryRemoteDeltaJob::lsJobFinishedWithoutErrorSlot()
+{
+    if (_delta.syncToken.isEmpty()) {
+        emit finished(HttpError{ 0, tr("Server error: the sync-collection reply has no sync-token") });
+        deleteLater();
+        return;
+    }
+
+    qCInfo(lcDiscovery) << "Remote changes since" << _syncToken << ":" << _delta.affectedDirectories.size() << "affected directories";
+    emit finished(_delta);
+    deleteLater();
+}
+
+void DiscoveryRemoteDeltaJob::lsJobFinishedWithErrorSlot(QNetworkReply *r)
+{
+    // 403 with a DAV:valid-sync-token precondition means that the token expired
+    const auto httpCode = r->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    qCWarning(lcDiscovery) << "sync-collection REPORT error" << r->errorString() << httpCode << r->error();
+
+    emit finished(HttpError{ httpCode, r->errorString() });
+    deleteLater();
+}
 }
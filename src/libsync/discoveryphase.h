@@ -25,6 +25,7 @@
 #include <QWaitCondition>
 #include <QRunnable>
 #include <deque>
+#include <memory>
 #include "syncoptions.h"
 #include "syncfileitem.h"
 
@@ -153,6 +154,8 @@ public:
                                          QObject *parent = nullptr);
     // Specify that this is the root and we need to check the data-fingerprint
     void setIsRootPath() { _isRootPath = true; }
+    // Also ask for the sync-token of the root, see DiscoveryRemoteDeltaJob
+    void setQuerySyncToken() { _querySyncToken = true; }
     void start();
     void abort();
     [[nodiscard]] bool isFileDropDetected() const;
@@ -190,6 +193,7 @@ private:
     bool _ignoredFirst = false;
     // Set to true if this is the root path and we need to check the data-fingerprint
     bool _isRootPath = false;
+    bool _querySyncToken = false;
     // If this directory is an external storage (The first item has 'M' in its permission)
     bool _isExternalStorage = false;
     // If this directory is e2ee
@@ -207,6 +211,64 @@ private:
 
 public:
     QByteArray _dataFingerprint;
+    QByteArray _syncToken;
+};
+
+/**
+ * The changes of the remote sync folder since a sync-token, see DiscoveryRemoteDeltaJob
+ *
+ * Paths are relative to the sync folder, the root directory is "".
+ */
+struct RemoteDelta
+{
+    QByteArray syncToken; // to ask for the changes after this delta
+    QHash<QString, QHash<QString, RemoteInfo>> changedEntries; // directory -> name -> changed or new entry
+    QHash<QString, QSet<QString>> removedEntries; // directory -> names
+    QSet<QString> affectedDirectories; // directories with changes somewhere below them
+};
+
+/**
+ * @brief Ask the server for the changes below the sync folder since a sync-token
+ *
+ * Sends a WebDAV sync-collection REPORT (RFC 6578) for the whole tree. The
+ * result allows the discovery to build the listings of the changed
+ * directories from the journal instead of running a PROPFIND for each of them.
+ *
+ * Any error, in particular an expired or unknown sync-token, is reported
+ * as an HttpError; the caller then falls back to the full remote discovery.
+ *
+ * @ingroup libsync
+ */
+class DiscoveryRemoteDeltaJob : public QObject
+{
+    Q_OBJECT
+public:
+    explicit DiscoveryRemoteDeltaJob(const AccountPtr &account,
+                                     const QString &remoteRootFolderPath,
+                                     const QByteArray &syncToken,
+                                     QObject *parent = nullptr);
+    void start();
+    void abort();
+
+signals:
+    void finished(const OCC::HttpResult<OCC::RemoteDelta> &result);
+
+private slots:
+    void directoryListingIteratedSlot(const QString &file, const QMap<QString, QString> &map);
+    void directoryListingRemovedSlot(const QString &file);
+    void lsJobFinishedWithoutErrorSlot();
+    void lsJobFinishedWithErrorSlot(QNetworkReply *reply);
+
+private:
+    /** Splits the href of a member into its directory and name, returns false if it is outside of the sync folder */
+    bool splitPath(const QString &file, QString *directory, QString *name);
+    void markAffected(QString directory);
+
+    AccountPtr _account;
+    QString _remoteRootFolderPath;
+    QByteArray _syncToken;
+    RemoteDelta _delta;
+    QPointer<LsColJob> _lsColJob;
 };
 
 class DiscoveryPhase : public QObject
@@ -325,8 +387,13 @@ public:
     void setSelectiveSyncBlackList(const QStringList &list);
     void setSelectiveSyncWhiteList(const QStringList &list);
 
+    // Remote changes since the last sync, if known the listings of unchanged
+    // directories are built from the journal, see ProcessDirectoryJob::serverEntriesFromRemoteDelta()
+    std::unique_ptr<RemoteDelta> _remoteDelta;
+
     // output
     QByteArray _dataFingerprint;
+    QByteArray _syncToken; // for the next sync, from _remoteDelta or the root listing
     bool _anotherSyncNeeded = false;
     QHash<QString, long long> _filesNeedingScheduledSync;
     QVector<QString> _filesUnscheduleSync;
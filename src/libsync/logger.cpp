@@ -16,14 +16,18 @@
 
 #include "config.h"
 
+#include <QDeadlineTimer>
 #include <QDir>
 #include <QRegularExpression>
 #include <QStringList>
+#include <QThread>
 #include <QtGlobal>
 #include <QTextCodec>
 #include <qmetaobject.h>
 
+#include <algorithm>
 #include <iostream>
+#include <vector>
 
 #ifdef ZLIB_FOUND
 #include <zlib.h>
@@ -38,6 +42,14 @@ namespace {
 constexpr int CrashLogSize = 20;
 constexpr auto MaxLogLinesCount = 50000;
 
+// Messages each thread can have waiting for the asynchronous log writer, a power of two
+constexpr quint64 AsyncLogBufferSize = 8192;
+// How often the asynchronous log writer drains the buffers that don't fill up
+constexpr int AsyncLogWriteIntervalMs = 100;
+
+// Gives the messages of all threads their order in the log file
+std::atomic<quint64> asyncLogSequence{0};
+
 static bool compressLog(const QString &originalName, const QString &targetName)
 {
 #ifdef ZLIB_FOUND
@@ -68,6 +80,82 @@ static bool compressLog(const QString &originalName, const QString &targetName)
 
 namespace OCC {
 
+/**
+ * Ring buffer of the messages of one thread for the asynchronous logging.
+ *
+ * Only that thread pushes, and only the thread holding Logger::_drainMutex
+ * drains it, so head and tail are enough to synchronize the two.
+ */
+struct AsyncLogBuffer
+{
+    struct Entry
+    {
+        quint64 sequence = 0;
+        QString message;
+    };
+
+    AsyncLogBuffer()
+        : entries(AsyncLogBufferSize)
+    {
+    }
+
+    /// Returns the number of buffered messages including this one, 0 if it was dropped
+    quint64 push(QString &&message)
+    {
+        const auto currentHead = head.load(std::memory_order_relaxed);
+        const auto currentTail = tail.load(std::memory_order_acquire);
+        if (currentHead - currentTail == AsyncLogBufferSize) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return 0;
+        }
+        auto &entry = entries[currentHead & (AsyncLogBufferSize - 1)];
+        entry.sequence = asyncLogSequence.fetch_add(1, std::memory_order_relaxed);
+        entry.message = std::move(message);
+        head.store(currentHead + 1, std::memory_order_release);
+        return currentHead + 1 - currentTail;
+    }
+
+    void drain(std::vector<Entry> &output)
+    {
+        auto currentTail = tail.load(std::memory_order_relaxed);
+        const auto currentHead = head.load(std::memory_order_acquire);
+        for (; currentTail != currentHead; ++currentTail) {
+            output.push_back(std::move(entries[currentTail & (AsyncLogBufferSize - 1)]));
+        }
+        tail.store(currentTail, std::memory_order_release);
+    }
+
+    [[nodiscard]] bool isEmpty() const
+    {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    std::vector<Entry> entries;
+    std::atomic<quint64> head{0};
+    std::atomic<quint64> tail{0};
+    std::atomic<quint64> dropped{0};
+    // Set when the thread ends, the buffer is forgotten once it was drained
+    std::atomic<bool> threadFinished{false};
+};
+
+namespace {
+
+struct ThreadLogBuffer
+{
+    ~ThreadLogBuffer()
+    {
+        if (buffer) {
+            buffer->threadFinished = true;
+        }
+    }
+
+    std::shared_ptr<AsyncLogBuffer> buffer;
+};
+
+thread_local ThreadLogBuffer threadLogBuffer;
+
+}
+
 Logger *Logger::instance()
 {
     static Logger log;
@@ -89,6 +177,7 @@ Logger::Logger(QObject *parent)
 
 Logger::~Logger()
 {
+    setAsyncLogging(false);
     if (_logstream) {
         _logstream->flush();
     }
@@ -116,8 +205,7 @@ bool Logger::isLoggingToFile() const
 
 void Logger::doLog(QtMsgType type, const QMessageLogContext &ctx, const QString &message)
 {
-    static long long int linesCounter = 0;
-    const auto &msg = qFormatLogMessage(type, ctx, message);
+    auto msg = qFormatLogMessage(type, ctx, message);
 #if defined Q_OS_WIN && (defined NEXTCLOUD_DEV || defined QT_DEBUG)
     // write logs to Output window of Visual Studio
     {
@@ -142,27 +230,22 @@ void Logger::doLog(QtMsgType type, const QMessageLogContext &ctx, const QString
         OutputDebugString(msgW.c_str());
     }
 #endif
+    if (_asyncLogging && type != QtFatalMsg) {
+        emit logWindowLog(msg);
+        doLogAsync(std::move(msg));
+        return;
+    }
+
+    if (type == QtFatalMsg) {
+        // The buffered messages most likely tell how it came to this
+        flushAsyncLog();
+    }
     {
         QMutexLocker lock(&_mutex);
 
-        if (linesCounter >= MaxLogLinesCount) {
-            linesCounter = 0;
-            if (_logstream) {
-                _logstream->flush();
-            }
-            closeNoLock();
-            enterNextLogFileNoLock();
-        }
-        ++linesCounter;
-
-        _crashLogIndex = (_crashLogIndex + 1) % CrashLogSize;
-        _crashLog[_crashLogIndex] = msg;
-
-        if (_logstream) {
-            (*_logstream) << msg << "\n";
-            if (_doFileFlush)
-                _logstream->flush();
-        }
+        writeNoLock(msg);
+        if (_logstream && _doFileFlush)
+            _logstream->flush();
         if (type == QtFatalMsg) {
             closeNoLock();
 #if defined(Q_OS_WIN)
@@ -174,6 +257,131 @@ void Logger::doLog(QtMsgType type, const QMessageLogContext &ctx, const QString
     emit logWindowLog(msg);
 }
 
+void Logger::writeNoLock(const QString &message)
+{
+    static long long int linesCounter = 0;
+    if (linesCounter >= MaxLogLinesCount) {
+        linesCounter = 0;
+        if (_logstream) {
+            _logstream->flush();
+        }
+        closeNoLock();
+        enterNextLogFileNoLock();
+    }
+    ++linesCounter;
+
+    _crashLogIndex = (_crashLogIndex + 1) % CrashLogSize;
+    _crashLog[_crashLogIndex] = message;
+
+    if (_logstream) {
+        (*_logstream) << message << "\n";
+    }
+}
+
+void Logger::doLogAsync(QString &&message)
+{
+    auto &buffer = threadLogBuffer.buffer;
+    if (!buffer) {
+        buffer = std::make_shared<AsyncLogBuffer>();
+        QMutexLocker locker(&_asyncBuffersMutex);
+        _asyncBuffers.append(buffer);
+    }
+
+    // Wake the writer early for threads that log faster than it writes
+    if (buffer->push(std::move(message)) == AsyncLogBufferSize / 2) {
+        _asyncWriterWakeup.wakeOne();
+    }
+}
+
+void Logger::setAsyncLogging(bool enabled)
+{
+    if (enabled == _asyncLogging) {
+        return;
+    }
+
+    if (enabled) {
+        {
+            QMutexLocker locker(&_asyncWriterMutex);
+            _stopAsyncWriter = false;
+        }
+        _asyncWriterThread.reset(QThread::create([this] { asyncWriterLoop(); }));
+        _asyncWriterThread->setObjectName(QStringLiteral("Logger writer"));
+        _asyncWriterThread->start();
+        _asyncLogging = true;
+        return;
+    }
+
+    _asyncLogging = false;
+    {
+        QMutexLocker locker(&_asyncWriterMutex);
+        _stopAsyncWriter = true;
+        _asyncWriterWakeup.wakeAll();
+    }
+    _asyncWriterThread->wait();
+    _asyncWriterThread.reset();
+
+    // Messages that raced with the shutdown of the writer
+    flushAsyncLog();
+}
+
+void Logger::flushAsyncLog()
+{
+    QMutexLocker drainLocker(&_drainMutex);
+
+    QVector<std::shared_ptr<AsyncLogBuffer>> buffers;
+    {
+        QMutexLocker locker(&_asyncBuffersMutex);
+        buffers = _asyncBuffers;
+        // Finished threads don't push anymore, their empty buffers can go
+        _asyncBuffers.erase(std::remove_if(_asyncBuffers.begin(), _asyncBuffers.end(), [](const auto &buffer) {
+            return buffer->threadFinished && buffer->isEmpty();
+        }), _asyncBuffers.end());
+    }
+
+    std::vector<AsyncLogBuffer::Entry> entries;
+    quint64 dropped = 0;
+    for (const auto &buffer : qAsConst(buffers)) {
+        buffer->drain(entries);
+        dropped += buffer->dropped.exchange(0);
+    }
+    if (entries.empty() && dropped == 0) {
+        return;
+    }
+    std::sort(entries.begin(), entries.end(), [](const AsyncLogBuffer::Entry &lhs, const AsyncLogBuffer::Entry &rhs) {
+        return lhs.sequence < rhs.sequence;
+    });
+
+    QMutexLocker locker(&_mutex);
+    if (dropped > 0) {
+        _droppedLogMessages += dropped;
+        const QMessageLogContext context(__FILE__, __LINE__, Q_FUNC_INFO, "nextcloud.sync.logger");
+        writeNoLock(qFormatLogMessage(QtWarningMsg, context,
+            QStringLiteral("Dropped %1 log messages, the log writer could not keep up").arg(dropped)));
+    }
+    for (const auto &entry : entries) {
+        writeNoLock(entry.message);
+    }
+    if (_logstream && _doFileFlush) {
+        _logstream->flush();
+    }
+}
+
+void Logger::asyncWriterLoop()
+{
+    forever {
+        {
+            QMutexLocker locker(&_asyncWriterMutex);
+            if (!_stopAsyncWriter) {
+                _asyncWriterWakeup.wait(&_asyncWriterMutex, QDeadlineTimer(AsyncLogWriteIntervalMs));
+            }
+            if (_stopAsyncWriter) {
+                return;
+            }
+        }
+        flushAsyncLog();
+    }
+}
+
 void Logger::closeNoLock()
 {
     dumpCrashLog();
@@ -193,6 +401,10 @@ QString Logger::logFile() const
 
 void Logger::setLogFile(const QString &name)
 {
+    if (_asyncLogging) {
+        // What was logged so far belongs into the previous file
+        flushAsyncLog();
+    }
     QMutexLocker locker(&_mutex);
     setLogFileNoLock(name);
 }
@@ -363,6 +575,9 @@ void Logger::setLogFileNoLock(const QString &name)
 
 void Logger::enterNextLogFile()
 {
+    if (_asyncLogging) {
+        flushAsyncLog();
+    }
     QMutexLocker locker(&_mutex);
     enterNextLogFileNoLock();
 }
@@ -20,13 +20,21 @@
 #include <QDateTime>
 #include <QFile>
 #include <QTextStream>
+#include <QWaitCondition>
 #include <qmutex.h>
 
+#include <atomic>
+#include <memory>
+
 #include "common/utility.h"
 #include "owncloudlib.h"
 
+class QThread;
+
 namespace OCC {
 
+struct AsyncLogBuffer;
+
 /**
  * @brief The Logger class
  * @ingroup libsync
@@ -57,6 +65,25 @@ public:
     bool logDebug() const { return _logDebug; }
     void setLogDebug(bool debug);
 
+    /** Writes the log from a background thread.
+     *
+     * Every thread that logs gets its own lock-free ring buffer, which the
+     * writer thread drains into the log file in the order the messages were
+     * logged. When a buffer is full its messages are dropped instead of
+     * blocking the thread, the writer logs how many were lost.
+     *
+     * Fatal messages and switching the log file write everything buffered
+     * so far first.
+     */
+    void setAsyncLogging(bool enabled);
+    bool isAsyncLogging() const { return _asyncLogging; }
+
+    /// Writes everything that was logged asynchronously so far
+    void flushAsyncLog();
+
+    /// The number of messages dropped because their ring buffer was full
+    quint64 droppedLogMessages() const { return _droppedLogMessages; }
+
     /** Returns where the automatic logdir would be */
     QString temporaryFolderLogDirPath() const;
 
@@ -98,6 +125,9 @@ private:
     void dumpCrashLog();
     void enterNextLogFileNoLock();
     void setLogFileNoLock(const QString &name);
+    void writeNoLock(const QString &message);
+    void doLogAsync(QString &&message);
+    void asyncWriterLoop();
 
     QFile _logFile;
     bool _doFileFlush = false;
@@ -110,6 +140,17 @@ private:
     QSet<QString> _logRules;
     QVector<QString> _crashLog;
     int _crashLogIndex = 0;
+
+    // State of the asynchronous logging, see setAsyncLogging()
+    std::atomic<bool> _asyncLogging{false};
+    std::atomic<quint64> _droppedLogMessages{0};
+    QMutex _asyncBuffersMutex; // protects _asyncBuffers
+    QVector<std::shared_ptr<AsyncLogBuffer>> _asyncBuffers;
+    QMutex _drainMutex; // only one thread drains the buffers at a time, taken before _mutex
+    QMutex _asyncWriterMutex; // protects _stopAsyncWriter
+    QWaitCondition _asyncWriterWakeup;
+    bool _stopAsyncWriter = false;
+    std::unique_ptr<QThread> _asyncWriterThread;
 };
 
 } // namespace OCC
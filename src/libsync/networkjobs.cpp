@@ -183,134 +183,213 @@ bool MkColJob::finished()
 }
 
 /*********************************************************************************************/
-// supposed to read <D:collection> when pointing to <D:resourcetype><D:collection></D:resourcetype>..
-static QString readContentsAsString(QXmlStreamReader &reader)
-{
-    QString result;
-    int level = 0;
-    do {
-        QXmlStreamReader::TokenType type = reader.readNext();
-        if (type == QXmlStreamReader::StartElement) {
-            level++;
-            result += "<" + reader.name().toString() + ">";
-        } else if (type == QXmlStreamReader::Characters) {
-            result += reader.text();
-        } else if (type == QXmlStreamReader::EndElement) {
-            level--;
-            if (level < 0) {
-                break;
-            }
-            result += "</" + reader.name().toString() + ">";
-        }
+LsColXMLParser::LsColXMLParser() = default;
 
-    } while (!reader.atEnd());
-    return result;
+bool LsColXMLParser::parse(const QByteArray &xml, QHash<QString, ExtraFolderInfo> *fileInfo, const QString &expectedPath)
+{
+    startParsing(fileInfo, expectedPath);
+    return addData(xml) && finish();
 }
 
+void LsColXMLParser::startParsing(QHash<QString, ExtraFolderInfo> *fileInfo, const QString &expectedPath)
+{
+    _reader.clear();
+    _reader.addExtraNamespaceDeclaration(QXmlStreamNamespaceDeclaration("d", "DAV:"));
+    _fileInfo = fileInfo;
+    _expectedPath = expectedPath;
+    _failed = false;
 
-LsColXMLParser::LsColXMLParser() = default;
+    _folders.clear();
+    _currentHref.clear();
+    _currentTmpProperties.clear();
+    _currentHttp200Properties.clear();
+    _currentResponseStatus.clear();
+    _currentPropsHaveHttp200 = false;
+    _insidePropstat = false;
+    _insideProp = false;
+    _insideMultiStatus = false;
 
-bool LsColXMLParser::parse(const QByteArray &xml, QHash<QString, ExtraFolderInfo> *fileInfo, const QString &expectedPath)
+    _capture = Capture::None;
+    _captureName.clear();
+    _captureText.clear();
+    _captureLevel = 0;
+}
+
+bool LsColXMLParser::addData(const QByteArray &data)
 {
-    // Parse DAV response
-    QXmlStreamReader reader(xml);
-    reader.addExtraNamespaceDeclaration(QXmlStreamNamespaceDeclaration("d", "DAV:"));
-
-    QStringList folders;
-    QString currentHref;
-    QMap<QString, QString> currentTmpProperties;
-    QMap<QString, QString> currentHttp200Properties;
-    bool currentPropsHaveHttp200 = false;
-    bool insidePropstat = false;
-    bool insideProp = false;
-    bool insideMultiStatus = false;
-
-    while (!reader.atEnd()) {
-        QXmlStreamReader::TokenType type = reader.readNext();
-        QString name = reader.name().toString();
-        // Start elements with DAV:
-        if (type == QXmlStreamReader::StartElement && reader.namespaceUri() == QLatin1String("DAV:")) {
-            if (name == QLatin1String("href")) {
-                // We don't use URL encoding in our request URL (which is the expected path) (QNAM will do it for us)
-                // but the result will have URL encoding..
-                QString hrefString = QUrl::fromLocalFile(QUrl::fromPercentEncoding(reader.readElementText().toUtf8()))
-                        .adjusted(QUrl::NormalizePathSegments)
-                        .path();
-                if (!hrefString.startsWith(expectedPath)) {
-                    qCWarning(lcLsColJob) << "Invalid href" << hrefString << "expected starting with" << expectedPath;
-                    return false;
-                }
-                currentHref = hrefString;
-            } else if (name == QLatin1String("response")) {
-            } else if (name == QLatin1String("propstat")) {
-                insidePropstat = true;
-            } else if (name == QLatin1String("status") && insidePropstat) {
-                QString httpStatus = reader.readElementText();
-                if (httpStatus.startsWith("HTTP/1.1 200")) {
-                    currentPropsHaveHttp200 = true;
-                } else {
-                    currentPropsHaveHttp200 = false;
-                }
-            } else if (name == QLatin1String("prop")) {
-                insideProp = true;
-                continue;
-            } else if (name == QLatin1String("multistatus")) {
-                insideMultiStatus = true;
-                continue;
-            }
+    if (_failed) {
+        return false;
+    }
+    _reader.addData(data);
+    return processTokens();
+}
+
+bool LsColXMLParser::finish()
+{
+    if (_failed || !processTokens()) {
+        return false;
+    }
+
+    if (_reader.hasError()) {
+        // Still waiting for more data: the document is incomplete
+        qCWarning(lcLsColJob) << "ERROR" << _reader.errorString() << "at line" << _reader.lineNumber();
+        return false;
+    } else if (!_insideMultiStatus) {
+        qCWarning(lcLsColJob) << "ERROR no WebDAV response?";
+        return false;
+    }
+
+    emit directoryListingSubfolders(_folders);
+    emit finishedWithoutError();
+    return true;
+}
+
+bool LsColXMLParser::processTokens()
+{
+    // Not a loop on atEnd(): that stays true after running out of data until readNext() is called again
+    while (_reader.tokenType() != QXmlStreamReader::EndDocument) {
+        const auto type = _reader.readNext();
+        if (type == QXmlStreamReader::Invalid) {
+            break;
+        }
+        if (!processToken(type)) {
+            _failed = true;
+            return false;
         }
+    }
 
-        if (type == QXmlStreamReader::StartElement && insidePropstat && insideProp) {
-            // All those elements are properties
-            QString propertyContent = readContentsAsString(reader);
-            if (name == QLatin1String("resourcetype") && propertyContent.contains("collection")) {
-                folders.append(currentHref);
-            } else if (name == QLatin1String("size")) {
-                bool ok = false;
-                auto s = propertyContent.toLongLong(&ok);
-                if (ok && fileInfo) {
-                    (*fileInfo)[currentHref].size = s;
-                }
-            } else if (name == QLatin1String("fileid")) {
-                (*fileInfo)[currentHref].fileId = propertyContent.toUtf8();
+    if (_reader.hasError() && _reader.error() != QXmlStreamReader::PrematureEndOfDocumentError) {
+        // XML Parser error? Whatever had been emitted before will come as directoryListingIterated
+        qCWarning(lcLsColJob) << "ERROR" << _reader.errorString() << "at line" << _reader.lineNumber();
+        _failed = true;
+        return false;
+    }
+    return true;
+}
+
+bool LsColXMLParser::processToken(QXmlStreamReader::TokenType type)
+{
+    // Collect the contents of href, status and property elements
+    if (_capture != Capture::None) {
+        // supposed to read <D:collection> when pointing to <D:resourcetype><D:collection></D:resourcetype>..
+        const auto keepMarkup = _capture == Capture::Property;
+        if (type == QXmlStreamReader::Characters) {
+            _captureText += _reader.text();
+        } else if (type == QXmlStreamReader::StartElement) {
+            ++_captureLevel;
+            if (keepMarkup) {
+                _captureText += "<" + _reader.name().toString() + ">";
+            }
+        } else if (type == QXmlStreamReader::EndElement) {
+            if (_captureLevel == 0) {
+                return finishCapture();
+            }
+            --_captureLevel;
+            if (keepMarkup) {
+                _captureText += "</" + _reader.name().toString() + ">";
             }
-            currentTmpProperties.insert(reader.name().toString(), propertyContent);
         }
+        return true;
+    }
 
-        // End elements with DAV:
-        if (type == QXmlStreamReader::EndElement) {
-            if (reader.namespaceUri() == QLatin1String("DAV:")) {
-                if (reader.name() == QStringLiteral("response")) {
-                    if (currentHref.endsWith('/')) {
-                        currentHref.chop(1);
-                    }
-                    emit directoryListingIterated(currentHref, currentHttp200Properties);
-                    currentHref.clear();
-                    currentHttp200Properties.clear();
-                } else if (reader.name() == QStringLiteral("propstat")) {
-                    insidePropstat = false;
-                    if (currentPropsHaveHttp200) {
-                        currentHttp200Properties = QMap<QString, QString>(currentTmpProperties);
-                    }
-                    currentTmpProperties.clear();
-                    currentPropsHaveHttp200 = false;
-                } else if (reader.name() == QStringLiteral("prop")) {
-                    insideProp = false;
-                }
+    // Start elements with DAV:
+    if (type == QXmlStreamReader::StartElement && _reader.namespaceUri() == QLatin1String("DAV:")) {
+        const auto name = _reader.name();
+        if (name == QLatin1String("href")) {
+            _capture = Capture::Href;
+            return true;
+        } else if (name == QLatin1String("response")) {
+            return true;
+        } else if (name == QLatin1String("propstat")) {
+            _insidePropstat = true;
+            return true;
+        } else if (name == QLatin1String("status")) {
+            // A status outside of a propstat applies to the whole response
+            _capture = _insidePropstat ? Capture::Status : Capture::ResponseStatus;
+            return true;
+        } else if (name == QLatin1String("sync-token") && !_insideProp) {
+            _capture = Capture::SyncToken;
+            return true;
+        } else if (name == QLatin1String("prop")) {
+            _insideProp = true;
+            return true;
+        } else if (name == QLatin1String("multistatus")) {
+            _insideMultiStatus = true;
+            return true;
+        }
+    }
+
+    if (type == QXmlStreamReader::StartElement && _insidePropstat && _insideProp) {
+        // All those elements are properties
+        _capture = Capture::Property;
+        _captureName = _reader.name().toString();
+        return true;
+    }
+
+    // End elements with DAV:
+    if (type == QXmlStreamReader::EndElement && _reader.namespaceUri() == QLatin1String("DAV:")) {
+        if (_reader.name() == QStringLiteral("response")) {
+            if (_currentHref.endsWith('/')) {
+                _currentHref.chop(1);
+            }
+            const auto responseCode = _currentResponseStatus.section(QLatin1Char(' '), 1, 1).toInt();
+            if (responseCode >= 300) {
+                emit directoryListingRemoved(_currentHref);
+            } else {
+                emit directoryListingIterated(_currentHref, _currentHttp200Properties);
             }
+            _currentHref.clear();
+            _currentHttp200Properties.clear();
+            _currentResponseStatus.clear();
+        } else if (_reader.name() == QStringLiteral("propstat")) {
+            _insidePropstat = false;
+            if (_currentPropsHaveHttp200) {
+                _currentHttp200Properties = QMap<QString, QString>(_currentTmpProperties);
+            }
+            _currentTmpProperties.clear();
+            _currentPropsHaveHttp200 = false;
+        } else if (_reader.name() == QStringLiteral("prop")) {
+            _insideProp = false;
         }
     }
+    return true;
+}
 
-    if (reader.hasError()) {
-        // XML Parser error? Whatever had been emitted before will come as directoryListingIterated
-        qCWarning(lcLsColJob) << "ERROR" << reader.errorString() << xml;
-        return false;
-    } else if (!insideMultiStatus) {
-        qCWarning(lcLsColJob) << "ERROR no WebDAV response?" << xml;
-        return false;
-    } else {
-        emit directoryListingSubfolders(folders);
-        emit finishedWithoutError();
+bool LsColXMLParser::finishCapture()
+{
+    const auto capture = std::exchange(_capture, Capture::None);
+    const auto text = std::exchange(_captureText, QString());
+
+    if (capture == Capture::Href) {
+        // We don't use URL encoding in our request URL (which is the expected path) (QNAM will do it for us)
+        // but the result will have URL encoding..
+        QString hrefString = QUrl::fromLocalFile(QUrl::fromPercentEncoding(text.toUtf8()))
+                .adjusted(QUrl::NormalizePathSegments)
+                .path();
+        if (!hrefString.startsWith(_expectedPath)) {
+            qCWarning(lcLsColJob) << "Invalid href" << hrefString << "expected starting with" << _expectedPath;
+            return false;
+        }
+        _currentHref = hrefString;
+    } else if (capture == Capture::Status) {
+        _currentPropsHaveHttp200 = text.startsWith("HTTP/1.1 200");
+    } else if (capture == Capture::ResponseStatus) {
+        _currentResponseStatus = text.trimmed();
+    } else if (capture == Capture::SyncToken) {
+        emit syncTokenReceived(text.trimmed().toUtf8());
+    } else if (capture == Capture::Property) {
+        if (_captureName == QLatin1String("resourcetype") && text.contains("collection")) {
+            _folders.append(_currentHref);
+        } else if (_captureName == QLatin1String("size")) {
+            bool ok = false;
+            auto s = text.toLongLong(&ok);
+            if (ok && _fileInfo) {
+                (*_fileInfo)[_currentHref].size = s;
+            }
+        } else if (_captureName == QLatin1String("fileid") && _fileInfo) {
+            (*_fileInfo)[_currentHref].fileId = text.toUtf8();
+        }
+        _currentTmpProperties.insert(_captureName, text);
     }
     return true;
 }
@@ -338,6 +417,12 @@ QList<QByteArray> LsColJob::properties() const
     return _properties;
 }
 
+void LsColJob::setSyncCollection(const QByteArray &syncToken)
+{
+    _syncCollection = true;
+    _syncToken = syncToken;
+}
+
 void LsColJob::start()
 {
     QList<QByteArray> properties = _properties;
@@ -361,58 +446,104 @@ void LsColJob::start()
     }
 
     QNetworkRequest req;
-    req.setRawHeader("Depth", "1");
-    QByteArray xml("<?xml version=\"1.0\" ?>\n"
-                   "<d:propfind xmlns:d=\"DAV:\" xmlns:oc=\"http://owncloud.org/ns\">\n"
-                   "  <d:prop>\n"
-        + propStr + "  </d:prop>\n"
-                    "</d:propfind>\n");
+    QByteArray verb;
+    QByteArray xml;
+    if (_syncCollection) {
+        // RFC 6578: the report is only defined for Depth 0, the sync-level selects the whole tree
+        verb = "REPORT";
+        req.setRawHeader("Depth", "0");
+        xml = "<?xml version=\"1.0\" ?>\n"
+              "<d:sync-collection xmlns:d=\"DAV:\" xmlns:oc=\"http://owncloud.org/ns\">\n"
+              "  <d:sync-token>" + QString::fromUtf8(_syncToken).toHtmlEscaped().toUtf8() + "</d:sync-token>\n"
+              "  <d:sync-level>infinite</d:sync-level>\n"
+              "  <d:prop>\n"
+            + propStr + "  </d:prop>\n"
+                        "</d:sync-collection>\n";
+    } else {
+        verb = "PROPFIND";
+        req.setRawHeader("Depth", "1");
+        xml = "<?xml version=\"1.0\" ?>\n"
+              "<d:propfind xmlns:d=\"DAV:\" xmlns:oc=\"http://owncloud.org/ns\">\n"
+              "  <d:prop>\n"
+            + propStr + "  </d:prop>\n"
+                        "</d:propfind>\n";
+    }
     auto *buf = new QBuffer(this);
     buf->setData(xml);
     buf->open(QIODevice::ReadOnly);
     if (_url.isValid()) {
-        sendRequest("PROPFIND", _url, req, buf);
+        sendRequest(verb, _url, req, buf);
     } else {
-        sendRequest("PROPFIND", makeDavUrl(path()), req, buf);
+        sendRequest(verb, makeDavUrl(path()), req, buf);
     }
     AbstractNetworkJob::start();
 }
 
-// TODO: Instead of doing all in this slot, we should iteratively parse in readyRead(). This
-// would allow us to be more asynchronous in processing while data is coming from the network,
-// not all in one big blob at the end.
-bool LsColJob::finished()
+void LsColJob::newReplyHook(QNetworkReply *reply)
 {
-    qCInfo(lcLsColJob) << "LSCOL of" << reply()->request().url() << "FINISHED WITH STATUS"
-                       << replyStatusString();
+    // A new reply (e.g. after a redirect) starts a new document
+    _parser = std::make_unique<LsColXMLParser>();
+    _parsingStarted = false;
+    _parsingFailed = false;
+    connect(_parser.get(), &LsColXMLParser::directoryListingSubfolders,
+        this, &LsColJob::directoryListingSubfolders);
+    connect(_parser.get(), &LsColXMLParser::directoryListingIterated,
+        this, &LsColJob::directoryListingIterated);
+    connect(_parser.get(), &LsColXMLParser::directoryListingRemoved,
+        this, &LsColJob::directoryListingRemoved);
+    connect(_parser.get(), &LsColXMLParser::syncTokenReceived,
+        this, &LsColJob::syncTokenReceived);
+    connect(_parser.get(), &LsColXMLParser::finishedWithError,
+        this, &LsColJob::finishedWithError);
+    connect(_parser.get(), &LsColXMLParser::finishedWithoutError,
+        this, &LsColJob::finishedWithoutError);
+
+    connect(reply, &QIODevice::readyRead, this, &LsColJob::slotReadyRead);
+}
 
+bool LsColJob::isMultiStatusReply() const
+{
     const auto contentType = reply()->header(QNetworkRequest::ContentTypeHeader).toString();
     const auto httpCode = reply()->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
     const auto validContentType = contentType.contains("application/xml; charset=utf-8") ||
                                   contentType.contains("application/xml; charset=\"utf-8\"") ||
                                   contentType.contains("text/xml; charset=utf-8") ||
                                   contentType.contains("text/xml; charset=\"utf-8\"");
+    return httpCode == 207 && validContentType;
+}
+
+void LsColJob::slotReadyRead()
+{
+    if (sender() != reply() || _parsingFailed) {
+        return;
+    }
 
-    if (httpCode == 207 && validContentType) {
-        LsColXMLParser parser;
-        connect(&parser, &LsColXMLParser::directoryListingSubfolders,
-            this, &LsColJob::directoryListingSubfolders);
-        connect(&parser, &LsColXMLParser::directoryListingIterated,
-            this, &LsColJob::directoryListingIterated);
-        connect(&parser, &LsColXMLParser::finishedWithError,
-            this, &LsColJob::finishedWithError);
-        connect(&parser, &LsColXMLParser::finishedWithoutError,
-            this, &LsColJob::finishedWithoutError);
-
-        // bool LsColXMLParser::parse takes a while, let's process some events in attempt to make UI more responsive
-        // from https://doc.qt.io/qt-5/qcoreapplication.html#processEvents-1 
-        // "You can call this function occasionally when your program is busy doing a long operation (e.g. copying a file)."
-        // we should not abuse this function, as it affects QObject instances lifetime (when children are getting deleted or when deleteLater is called)
-        // one reason I had to remove ability for LsColJob to have parent, which, otherwise, leads to a crash later
-        QCoreApplication::processEvents(QEventLoop::AllEvents, 100);
-
-        QString expectedPath = reply()->request().url().path(); // something like "/owncloud/remote.php/dav/folder"
-        if (!parser.parse(reply()->readAll(), &_folderInfos, expectedPath)) {
+    if (!_parsingStarted) {
+        if (!isMultiStatusReply()) {
+            // Handled in finished(), leave the body to it
+            return;
+        }
+        _parsingStarted = true;
+        _parser->startParsing(&_folderInfos, reply()->request().url().path());
+    }
+
+    // Entries are emitted while the rest of the listing is still in transfer
+    if (!_parser->addData(reply()->readAll())) {
+        _parsingFailed = true;
+    }
+}
+
+bool LsColJob::finished()
+{
+    qCInfo(lcLsColJob) << "LSCOL of" << reply()->request().url() << "FINISHED WITH STATUS"
+                       << replyStatusString();
+
+    if (isMultiStatusReply()) {
+        if (!_parsingStarted) {
+            _parsingStarted = true;
+            _parser->startParsing(&_folderInfos, reply()->request().url().path()); // something like "/owncloud/remote.php/dav/folder"
+        }
+        if (_parsingFailed || !_parser->addData(reply()->readAll()) || !_parser->finish()) {
             // XML parse error
             emit finishedWithError(reply());
         }
@@ -24,6 +24,9 @@
 
 #include <QBuffer>
 #include <QUrlQuery>
+#include <QXmlStreamReader>
+
+#include <memory>
 
 class QUrl;
 class QJsonObject;
@@ -118,7 +121,13 @@ struct ExtraFolderInfo {
 };
 
 /**
- * @brief The LsColJob class
+ * @brief Parser for the multistatus reply of a PROPFIND
+ *
+ * The reply can either be parsed in one go with parse() or be fed as it
+ * arrives with startParsing(), addData() and finish().
+ * directoryListingIterated is emitted as soon as a response element is
+ * complete.
+ *
  * @ingroup libsync
  */
 class OWNCLOUDSYNC_EXPORT LsColXMLParser : public QObject
@@ -131,13 +140,65 @@ public:
                QHash<QString, ExtraFolderInfo> *sizes,
                const QString &expectedPath);
 
+    /** Resets the parser for a new document. */
+    void startParsing(QHash<QString, ExtraFolderInfo> *sizes, const QString &expectedPath);
+
+    /** Parses as much of the document as possible, returns false on errors. */
+    bool addData(const QByteArray &data);
+
+    /** To be called once the whole document was added, returns false if it was invalid or incomplete. */
+    bool finish();
+
 signals:
     void directoryListingSubfolders(const QStringList &items);
     void directoryListingIterated(const QString &name, const QMap<QString, QString> &properties);
+    /** A response without properties, e.g. a member removed since the sync-token of a sync-collection report */
+    void directoryListingRemoved(const QString &name);
+    /** The sync-token of a sync-collection report */
+    void syncTokenReceived(const QByteArray &syncToken);
     void finishedWithError(QNetworkReply *reply);
     void finishedWithoutError();
+
+private:
+    enum class Capture {
+        None,
+        Href,
+        Status,
+        ResponseStatus,
+        Property,
+        SyncToken,
+    };
+
+    bool processTokens();
+    bool processToken(QXmlStreamReader::TokenType type);
+    bool finishCapture();
+
+    QXmlStreamReader _reader;
+    QHash<QString, ExtraFolderInfo> *_fileInfo = nullptr;
+    QString _expectedPath;
+    bool _failed = false;
+
+    QStringList _folders;
+    QString _currentHref;
+    QMap<QString, QString> _currentTmpProperties;
+    QMap<QString, QString> _currentHttp200Properties;
+    QString _currentResponseStatus;
+    bool _currentPropsHaveHttp200 = false;
+    bool _insidePropstat = false;
+    bool _insideProp = false;
+    bool _insideMultiStatus = false;
+
+    // Element whose text content is currently collected
+    Capture _capture = Capture::None;
+    QString _captureName;
+    QString _captureText;
+    int _captureLevel = 0;
 };
 
+/**
+ * @brief The LsColJob class
+ * @ingroup libsync
+ */
 class OWNCLOUDSYNC_EXPORT LsColJob : public AbstractNetworkJob
 {
     Q_OBJECT
@@ -158,18 +219,43 @@ public:
     void setProperties(QList<QByteArray> properties);
     [[nodiscard]] QList<QByteArray> properties() const;
 
+    /**
+     * Instead of listing the collection, ask for the members that changed below
+     * it since syncToken with a sync-collection REPORT (RFC 6578).
+     *
+     * Changed members are reported with directoryListingIterated(), removed ones
+     * with directoryListingRemoved(), and the token to use for the next report
+     * with syncTokenReceived().
+     */
+    void setSyncCollection(const QByteArray &syncToken);
+
 signals:
     void directoryListingSubfolders(const QStringList &items);
     void directoryListingIterated(const QString &name, const QMap<QString, QString> &properties);
+    void directoryListingRemoved(const QString &name);
+    void syncTokenReceived(const QByteArray &syncToken);
     void finishedWithError(QNetworkReply *reply);
     void finishedWithoutError();
 
+protected:
+    void newReplyHook(QNetworkReply *reply) override;
+
 private slots:
     bool finished() override;
+    void slotReadyRead();
 
 private:
+    [[nodiscard]] bool isMultiStatusReply() const;
+
     QList<QByteArray> _properties;
     QUrl _url; // Used instead of path() if the url is specified in the constructor
+    bool _syncCollection = false;
+    QByteArray _syncToken;
+
+    // Parses the reply while it is being received
+    std::unique_ptr<LsColXMLParser> _parser;
+    bool _parsingStarted = false;
+    bool _parsingFailed = false;
 };
 
 /**
@@ -83,16 +83,56 @@ qint64 freeSpaceLimit()
 
 OwncloudPropagator::~OwncloudPropagator() = default;
 
+BandwidthManager *OwncloudPropagator::bandwidthManager() const
+{
+    return _account->bandwidthManager();
+}
+
 
 int OwncloudPropagator::maximumActiveTransferJob()
 {
-    if (_downloadLimit != 0
-        || _uploadLimit != 0
-        || !_syncOptions._parallelNetworkJobs) {
-        // disable parallelism when there is a network limit.
+    // Network limits don't reduce the parallelism: the transfers share the
+    // token buckets of the BandwidthManager
+    if (!_syncOptions._parallelNetworkJobs) {
         return 1;
     }
-    return qMin(3, qCeil(_syncOptions._parallelNetworkJobs / 2.));
+    return _concurrencyController.window();
+}
+
+void OwncloudPropagator::reportJobFinished(const SyncFileItem &item, std::chrono::milliseconds duration)
+{
+    if (!_syncOptions._adaptiveTransferConcurrency) {
+        return;
+    }
+
+    const auto isCongestion = ConcurrencyController::isCongestionSignal(item._httpErrorCode);
+    if (!ProgressInfo::isSizeDependent(item) && !isCongestion) {
+        // only transfers and server overload are relevant for the transfer window
+        return;
+    }
+
+    const auto transferred = item._status == SyncFileItem::Success ? item._size : 0;
+    _concurrencyController.addSample(transferred, duration, item._httpErrorCode);
+
+    if (!_concurrencyIntervalTimer.isValid()) {
+        _concurrencyIntervalTimer.start();
+        return;
+    }
+
+    // evaluate at most once per second, and immediately on congestion
+    const auto interval = std::chrono::milliseconds(_concurrencyIntervalTimer.elapsed());
+    if (interval < std::chrono::seconds(1) && !isCongestion) {
+        return;
+    }
+
+    const auto oldWindow = _concurrencyController.window();
+    _concurrencyController.evaluate(interval);
+    _concurrencyIntervalTimer.start();
+
+    if (_concurrencyController.window() != oldWindow) {
+        emit transferConcurrencyChanged(_concurrencyController.window());
+        scheduleNextJob();
+    }
 }
 
 /* The maximum number of active jobs in parallel  */
@@ -288,6 +328,9 @@ void PropagateItemJob::done(const SyncFileItem::Status statusArg, const QString
         qCWarning(lcPropagator) << "Could not complete propagation of" << _item->destination() << "by" << this << "with status" << _item->_status << "and error:" << _item->_errorString;
     else
         qCInfo(lcPropagator) << "Completed propagation of" << _item->destination() << "by" << this << "with status" << _item->_status;
+    if (_propagationTimer.isValid()) {
+        propagator()->reportJobFinished(*_item, std::chrono::milliseconds(_propagationTimer.elapsed()));
+    }
     emit propagator()->itemCompleted(_item, category);
     emit finished(_item->_status);
 
@@ -502,6 +545,13 @@ void OwncloudPropagator::start(SyncFileItemVector &&items)
     Q_ASSERT(std::is_sorted(items.begin(), items.end()));
 
     _abortRequested = false;
+    _started = true;
+
+    if (_pipelinedJobs) {
+        // The items propagated during the discovery keep running, the
+        // directory jobs above them wait for them before they finish
+        _pipelinedJobs->close();
+    }
 
     /* This builds all the jobs needed for the propagation.
      * Each directory is a PropagateDirectory job, which contains the files in it.
@@ -537,6 +587,8 @@ void OwncloudPropagator::start(SyncFileItemVector &&items)
     // process each item that is new and is a directory and make sure every parent in its tree has the instruction NEW instead of REMOVE
     adjustDeletedFoldersWithNewChildren(items);
 
+    skipPipelinedItems(items);
+
     resetDelayedUploadTasks();
     _rootJob.reset(new PropagateRootDirectory(this));
     QStack<QPair<QString /* directory name */, PropagateDirectory * /* job */>> directories;
@@ -611,12 +663,85 @@ void OwncloudPropagator::start(SyncFileItemVector &&items)
         _rootJob->appendDirDeletionJob(it);
     }
 
-    connect(_rootJob.data(), &PropagatorJob::finished, this, &OwncloudPropagator::emitFinished);
+    connect(_rootJob.data(), &PropagatorJob::finished, this, &OwncloudPropagator::slotRootJobFinished);
 
     _jobScheduled = false;
     scheduleNextJob();
 }
 
+bool OwncloudPropagator::propagateEarly(const SyncFileItemPtr &item)
+{
+    if (_started || _abortRequested) {
+        return false;
+    }
+
+    const auto regex = syncOptions().fileRegex();
+    if (regex.isValid() && !regex.match(item->_file).hasMatch()) {
+        return false;
+    }
+
+    // Bulk uploads are collected and sent once the whole tree is known
+    if (item->_direction == SyncFileItem::Up && isDelayedUploadItem(item)) {
+        return false;
+    }
+
+    if (!_pipelinedJobs) {
+        _pipelinedJobs.reset(new PropagatePipelinedJobs(this));
+        connect(_pipelinedJobs.data(), &PropagatorJob::finished, this, &OwncloudPropagator::slotPipelinedJobsFinished);
+    }
+
+    qCDebug(lcPropagator) << "Propagating during discovery" << item->_file << item->_instruction;
+    _pipelinedItems.insert(item);
+    _pipelinedJobs->appendTask(item);
+    scheduleNextJob();
+    return true;
+}
+
+void OwncloudPropagator::abortPipelinedJobs()
+{
+    if (_pipelinedJobs && _pipelinedJobs->_state != PropagatorJob::Finished) {
+        _pipelinedJobs->abort(PropagatorJob::AbortType::Synchronous);
+    }
+}
+
+void OwncloudPropagator::slotPipelinedJobsFinished()
+{
+    qCInfo(lcPropagator) << "Items propagated during discovery are done:" << _pipelinedItems.size();
+
+    // An abort could have finished the propagation already
+    if (_finishedEmited || !_rootJob) {
+        return;
+    }
+
+    // The root job waits for them before the directory deletions
+    scheduleNextJob();
+}
+
+void OwncloudPropagator::slotRootJobFinished(SyncFileItem::Status status)
+{
+    if (_pipelinedJobs && _pipelinedJobs->_state != PropagatorJob::Finished) {
+        // The root job only finishes early on errors
+        abortPipelinedJobs();
+    }
+    if (status == SyncFileItem::Success && _pipelinedJobs
+        && _pipelinedJobs->errorStatus() != SyncFileItem::NoStatus) {
+        status = _pipelinedJobs->errorStatus();
+    }
+    emitFinished(status);
+}
+
+void OwncloudPropagator::skipPipelinedItems(SyncFileItemVector &items)
+{
+    if (_pipelinedItems.isEmpty()) {
+        return;
+    }
+
+    items.erase(std::remove_if(items.begin(), items.end(), [this](const SyncFileItemPtr &item) {
+        return _pipelinedItems.contains(item);
+    }),
+        items.end());
+}
+
 void OwncloudPropagator::startDirectoryPropagation(const SyncFileItemPtr &item,
                                                    QStack<QPair<QString, PropagateDirectory *>> &directories,
                                                    QVector<PropagatorJob *> &directoriesToRemove,
@@ -758,6 +883,19 @@ void OwncloudPropagator::setSyncOptions(const SyncOptions &syncOptions)
 {
     _syncOptions = syncOptions;
     _chunkSize = syncOptions._initialChunkSize;
+    _concurrencyController = ConcurrencyController(ConcurrencyController::defaultWindow(_syncOptions._parallelNetworkJobs), 1, hardMaximumActiveJob());
+    _bulkUploadBatchController = BulkUploadBatchController(_syncOptions._initialChunkSize, _syncOptions.minChunkSize(), _syncOptions.maxChunkSize(), _syncOptions._targetChunkUploadDuration);
+}
+
+void OwncloudPropagator::setParallelNetworkJobs(int count)
+{
+    if (count == _syncOptions._parallelNetworkJobs) {
+        return;
+    }
+    _syncOptions._parallelNetworkJobs = count;
+    // keeps the adapted window unless it doesn't fit anymore
+    _concurrencyController.setBounds(1, hardMaximumActiveJob());
+    scheduleNextJob();
 }
 
 bool OwncloudPropagator::localFileNameClash(const QString &relFile)
@@ -858,22 +996,33 @@ void OwncloudPropagator::scheduleNextJob()
 
 void OwncloudPropagator::scheduleNextJobImpl()
 {
-    // TODO: If we see that the automatic up-scaling has a bad impact we
-    // need to check how to avoid this.
-    // Down-scaling on slow networks? https://github.com/owncloud/client/issues/3382
-    // Making sure we do up/down at same time? https://github.com/owncloud/client/issues/1633
+    // The transfer window (maximumActiveTransferJob()) is scaled up and down by
+    // _concurrencyController based on observed throughput, latency and server errors.
+    // See https://github.com/owncloud/client/issues/3382
 
     _jobScheduled = false;
 
     if (_activeJobList.count() < maximumActiveTransferJob()) {
-        if (_rootJob->scheduleSelfOrChild()) {
+        if (scheduleSelfOrChild()) {
             scheduleNextJob();
         }
-    } else if (_activeJobList.count() < hardMaximumActiveJob()) {
+        return;
+    }
+
+    // the transfer window is the limiting factor only when it is filled with
+    // transfers, jobs that are likely finished quickly don't count
+    const auto activeTransferJobCount = std::count_if(_activeJobList.cbegin(), _activeJobList.cend(), [](PropagateItemJob *job) {
+        return !job->isLikelyFinishedQuickly();
+    });
+    if (activeTransferJobCount >= maximumActiveTransferJob()) {
+        _concurrencyController.markSaturated();
+    }
+
+    if (_activeJobList.count() < hardMaximumActiveJob()) {
         int likelyFinishedQuicklyCount = 0;
-        // NOTE: Only counts the first 3 jobs! Then for each
+        // NOTE: Only counts the first maximumActiveTransferJob() jobs! Then for each
         // one that is likely finished quickly, we can launch another one.
-        // When a job finishes another one will "move up" to be one of the first 3 and then
+        // When a job finishes another one will "move up" to be one of the first ones and then
         // be counted too.
         for (int i = 0; i < maximumActiveTransferJob() && i < _activeJobList.count(); i++) {
             if (_activeJobList.at(i)->isLikelyFinishedQuickly()) {
@@ -882,13 +1031,21 @@ void OwncloudPropagator::scheduleNextJobImpl()
         }
         if (_activeJobList.count() < maximumActiveTransferJob() + likelyFinishedQuicklyCount) {
             qCDebug(lcPropagator) << "Can pump in another request! activeJobs =" << _activeJobList.count();
-            if (_rootJob->scheduleSelfOrChild()) {
+            if (scheduleSelfOrChild()) {
                 scheduleNextJob();
             }
         }
     }
 }
 
+bool OwncloudPropagator::scheduleSelfOrChild()
+{
+    if (_pipelinedJobs && _pipelinedJobs->scheduleSelfOrChild()) {
+        return true;
+    }
+    return _rootJob && _rootJob->scheduleSelfOrChild();
+}
+
 void OwncloudPropagator::reportProgress(const SyncFileItem &item, qint64 bytes)
 {
     emit progress(item, bytes);
@@ -910,7 +1067,14 @@ OwncloudPropagator::DiskSpaceResult OwncloudPropagator::diskSpaceCheck() const
         return DiskSpaceCritical;
     }
 
-    if (freeBytes - _rootJob->committedDiskSpace() < freeSpaceLimit()) {
+    qint64 committedDiskSpace = 0;
+    if (_rootJob) {
+        committedDiskSpace += _rootJob->committedDiskSpace();
+    }
+    if (_pipelinedJobs) {
+        committedDiskSpace += _pipelinedJobs->committedDiskSpace();
+    }
+    if (freeBytes - committedDiskSpace < freeSpaceLimit()) {
         return DiskSpaceFailure;
     }
 
@@ -1415,6 +1579,21 @@ void PropagateDirectory::slotFirstJobFinished(SyncFileItem::Status status)
 
 void PropagateDirectory::slotSubJobsFinished(SyncFileItem::Status status)
 {
+    // Files below the directory that were propagated during the discovery
+    // may still be running, the directory is only done after them
+    const auto pipelinedJobs = propagator()->pipelinedJobs();
+    if (pipelinedJobs && pipelinedJobs->hasUnfinishedItemsBelow(_item->_file)) {
+        if (!_pipelinedItemsFinishedConnection) {
+            _pipelinedItemsFinishedConnection = connect(pipelinedJobs, &PropagatePipelinedJobs::itemsBelowFinished, this, [this, status](const QString &directory) {
+                if (directory == _item->_file) {
+                    disconnect(_pipelinedItemsFinishedConnection);
+                    slotSubJobsFinished(status);
+                }
+            });
+        }
+        return;
+    }
+
     if (!_item->isEmpty() && status == SyncFileItem::Success) {
         _item->_isAnyCaseClashChild = _item->_isAnyCaseClashChild || _subJobs._isAnyCaseClashChild;
         _item->_isAnyInvalidCharChild = _item->_isAnyInvalidCharChild || _subJobs._isAnyInvalidCharChild;
@@ -1507,7 +1686,10 @@ void PropagateDirectory::slotSubJobsFinished(SyncFileItem::Status status)
                 }
             }
 #endif
-            if (!_item->_isAnyCaseClashChild && !_item->_isAnyInvalidCharChild) {
+            if (_item->_instruction == CSYNC_INSTRUCTION_UPDATE_METADATA && pipelinedJobs && pipelinedJobs->hasErrorsBelow(_item->_file)) {
+                // Keep the old etag so that the failed file is discovered again in the next sync
+                qCInfo(lcDirectory) << "Not updating the metadata of" << _item->_file << "because a file in it failed";
+            } else if (!_item->_isAnyCaseClashChild && !_item->_isAnyInvalidCharChild) {
                 const auto result = propagator()->updateMetadata(*_item);
                 if (!result) {
                     status = _item->_status = SyncFileItem::FatalError;
@@ -1598,6 +1780,12 @@ bool PropagateRootDirectory::scheduleSelfOrChild()
         return scheduleDelayedJobs();
     }
 
+    // The deletions also wait for the items propagated during the discovery
+    const auto pipelinedJobs = propagator()->pipelinedJobs();
+    if (pipelinedJobs && pipelinedJobs->hasUnfinishedItemsBelow(QString())) {
+        return false;
+    }
+
     return _dirDeletionJobs.scheduleSelfOrChild();
 }
 
@@ -1675,6 +1863,186 @@ bool PropagateRootDirectory::scheduleDelayedJobs()
 
 // ================================================================================
 
+// Orders the error statuses a sub job can finish with, worst last
+static int errorSeverity(SyncFileItem::Status status)
+{
+    switch (status) {
+    case SyncFileItem::FatalError:
+        return 5;
+    case SyncFileItem::NormalError:
+        return 4;
+    case SyncFileItem::DetailError:
+        return 3;
+    case SyncFileItem::BlacklistedError:
+        return 2;
+    case SyncFileItem::SoftError:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+PropagatePipelinedJobs::PropagatePipelinedJobs(OwncloudPropagator *propagator)
+    : PropagatorJob(propagator)
+{
+}
+
+void PropagatePipelinedJobs::appendTask(const SyncFileItemPtr &item)
+{
+    ASSERT(!_closed);
+    _tasksToDo.append(item);
+
+    auto parentPath = item->_file;
+    do {
+        parentPath.truncate(qMax(0, parentPath.lastIndexOf(QLatin1Char('/'))));
+        ++_unfinishedItemsBelow[parentPath];
+    } while (!parentPath.isEmpty());
+}
+
+bool PropagatePipelinedJobs::hasUnfinishedItemsBelow(const QString &directory) const
+{
+    return _unfinishedItemsBelow.value(directory) > 0;
+}
+
+bool PropagatePipelinedJobs::hasErrorsBelow(const QString &directory) const
+{
+    return _directoriesWithErrors.contains(directory);
+}
+
+void PropagatePipelinedJobs::itemFinished(const SyncFileItemPtr &item, SyncFileItem::Status status)
+{
+    const auto failed = status == SyncFileItem::FatalError
+        || status == SyncFileItem::NormalError
+        || status == SyncFileItem::SoftError
+        || status == SyncFileItem::DetailError
+        || status == SyncFileItem::BlacklistedError;
+
+    QStringList finishedDirectories;
+    auto parentPath = item->_file;
+    do {
+        parentPath.truncate(qMax(0, parentPath.lastIndexOf(QLatin1Char('/'))));
+        if (failed) {
+            _directoriesWithErrors.insert(parentPath);
+        }
+        auto &unfinished = _unfinishedItemsBelow[parentPath];
+        if (--unfinished == 0) {
+            finishedDirectories.append(parentPath);
+        }
+    } while (!parentPath.isEmpty());
+
+    // Deepest first, a directory finishes before its parent
+    for (const auto &directory : qAsConst(finishedDirectories)) {
+        emit itemsBelowFinished(directory);
+    }
+}
+
+void PropagatePipelinedJobs::close()
+{
+    _closed = true;
+    if (_tasksToDo.isEmpty() && _runningJobs.isEmpty()) {
+        QMetaObject::invokeMethod(this, "finalize", Qt::QueuedConnection);
+    }
+}
+
+bool PropagatePipelinedJobs::scheduleSelfOrChild()
+{
+    if (_state == Finished) {
+        return false;
+    }
+    _state = Running;
+
+    while (!_tasksToDo.isEmpty()) {
+        const auto nextTask = _tasksToDo.takeFirst();
+        PropagatorJob *job = propagator()->createJob(nextTask);
+        if (!job) {
+            qCWarning(lcPropagator) << "Useless task found for file" << nextTask->destination() << "instruction" << nextTask->_instruction;
+            itemFinished(nextTask, SyncFileItem::NoStatus);
+            continue;
+        }
+        _runningJobs.append(job);
+        _runningItems.insert(job, nextTask);
+        connect(job, &PropagatorJob::finished, this, &PropagatePipelinedJobs::slotSubJobFinished);
+        return job->scheduleSelfOrChild();
+    }
+
+    if (_closed && _runningJobs.isEmpty()) {
+        QMetaObject::invokeMethod(this, "finalize", Qt::QueuedConnection);
+    }
+    return false;
+}
+
+void PropagatePipelinedJobs::abort(PropagatorJob::AbortType abortType)
+{
+    const auto tasksToDo = std::exchange(_tasksToDo, {});
+    for (const auto &task : tasksToDo) {
+        itemFinished(task, SyncFileItem::NormalError);
+    }
+    if (!_runningJobs.empty()) {
+        _abortsCount = _runningJobs.size();
+        for (const auto job : qAsConst(_runningJobs)) {
+            if (abortType == AbortType::Asynchronous) {
+                connect(job, &PropagatorJob::abortFinished,
+                        this, &PropagatePipelinedJobs::slotSubJobAbortFinished);
+            }
+            job->abort(abortType);
+        }
+    } else if (abortType == AbortType::Asynchronous) {
+        emit abortFinished();
+    }
+}
+
+qint64 PropagatePipelinedJobs::committedDiskSpace() const
+{
+    qint64 needed = 0;
+    for (const auto job : _runningJobs) {
+        needed += job->committedDiskSpace();
+    }
+    return needed;
+}
+
+void PropagatePipelinedJobs::slotSubJobFinished(SyncFileItem::Status status)
+{
+    auto *subJob = dynamic_cast<PropagatorJob *>(sender());
+    ASSERT(subJob);
+
+    subJob->deleteLater();
+    const auto index = _runningJobs.indexOf(subJob);
+    ENFORCE(index >= 0);
+    _runningJobs.remove(index);
+
+    if (errorSeverity(status) > errorSeverity(_hasError)) {
+        _hasError = status;
+    }
+
+    itemFinished(_runningItems.take(subJob), status);
+
+    if (_closed && _tasksToDo.isEmpty() && _runningJobs.isEmpty()) {
+        finalize();
+    } else {
+        propagator()->scheduleNextJob();
+    }
+}
+
+void PropagatePipelinedJobs::slotSubJobAbortFinished()
+{
+    _abortsCount--;
+    if (_abortsCount == 0) {
+        emit abortFinished();
+    }
+}
+
+void PropagatePipelinedJobs::finalize()
+{
+    if (_state == Finished) {
+        return;
+    }
+
+    _state = Finished;
+    emit finished(_hasError == SyncFileItem::NoStatus ? SyncFileItem::Success : _hasError);
+}
+
+// ================================================================================
+
 CleanupPollsJob::~CleanupPollsJob() = default;
 
 void CleanupPollsJob::start()
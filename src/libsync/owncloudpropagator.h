@@ -21,12 +21,15 @@
 #include <QElapsedTimer>
 #include <QTimer>
 #include <QPointer>
+#include <QSet>
 #include <QIODevice>
 #include <QMutex>
 #include <QNetworkReply>
 
 #include "accountfwd.h"
 #include "bandwidthmanager.h"
+#include "bulkuploadbatchcontroller.h"
+#include "concurrencycontroller.h"
 #include "csync.h"
 #include "progressdispatcher.h"
 #include "syncfileitem.h"
@@ -191,6 +194,9 @@ protected:
 
     [[nodiscard]] bool hasEncryptedAncestor() const;
 
+    /** Measures how long the job has been running since it was scheduled */
+    QElapsedTimer _propagationTimer;
+
 protected slots:
     void slotRestoreJobFinished(SyncFileItem::Status status);
 
@@ -221,6 +227,7 @@ public:
         qCInfo(lcPropagator) << "Starting" << _item->_instruction << "propagation of" << _item->destination() << "by" << this;
 
         _state = Running;
+        _propagationTimer.start();
         QMetaObject::invokeMethod(this, "start"); // We could be in a different thread (neon jobs)
         return true;
     }
@@ -340,6 +347,8 @@ public:
             // even if caller allows async abort (asyncAbort)
             _firstJob->abort(AbortType::Synchronous);
 
+        disconnect(_pipelinedItemsFinishedConnection);
+
         if (abortType == AbortType::Asynchronous){
             connect(&_subJobs, &PropagatorCompositeJob::abortFinished, this, &PropagateDirectory::abortFinished);
         }
@@ -362,6 +371,9 @@ private slots:
     void slotFirstJobFinished(OCC::SyncFileItem::Status status);
     virtual void slotSubJobsFinished(OCC::SyncFileItem::Status status);
 
+private:
+    // While the files of the directory propagated during the discovery are running
+    QMetaObject::Connection _pipelinedItemsFinishedConnection;
 };
 
 /**
@@ -399,6 +411,67 @@ private:
     SyncFileItem::Status _errorStatus = SyncFileItem::Status::NoStatus;
 };
 
+/**
+ * @brief Propagates files that were handed over while the discovery is still running
+ *
+ * Only files whose parent directory is completely discovered and unchanged
+ * end up here, so none of them depends on another job and they all run in
+ * parallel. Contrary to PropagatorCompositeJob running out of tasks does not
+ * finish this job: it finishes once close() was called and all sub jobs are done.
+ *
+ * The job tree of the remaining items runs next to it. Only the directory
+ * jobs above the files wait for them, see hasUnfinishedItemsBelow().
+ *
+ * @ingroup libsync
+ */
+class OWNCLOUDSYNC_EXPORT PropagatePipelinedJobs : public PropagatorJob
+{
+    Q_OBJECT
+public:
+    explicit PropagatePipelinedJobs(OwncloudPropagator *propagator);
+
+    void appendTask(const SyncFileItemPtr &item);
+
+    /** No further tasks will be appended, finish when the running jobs are done. */
+    void close();
+
+    bool scheduleSelfOrChild() override;
+    void abort(PropagatorJob::AbortType abortType) override;
+
+    [[nodiscard]] qint64 committedDiskSpace() const override;
+
+    /** The worst status of all finished sub jobs */
+    [[nodiscard]] SyncFileItem::Status errorStatus() const { return _hasError; }
+
+    /** Whether items below the directory, "" for the root, are still to do or running */
+    [[nodiscard]] bool hasUnfinishedItemsBelow(const QString &directory) const;
+
+    /** Whether an item below the directory failed */
+    [[nodiscard]] bool hasErrorsBelow(const QString &directory) const;
+
+signals:
+    /** The last of the items below the directory is done */
+    void itemsBelowFinished(const QString &directory);
+
+private slots:
+    void slotSubJobFinished(OCC::SyncFileItem::Status status);
+    void slotSubJobAbortFinished();
+    void finalize();
+
+private:
+    /** The directory is done with the item, counts the items below each of its parents */
+    void itemFinished(const SyncFileItemPtr &item, SyncFileItem::Status status);
+
+    QVector<SyncFileItemPtr> _tasksToDo;
+    QVector<PropagatorJob *> _runningJobs;
+    QHash<PropagatorJob *, SyncFileItemPtr> _runningItems;
+    QHash<QString, int> _unfinishedItemsBelow;
+    QSet<QString> _directoriesWithErrors;
+    SyncFileItem::Status _hasError = SyncFileItem::NoStatus;
+    int _abortsCount = 0;
+    bool _closed = false;
+};
+
 /**
  * @brief Dummy job that just mark it as completed and ignored
  * @ingroup libsync
@@ -437,9 +510,10 @@ public:
 public:
     OwncloudPropagator(AccountPtr account, const QString &localDir, const QString &remoteFolder, SyncJournalDb *progressDb, QSet<QString> &bulkUploadBlackList)
         : _journal(progressDb)
-        , _bandwidthManager(this)
         , _chunkSize(10 * 1000 * 1000) // 10 MB, overridden in setSyncOptions
         , _account(account)
+        , _concurrencyController(ConcurrencyController::defaultWindow(_syncOptions._parallelNetworkJobs), 1, hardMaximumActiveJob())
+        , _bulkUploadBatchController(_syncOptions._initialChunkSize, _syncOptions.minChunkSize(), _syncOptions.maxChunkSize(), _syncOptions._targetChunkUploadDuration)
         , _localDir(Utility::trailingSlashPath(localDir))
         , _remoteFolder(Utility::trailingSlashPath(remoteFolder))
         , _bulkUploadBlackList(bulkUploadBlackList)
@@ -451,6 +525,30 @@ public:
 
     void start(SyncFileItemVector &&_syncedItems);
 
+    /** Propagates an item while the discovery is still running.
+     *
+     * The caller guarantees that the item does not depend on anything that is
+     * still being discovered. The item must still be part of the list passed to
+     * start() later on, it is skipped there. The directory jobs built by start()
+     * wait for the items propagated early below them before they finish.
+     *
+     * Returns false if the item has to wait for start(), for example because it
+     * will be part of a bulk upload.
+     */
+    bool propagateEarly(const SyncFileItemPtr &item);
+
+    /** Whether start() was called */
+    [[nodiscard]] bool hasStarted() const { return _started; }
+
+    /** The items passed to propagateEarly(), nullptr if there are none */
+    [[nodiscard]] PropagatePipelinedJobs *pipelinedJobs() const { return _pipelinedJobs.data(); }
+
+    /** Synchronously aborts the items passed to propagateEarly().
+     *
+     * Used when the sync ends before the items are done.
+     */
+    void abortPipelinedJobs();
+
     void startDirectoryPropagation(const SyncFileItemPtr &item,
                                    QStack<QPair<QString, PropagateDirectory*>> &directories,
                                    QVector<PropagatorJob *> &directoriesToRemove,
@@ -468,9 +566,12 @@ public:
     [[nodiscard]] const SyncOptions &syncOptions() const;
     void setSyncOptions(const SyncOptions &syncOptions);
 
-    int _downloadLimit = 0;
-    int _uploadLimit = 0;
-    BandwidthManager _bandwidthManager;
+    /** Changes the maximum number of parallel jobs of the running propagation */
+    void setParallelNetworkJobs(int count);
+
+    /// Shared with the propagators of the other folders of the account,
+    /// the limits are set by SyncEngine::setNetworkLimits()
+    [[nodiscard]] BandwidthManager *bandwidthManager() const;
 
     bool _abortRequested = false;
 
@@ -498,9 +599,25 @@ public:
      */
     QHash<QString, qint64> _folderQuota;
 
-    /* the maximum number of jobs using bandwidth (uploads or downloads, in parallel) */
+    /* the maximum number of jobs using bandwidth (uploads or downloads, in parallel)
+     *
+     * This is the window of the adaptive concurrency controller, see
+     * reportJobFinished().
+     */
     int maximumActiveTransferJob();
 
+    /** Feeds the outcome of a finished job into the adaptive concurrency controller.
+     *
+     * Called from PropagateItemJob::done(). Every second of propagation the collected
+     * samples are evaluated and the transfer window is adjusted.
+     */
+    void reportJobFinished(const SyncFileItem &item, std::chrono::milliseconds duration);
+
+    [[nodiscard]] const ConcurrencyController &concurrencyController() const { return _concurrencyController; }
+
+    /** The size of the batches of bulk uploads, adapted after each batch by BulkPropagatorJob. */
+    BulkUploadBatchController &bulkUploadBatchController() { return _bulkUploadBatchController; }
+
     /** The size to use for upload chunks.
      *
      * Will be dynamically adjusted after each chunk upload finishes
@@ -554,12 +671,22 @@ public:
             return;
 
         _abortRequested = true;
-        if (_rootJob) {
+        PropagatorJob *jobToAbort = _rootJob.data();
+        if (_pipelinedJobs && _pipelinedJobs->_state != PropagatorJob::Finished) {
+            if (jobToAbort) {
+                // The root job waits for the early items, they go first
+                QMetaObject::invokeMethod(this, [this] { abortPipelinedJobs(); }, Qt::QueuedConnection);
+            } else {
+                // The discovery is still running
+                jobToAbort = _pipelinedJobs.data();
+            }
+        }
+        if (jobToAbort) {
             // Connect to abortFinished  which signals that abort has been asynchronously finished
-            connect(_rootJob.data(), &PropagateDirectory::abortFinished, this, &OwncloudPropagator::emitFinished);
+            connect(jobToAbort, &PropagatorJob::abortFinished, this, &OwncloudPropagator::emitFinished);
 
             // Use Queued Connection because we're possibly already in an item's finished stack
-            QMetaObject::invokeMethod(_rootJob.data(), "abort", Qt::QueuedConnection,
+            QMetaObject::invokeMethod(jobToAbort, "abort", Qt::QueuedConnection,
                                       Q_ARG(PropagatorJob::AbortType, PropagatorJob::AbortType::Asynchronous));
 
             // Give asynchronous abort 5000 msec to finish on its own
@@ -651,10 +778,18 @@ private slots:
     void abortTimeout()
     {
         // Abort synchronously and finish
-        _rootJob.data()->abort(PropagatorJob::AbortType::Synchronous);
+        if (_rootJob) {
+            _rootJob->abort(PropagatorJob::AbortType::Synchronous);
+        }
+        abortPipelinedJobs();
         emitFinished(SyncFileItem::NormalError);
     }
 
+    /** All items propagated early are done, the root job may finish */
+    void slotPipelinedJobsFinished();
+
+    void slotRootJobFinished(OCC::SyncFileItem::Status status);
+
     /** Emit the finished signal and make sure it is only emitted once */
     void emitFinished(OCC::SyncFileItem::Status status)
     {
@@ -686,6 +821,9 @@ signals:
     void insufficientLocalStorage();
     void insufficientRemoteStorage();
 
+    /** Emitted when the adaptive controller changed the number of parallel transfers */
+    void transferConcurrencyChanged(int window);
+
 private:
     std::unique_ptr<PropagateUploadFileCommon> createUploadJob(SyncFileItemPtr item,
                                                                bool deleteExisting);
@@ -696,11 +834,24 @@ private:
 
     static void adjustDeletedFoldersWithNewChildren(SyncFileItemVector &items);
 
+    /** Removes the items that were propagated early from items */
+    void skipPipelinedItems(SyncFileItemVector &items);
+
+    /** Schedules the next job of the early items or of the job tree */
+    bool scheduleSelfOrChild();
+
     AccountPtr _account;
     QScopedPointer<PropagateRootDirectory> _rootJob;
+    QScopedPointer<PropagatePipelinedJobs> _pipelinedJobs;
+    QSet<SyncFileItemPtr> _pipelinedItems;
+    bool _started = false;
     SyncOptions _syncOptions;
     bool _jobScheduled = false;
 
+    ConcurrencyController _concurrencyController;
+    QElapsedTimer _concurrencyIntervalTimer;
+    BulkUploadBatchController _bulkUploadBatchController;
+
     const QString _localDir; // absolute path to the local directory. ends with '/'
     const QString _remoteFolder; // remote folder, ends with '/'
 
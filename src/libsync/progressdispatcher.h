@@ -180,6 +180,9 @@ public:
     QString _currentDiscoveredRemoteFolder;
     QString _currentDiscoveredLocalFolder;
 
+    // Number of transfers the propagator currently allows in parallel, 0 outside of propagation
+    int _transferConcurrency = 0;
+
     void setProgressComplete(const SyncFileItem &item);
 
     void setProgressItem(const SyncFileItem &item, qint64 completed);
@@ -33,6 +33,7 @@
 #include <QFileInfo>
 #include <QDir>
 
+#include <algorithm>
 #include <cmath>
 
 namespace OCC {
@@ -76,9 +77,6 @@ GETFileJob::GETFileJob(AccountPtr account, const QString &path, QIODevice *devic
     , _expectedContentLength(-1)
     , _resumeStart(resumeStart)
     , _errorStatus(SyncFileItem::NoStatus)
-    , _bandwidthLimited(false)
-    , _bandwidthChoked(false)
-    , _bandwidthQuota(0)
     , _bandwidthManager(nullptr)
     , _hasEmittedFinishedSignal(false)
     , _lastModified()
@@ -97,9 +95,6 @@ GETFileJob::GETFileJob(AccountPtr account, const QUrl &url, QIODevice *device,
     , _resumeStart(resumeStart)
     , _errorStatus(SyncFileItem::NoStatus)
     , _directDownloadUrl(url)
-    , _bandwidthLimited(false)
-    , _bandwidthChoked(false)
-    , _bandwidthQuota(0)
     , _bandwidthManager(nullptr)
     , _hasEmittedFinishedSignal(false)
     , _lastModified()
@@ -110,8 +105,9 @@ GETFileJob::GETFileJob(AccountPtr account, const QUrl &url, QIODevice *device,
 
 void GETFileJob::start()
 {
-    if (_resumeStart > 0) {
-        _headers["Range"] = "bytes=" + QByteArray::number(_resumeStart) + '-';
+    if (_resumeStart > 0 || _rangeEnd >= 0) {
+        _headers["Range"] = "bytes=" + QByteArray::number(_resumeStart) + '-'
+            + (_rangeEnd >= 0 ? QByteArray::number(_rangeEnd) : QByteArray());
         _headers["Accept-Ranges"] = "bytes";
         qCDebug(lcGetJob) << "Retry with range " << _headers["Range"];
     }
@@ -130,11 +126,6 @@ void GETFileJob::start()
         sendRequest("GET", _directDownloadUrl, req);
     }
 
-    qCDebug(lcGetJob) << _bandwidthManager << _bandwidthChoked << _bandwidthLimited;
-    if (_bandwidthManager) {
-        _bandwidthManager->registerDownloadJob(this);
-    }
-
     connect(this, &AbstractNetworkJob::networkActivity, account().data(), &Account::propagatorNetworkActivity);
 
     AbstractNetworkJob::start();
@@ -214,14 +205,28 @@ void GETFileJob::slotMetaDataChanged()
     }
 
     qint64 start = 0;
+    qint64 end = -1;
     QByteArray ranges = reply()->rawHeader("Content-Range");
     if (!ranges.isEmpty()) {
-        static const QRegularExpression rx("bytes (\\d+)-");
+        static const QRegularExpression rx("bytes (\\d+)-(\\d*)");
         const auto rxMatch = rx.match(ranges);
         if (rxMatch.hasMatch()) {
             start = rxMatch.captured(1).toLongLong();
+            if (!rxMatch.captured(2).isEmpty()) {
+                end = rxMatch.captured(2).toLongLong();
+            }
         }
     }
+    if (_rangeEnd >= 0 && (start != _resumeStart || end != _rangeEnd)) {
+        // A bounded range only covers part of the device: never rewrite it from scratch
+        qCWarning(lcGetJob) << "Wrong content-range: " << ranges << " while expecting" << _headers["Range"];
+        _rangeRequestRejected = ranges.isEmpty();
+        _errorString = _rangeRequestRejected ? tr("Server does not support range requests")
+                                             : tr("Server returned wrong content-range");
+        _errorStatus = SyncFileItem::NormalError;
+        reply()->abort();
+        return;
+    }
     if (start != _resumeStart) {
         qCWarning(lcGetJob) << "Wrong content-range: " << ranges << " while expecting start was" << _resumeStart;
         if (ranges.isEmpty()) {
@@ -255,33 +260,6 @@ void GETFileJob::setBandwidthManager(BandwidthManager *bwm)
     _bandwidthManager = bwm;
 }
 
-void GETFileJob::setChoked(bool c)
-{
-    _bandwidthChoked = c;
-    QMetaObject::invokeMethod(this, "slotReadyRead", Qt::QueuedConnection);
-}
-
-void GETFileJob::setBandwidthLimited(bool b)
-{
-    _bandwidthLimited = b;
-    QMetaObject::invokeMethod(this, "slotReadyRead", Qt::QueuedConnection);
-}
-
-void GETFileJob::giveBandwidthQuota(qint64 q)
-{
-    _bandwidthQuota = q;
-    qCDebug(lcGetJob) << "Got" << q << "bytes";
-    QMetaObject::invokeMethod(this, "slotReadyRead", Qt::QueuedConnection);
-}
-
-qint64 GETFileJob::currentDownloadPosition()
-{
-    if (_device && _device->pos() > 0 && _device->pos() > qint64(_resumeStart)) {
-        return _device->pos();
-    }
-    return _resumeStart;
-}
-
 qint64 GETFileJob::writeToDevice(const QByteArray &data)
 {
     return _device->write(data);
@@ -295,18 +273,14 @@ void GETFileJob::slotReadyRead()
     QByteArray buffer(bufferSize, Qt::Uninitialized);
 
     while (reply()->bytesAvailable() > 0 && _saveBodyToFile) {
-        if (_bandwidthChoked) {
-            qCWarning(lcGetJob) << "Download choked";
-            break;
-        }
-        qint64 toRead = bufferSize;
-        if (_bandwidthLimited) {
-            toRead = qMin(qint64(bufferSize), _bandwidthQuota);
+        auto toRead = qMin(qint64(bufferSize), reply()->bytesAvailable());
+        if (_bandwidthManager) {
+            toRead = _bandwidthManager->takeDownloadQuota(this, toRead);
             if (toRead == 0) {
+                // The manager calls slotReadyRead() again once there is quota
                 qCDebug(lcGetJob) << "Out of quota";
                 break;
             }
-            _bandwidthQuota -= toRead;
         }
 
         const qint64 readBytes = reply()->read(buffer.data(), toRead);
@@ -576,6 +550,9 @@ void PropagateDownloadFile::startAfterIsEncryptedIsChecked()
         qCDebug(lcPropagateDownload) << _item->_file << "may not need download, computing checksum";
         auto computeChecksum = new ComputeChecksum(this);
         computeChecksum->setChecksumType(parseChecksumHeaderType(_item->_checksumHeader));
+        if (propagator()->syncOptions()._checksumCache) {
+            computeChecksum->setChecksumCache(propagator()->_journal);
+        }
         connect(computeChecksum, &ComputeChecksum::done,
             this, &PropagateDownloadFile::conflictChecksumComputed);
         propagator()->_activeJobList.append(this);
@@ -643,15 +620,24 @@ void PropagateDownloadFile::startDownload()
 
     QString tmpFileName;
     QByteArray expectedEtagForResume;
+    bool resumeSegmented = false;
+    _segmentedDownload = canDownloadInSegments();
+    _completedSegments.clear();
+    _completedSegmentBytes = 0;
     const SyncJournalDb::DownloadInfo progressInfo = propagator()->_journal->getDownloadInfo(_item->_file);
     if (progressInfo._valid) {
         // if the etag has changed meanwhile, remove the already downloaded part.
-        if (progressInfo._etag != _item->_etag) {
+        // A segmented temporary file has holes, it can't be resumed sequentially.
+        if (progressInfo._etag != _item->_etag || (progressInfo._segmented && !_segmentedDownload)) {
             FileSystem::remove(propagator()->fullLocalPath(progressInfo._tmpfile));
             propagator()->_journal->setDownloadInfo(_item->_file, SyncJournalDb::DownloadInfo());
         } else {
             tmpFileName = progressInfo._tmpfile;
             expectedEtagForResume = progressInfo._etag;
+            resumeSegmented = progressInfo._segmented;
+            if (resumeSegmented) {
+                _completedSegments = progressInfo._completedRanges;
+            }
         }
     }
 
@@ -659,9 +645,20 @@ void PropagateDownloadFile::startDownload()
         tmpFileName = createDownloadTmpFileName(_item->_file);
     }
     _tmpFile.setFileName(propagator()->fullLocalPath(tmpFileName));
+    _tmpFileName = tmpFileName;
 
     _resumeStart = _tmpFile.size();
-    if (_resumeStart > 0 && _resumeStart == _item->_size) {
+    if (_segmentedDownload) {
+        if (!resumeSegmented && _resumeStart > 0) {
+            // What an interrupted sequential download got is the first segment
+            _completedSegments = { { 0, qMin(_resumeStart, _item->_size) } };
+        }
+        _resumeStart = 0;
+        for (const auto &segment : std::as_const(_completedSegments)) {
+            _completedSegmentBytes += segment.second - segment.first;
+        }
+    }
+    if (_segmentedDownload ? _completedSegmentBytes == _item->_size : (_resumeStart > 0 && _resumeStart == _item->_size)) {
         qCInfo(lcPropagateDownload) << "File is already complete, no need to download";
         downloadFinished();
         return;
@@ -715,13 +712,26 @@ void PropagateDownloadFile::startDownload()
         }
 
         // Remove the temporary, if empty.
-        if (_resumeStart == 0) {
+        if (_resumeStart == 0 && _completedSegmentBytes == 0) {
             _tmpFile.remove();
         }
 
         return;
     }
 
+    if (_segmentedDownload) {
+        // The segments are written at their offset in the preallocated file
+        if (_tmpFile.size() != _item->_size && !_tmpFile.resize(_item->_size)) {
+            qCWarning(lcPropagateDownload) << "could not preallocate temporary file" << _tmpFile.fileName();
+            done(SyncFileItem::NormalError, _tmpFile.errorString(), ErrorCategory::GenericError);
+            return;
+        }
+        _tmpFile.close();
+        saveSegmentedDownloadInfo();
+        startSegmentedDownload();
+        return;
+    }
+
     {
         SyncJournalDb::DownloadInfo pi;
         pi._etag = _item->_etag;
@@ -751,17 +761,227 @@ void PropagateDownloadFile::startDownload()
             url,
             &_tmpFile, headers, expectedEtagForResume, _resumeStart, this);
     }
-    _job->setBandwidthManager(&propagator()->_bandwidthManager);
+    _job->setBandwidthManager(propagator()->bandwidthManager());
     connect(_job.data(), &GETFileJob::finishedSignal, this, &PropagateDownloadFile::slotGetFinished);
     connect(_job.data(), &GETFileJob::downloadProgress, this, &PropagateDownloadFile::slotDownloadProgress);
     propagator()->_activeJobList.append(this);
     _job->start();
 }
 
+bool PropagateDownloadFile::canDownloadInSegments() const
+{
+    const auto &options = propagator()->syncOptions();
+    return options._maxParallelDownloadSegments > 1
+        && options._downloadSegmentSize > 0
+        && _item->_size > options._downloadSegmentSize
+        && !isEncrypted() // decryption needs the data in order
+        && _item->_directDownloadUrl.isEmpty()
+        && !_segmentedDownloadRejected;
+}
+
+void PropagateDownloadFile::startSegmentedDownload()
+{
+    const auto segmentSize = propagator()->syncOptions()._downloadSegmentSize;
+    const auto addPending = [this, segmentSize](qint64 from, qint64 to) {
+        for (auto start = from; start < to; start += segmentSize) {
+            _pendingSegments.append({ start, qMin(start + segmentSize, to) });
+        }
+    };
+
+    std::sort(_completedSegments.begin(), _completedSegments.end());
+    _pendingSegments.clear();
+    qint64 position = 0;
+    for (const auto &segment : std::as_const(_completedSegments)) {
+        addPending(position, segment.first);
+        position = qMax(position, segment.second);
+    }
+    addPending(position, _item->_size);
+
+    qCInfo(lcPropagateDownload) << "Downloading" << _item->_file << "in" << _pendingSegments.size() << "segments,"
+                                << _completedSegmentBytes << "bytes are already complete";
+    propagator()->reportProgress(*_item, _completedSegmentBytes);
+    startNextSegment();
+}
+
+void PropagateDownloadFile::startNextSegment()
+{
+    const auto maxParallelSegments = propagator()->syncOptions()._maxParallelDownloadSegments;
+
+    // The first segment runs in the slot the scheduler gave to this job, the others
+    // only if the propagator has room for more transfers.
+    while (!_pendingSegments.isEmpty()
+        && _runningSegments.size() < maxParallelSegments
+        && (_runningSegments.isEmpty() || propagator()->_activeJobList.count() < propagator()->maximumActiveTransferJob())) {
+        const auto segment = _pendingSegments.takeFirst();
+
+        auto device = new QFile(_tmpFile.fileName());
+        if (!device->open(QIODevice::ReadWrite | QIODevice::Unbuffered) || !device->seek(segment.first)) {
+            qCWarning(lcPropagateDownload) << "could not open temporary file" << _tmpFile.fileName() << "at" << segment.first;
+            const auto errorString = device->errorString();
+            delete device;
+            abortRunningSegments();
+            done(SyncFileItem::NormalError, errorString, ErrorCategory::GenericError);
+            return;
+        }
+
+        auto job = new GETFileJob(propagator()->account(),
+            propagator()->fullRemotePath(_item->_file),
+            device, {}, _item->_etag, segment.first, this);
+        device->setParent(job);
+        job->setRangeEnd(segment.second - 1);
+        job->setBandwidthManager(propagator()->bandwidthManager());
+        connect(job, &GETFileJob::finishedSignal, this, &PropagateDownloadFile::slotSegmentFinished);
+        connect(job, &GETFileJob::downloadProgress, this, &PropagateDownloadFile::slotSegmentProgress);
+        _runningSegments.insert(job, RunningSegment{ segment.first, segment.second - segment.first, 0, device });
+        propagator()->_activeJobList.append(this);
+        job->start();
+    }
+}
+
+void PropagateDownloadFile::abortRunningSegments()
+{
+    for (auto it = _runningSegments.cbegin(); it != _runningSegments.cend(); ++it) {
+        disconnect(it.key(), nullptr, this, nullptr);
+        it.key()->cancel();
+        propagator()->_activeJobList.removeOne(this);
+    }
+    _runningSegments.clear();
+    _pendingSegments.clear();
+    _downloadProgress = 0;
+}
+
+void PropagateDownloadFile::saveSegmentedDownloadInfo()
+{
+    // Merge adjacent segments to keep the list short
+    std::sort(_completedSegments.begin(), _completedSegments.end());
+    QVector<QPair<qint64, qint64>> merged;
+    for (const auto &segment : std::as_const(_completedSegments)) {
+        if (!merged.isEmpty() && segment.first <= merged.last().second) {
+            merged.last().second = qMax(merged.last().second, segment.second);
+        } else {
+            merged.append(segment);
+        }
+    }
+    _completedSegments = merged;
+
+    SyncJournalDb::DownloadInfo pi;
+    pi._etag = _item->_etag;
+    pi._tmpfile = _tmpFileName;
+    pi._valid = true;
+    pi._segmented = true;
+    pi._completedRanges = _completedSegments;
+    propagator()->_journal->setDownloadInfo(_item->_file, pi);
+    propagator()->_journal->commit("download segment");
+}
+
+void PropagateDownloadFile::slotSegmentFinished()
+{
+    auto job = qobject_cast<GETFileJob *>(sender());
+    ASSERT(job);
+    if (!_runningSegments.contains(job)) {
+        return;
+    }
+
+    propagator()->_activeJobList.removeOne(this);
+    const auto segment = _runningSegments.take(job);
+    const auto written = segment.device->pos() - segment.start;
+    segment.device->close();
+
+    _item->_httpErrorCode = job->reply()->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    _item->_requestId = job->requestId();
+
+    if (job->rangeRequestRejected()) {
+        qCWarning(lcPropagateDownload) << "server does not support range requests, downloading" << _item->_file << "in one piece";
+        abortRunningSegments();
+        FileSystem::remove(_tmpFile.fileName());
+        propagator()->_journal->setDownloadInfo(_item->_file, SyncJournalDb::DownloadInfo());
+        _segmentedDownloadRejected = true;
+        startDownload();
+        return;
+    }
+
+    QNetworkReply::NetworkError err = job->reply()->error();
+    if (err != QNetworkReply::NoError) {
+        abortRunningSegments();
+
+        const bool badRangeHeader = _item->_httpErrorCode == 416;
+        const bool fileNotFound = _item->_httpErrorCode == 404;
+        if (badRangeHeader || fileNotFound) {
+            qCWarning(lcPropagateDownload) << "server replied" << _item->_httpErrorCode << "to segment" << segment.start << "of" << _item->_file;
+            FileSystem::remove(_tmpFile.fileName());
+            propagator()->_journal->setDownloadInfo(_item->_file, SyncJournalDb::DownloadInfo());
+        }
+
+        if (badRangeHeader) {
+            propagator()->_anotherSyncNeeded = true;
+            job->setErrorStatus(SyncFileItem::SoftError);
+        } else if (fileNotFound) {
+            job->setErrorString(tr("File was deleted from server"));
+            job->setErrorStatus(SyncFileItem::SoftError);
+            propagator()->_journal->schedulePathForRemoteDiscovery(_item->_file);
+        }
+
+        QByteArray errorBody;
+        QString errorString = _item->_httpErrorCode >= 400 ? job->errorStringParsingBody(&errorBody)
+                                                           : job->errorString();
+        SyncFileItem::Status status = job->errorStatus();
+        if (status == SyncFileItem::NoStatus) {
+            status = classifyError(err, _item->_httpErrorCode,
+                &propagator()->_anotherSyncNeeded, errorBody);
+        }
+
+        done(status, errorString, errorCategoryFromNetworkError(err));
+        return;
+    }
+
+    if (written != segment.size) {
+        qCWarning(lcPropagateDownload) << "segment" << segment.start << "of" << _item->_file << "got" << written << "of" << segment.size << "bytes";
+        abortRunningSegments();
+        propagator()->_anotherSyncNeeded = true;
+        done(SyncFileItem::SoftError, tr("The file could not be downloaded completely."), ErrorCategory::GenericError);
+        return;
+    }
+
+    _completedSegments.append({ segment.start, segment.start + segment.size });
+    _completedSegmentBytes += segment.size;
+    saveSegmentedDownloadInfo();
+
+    if (!_pendingSegments.isEmpty() || !_runningSegments.isEmpty()) {
+        startNextSegment();
+        return;
+    }
+
+    updateItemFromReply(job);
+
+    if (_tmpFile.size() != _item->_size) {
+        qCWarning(lcPropagateDownload) << "segmented download of" << _item->_file << "has size" << _tmpFile.size() << "instead of" << _item->_size;
+        propagator()->_anotherSyncNeeded = true;
+        done(SyncFileItem::SoftError, tr("The file could not be downloaded completely."), ErrorCategory::GenericError);
+        return;
+    }
+
+    validateDownloadedFile(job->reply());
+}
+
+void PropagateDownloadFile::slotSegmentProgress(qint64 received, qint64)
+{
+    const auto it = _runningSegments.find(qobject_cast<GETFileJob *>(sender()));
+    if (it == _runningSegments.end()) {
+        return;
+    }
+    it->progress = received;
+
+    _downloadProgress = 0;
+    for (const auto &segment : std::as_const(_runningSegments)) {
+        _downloadProgress += segment.progress;
+    }
+    propagator()->reportProgress(*_item, _completedSegmentBytes + _downloadProgress);
+}
+
 qint64 PropagateDownloadFile::committedDiskSpace() const
 {
     if (_state == Running) {
-        return qBound(0LL, _item->_size - _resumeStart - _downloadProgress, _item->_size);
+        return qBound(0LL, _item->_size - _resumeStart - _completedSegmentBytes - _downloadProgress, _item->_size);
     }
     return 0;
 }
@@ -854,22 +1074,7 @@ void PropagateDownloadFile::slotGetFinished()
         return;
     }
 
-    _item->_responseTimeStamp = job->responseTimestamp();
-
-    if (!job->etag().isEmpty()) {
-        // The etag will be empty if we used a direct download URL.
-        // (If it was really empty by the server, the GETFileJob will have errored
-        _item->_etag = parseEtag(job->etag());
-    }
-    if (job->lastModified()) {
-        // It is possible that the file was modified on the server since we did the discovery phase
-        // so make sure we have the up-to-date time
-        _item->_modtime = job->lastModified();
-        Q_ASSERT(_item->_modtime > 0);
-        if (_item->_modtime <= 0) {
-            qCWarning(lcPropagateDownload()) << "invalid modified time" << _item->_file << _item->_modtime;
-        }
-    }
+    updateItemFromReply(job);
 
     _tmpFile.close();
     _tmpFile.flush();
@@ -916,19 +1121,44 @@ void PropagateDownloadFile::slotGetFinished()
         return;
     }
 
+    validateDownloadedFile(job->reply());
+}
+
+void PropagateDownloadFile::updateItemFromReply(GETFileJob *job)
+{
+    _item->_responseTimeStamp = job->responseTimestamp();
+
+    if (!job->etag().isEmpty()) {
+        // The etag will be empty if we used a direct download URL.
+        // (If it was really empty by the server, the GETFileJob will have errored
+        _item->_etag = parseEtag(job->etag());
+    }
+    if (job->lastModified()) {
+        // It is possible that the file was modified on the server since we did the discovery phase
+        // so make sure we have the up-to-date time
+        _item->_modtime = job->lastModified();
+        Q_ASSERT(_item->_modtime > 0);
+        if (_item->_modtime <= 0) {
+            qCWarning(lcPropagateDownload()) << "invalid modified time" << _item->_file << _item->_modtime;
+        }
+    }
+}
+
+void PropagateDownloadFile::validateDownloadedFile(QNetworkReply *reply)
+{
     // Did the file come with conflict headers? If so, store them now!
     // If we download conflict files but the server doesn't send conflict
     // headers, the record will be established by SyncEngine::conflictRecordMaintenance.
     // (we can't reliably determine the file id of the base file here,
     // it might still be downloaded in a parallel job and not exist in
     // the database yet!)
-    if (job->reply()->rawHeader("OC-Conflict") == "1") {
+    if (reply->rawHeader("OC-Conflict") == "1") {
         _conflictRecord.path = _item->_file.toUtf8();
-        _conflictRecord.initialBasePath = job->reply()->rawHeader("OC-ConflictInitialBasePath");
-        _conflictRecord.baseFileId = job->reply()->rawHeader("OC-ConflictBaseFileId");
-        _conflictRecord.baseEtag = job->reply()->rawHeader("OC-ConflictBaseEtag");
+        _conflictRecord.initialBasePath = reply->rawHeader("OC-ConflictInitialBasePath");
+        _conflictRecord.baseFileId = reply->rawHeader("OC-ConflictBaseFileId");
+        _conflictRecord.baseEtag = reply->rawHeader("OC-ConflictBaseEtag");
 
-        auto mtimeHeader = job->reply()->rawHeader("OC-ConflictBaseMtime");
+        auto mtimeHeader = reply->rawHeader("OC-ConflictBaseMtime");
         if (!mtimeHeader.isEmpty())
             _conflictRecord.baseModtime = mtimeHeader.toLongLong();
 
@@ -945,8 +1175,9 @@ void PropagateDownloadFile::slotGetFinished()
         this, &PropagateDownloadFile::transmissionChecksumValidated);
     connect(validator, &ValidateChecksumHeader::validationFailed,
         this, &PropagateDownloadFile::slotChecksumFail);
-    auto checksumHeader = findBestChecksum(job->reply()->rawHeader(checkSumHeaderC));
-    auto contentMd5Header = job->reply()->rawHeader(contentMd5HeaderC);
+    auto checksumHeader = findBestChecksum(reply->rawHeader(checkSumHeaderC));
+    // The Content-MD5 of a ranged reply only covers the range
+    auto contentMd5Header = _segmentedDownload ? QByteArray() : reply->rawHeader(contentMd5HeaderC);
     if (checksumHeader.isEmpty() && !contentMd5Header.isEmpty())
         checksumHeader = "MD5:" + contentMd5Header;
     validator->start(_tmpFile.fileName(), checksumHeader);
@@ -1415,6 +1646,11 @@ void PropagateDownloadFile::abort(PropagatorJob::AbortType abortType)
 {
     if (_job && _job->reply())
         _job->reply()->abort();
+    for (auto it = _runningSegments.cbegin(); it != _runningSegments.cend(); ++it) {
+        if (it.key()->reply()) {
+            it.key()->reply()->abort();
+        }
+    }
 
     if (abortType == AbortType::Asynchronous) {
         emit abortFinished();
@@ -46,9 +46,6 @@ class OWNCLOUDSYNC_EXPORT GETFileJob : public AbstractNetworkJob
     SyncFileItem::Status _errorStatus;
     QUrl _directDownloadUrl;
     QByteArray _etag;
-    bool _bandwidthLimited; // if _bandwidthQuota will be used
-    bool _bandwidthChoked; // if download is paused (won't read on readyRead())
-    qint64 _bandwidthQuota;
     QPointer<BandwidthManager> _bandwidthManager;
     bool _hasEmittedFinishedSignal;
     time_t _lastModified;
@@ -56,6 +53,10 @@ class OWNCLOUDSYNC_EXPORT GETFileJob : public AbstractNetworkJob
     /// Will be set to true once we've seen a 2xx response header
     bool _saveBodyToFile = false;
 
+    /// Last byte of a bounded range request, -1 to download until the end
+    qint64 _rangeEnd = -1;
+    bool _rangeRequestRejected = false;
+
 protected:
     qint64 _contentLength;
 
@@ -97,10 +98,6 @@ public:
     void newReplyHook(QNetworkReply *reply) override;
 
     void setBandwidthManager(BandwidthManager *bwm);
-    void setChoked(bool c);
-    void setBandwidthLimited(bool b);
-    void giveBandwidthQuota(qint64 q);
-    qint64 currentDownloadPosition();
 
     [[nodiscard]] QString errorString() const override;
     void setErrorString(const QString &s) { _errorString = s; }
@@ -118,6 +115,16 @@ public:
     [[nodiscard]] qint64 expectedContentLength() const { return _expectedContentLength; }
     void setExpectedContentLength(qint64 size) { _expectedContentLength = size; }
 
+    /** Only request the bytes from resumeStart up to and including end.
+     *
+     * Unlike for an open range, the job can't fall back to downloading the whole
+     * file if the server ignores the range: it fails and rangeRequestRejected()
+     * returns true.
+     */
+    void setRangeEnd(qint64 end) { _rangeEnd = end; }
+    [[nodiscard]] qint64 rangeEnd() const { return _rangeEnd; }
+    [[nodiscard]] bool rangeRequestRejected() const { return _rangeRequestRejected; }
+
 protected:
     virtual qint64 writeToDevice(const QByteArray &data);
 
@@ -176,8 +183,13 @@ private:
     +-> startDownload() <--------------------------+
           |                                        |
           +-> run a GETFileJob                     | checksum identical?
+          |                                        |
+          |  or for large files, if enabled:       |
+          +-> startNextSegment()                   |
+                run GETFileJobs for byte ranges    |
                                                    |
       done?-> slotGetFinished()                    |
+         or   slotSegmentFinished() for the last   |
                 |                                  |
                 +-> validate checksum header       |
                                                    |
@@ -228,6 +240,8 @@ private slots:
     void startDownload();
     /// Called when the GETFileJob finishes
     void slotGetFinished();
+    /// Called when the GETFileJob of one segment of a segmented download finishes
+    void slotSegmentFinished();
     /// Called when the download's checksum header was validated
     void transmissionChecksumValidated(const QByteArray &checksumType, const QByteArray &checksum);
     /// Called when the download's checksum computation is done
@@ -242,6 +256,7 @@ private slots:
 
     void abort(PropagatorJob::AbortType abortType) override;
     void slotDownloadProgress(qint64, qint64);
+    void slotSegmentProgress(qint64, qint64);
     void slotChecksumFail(const QString &errMsg, const QByteArray &calculatedChecksumType,
         const QByteArray &calculatedChecksum, const ValidateChecksumHeader::FailureReason reason);
     void processChecksumRecalculate(const QNetworkReply *reply, const QByteArray &originalChecksumHeader, const QString &errorMessage);
@@ -252,10 +267,43 @@ private:
     void deleteExistingFolder();
     [[nodiscard]] bool isEncrypted() const { return _isEncrypted; }
 
+    /// Takes the etag and modification time of a successful reply
+    void updateItemFromReply(GETFileJob *job);
+    /// Stores the conflict headers and validates the checksum header of the complete download
+    void validateDownloadedFile(QNetworkReply *reply);
+
+    /// Whether the file is large enough and allowed to be downloaded as several ranges in parallel
+    [[nodiscard]] bool canDownloadInSegments() const;
+    /// Splits everything that isn't in _completedSegments into segments and starts them
+    void startSegmentedDownload();
+    /// Starts pending segments while the propagator has room for more transfers
+    void startNextSegment();
+    /// Cancels the running segments without processing their results
+    void abortRunningSegments();
+    /// Records the completed segments in the DownloadInfo so they are kept on resume
+    void saveSegmentedDownloadInfo();
+
+    struct RunningSegment
+    {
+        qint64 start = 0;
+        qint64 size = 0;
+        qint64 progress = 0;
+        QIODevice *device = nullptr; // owned by the job
+    };
+
     qint64 _resumeStart = 0;
     qint64 _downloadProgress = 0;
     QPointer<GETFileJob> _job;
     QFile _tmpFile;
+    QString _tmpFileName; // relative to the sync folder
+
+    bool _segmentedDownload = false;
+    bool _segmentedDownloadRejected = false; // the server ignored our ranges
+    QHash<GETFileJob *, RunningSegment> _runningSegments;
+    QVector<QPair<qint64, qint64>> _pendingSegments; // [start, end)
+    QVector<QPair<qint64, qint64>> _completedSegments; // [start, end)
+    qint64 _completedSegmentBytes = 0;
+
     bool _deleteExisting = false;
     bool _isEncrypted = false;
     FolderMetadata::EncryptedFile _encryptedInfo;
@@ -338,9 +338,24 @@ void PropagateUploadFileCommon::slotComputeContentChecksum()
         return;
     }
 
+    // Hash the data while it is uploaded instead of reading the file twice
+    if (!checksumType.isEmpty() && canChecksumWhileUploading()) {
+        auto uploadChecksum = std::make_shared<UploadChecksum>(_fileToUpload._path, checksumType);
+        if (uploadChecksum->isValid()) {
+            qCInfo(lcPropagateUpload) << "Computing the" << checksumType << "checksum of" << _item->_file << "while uploading";
+            _uploadChecksum = std::move(uploadChecksum);
+            _item->_checksumHeader.clear();
+            slotStartUpload(QByteArray(), QByteArray());
+            return;
+        }
+    }
+
     // Compute the content checksum.
     auto computeChecksum = new ComputeChecksum(this);
     computeChecksum->setChecksumType(checksumType);
+    if (propagator()->syncOptions()._checksumCache && !_uploadingEncrypted) {
+        computeChecksum->setChecksumCache(propagator()->_journal);
+    }
 
     connect(computeChecksum, &ComputeChecksum::done,
         this, &PropagateUploadFileCommon::slotComputeTransmissionChecksum);
@@ -436,6 +451,21 @@ void PropagateUploadFileCommon::slotStartUpload(const QByteArray &transmissionCh
     doStartUpload();
 }
 
+void PropagateUploadFileCommon::setUploadedChecksum(const QByteArray &checksumType, const QByteArray &checksum)
+{
+    _item->_checksumHeader = makeChecksumHeader(checksumType, checksum);
+
+    // Same choice as slotComputeTransmissionChecksum(): the transmission checksum
+    // type is the preferred one unless checksums for uploads are disabled
+    const auto supportedTransmissionChecksums =
+        propagator()->account()->capabilities().supportedChecksumTypes();
+    if (supportedTransmissionChecksums.contains(checksumType) || uploadChecksumEnabled()) {
+        _transmissionChecksumHeader = _item->_checksumHeader;
+    } else {
+        _transmissionChecksumHeader.clear();
+    }
+}
+
 void PropagateUploadFileCommon::slotFolderUnlocked(const QByteArray &folderId, int httpReturnCode)
 {
     if (_uploadStatus.status == SyncFileItem::NoStatus && httpReturnCode != 200) {
@@ -457,13 +487,100 @@ void PropagateUploadFileCommon::slotOnErrorStartFolderUnlock(SyncFileItem::Statu
     }
 }
 
+UploadChecksum::UploadChecksum(const QString &filePath, const QByteArray &checksumType)
+    : _filePath(filePath)
+    , _checksumType(checksumType)
+    , _calculator(checksumType)
+{
+}
+
+void UploadChecksum::addData(qint64 offset, const char *data, qint64 size)
+{
+    QMutexLocker locker(&_mutex);
+    addDataLocked(offset, data, size);
+}
+
+qint64 UploadChecksum::hashedSize() const
+{
+    QMutexLocker locker(&_mutex);
+    return _hashedSize;
+}
+
+void UploadChecksum::addDataLocked(qint64 offset, const char *data, qint64 size)
+{
+    if (size <= 0 || offset + size <= _hashedSize) {
+        // Seen already, e.g. the device was rewound to resend the data
+        return;
+    }
+
+    if (offset > _hashedSize) {
+        if (_pendingSize + size <= maxPendingSize && !_pending.contains(offset)) {
+            _pending.insert(offset, QByteArray(data, size));
+            _pendingSize += size;
+        }
+        return;
+    }
+
+    hash(offset, data, size);
+
+    // The gap before some of the blocks that were read ahead may be filled now
+    while (!_pending.isEmpty() && _pending.firstKey() <= _hashedSize) {
+        const auto blockOffset = _pending.firstKey();
+        const auto block = _pending.take(blockOffset);
+        _pendingSize -= block.size();
+        if (blockOffset + block.size() > _hashedSize) {
+            hash(blockOffset, block.constData(), block.size());
+        }
+    }
+}
+
+void UploadChecksum::hash(qint64 offset, const char *data, qint64 size)
+{
+    Q_ASSERT(offset <= _hashedSize && offset + size > _hashedSize);
+    const auto seen = _hashedSize - offset;
+    _calculator.addData(data + seen, size - seen);
+    _hashedSize = offset + size;
+}
+
+QByteArray UploadChecksum::finish(qint64 fileSize)
+{
+    QMutexLocker locker(&_mutex);
+    if (_hashedSize < fileSize) {
+        qCInfo(lcPropagateUpload) << "Reading" << _filePath << "from" << _hashedSize
+                                  << "to complete the checksum," << _pendingSize << "bytes are kept from the upload";
+
+        QFile file(_filePath);
+        QString openError;
+        if (!FileSystem::openAndSeekFileSharedRead(&file, &openError, _hashedSize)) {
+            qCWarning(lcPropagateUpload) << "Could not open" << _filePath << "to complete the checksum:" << openError;
+            return {};
+        }
+
+        constexpr qint64 bufferSize = 500 * 1024;
+        QByteArray buffer(bufferSize, Qt::Uninitialized);
+        while (_hashedSize < fileSize) {
+            // Blocks that were read ahead are skipped
+            if (file.pos() != _hashedSize && !file.seek(_hashedSize)) {
+                qCWarning(lcPropagateUpload) << "Could not seek in" << _filePath << file.errorString();
+                return {};
+            }
+            const auto sizeRead = file.read(buffer.data(), qMin(bufferSize, fileSize - _hashedSize));
+            if (sizeRead <= 0) {
+                qCWarning(lcPropagateUpload) << "Could not read" << _filePath << "to complete the checksum:" << file.errorString();
+                return {};
+            }
+            addDataLocked(_hashedSize, buffer.constData(), sizeRead);
+        }
+    }
+    return _calculator.result();
+}
+
 UploadDevice::UploadDevice(const QString &fileName, qint64 start, qint64 size, BandwidthManager *bwm)
     : _file(fileName)
     , _start(start)
     , _size(size)
     , _bandwidthManager(bwm)
 {
-    _bandwidthManager->registerUploadDevice(this);
 }
 
 
@@ -520,15 +637,11 @@ qint64 UploadDevice::readData(char *data, qint64 maxlen)
     if (maxlen <= 0) {
         return 0;
     }
-    if (isChoked()) {
-        return 0;
-    }
-    if (isBandwidthLimited()) {
-        maxlen = qMin(maxlen, _bandwidthQuota);
-        if (maxlen <= 0) { // no quota
+    if (_bandwidthManager && isBandwidthLimited()) {
+        maxlen = _bandwidthManager->takeUploadQuota(this, maxlen);
+        if (maxlen <= 0) { // no quota, the manager emits readyRead() later on
             return 0;
         }
-        _bandwidthQuota -= maxlen;
     }
 
     auto c = _file.read(data, maxlen);
@@ -536,18 +649,13 @@ qint64 UploadDevice::readData(char *data, qint64 maxlen)
         setErrorString(_file.errorString());
         return -1;
     }
+    if (_checksum) {
+        _checksum->addData(_start + _read, data, c);
+    }
     _read += c;
     return c;
 }
 
-void UploadDevice::slotJobUploadProgress(qint64 sent, qint64 t)
-{
-    if (sent == 0 || t == 0) {
-        return;
-    }
-    _readWithProgress = sent;
-}
-
 bool UploadDevice::atEnd() const
 {
     return _read >= _size;
@@ -582,26 +690,15 @@ bool UploadDevice::seek(qint64 pos)
     return true;
 }
 
-void UploadDevice::giveBandwidthQuota(qint64 bwq)
-{
-    if (!atEnd()) {
-        _bandwidthQuota = bwq;
-        QMetaObject::invokeMethod(this, "readyRead", Qt::QueuedConnection); // tell QNAM that we have quota
-    }
-}
-
 void UploadDevice::setBandwidthLimited(bool b)
 {
     _bandwidthLimited = b;
     QMetaObject::invokeMethod(this, "readyRead", Qt::QueuedConnection);
 }
 
-void UploadDevice::setChoked(bool b)
+void UploadDevice::setChecksum(const std::shared_ptr<UploadChecksum> &checksum)
 {
-    _choked = b;
-    if (!_choked) {
-        QMetaObject::invokeMethod(this, "readyRead", Qt::QueuedConnection);
-    }
+    _checksum = checksum;
 }
 
 void PropagateUploadFileCommon::startPollJob(const QString &path)
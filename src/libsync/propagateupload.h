@@ -15,10 +15,16 @@
 
 #include "owncloudpropagator.h"
 #include "networkjobs.h"
+#include "common/checksumcalculator.h"
 
 #include <QBuffer>
 #include <QFile>
 #include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QMap>
+#include <QMutex>
+
+#include <memory>
 
 
 namespace OCC {
@@ -30,11 +36,61 @@ Q_DECLARE_LOGGING_CATEGORY(lcPropagateUploadNG)
 
 class BandwidthManager;
 
+/**
+ * @brief Computes the checksum of a file from the data that is read for its upload
+ *
+ * The UploadDevices of the file pass every block they read to addData().
+ * Blocks are hashed in file order. Blocks that are read ahead of the hashed
+ * part, like the ones of chunks uploaded in parallel, are kept until the gap
+ * is filled, up to maxPendingSize bytes. finish() reads whatever was not seen
+ * that way from disk, e.g. the part of a resumed upload that is already on
+ * the server.
+ *
+ * addData() may be called from any thread.
+ * @ingroup libsync
+ */
+class UploadChecksum
+{
+public:
+    UploadChecksum(const QString &filePath, const QByteArray &checksumType);
+
+    [[nodiscard]] bool isValid() const { return _calculator.isValid(); }
+    [[nodiscard]] QByteArray checksumType() const { return _checksumType; }
+
+    /** Hashes the size bytes at offset of the file, if they continue the hashed part. */
+    void addData(qint64 offset, const char *data, qint64 size);
+
+    /** Number of bytes at the start of the file that were hashed. */
+    [[nodiscard]] qint64 hashedSize() const;
+
+    /**
+     * Returns the checksum of the first fileSize bytes of the file, reading
+     * the missing parts from disk. Blocks; run it in a thread.
+     *
+     * Returns an empty checksum if the file could not be read.
+     */
+    QByteArray finish(qint64 fileSize);
+
+    static constexpr qint64 maxPendingSize = 16 * 1024 * 1024;
+
+private:
+    void addDataLocked(qint64 offset, const char *data, qint64 size);
+    void hash(qint64 offset, const char *data, qint64 size);
+
+    QString _filePath;
+    QByteArray _checksumType;
+    ChecksumCalculator _calculator;
+    mutable QMutex _mutex;
+    qint64 _hashedSize = 0;
+    QMap<qint64, QByteArray> _pending; // blocks read ahead of _hashedSize, by offset
+    qint64 _pendingSize = 0;
+};
+
 /**
  * @brief The UploadDevice class
  * @ingroup libsync
  */
-class UploadDevice : public QIODevice
+class OWNCLOUDSYNC_EXPORT UploadDevice : public QIODevice
 {
     Q_OBJECT
 public:
@@ -52,11 +108,12 @@ public:
     [[nodiscard]] bool isSequential() const override;
     bool seek(qint64 pos) override;
 
+    /** Whether reads take quota from the BandwidthManager, true by default */
     void setBandwidthLimited(bool);
     bool isBandwidthLimited() { return _bandwidthLimited; }
-    void setChoked(bool);
-    bool isChoked() { return _choked; }
-    void giveBandwidthQuota(qint64 bwq);
+
+    /** Passes the data that is read to checksum. */
+    void setChecksum(const std::shared_ptr<UploadChecksum> &checksum);
 
 signals:
 
@@ -73,13 +130,9 @@ private:
 
     // Bandwidth manager related
     QPointer<BandwidthManager> _bandwidthManager;
-    qint64 _bandwidthQuota = 0;
-    qint64 _readWithProgress = 0;
-    bool _bandwidthLimited = false; // if _bandwidthQuota will be used
-    bool _choked = false; // if upload is paused (readData() will return 0)
-    friend class BandwidthManager;
-public slots:
-    void slotJobUploadProgress(qint64 sent, qint64 t);
+    bool _bandwidthLimited = true;
+
+    std::shared_ptr<UploadChecksum> _checksum;
 };
 
 /**
@@ -237,6 +290,9 @@ protected:
     UploadFileInfo _fileToUpload;
     QByteArray _transmissionChecksumHeader;
 
+    /// Set while the content checksum is computed from the uploaded data, see canChecksumWhileUploading()
+    std::shared_ptr<UploadChecksum> _uploadChecksum;
+
 public:
     PropagateUploadFileCommon(OwncloudPropagator *propagator, const SyncFileItemPtr &item);
 
@@ -316,6 +372,17 @@ protected:
 
     /** Bases headers that need to be sent on the PUT, or in the MOVE for chunking-ng */
     QMap<QByteArray, QByteArray> headers();
+
+    /**
+     * Whether the content checksum may be computed from the data that is
+     * read for the upload, see SyncOptions::_checksumWhileUploading.
+     *
+     * Only possible if the checksum is sent after the data.
+     */
+    [[nodiscard]] virtual bool canChecksumWhileUploading() const { return false; }
+
+    /** Sets the content and the transmission checksum once _uploadChecksum is complete */
+    void setUploadedChecksum(const QByteArray &checksumType, const QByteArray &checksum);
 private:
   PropagateUploadEncrypted *_uploadEncryptedHelper = nullptr;
   bool _uploadingEncrypted = false;
@@ -390,6 +457,9 @@ public:
 public slots:
     void abort(OCC::PropagateUploadFileNG::AbortType abortType) override;
 
+protected:
+    [[nodiscard]] bool canChecksumWhileUploading() const override;
+
 private slots:
     void slotPropfindFinished();
     void slotPropfindFinishedWithError();
@@ -399,6 +469,7 @@ private slots:
     void slotPutFinished();
     void slotMoveJobFinished();
     void slotUploadProgress(qint64, qint64);
+    void slotUploadChecksumFinished();
 
 private:
     // Map chunk number with its size  from the PROPFIND on resume.
@@ -408,20 +479,43 @@ private:
         QString originalName;
     };
 
+    // A chunk PUT that is currently in flight
+    struct RunningChunk {
+        qint64 size = 0LL; /// size of the chunk
+        qint64 progress = 0LL; /// bytes of the chunk that were sent so far
+        int parallelism = 1; /// number of chunks of this file in flight when it was started
+    };
+
     [[nodiscard]] QUrl chunkUploadFolderUrl() const;
     [[nodiscard]] QUrl chunkUrl(const int chunk) const;
     [[nodiscard]] QByteArray destinationHeader() const;
 
+    /** How many chunks of this file may be uploaded concurrently.
+     *
+     * Bounded by SyncOptions::_maxParallelChunkUploads and by the server
+     * capabilities. The propagator's transfer window still applies on top.
+     */
+    [[nodiscard]] int maxParallelChunks() const;
+
     void startNewUpload();
     void startNextChunk();
     void finishUpload();
+    void adjustChunkSize(const PUTFileJob *job, const RunningChunk &chunk);
 
     QMap<qint64, ServerChunkInfo> _serverChunks;
 
-    qint64 _sent = 0; /// amount of data (bytes) that was already sent
+    // Chunks that were started but not acknowledged by the server yet.
+    // When resuming, the server side chunks after the first hole are removed,
+    // so a failure with several chunks in flight only loses the later ones.
+    QHash<const PUTFileJob *, RunningChunk> _runningChunks;
+
+    // Completes _uploadChecksum before the MOVE
+    QFutureWatcher<QByteArray> _uploadChecksumWatcher;
+
+    qint64 _sent = 0; /// amount of data (bytes) that was already handed to PUT jobs
+    qint64 _confirmed = 0; /// amount of data (bytes) the server acknowledged
     uint _transferId = 0; /// transfer id (part of the url)
     int _currentChunk = 1; /// Id of the next chunk that will be sent
-    qint64 _currentChunkSize = 0; /// current chunk size
     bool _removeJobError = false; /// If not null, there was an error removing the job
 };
 }
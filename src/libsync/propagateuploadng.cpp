@@ -30,8 +30,10 @@
 #include <QNetworkAccessManager>
 #include <QFileInfo>
 #include <QDir>
+#include <qtconcurrentrun.h>
 #include <cmath>
 #include <cstring>
+#include <utility>
 
 namespace OCC {
 
@@ -82,6 +84,13 @@ QUrl PropagateUploadFileNG::chunkUrl(const int chunk) const
     |
     +-> MOVE ------> moveJobFinished() ---> finalize()
 
+  When the checksum is computed while uploading (see canChecksumWhileUploading()),
+  finishUpload() first completes it in a thread and sends the MOVE from
+  slotUploadChecksumFinished().
+
+  When parallel chunk uploads are enabled (see maxParallelChunks()), startNextChunk()
+  starts further chunks while the propagator has room for more transfers. The MOVE is
+  only sent once every chunk PUT was acknowledged.
 
  */
 
@@ -158,6 +167,7 @@ void PropagateUploadFileNG::slotPropfindFinished()
         _serverChunks.remove(_currentChunk);
         ++_currentChunk;
     }
+    _confirmed = _sent;
 
     if (_sent > _fileToUpload._size) {
         // Normally this can't happen because the size is xor'ed with the transfer id, and it is
@@ -256,6 +266,8 @@ void PropagateUploadFileNG::startNewUpload()
     }
     _transferId = uint(Utility::rand() ^ uint(_item->_modtime) ^ (uint(_fileToUpload._size) << 16) ^ qHash(_fileToUpload._file));
     _sent = 0;
+    _confirmed = 0;
+    _runningChunks.clear();
     _currentChunk = 1; // Chunked upload v2: numbers range from 1 to 10000
 
     propagator()->reportProgress(*_item, 0);
@@ -310,6 +322,17 @@ void PropagateUploadFileNG::finishUpload()
     Q_ASSERT(_jobs.isEmpty()); // There should be no running job anymore
     _finished = true;
 
+    if (_uploadChecksum) {
+        // The checksum is sent with the MOVE. Complete it with the data the upload didn't read.
+        connect(&_uploadChecksumWatcher, &QFutureWatcherBase::finished,
+            this, &PropagateUploadFileNG::slotUploadChecksumFinished, Qt::UniqueConnection);
+        propagator()->_activeJobList.append(this);
+        _uploadChecksumWatcher.setFuture(QtConcurrent::run([uploadChecksum = _uploadChecksum, fileSize = _fileToUpload._size] {
+            return uploadChecksum->finish(fileSize);
+        }));
+        return;
+    }
+
     // Finish with a MOVE
     // If we changed the file name, we must store the changed filename in the remote folder, not the original one.
     const auto destination = QDir::cleanPath(propagator()->account()->davUrl().path() + propagator()->fullRemotePath(_fileToUpload._file));
@@ -339,6 +362,52 @@ void PropagateUploadFileNG::finishUpload()
     return;
 }
 
+void PropagateUploadFileNG::slotUploadChecksumFinished()
+{
+    propagator()->_activeJobList.removeOne(this);
+    const auto uploadChecksum = std::exchange(_uploadChecksum, nullptr);
+    if (propagator()->_abortRequested) {
+        return;
+    }
+
+    const auto checksum = _uploadChecksumWatcher.result();
+    if (checksum.isEmpty()) {
+        abortWithError(SyncFileItem::SoftError, tr("Could not compute the checksum of the uploaded file."));
+        return;
+    }
+
+    // The checksum must describe the data that was uploaded
+    const QString fullFilePath(propagator()->fullLocalPath(_item->_file));
+    if (!FileSystem::verifyFileUnchanged(fullFilePath, _item->_size, _item->_modtime)) {
+        propagator()->_anotherSyncNeeded = true;
+        abortWithError(SyncFileItem::SoftError, tr("Local file changed during sync."));
+        return;
+    }
+
+    setUploadedChecksum(uploadChecksum->checksumType(), checksum);
+
+    // Keep the content checksum with the upload info, the server knows it after the MOVE
+    auto uploadInfo = propagator()->_journal->getUploadInfo(_item->_file);
+    uploadInfo._contentChecksum = _item->_checksumHeader;
+    propagator()->_journal->setUploadInfo(_item->_file, uploadInfo);
+    propagator()->_journal->commit("Upload info");
+
+    finishUpload();
+}
+
+bool PropagateUploadFileNG::canChecksumWhileUploading() const
+{
+    return propagator()->syncOptions()._checksumWhileUploading;
+}
+
+int PropagateUploadFileNG::maxParallelChunks() const
+{
+    if (propagator()->account()->capabilities().chunkingParallelUploadDisabled()) {
+        return 1;
+    }
+    return qMax(1, propagator()->syncOptions()._maxParallelChunkUploads);
+}
+
 void PropagateUploadFileNG::startNextChunk()
 {
     if (propagator()->_abortRequested)
@@ -347,15 +416,19 @@ void PropagateUploadFileNG::startNextChunk()
     const auto fileSize = _fileToUpload._size;
     ENFORCE(fileSize >= _sent, "Sent data exceeds file size")
     // prevent situation that chunk size is bigger then required one to send
-    _currentChunkSize = qMin(propagator()->_chunkSize, fileSize - _sent);
+    const auto currentChunkSize = qMin(propagator()->_chunkSize, fileSize - _sent);
 
-    if (_currentChunkSize == 0) {
+    if (currentChunkSize == 0) {
+        if (!_runningChunks.isEmpty()) {
+            // Everything is sent, wait for the remaining chunks before the MOVE
+            return;
+        }
         finishUpload();
         return;
     }
 
     const auto fileName = _fileToUpload._path;
-    auto device = std::make_unique<UploadDevice>(fileName, _sent, _currentChunkSize, &propagator()->_bandwidthManager);
+    auto device = std::make_unique<UploadDevice>(fileName, _sent, currentChunkSize, propagator()->bandwidthManager());
     if (!device->open(QIODevice::ReadOnly)) {
         qCWarning(lcPropagateUploadNG) << "Could not prepare upload device: " << device->errorString();
 
@@ -369,26 +442,69 @@ void PropagateUploadFileNG::startNextChunk()
         return;
     }
 
+    if (_uploadChecksum) {
+        device->setChecksum(_uploadChecksum);
+    }
+
     QMap<QByteArray, QByteArray> headers;
     headers["OC-Chunk-Offset"] = QByteArray::number(_sent);
     headers["Destination"] = destinationHeader();
 
-    _sent += _currentChunkSize;
+    _sent += currentChunkSize;
     const auto url = chunkUrl(_currentChunk);
 
     // job takes ownership of device via a QScopedPointer. Job deletes itself when finishing
-    const auto devicePtr = device.get(); // for connections later
     const auto job = new PUTFileJob(propagator()->account(), url, std::move(device), headers, _currentChunk, this);
     _jobs.append(job);
+    _runningChunks.insert(job, RunningChunk{currentChunkSize, 0, static_cast<int>(_runningChunks.size()) + 1});
     connect(job, &PUTFileJob::finishedSignal, this, &PropagateUploadFileNG::slotPutFinished);
     connect(job, &PUTFileJob::uploadProgress,
         this, &PropagateUploadFileNG::slotUploadProgress);
-    connect(job, &PUTFileJob::uploadProgress,
-        devicePtr, &UploadDevice::slotJobUploadProgress);
     connect(job, &QObject::destroyed, this, &PropagateUploadFileCommon::slotJobDestroyed);
     job->start();
     propagator()->_activeJobList.append(this);
     _currentChunk++;
+
+    // Keep more chunks of this file in flight while the scheduler has room for transfers
+    if (_runningChunks.size() < maxParallelChunks()
+        && _sent < fileSize
+        && propagator()->_activeJobList.count() < propagator()->maximumActiveTransferJob()) {
+        startNextChunk();
+    }
+}
+
+void PropagateUploadFileNG::adjustChunkSize(const PUTFileJob *job, const RunningChunk &chunk)
+{
+    // Dynamic chunk sizing is enabled if the server configured a
+    // target duration for each chunk upload.
+    const auto targetDuration = propagator()->syncOptions()._targetChunkUploadDuration;
+    if (targetDuration.count() <= 0) {
+        return;
+    }
+
+    const auto uploadTime = job->msSinceStart() + std::chrono::milliseconds(1); // add one to avoid div-by-zero
+
+    // The chunk shared the bandwidth with chunk.parallelism chunks of this file, while the
+    // next chunks will share it with plannedParallelism ones. Scale the prediction so the
+    // aggregated throughput of the file, not the one of a single stream, determines the size.
+    const auto plannedParallelism = qMax(1, qMin(maxParallelChunks(), propagator()->maximumActiveTransferJob()));
+    const qint64 predictedGoodSize = (chunk.size * targetDuration) / uploadTime * chunk.parallelism / plannedParallelism;
+
+    // The whole targeting is heuristic. The predictedGoodSize will fluctuate
+    // quite a bit because of external factors (like available bandwidth)
+    // and internal factors (like number of parallel uploads).
+    //
+    // We use an exponential moving average here as a cheap way of smoothing
+    // the chunk sizes a bit.
+    const qint64 targetSize = propagator()->_chunkSize / 2 + predictedGoodSize / 2;
+
+    // Adjust the dynamic chunk size _chunkSize used for sizing of the item's chunks to be send
+    propagator()->_chunkSize = ::qBound(propagator()->syncOptions().minChunkSize(), targetSize, propagator()->syncOptions().maxChunkSize());
+
+    qCInfo(lcPropagateUploadNG) << "Chunked upload of" << chunk.size << "bytes took" << uploadTime.count()
+                                << "ms with" << chunk.parallelism << "chunks in parallel, desired is" << targetDuration.count()
+                                << "ms, expected good chunk size is" << predictedGoodSize << "bytes and nudged next chunk size to "
+                                << propagator()->_chunkSize << "bytes";
 }
 
 void PropagateUploadFileNG::slotPutFinished()
@@ -397,6 +513,7 @@ void PropagateUploadFileNG::slotPutFinished()
     ASSERT(job);
 
     slotJobDestroyed(job); // remove it from the _jobs list
+    const auto chunk = _runningChunks.take(job);
 
     propagator()->_activeJobList.removeOne(this);
 
@@ -418,34 +535,12 @@ void PropagateUploadFileNG::slotPutFinished()
     }
 
     ENFORCE(_sent <= _fileToUpload._size, "can't send more than size");
+    _confirmed += chunk.size;
 
     // Adjust the chunk size for the time taken.
-    //
-    // Dynamic chunk sizing is enabled if the server configured a
-    // target duration for each chunk upload.
-    auto targetDuration = propagator()->syncOptions()._targetChunkUploadDuration;
-    if (targetDuration.count() > 0) {
-        auto uploadTime = ++job->msSinceStart(); // add one to avoid div-by-zero
-        qint64 predictedGoodSize = (_currentChunkSize * targetDuration) / uploadTime;
+    adjustChunkSize(job, chunk);
 
-        // The whole targeting is heuristic. The predictedGoodSize will fluctuate
-        // quite a bit because of external factors (like available bandwidth)
-        // and internal factors (like number of parallel uploads).
-        //
-        // We use an exponential moving average here as a cheap way of smoothing
-        // the chunk sizes a bit.
-        qint64 targetSize = propagator()->_chunkSize / 2 + predictedGoodSize / 2;
-
-        // Adjust the dynamic chunk size _chunkSize used for sizing of the item's chunks to be send
-        propagator()->_chunkSize = ::qBound(propagator()->syncOptions().minChunkSize(), targetSize, propagator()->syncOptions().maxChunkSize());
-
-        qCInfo(lcPropagateUploadNG) << "Chunked upload of" << _currentChunkSize << "bytes took" << uploadTime.count()
-                                  << "ms, desired is" << targetDuration.count() << "ms, expected good chunk size is"
-                                  << predictedGoodSize << "bytes and nudged next chunk size to "
-                                  << propagator()->_chunkSize << "bytes";
-    }
-
-    _finished = _sent == _item->_size;
+    _finished = _sent == _item->_size && _runningChunks.isEmpty();
 
     // Check if the file still exists
     const QString fullFilePath(propagator()->fullLocalPath(_item->_file));
@@ -559,7 +654,19 @@ void PropagateUploadFileNG::slotUploadProgress(qint64 sent, qint64 total)
     if (sent == 0 && total == 0) {
         return;
     }
-    propagator()->reportProgress(*_item, _sent + sent - total);
+
+    const auto job = qobject_cast<PUTFileJob *>(sender());
+    const auto it = _runningChunks.find(job);
+    if (it == _runningChunks.end()) {
+        return;
+    }
+    it->progress = sent;
+
+    auto progress = _confirmed;
+    for (const auto &runningChunk : qAsConst(_runningChunks)) {
+        progress += runningChunk.progress;
+    }
+    propagator()->reportProgress(*_item, progress);
 }
 
 void PropagateUploadFileNG::abort(PropagatorJob::AbortType abortType)
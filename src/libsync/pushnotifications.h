@@ -74,6 +74,12 @@ signals:
      */
     void filesChanged(OCC::Account *account);
 
+    /**
+     * Will be emitted instead of filesChanged() if the server reported the
+     * numeric ids of the changed files
+     */
+    void fileIdsChanged(OCC::Account *account, const QList<qint64> &fileIds);
+
     /**
      * Will be emitted if activities have been changed on the server
      */
@@ -120,6 +126,7 @@ private:
 
     void handleAuthenticated();
     void handleNotifyFile();
+    void handleNotifyFileId(const QString &message);
     void handleInvalidCredentials();
     void handleNotifyNotification();
     void handleNotifyActivity();
@@ -32,8 +32,6 @@ PutMultiFileJob::PutMultiFileJob(AccountPtr account,
 
     for(const auto &singleDevice : _devices) {
         singleDevice._device->setParent(this);
-        connect(this, &PutMultiFileJob::uploadProgress,
-                singleDevice._device.get(), &UploadDevice::slotJobUploadProgress);
     }
 }
 
@@ -48,7 +46,6 @@ void PutMultiFileJob::start()
         // QHttpMultiPart's internal QHttpMultiPartIODevice::readData will loop over and over trying
         // to read data from our UploadDevice while there is data left to be read; this will cause
         // a deadlock as we will never have a chance to progress the data read
-        oneDevice._device->setChoked(false);
         oneDevice._device->setBandwidthLimited(false);
 
         auto onePart = QHttpPart{};
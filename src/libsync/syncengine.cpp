@@ -63,8 +63,6 @@ namespace OCC {
 
 Q_LOGGING_CATEGORY(lcEngine, "nextcloud.sync.engine", QtInfoMsg)
 
-bool SyncEngine::s_anySyncRunning = false;
-
 /** When the client touches a file, block change notifications for this duration (ms)
  *
  * On Linux and Windows the file watcher can't distinguish a change that originates
@@ -332,6 +330,11 @@ void OCC::SyncEngine::slotItemDiscovered(const OCC::SyncFileItemPtr &item)
 {
     emit itemDiscovered(item);
 
+    if (item->isDirectory()) {
+        // Directories are discovered after their content
+        releasePipelineCandidates(item);
+    }
+
     if (Utility::isConflictFile(item->_file))
         _seenConflictFiles.insert(item->_file);
     if (item->_instruction == CSYNC_INSTRUCTION_UPDATE_METADATA && !item->isDirectory()) {
@@ -485,9 +488,86 @@ void OCC::SyncEngine::slotItemDiscovered(const OCC::SyncFileItemPtr &item)
 
     if (item->isDirectory()) {
         slotFolderDiscovered(item->_etag.isEmpty(), item->_file);
+    } else if (isPipelineCandidate(*item)) {
+        const auto slashPosition = item->_file.lastIndexOf(QLatin1Char('/'));
+        _pipelineCandidates[slashPosition > 0 ? item->_file.left(slashPosition) : QString()].append(item);
     }
 }
 
+bool SyncEngine::isPipelineCandidate(const SyncFileItem &item) const
+{
+    // Only plain transfers: renames, removals and conflicts need the whole tree
+    return _syncOptions._pipelinedPropagation
+        && !singleItemDiscoveryOptions().isValid()
+        && !item.isDirectory()
+        && item._type != ItemTypeSoftLink
+        && (item._instruction == CSYNC_INSTRUCTION_NEW || item._instruction == CSYNC_INSTRUCTION_SYNC)
+        && !item.isEncrypted()
+        && !Utility::isConflictFile(item._file);
+}
+
+void SyncEngine::releasePipelineCandidates(const SyncFileItemPtr &directoryItem)
+{
+    const auto candidates = _pipelineCandidates.take(directoryItem->_file);
+    if (candidates.isEmpty() || !_discoveryPhase) {
+        return;
+    }
+
+    // The files wait for the end of the discovery if the directory itself changes
+    if ((directoryItem->_instruction != CSYNC_INSTRUCTION_NONE && directoryItem->_instruction != CSYNC_INSTRUCTION_UPDATE_METADATA)
+        || directoryItem->_file != directoryItem->destination()
+        || directoryItem->isEncrypted()
+        || directoryItem->_isFileDropDetected) {
+        return;
+    }
+
+    // Nothing may change before the user confirmed the removal of all files.
+    // An unchanged directory counts as an unchanged file and rules that out.
+    if (_promptRemoveAllFiles && !_hasNoneFiles && directoryItem->_instruction != CSYNC_INSTRUCTION_NONE) {
+        return;
+    }
+
+    // A changed data fingerprint means the files get restored after the discovery
+    const auto databaseFingerprint = _journal->dataFingerprint();
+    if (!databaseFingerprint.isEmpty() && _discoveryPhase->_dataFingerprint != databaseFingerprint) {
+        return;
+    }
+
+    // The directory must be known at the same place locally and on the server,
+    // this also rules out directories inside a renamed one.
+    SyncJournalFileRecord record;
+    if (!_journal->getFileRecord(directoryItem->_file, &record) || !record.isValid() || !record.isDirectory()) {
+        return;
+    }
+
+    if (!_propagator) {
+        createPropagator();
+    }
+
+    SyncFileItemVector propagatedItems;
+    for (const auto &item : candidates) {
+        if (isPipelineCandidate(*item) && _propagator->propagateEarly(item)) {
+            propagatedItems.append(item);
+        }
+    }
+    if (propagatedItems.isEmpty()) {
+        return;
+    }
+
+    qCInfo(lcEngine) << "Propagating" << propagatedItems.size() << "items of" << directoryItem->_file << "during discovery";
+    if (!_propagationStartedEarly) {
+        _propagationStartedEarly = true;
+
+        // The jobs only run from the next event loop iteration, announce the
+        // propagation before any of them completes an item
+        _progressInfo->_status = ProgressInfo::Propagation;
+        emit transmissionProgress(*_progressInfo);
+        _progressInfo->startEstimateUpdates();
+        Q_EMIT started();
+    }
+    emit aboutToPropagateEarly(propagatedItems);
+}
+
 void SyncEngine::startSync()
 {
     if (_journal->exists()) {
@@ -517,7 +597,8 @@ void SyncEngine::startSync()
         }
     }
 
-    if (s_anySyncRunning || _syncRunning) {
+    if (_syncRunning) {
+        qCWarning(lcEngine) << "A sync is already running, not starting another one";
         return;
     }
     const auto currentEncryptionStatus = EncryptionStatusEnums::toDbEncryptionStatus(EncryptionStatusEnums::fromEndToEndEncryptionApiVersion(_account->capabilities().clientSideEncryptionVersion()));
@@ -525,13 +606,13 @@ void SyncEngine::startSync()
         _journal->schedulePathForRemoteDiscovery(record.path());
     });
 
-    s_anySyncRunning = true;
     _syncRunning = true;
     _anotherSyncNeeded = NoFollowUpSync;
     _clearTouchedFilesTimer.stop();
 
     _hasNoneFiles = false;
     _hasRemoveFile = false;
+    _promptRemoveAllFiles = ConfigFile().promptDeleteFiles() && !_syncOptions.isCmd();
     _seenConflictFiles.clear();
 
     _progressInfo->reset();
@@ -567,6 +648,8 @@ void SyncEngine::startSync()
     }
 
     _syncItems.clear();
+    _pipelineCandidates.clear();
+    _propagationStartedEarly = false;
     _needsUpdate = false;
 
     if (!_journal->exists()) {
@@ -596,6 +679,8 @@ void SyncEngine::startSync()
     // undo the filter to allow this sync to retrieve and store the correct etags.
     _journal->clearEtagStorageFilter();
 
+    _journal->setWriteBehindEnabled(_syncOptions._journalWriteBehind);
+
     _excludedFiles->setExcludeConflictFiles(!_account->capabilities().uploadConflictFiles());
 
     _lastLocalDiscoveryStyle = _localDiscoveryStyle;
@@ -686,6 +771,9 @@ void SyncEngine::startSync()
 
     ProcessDirectoryJob *discoveryJob = nullptr;
 
+    // Loading the whole table only pays off when the whole tree is discovered
+    _journal->setMetadataSnapshotEnabled(_syncOptions._discoveryMetadataSnapshot && !singleItemDiscoveryOptions().isValid());
+
     if (singleItemDiscoveryOptions().isValid()) {
         _discoveryPhase->_listExclusiveFiles.clear();
         _discoveryPhase->_listExclusiveFiles.push_back(singleItemDiscoveryOptions().filePathRelative);
@@ -735,9 +823,34 @@ void SyncEngine::startSync()
         );
     }
     
-    _discoveryPhase->startJob(discoveryJob);
     connect(discoveryJob, &ProcessDirectoryJob::etag, this, &SyncEngine::slotRootEtagReceived);
     connect(_discoveryPhase.data(), &DiscoveryPhase::addErrorToGui, this, &SyncEngine::addErrorToGui);
+
+    const auto syncToken = _syncOptions._remoteDeltaDiscovery && !singleItemDiscoveryOptions().isValid()
+        ? _journal->keyValueStoreGetByteArray(QStringLiteral("remote_sync_token"))
+        : QByteArray();
+    if (syncToken.isEmpty()) {
+        _discoveryPhase->startJob(discoveryJob);
+        return;
+    }
+
+    // Ask for the remote changes since the last sync first, they spare the PROPFIND of the changed directories
+    auto deltaJob = new DiscoveryRemoteDeltaJob(_account, _discoveryPhase->_remoteFolder, syncToken, _discoveryPhase.data());
+    connect(deltaJob, &DiscoveryRemoteDeltaJob::finished, this, [this, discoveryPhase = _discoveryPhase.data(), discoveryJob](const HttpResult<RemoteDelta> &result) {
+        if (_discoveryPhase.data() != discoveryPhase) {
+            // The sync was aborted
+            return;
+        }
+        if (result) {
+            _discoveryPhase->_remoteDelta = std::make_unique<RemoteDelta>(*result);
+            _discoveryPhase->_syncToken = result->syncToken;
+        } else {
+            qCInfo(lcEngine) << "Could not get the remote changes since the last sync, discovering the whole remote tree"
+                             << result.error().code << result.error().message;
+        }
+        _discoveryPhase->startJob(discoveryJob);
+    });
+    deltaJob->start();
 }
 
 void SyncEngine::slotFolderDiscovered(bool local, const QString &folder)
@@ -782,6 +895,8 @@ void SyncEngine::slotDiscoveryFinished()
 
     qCInfo(lcEngine) << "#### Discovery end #################################################### " << _stopWatch.addLapTime(QLatin1String("Discovery Finished")) << "ms";
 
+    _journal->setMetadataSnapshotEnabled(false);
+
     // Sanity check
     if (!_journal->open()) {
         qCWarning(lcEngine) << "Bailing out, DB failure";
@@ -795,8 +910,10 @@ void SyncEngine::slotDiscoveryFinished()
 
     _progressInfo->_currentDiscoveredRemoteFolder.clear();
     _progressInfo->_currentDiscoveredLocalFolder.clear();
-    _progressInfo->_status = ProgressInfo::Reconcile;
-    emit transmissionProgress(*_progressInfo);
+    if (!_propagationStartedEarly) {
+        _progressInfo->_status = ProgressInfo::Reconcile;
+        emit transmissionProgress(*_progressInfo);
+    }
 
     //    qCInfo(lcEngine) << "Permissions of the root folder: " << _csync_ctx->remote.root_perms.toString();
     auto finish = [this]{
@@ -863,22 +980,12 @@ void SyncEngine::slotDiscoveryFinished()
         // do a database commit
         _journal->commit(QStringLiteral("post treewalk"));
 
-        _propagator = QSharedPointer<OwncloudPropagator>(
-            new OwncloudPropagator(_account, _localPath, _remotePath, _journal, _bulkUploadBlackList));
-        _propagator->setSyncOptions(_syncOptions);
-        connect(_propagator.data(), &OwncloudPropagator::itemCompleted,
-            this, &SyncEngine::slotItemCompleted);
-        connect(_propagator.data(), &OwncloudPropagator::progress,
-            this, &SyncEngine::slotProgress);
-        connect(_propagator.data(), &OwncloudPropagator::finished, this, &SyncEngine::slotPropagationFinished, Qt::QueuedConnection);
-        connect(_propagator.data(), &OwncloudPropagator::seenLockedFile, this, &SyncEngine::seenLockedFile);
-        connect(_propagator.data(), &OwncloudPropagator::touchedFile, this, &SyncEngine::slotAddTouchedFile);
-        connect(_propagator.data(), &OwncloudPropagator::insufficientLocalStorage, this, &SyncEngine::slotInsufficientLocalStorage);
-        connect(_propagator.data(), &OwncloudPropagator::insufficientRemoteStorage, this, &SyncEngine::slotInsufficientRemoteStorage);
-        connect(_propagator.data(), &OwncloudPropagator::newItem, this, &SyncEngine::slotNewItem);
-
-        // apply the network limits to the propagator
-        setNetworkLimits(_uploadLimit, _downloadLimit);
+        _pipelineCandidates.clear();
+
+        // The propagator already exists if items were propagated during the discovery
+        if (!_propagator) {
+            createPropagator();
+        }
 
         deleteStaleDownloadInfos(_syncItems);
         deleteStaleUploadInfos(_syncItems);
@@ -886,7 +993,7 @@ void SyncEngine::slotDiscoveryFinished()
         _journal->commit(QStringLiteral("post stale entry removal"));
 
         // Emit the started signal only after the propagator has been set up.
-        if (_needsUpdate)
+        if (_needsUpdate && !_propagationStartedEarly)
             Q_EMIT started();
 
         _propagator->start(std::move(_syncItems));
@@ -894,8 +1001,7 @@ void SyncEngine::slotDiscoveryFinished()
         qCInfo(lcEngine) << "#### Post-Reconcile end #################################################### " << _stopWatch.addLapTime(QStringLiteral("Post-Reconcile Finished")) << "ms";
     };
 
-    const auto displayDialog = ConfigFile().promptDeleteFiles() && !_syncOptions.isCmd();
-    if (!_hasNoneFiles && _hasRemoveFile && displayDialog) {
+    if (!_hasNoneFiles && _hasRemoveFile && _promptRemoveAllFiles) {
         qCInfo(lcEngine) << "All the files are going to be changed, asking the user";
         int side = 0; // > 0 means more deleted on the server.  < 0 means more deleted on the client
         for (const auto &it : _syncItems) {
@@ -927,6 +1033,28 @@ void SyncEngine::slotDiscoveryFinished()
     finish();
 }
 
+void SyncEngine::createPropagator()
+{
+    _propagator = QSharedPointer<OwncloudPropagator>(
+        new OwncloudPropagator(_account, _localPath, _remotePath, _journal, _bulkUploadBlackList));
+    _propagator->setSyncOptions(_syncOptions);
+    connect(_propagator.data(), &OwncloudPropagator::itemCompleted,
+        this, &SyncEngine::slotItemCompleted);
+    connect(_propagator.data(), &OwncloudPropagator::progress,
+        this, &SyncEngine::slotProgress);
+    connect(_propagator.data(), &OwncloudPropagator::finished, this, &SyncEngine::slotPropagationFinished, Qt::QueuedConnection);
+    connect(_propagator.data(), &OwncloudPropagator::seenLockedFile, this, &SyncEngine::seenLockedFile);
+    connect(_propagator.data(), &OwncloudPropagator::touchedFile, this, &SyncEngine::slotAddTouchedFile);
+    connect(_propagator.data(), &OwncloudPropagator::insufficientLocalStorage, this, &SyncEngine::slotInsufficientLocalStorage);
+    connect(_propagator.data(), &OwncloudPropagator::insufficientRemoteStorage, this, &SyncEngine::slotInsufficientRemoteStorage);
+    connect(_propagator.data(), &OwncloudPropagator::newItem, this, &SyncEngine::slotNewItem);
+    connect(_propagator.data(), &OwncloudPropagator::transferConcurrencyChanged, this, &SyncEngine::slotTransferConcurrencyChanged);
+
+    // apply the network limits to the propagator
+    setNetworkLimits(_uploadLimit, _downloadLimit);
+    _progressInfo->_transferConcurrency = _propagator->maximumActiveTransferJob();
+}
+
 void SyncEngine::slotCleanPollsJobAborted(const QString &error, const ErrorCategory errorCategory)
 {
     emit syncError(error, errorCategory);
@@ -960,6 +1088,19 @@ void SyncEngine::detectFileLock(const SyncFileItemPtr &item)
     }
 }
 
+void SyncEngine::setParallelNetworkJobs(int count)
+{
+    _syncOptions._parallelNetworkJobs = count;
+
+    if (_discoveryPhase) {
+        // picked up when the next directory job finishes
+        _discoveryPhase->_syncOptions._parallelNetworkJobs = count;
+    }
+    if (_propagator) {
+        _propagator->setParallelNetworkJobs(count);
+    }
+}
+
 void SyncEngine::setNetworkLimits(int upload, int download)
 {
     _uploadLimit = upload;
@@ -968,8 +1109,8 @@ void SyncEngine::setNetworkLimits(int upload, int download)
     if (!_propagator)
         return;
 
-    _propagator->_uploadLimit = upload;
-    _propagator->_downloadLimit = download;
+    _propagator->bandwidthManager()->setUploadLimit(upload);
+    _propagator->bandwidthManager()->setDownloadLimit(download);
 
     if (upload != 0 || download != 0) {
         qCInfo(lcEngine) << "Network Limits (down/up) " << upload << download;
@@ -996,10 +1137,21 @@ void SyncEngine::slotPropagationFinished(OCC::SyncFileItem::Status status)
         _journal->setDataFingerprint(_discoveryPhase->_dataFingerprint);
     }
 
+    // Only a sync without errors has everything before the token in the journal,
+    // otherwise the next delta has to report the failed items again
+    if (status == SyncFileItem::Success && _discoveryPhase && !_discoveryPhase->_syncToken.isEmpty()) {
+        _journal->keyValueStoreSet(QStringLiteral("remote_sync_token"), _discoveryPhase->_syncToken);
+    }
+
     conflictRecordMaintenance();
     caseClashConflictRecordMaintenance();
 
     _journal->deleteStaleFlagsEntries();
+    if (_syncOptions._checksumCache) {
+        _journal->deleteStaleChecksumCacheEntries();
+        const auto checksumCacheStatistics = _journal->checksumCacheStatistics();
+        qCInfo(lcEngine) << "Checksum cache hits:" << checksumCacheStatistics._hits << "misses:" << checksumCacheStatistics._misses;
+    }
     _journal->commit("All Finished.", false);
 
     // Send final progress information even if no
@@ -1016,13 +1168,26 @@ void SyncEngine::finalize(bool success)
 {
     setSingleItemDiscoveryOptions({});
 
+    if (_propagator && !_propagator->hasStarted()) {
+        // The sync ended during the discovery, stop what was propagated so far
+        _propagator->abortPipelinedJobs();
+    }
+    _pipelineCandidates.clear();
+
+    // Everything the sync run wrote must be in the database before anyone is told it finished
+    if (const auto flushed = _journal->setWriteBehindEnabled(false); !flushed) {
+        qCWarning(lcEngine) << "Could not write the results of the sync to the journal:" << flushed.error();
+        Q_EMIT syncError(tr("Unable to write to the sync journal: %1").arg(flushed.error()), ErrorCategory::GenericError);
+        success = false;
+    }
+    _journal->setMetadataSnapshotEnabled(false);
+
     qCInfo(lcEngine) << "Sync run took " << _stopWatch.addLapTime(QLatin1String("Sync Finished")) << "ms";
     _stopWatch.stop();
 
     if (_discoveryPhase) {
         _discoveryPhase.take()->deleteLater();
     }
-    s_anySyncRunning = false;
     _syncRunning = false;
     emit finished(success);
 
@@ -1065,6 +1230,12 @@ void SyncEngine::slotProgress(const SyncFileItem &item, qint64 current)
     emit transmissionProgress(*_progressInfo);
 }
 
+void SyncEngine::slotTransferConcurrencyChanged(int window)
+{
+    _progressInfo->_transferConcurrency = window;
+    emit transmissionProgress(*_progressInfo);
+}
+
 
 void SyncEngine::restoreOldFiles(SyncFileItemVector &syncItems)
 {
@@ -1273,7 +1444,7 @@ void SyncEngine::switchToVirtualFiles(const QString &localPath, SyncJournalDb &j
 
 void SyncEngine::abort()
 {
-    if (_propagator) {
+    if (_propagator && _propagator->hasStarted()) {
         // If we're already in the propagation phase, aborting that is sufficient
         qCInfo(lcEngine) << "Aborting sync in propagator...";
         _propagator->abort();
@@ -1283,7 +1454,12 @@ void SyncEngine::abort()
         disconnect(_discoveryPhase.data(), nullptr, this, nullptr);
         _discoveryPhase.take()->deleteLater();
         qCInfo(lcEngine) << "Aborting sync in discovery...";
-        finalize(false);
+        if (_propagator) {
+            // Items are already being propagated, finalize once they are aborted
+            _propagator->abort();
+        } else {
+            finalize(false);
+        }
     }
 }
 
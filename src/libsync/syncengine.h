@@ -144,6 +144,14 @@ public slots:
 
     void setNetworkLimits(int upload, int download);
     void setSyncOptions(const OCC::SyncOptions &options) { _syncOptions = options; }
+
+    /**
+     * Changes the number of parallel network jobs, also of a running sync.
+     *
+     * Used when several folders share the network budget and the number of
+     * running syncs changes.
+     */
+    void setParallelNetworkJobs(int count);
     void setIgnoreHiddenFiles(bool ignore) { _ignore_hidden_files = ignore; }
 
     /**
@@ -167,6 +175,9 @@ signals:
     // after the above signals. with the items that actually need propagating
     void aboutToPropagate(OCC::SyncFileItemVector &);
 
+    // during the discovery, with the items that get propagated before the whole tree is known
+    void aboutToPropagateEarly(const OCC::SyncFileItemVector &items);
+
     // after each item completed by a job (successful or not)
     void itemCompleted(const OCC::SyncFileItemPtr &item, const OCC::ErrorCategory category);
 
@@ -221,6 +232,7 @@ private slots:
     void slotDiscoveryFinished();
     void slotPropagationFinished(SyncFileItem::Status status);
     void slotProgress(const OCC::SyncFileItem &item, qint64 current);
+    void slotTransferConcurrencyChanged(int window);
     void slotCleanPollsJobAborted(const QString &error, const OCC::ErrorCategory category);
     void detectFileLock(const OCC::SyncFileItemPtr &item);
 
@@ -301,6 +313,16 @@ private:
     // cleanup and emit the finished signal
     void finalize(bool success);
 
+    // creates _propagator and connects its signals
+    void createPropagator();
+
+    // Whether the item may be propagated before the discovery is finished,
+    // provided its parent directory turns out to be unchanged
+    [[nodiscard]] bool isPipelineCandidate(const SyncFileItem &item) const;
+
+    // Hands the candidates inside a completely discovered directory to the propagator
+    void releasePipelineCandidates(const SyncFileItemPtr &directoryItem);
+
     void processCaseClashConflictsBeforeDiscovery();
 
     // Aggregate scheduled sync runs into interval buckets. Can be used to
@@ -321,8 +343,6 @@ private:
     QSharedPointer<SyncEngine::ScheduledSyncTimer> nearbyScheduledSyncTimer(const qint64 scheduledSyncTimerSecs,
                                                                             const qint64 intervalSecs) const;
 
-    static bool s_anySyncRunning; //true when one sync is running somewhere (for debugging)
-
     // Must only be accessed during update and reconcile
     QVector<SyncFileItemPtr> _syncItems;
 
@@ -359,12 +379,21 @@ private:
      */
     void restoreOldFiles(SyncFileItemVector &syncItems);
 
+    // Candidates for pipelined propagation, by parent directory, see releasePipelineCandidates()
+    QHash<QString, SyncFileItemVector> _pipelineCandidates;
+
+    // true if started() was emitted because items were propagated during the discovery
+    bool _propagationStartedEarly = false;
+
     // true if there is at least one file which was not changed on the server
     bool _hasNoneFiles = false;
 
     // true if there is at leasr one file with instruction REMOVE
     bool _hasRemoveFile = false;
 
+    // true if the user confirms the removal of all files, see slotDiscoveryFinished()
+    bool _promptRemoveAllFiles = false;
+
     // If ignored files should be ignored
     bool _ignore_hidden_files = false;
 
@@ -38,15 +38,14 @@ static int pathCompare( const QString& lhs, const QString& rhs )
         );
 }
 
-static bool pathStartsWith( const QString& lhs, const QString& rhs )
+static QString errorCountKey(const QString &path)
 {
-    return lhs.startsWith(rhs,
+    // Should match pathCompare(), directories differing only in case share their count on macOS and Windows.
 #if defined(Q_OS_WIN) || defined(Q_OS_MAC)
-        Qt::CaseInsensitive
+    return path.toCaseFolded();
 #else
-        Qt::CaseSensitive
+    return path;
 #endif
-        );
 }
 
 bool SyncFileStatusTracker::PathComparator::operator()( const QString& lhs, const QString& rhs ) const
@@ -55,32 +54,72 @@ bool SyncFileStatusTracker::PathComparator::operator()( const QString& lhs, cons
     return pathCompare(lhs, rhs) < 0;
 }
 
-SyncFileStatus::SyncFileStatusTag SyncFileStatusTracker::lookupProblem(const QString &pathToMatch, const SyncFileStatusTracker::ProblemsMap &problemMap)
+SyncFileStatus::SyncFileStatusTag SyncFileStatusTracker::lookupProblem(const QString &pathToMatch) const
 {
-    auto lower = problemMap.lower_bound(pathToMatch);
-    for (auto it = lower; it != problemMap.cend(); ++it) {
-        const QString &problemPath = it->first;
-        SyncFileStatus::SyncFileStatusTag severity = it->second;
-
-        if (pathCompare(problemPath, pathToMatch) == 0) {
-            return severity;
-        } else if (severity == SyncFileStatus::StatusError
-            && pathStartsWith(problemPath, pathToMatch)
-            && (pathToMatch.isEmpty() || problemPath.at(pathToMatch.size()) == '/')) {
-            return SyncFileStatus::StatusWarning;
-        } else if (!pathStartsWith(problemPath, pathToMatch)) {
-            // Starting at lower_bound we get the first path that is not smaller,
-            // since: "a/" < "a/aa" < "a/aa/aaa" < "a/ab/aba"
-            // If problemMap keys are ["a/aa/aaa", "a/ab/aba"] and pathToMatch == "a/aa",
-            // lower_bound(pathToMatch) will point to "a/aa/aaa", and the moment that
-            // problemPath.startsWith(pathToMatch) == false, we know that we've looked
-            // at everything that interest us.
-            break;
-        }
+    const auto it = _syncProblems.find(pathToMatch);
+    if (it != _syncProblems.cend()) {
+        return it->second;
+    }
+    // A directory with an error somewhere below it gets a warning
+    if (_errorDescendantCount.contains(errorCountKey(pathToMatch))) {
+        return SyncFileStatus::StatusWarning;
     }
     return SyncFileStatus::StatusNone;
 }
 
+void SyncFileStatusTracker::setSyncProblem(const QString &relativePath, SyncFileStatus::SyncFileStatusTag severity)
+{
+    auto it = _syncProblems.find(relativePath);
+    const auto wasError = it != _syncProblems.end() && it->second == SyncFileStatus::StatusError;
+    if (it != _syncProblems.end()) {
+        it->second = severity;
+    } else {
+        _syncProblems.emplace(relativePath, severity);
+    }
+
+    if (!wasError && severity == SyncFileStatus::StatusError) {
+        updateParentErrorCounts(relativePath, 1);
+    } else if (wasError && severity != SyncFileStatus::StatusError) {
+        updateParentErrorCounts(relativePath, -1);
+    }
+}
+
+void SyncFileStatusTracker::eraseSyncProblem(const QString &relativePath)
+{
+    const auto it = _syncProblems.find(relativePath);
+    if (it == _syncProblems.end()) {
+        return;
+    }
+    const auto wasError = it->second == SyncFileStatus::StatusError;
+    _syncProblems.erase(it);
+    if (wasError) {
+        updateParentErrorCounts(relativePath, -1);
+    }
+}
+
+void SyncFileStatusTracker::updateParentErrorCounts(const QString &relativePath, int delta)
+{
+    ASSERT(!relativePath.isEmpty());
+    QString parentPath = relativePath;
+    while (!parentPath.isEmpty()) {
+        parentPath.truncate(qMax(0, parentPath.lastIndexOf(QLatin1Char('/'))));
+
+        const auto key = errorCountKey(parentPath);
+        const auto count = _errorDescendantCount.value(key) + delta;
+        ASSERT(count >= 0);
+        if (count > 0) {
+            _errorDescendantCount.insert(key, count);
+        } else {
+            _errorDescendantCount.remove(key);
+        }
+
+        // Only a directory whose first error appeared or whose last error went away changes its status
+        if (count == 0 || count == delta) {
+            emit fileStatusChanged(getSystemDestination(parentPath), fileStatus(parentPath));
+        }
+    }
+}
+
 /**
  * Whether this item should get an ERROR icon through the Socket API.
  *
@@ -115,6 +154,8 @@ SyncFileStatusTracker::SyncFileStatusTracker(SyncEngine *syncEngine)
 {
     connect(syncEngine, &SyncEngine::aboutToPropagate,
         this, &SyncFileStatusTracker::slotAboutToPropagate);
+    connect(syncEngine, &SyncEngine::aboutToPropagateEarly,
+        this, &SyncFileStatusTracker::slotAboutToPropagateEarly);
     connect(syncEngine, &SyncEngine::itemCompleted,
         this, &SyncFileStatusTracker::slotItemCompleted);
     connect(syncEngine, &SyncEngine::finished, this, &SyncFileStatusTracker::slotSyncFinished);
@@ -171,7 +212,7 @@ void SyncFileStatusTracker::slotPathTouched(const QString &fileName)
 
 void SyncFileStatusTracker::slotAddSilentlyExcluded(const QString &folderPath)
 {
-    _syncProblems[folderPath] = SyncFileStatus::StatusExcluded;
+    setSyncProblem(folderPath, SyncFileStatus::StatusExcluded);
     _syncSilentExcludes[folderPath] = SyncFileStatus::StatusExcluded;
     emit fileStatusChanged(getSystemDestination(folderPath), resolveSyncAndErrorStatus(folderPath, NotShared));
 }
@@ -230,21 +271,21 @@ void SyncFileStatusTracker::decSyncCountAndEmitStatusChanged(const QString &rela
 
 void SyncFileStatusTracker::slotAboutToPropagate(SyncFileItemVector &items)
 {
-    ASSERT(_syncCount.isEmpty());
+    ASSERT(_syncCount.isEmpty() || !_earlyPropagatedPaths.isEmpty());
 
     ProblemsMap oldProblems;
     std::swap(_syncProblems, oldProblems);
+    _errorDescendantCount.clear();
 
     foreach (const SyncFileItemPtr &item, items) {
         qCInfo(lcStatusTracker) << "Investigating" << item->destination() << item->_status << item->_instruction << item->_direction;
         _dirtyPaths.remove(item->destination());
 
         if (hasErrorStatus(*item)) {
-            _syncProblems[item->destination()] = SyncFileStatus::StatusError;
+            setSyncProblem(item->destination(), SyncFileStatus::StatusError);
             _syncSilentExcludes.erase(item->destination());
-            invalidateParentPaths(item->destination());
         } else if (hasExcludedStatus(*item)) {
-            _syncProblems[item->destination()] = SyncFileStatus::StatusExcluded;
+            setSyncProblem(item->destination(), SyncFileStatus::StatusExcluded);
             _syncSilentExcludes.erase(item->destination());
         }
 
@@ -254,7 +295,10 @@ void SyncFileStatusTracker::slotAboutToPropagate(SyncFileItemVector &items)
             && item->_instruction != CSYNC_INSTRUCTION_IGNORE
             && item->_instruction != CSYNC_INSTRUCTION_ERROR) {
             // Mark this path as syncing for instructions that will result in propagation.
-            incSyncCountAndEmitStatusChanged(item->destination(), sharedFlag);
+            // Items propagated during the discovery were marked already.
+            if (!_earlyPropagatedPaths.contains(item->destination())) {
+                incSyncCountAndEmitStatusChanged(item->destination(), sharedFlag);
+            }
         } else {
             emit fileStatusChanged(getSystemDestination(item->destination()), resolveSyncAndErrorStatus(item->destination(), sharedFlag));
         }
@@ -272,26 +316,39 @@ void SyncFileStatusTracker::slotAboutToPropagate(SyncFileItemVector &items)
     // (like an error file being deleted from disk)
     for (const auto &syncProblem : _syncProblems)
         oldProblems.erase(syncProblem.first);
+    QSet<QString> invalidatedParentPaths;
     for (const auto &oldProblem : oldProblems) {
         const QString &path = oldProblem.first;
         SyncFileStatus::SyncFileStatusTag severity = oldProblem.second;
         if (severity == SyncFileStatus::StatusError)
-            invalidateParentPaths(path);
+            invalidateParentPaths(path, invalidatedParentPaths);
         emit fileStatusChanged(getSystemDestination(path), fileStatus(path));
     }
 }
 
+void SyncFileStatusTracker::slotAboutToPropagateEarly(const SyncFileItemVector &items)
+{
+    for (const auto &item : items) {
+        qCInfo(lcStatusTracker) << "Propagating during discovery" << item->destination() << item->_instruction << item->_direction;
+        _dirtyPaths.remove(item->destination());
+        _earlyPropagatedPaths.insert(item->destination());
+
+        // Only transfers are propagated early, they always end with an itemCompleted
+        SharedFlag sharedFlag = item->_remotePerm.hasPermission(RemotePermissions::IsShared) ? Shared : NotShared;
+        incSyncCountAndEmitStatusChanged(item->destination(), sharedFlag);
+    }
+}
+
 void SyncFileStatusTracker::slotItemCompleted(const SyncFileItemPtr &item)
 {
     qCDebug(lcStatusTracker) << "Item completed" << item->destination() << item->_status << item->_instruction;
 
     if (hasErrorStatus(*item)) {
-        _syncProblems[item->destination()] = SyncFileStatus::StatusError;
-        invalidateParentPaths(item->destination());
+        setSyncProblem(item->destination(), SyncFileStatus::StatusError);
     } else if (hasExcludedStatus(*item)) {
-        _syncProblems[item->destination()] = SyncFileStatus::StatusExcluded;
+        setSyncProblem(item->destination(), SyncFileStatus::StatusExcluded);
     } else {
-        _syncProblems.erase(item->destination());
+        eraseSyncProblem(item->destination());
     }
     _syncSilentExcludes.erase(item->destination());
 
@@ -300,7 +357,7 @@ void SyncFileStatusTracker::slotItemCompleted(const SyncFileItemPtr &item)
         && item->_instruction != CSYNC_INSTRUCTION_UPDATE_METADATA
         && item->_instruction != CSYNC_INSTRUCTION_IGNORE
         && item->_instruction != CSYNC_INSTRUCTION_ERROR) {
-        // decSyncCount calls *must* be symmetric with incSyncCount calls in slotAboutToPropagate
+        // decSyncCount calls *must* be symmetric with incSyncCount calls in slotAboutToPropagate and slotAboutToPropagateEarly
         decSyncCountAndEmitStatusChanged(item->destination(), sharedFlag);
     } else {
         emit fileStatusChanged(getSystemDestination(item->destination()), resolveSyncAndErrorStatus(item->destination(), sharedFlag));
@@ -312,6 +369,7 @@ void SyncFileStatusTracker::slotSyncFinished()
     // Clear the sync counts to reduce the impact of unsymetrical inc/dec calls (e.g. when directory job abort)
     QHash<QString, int> oldSyncCount;
     std::swap(_syncCount, oldSyncCount);
+    _earlyPropagatedPaths.clear();
     for (auto it = oldSyncCount.begin(); it != oldSyncCount.end(); ++it) {
         // Don't announce folders, fileStatus expect only paths without '/', otherwise it asserts
         if (it.key().endsWith('/')) {
@@ -337,7 +395,7 @@ SyncFileStatus SyncFileStatusTracker::resolveSyncAndErrorStatus(const QString &r
     } else {
         // After a sync finished, we need to show the users issues from that last sync like the activity list does.
         // Also used for parent directories showing a warning for an error child.
-        SyncFileStatus::SyncFileStatusTag problemStatus = lookupProblem(relativePath, _syncProblems);
+        SyncFileStatus::SyncFileStatusTag problemStatus = lookupProblem(relativePath);
         if (problemStatus != SyncFileStatus::StatusNone)
             status.set(problemStatus);
     }
@@ -350,11 +408,17 @@ SyncFileStatus SyncFileStatusTracker::resolveSyncAndErrorStatus(const QString &r
     return status;
 }
 
-void SyncFileStatusTracker::invalidateParentPaths(const QString &path)
+void SyncFileStatusTracker::invalidateParentPaths(const QString &path, QSet<QString> &invalidatedPaths)
 {
-    QStringList splitPath = path.split('/', Qt::SkipEmptyParts);
-    for (int i = 0; i < splitPath.size(); ++i) {
-        QString parentPath = QStringList(splitPath.mid(0, i)).join(QLatin1String("/"));
+    // Parents that still have an error below them got their status pushed when it was recorded
+    QString parentPath = path;
+    while (!parentPath.isEmpty()) {
+        parentPath.truncate(qMax(0, parentPath.lastIndexOf(QLatin1Char('/'))));
+        const auto key = errorCountKey(parentPath);
+        if (_errorDescendantCount.contains(key) || invalidatedPaths.contains(key)) {
+            continue;
+        }
+        invalidatedPaths.insert(key);
         emit fileStatusChanged(getSystemDestination(parentPath), fileStatus(parentPath));
     }
 }
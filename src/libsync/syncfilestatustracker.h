@@ -49,6 +49,7 @@ signals:
 
 private slots:
     void slotAboutToPropagate(OCC::SyncFileItemVector &items);
+    void slotAboutToPropagateEarly(const OCC::SyncFileItemVector &items);
     void slotItemCompleted(const OCC::SyncFileItemPtr &item);
     void slotSyncFinished();
     void slotSyncEngineRunningChanged();
@@ -58,7 +59,10 @@ private:
         bool operator()( const QString& lhs, const QString& rhs ) const;
     };
     using ProblemsMap = std::map<QString, SyncFileStatus::SyncFileStatusTag, PathComparator>;
-    SyncFileStatus::SyncFileStatusTag lookupProblem(const QString &pathToMatch, const ProblemsMap &problemMap);
+    [[nodiscard]] SyncFileStatus::SyncFileStatusTag lookupProblem(const QString &pathToMatch) const;
+    void setSyncProblem(const QString &relativePath, SyncFileStatus::SyncFileStatusTag severity);
+    void eraseSyncProblem(const QString &relativePath);
+    void updateParentErrorCounts(const QString &relativePath, int delta);
 
     enum SharedFlag { UnknownShared,
         NotShared,
@@ -67,13 +71,14 @@ private:
         PathKnown };
     SyncFileStatus resolveSyncAndErrorStatus(const QString &relativePath, SharedFlag sharedState, PathKnownFlag isPathKnown = PathKnown);
 
-    void invalidateParentPaths(const QString &path);
+    void invalidateParentPaths(const QString &path, QSet<QString> &invalidatedPaths);
     QString getSystemDestination(const QString &relativePath);
     void incSyncCountAndEmitStatusChanged(const QString &relativePath, SharedFlag sharedState);
     void decSyncCountAndEmitStatusChanged(const QString &relativePath, SharedFlag sharedState);
 
     SyncEngine *_syncEngine;
 
+    // Only modified through setSyncProblem() and eraseSyncProblem(), which keep _errorDescendantCount in sync
     ProblemsMap _syncProblems;
     ProblemsMap _syncSilentExcludes;
     QSet<QString> _dirtyPaths;
@@ -81,6 +86,11 @@ private:
     // We'll show a file/directory as SYNC as long as its sync count is > 0.
     // A directory that starts/ends propagation will in turn increase/decrease its own parent by 1.
     QHash<QString, int> _syncCount;
+    // Items propagated during the discovery, their sync count was already increased by slotAboutToPropagateEarly()
+    QSet<QString> _earlyPropagatedPaths;
+    // Counts the errors in _syncProblems below each directory, directories without any aren't in the hash.
+    // A directory shows a WARNING as long as its count is > 0, without scanning _syncProblems for its children.
+    QHash<QString, int> _errorDescendantCount;
 };
 }
 
@@ -68,6 +68,46 @@ void SyncOptions::fillFromEnvironmentVariables()
     int maxParallel = qgetenv("OWNCLOUD_MAX_PARALLEL").toInt();
     if (maxParallel > 0)
         _parallelNetworkJobs = maxParallel;
+
+    int maxParallelChunks = qgetenv("OWNCLOUD_MAX_PARALLEL_CHUNKS").toInt();
+    if (maxParallelChunks > 0)
+        _maxParallelChunkUploads = maxParallelChunks;
+
+    int maxParallelSegments = qgetenv("OWNCLOUD_MAX_PARALLEL_DOWNLOAD_SEGMENTS").toInt();
+    if (maxParallelSegments > 0)
+        _maxParallelDownloadSegments = maxParallelSegments;
+
+    qint64 downloadSegmentSize = qgetenv("OWNCLOUD_DOWNLOAD_SEGMENT_SIZE").toLongLong();
+    if (downloadSegmentSize > 0)
+        _downloadSegmentSize = downloadSegmentSize;
+
+    QByteArray pipelinedSyncEnv = qgetenv("OWNCLOUD_PIPELINED_SYNC");
+    if (!pipelinedSyncEnv.isEmpty())
+        _pipelinedPropagation = pipelinedSyncEnv.toInt() != 0;
+
+    QByteArray journalWriteBehindEnv = qgetenv("OWNCLOUD_JOURNAL_WRITE_BEHIND");
+    if (!journalWriteBehindEnv.isEmpty())
+        _journalWriteBehind = journalWriteBehindEnv.toInt() != 0;
+
+    QByteArray discoverySnapshotEnv = qgetenv("OWNCLOUD_DISCOVERY_METADATA_SNAPSHOT");
+    if (!discoverySnapshotEnv.isEmpty())
+        _discoveryMetadataSnapshot = discoverySnapshotEnv.toInt() != 0;
+
+    QByteArray remoteDeltaDiscoveryEnv = qgetenv("OWNCLOUD_REMOTE_DELTA_DISCOVERY");
+    if (!remoteDeltaDiscoveryEnv.isEmpty())
+        _remoteDeltaDiscovery = remoteDeltaDiscoveryEnv.toInt() != 0;
+
+    QByteArray checksumWhileUploadingEnv = qgetenv("OWNCLOUD_CHECKSUM_WHILE_UPLOADING");
+    if (!checksumWhileUploadingEnv.isEmpty())
+        _checksumWhileUploading = checksumWhileUploadingEnv.toInt() != 0;
+
+    QByteArray checksumCacheEnv = qgetenv("OWNCLOUD_CHECKSUM_CACHE");
+    if (!checksumCacheEnv.isEmpty())
+        _checksumCache = checksumCacheEnv.toInt() != 0;
+
+    QByteArray adaptiveParallelismEnv = qgetenv("OWNCLOUD_ADAPTIVE_PARALLELISM");
+    if (!adaptiveParallelismEnv.isEmpty())
+        _adaptiveTransferConcurrency = adaptiveParallelismEnv.toInt() != 0;
 }
 
 void SyncOptions::verifyChunkSizes()
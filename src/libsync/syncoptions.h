@@ -66,6 +66,62 @@ public:
     /** The maximum number of active jobs in parallel  */
     int _parallelNetworkJobs = 6;
 
+    /** Whether the number of parallel transfers adapts to the observed
+     * throughput, latency and server errors (between 1 and _parallelNetworkJobs).
+     *
+     * When disabled, the initial window of ConcurrencyController::defaultWindow() is used.
+     */
+    bool _adaptiveTransferConcurrency = true;
+
+    /** The maximum number of chunks of a single file uploaded in parallel
+     * with chunking NG. 1 means chunks are sent one after the other.
+     */
+    int _maxParallelChunkUploads = 1;
+
+    /** The maximum number of byte ranges of a single file downloaded in
+     * parallel. 1 means files are downloaded as one stream.
+     */
+    int _maxParallelDownloadSegments = 1;
+
+    /** The size of the ranges of a segmented download. Only files larger
+     * than this are split.
+     */
+    qint64 _downloadSegmentSize = 100LL * 1000LL * 1000LL; // 100 MB
+
+    /** Whether files of completely discovered, unchanged directories are
+     * propagated while the rest of the tree is still being discovered.
+     */
+    bool _pipelinedPropagation = false;
+
+    /** Whether file records are written to the journal by a background
+     * thread in batches, see SyncJournalDb::setWriteBehindEnabled().
+     */
+    bool _journalWriteBehind = false;
+
+    /** Whether the discovery looks up journal records in an in-memory
+     * copy of the metadata table instead of querying SQLite for each item.
+     */
+    bool _discoveryMetadataSnapshot = false;
+
+    /** Whether the remote discovery asks the server for the changes since
+     * the last sync (WebDAV sync-collection, RFC 6578) instead of walking
+     * down every directory whose etag changed.
+     */
+    bool _remoteDeltaDiscovery = false;
+
+    /** Whether the checksum of a chunked upload is computed from the data
+     * that is read for the upload instead of reading the file beforehand.
+     * The checksum is sent with the final MOVE.
+     */
+    bool _checksumWhileUploading = false;
+
+    /** Whether content checksums are looked up in and stored to the checksum
+     * cache of the journal, see SyncJournalDb::getCachedChecksum().
+     *
+     * Enabled by default, like the checksumCache setting of ConfigFile.
+     */
+    bool _checksumCache = true;
+
     static constexpr auto chunkV2MinChunkSize = 5LL * 1000LL * 1000LL; // 5 MB
     static constexpr auto chunkV2MaxChunkSize = 5LL * 1000LL * 1000LL * 1000LL; // 5 GB
 
@@ -80,7 +136,10 @@ public:
     /** Reads settings from env vars where available.
      *
      * Currently reads _initialChunkSize, _minChunkSize, _maxChunkSize,
-     * _targetChunkUploadDuration, _parallelNetworkJobs.
+     * _targetChunkUploadDuration, _parallelNetworkJobs, _adaptiveTransferConcurrency,
+     * _maxParallelChunkUploads, _maxParallelDownloadSegments, _downloadSegmentSize,
+     * _pipelinedPropagation, _journalWriteBehind, _discoveryMetadataSnapshot,
+     * _remoteDeltaDiscovery, _checksumWhileUploading, _checksumCache.
      */
     void fillFromEnvironmentVariables();
 
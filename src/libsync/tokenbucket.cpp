@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2026 by Nextcloud GmbH <info@nextcloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "tokenbucket.h"
+
+#include <QtMath>
+
+namespace OCC {
+
+TokenBucket::TokenBucket(qint64 bytesPerSecond)
+    : _rate(qMax<qint64>(0, bytesPerSecond))
+{
+    // Start with a full bucket
+    _tokens = capacity();
+}
+
+qint64 TokenBucket::capacity() const
+{
+    return qMax(minimumCapacity, _rate * burstDuration.count() / 1000);
+}
+
+double TokenBucket::tokensAt(std::chrono::milliseconds now) const
+{
+    const auto elapsed = qMax<qint64>(0, (now - _lastRefill).count());
+    return qMin<double>(capacity(), _tokens + static_cast<double>(_rate) * elapsed / 1000.0);
+}
+
+void TokenBucket::setRate(qint64 bytesPerSecond, std::chrono::milliseconds now)
+{
+    bytesPerSecond = qMax<qint64>(0, bytesPerSecond);
+    if (bytesPerSecond == _rate) {
+        return;
+    }
+    const auto wasLimited = isLimited();
+    const auto tokens = tokensAt(now);
+    _rate = bytesPerSecond;
+    _lastRefill = now;
+    // A bucket that starts limiting starts full
+    _tokens = wasLimited ? qMin<double>(tokens, capacity()) : capacity();
+}
+
+qint64 TokenBucket::available(std::chrono::milliseconds now) const
+{
+    return static_cast<qint64>(tokensAt(now));
+}
+
+qint64 TokenBucket::take(qint64 bytes, std::chrono::milliseconds now)
+{
+    if (bytes <= 0) {
+        return 0;
+    }
+    if (!isLimited()) {
+        _bytesTaken += bytes;
+        return bytes;
+    }
+
+    _tokens = tokensAt(now);
+    _lastRefill = now;
+    const auto granted = qMin(bytes, static_cast<qint64>(_tokens));
+    _tokens -= granted;
+    _bytesTaken += granted;
+    return granted;
+}
+
+std::chrono::milliseconds TokenBucket::timeUntilAvailable(qint64 bytes, std::chrono::milliseconds now) const
+{
+    if (!isLimited()) {
+        return std::chrono::milliseconds(0);
+    }
+    const auto missing = qMin<double>(bytes, capacity()) - tokensAt(now);
+    if (missing <= 0) {
+        return std::chrono::milliseconds(0);
+    }
+    return std::chrono::milliseconds(qCeil(missing * 1000.0 / _rate));
+}
+
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2026 by Nextcloud GmbH <info@nextcloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#pragma once
+
+#include "owncloudlib.h"
+
+#include <QtGlobal>
+
+#include <chrono>
+
+namespace OCC {
+
+/**
+ * @brief Token bucket for limiting the rate of a stream of bytes
+ *
+ * The bucket is refilled with rate() tokens per second and holds at most
+ * capacity() of them, which is the burst a reader can get after it was idle.
+ * Every byte that is transferred takes one token. All the readers of a
+ * direction share one bucket, so the sum of their rates is limited, no
+ * matter how many of them run in parallel.
+ *
+ * Like ConcurrencyController the class has no notion of time on its own:
+ * the caller passes the current time, measured from any fixed point. That
+ * keeps it deterministic and testable.
+ *
+ * @ingroup libsync
+ */
+class OWNCLOUDSYNC_EXPORT TokenBucket
+{
+public:
+    /// The smallest burst, one read of the network buffers
+    static constexpr qint64 minimumCapacity = 16 * 1024;
+    /// The burst is the amount of tokens that are refilled in this time
+    static constexpr std::chrono::milliseconds burstDuration{250};
+
+    /** A rate of 0 or less means no limit. */
+    explicit TokenBucket(qint64 bytesPerSecond = 0);
+
+    /** Changes the rate, keeping the tokens that fit into the new capacity. */
+    void setRate(qint64 bytesPerSecond, std::chrono::milliseconds now);
+
+    [[nodiscard]] qint64 rate() const { return _rate; }
+    [[nodiscard]] bool isLimited() const { return _rate > 0; }
+    [[nodiscard]] qint64 capacity() const;
+
+    /** The tokens that are available at now. */
+    [[nodiscard]] qint64 available(std::chrono::milliseconds now) const;
+
+    /** Takes up to bytes tokens and returns how many were taken.
+     *
+     * Without a limit all of them are granted.
+     */
+    qint64 take(qint64 bytes, std::chrono::milliseconds now);
+
+    /** How long it takes until bytes tokens are available, at most capacity(). */
+    [[nodiscard]] std::chrono::milliseconds timeUntilAvailable(qint64 bytes, std::chrono::milliseconds now) const;
+
+    /** The number of bytes that passed the bucket, with or without a limit. */
+    [[nodiscard]] qint64 bytesTaken() const { return _bytesTaken; }
+
+private:
+    [[nodiscard]] double tokensAt(std::chrono::milliseconds now) const;
+
+    qint64 _rate = 0;
+    double _tokens = 0.0;
+    std::chrono::milliseconds _lastRefill{0};
+    qint64 _bytesTaken = 0;
+};
+
+}
@@ -0,0 +1,85 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include "common/checksumalgorithms.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QDebug>
+
+#include <functional>
+
+using namespace OCC;
+
+// Hashes this much data in buffers of the size ChecksumCalculator reads
+constexpr qint64 totalSize = 512LL * 1024 * 1024;
+constexpr int bufferSize = 500 * 1024;
+
+void measure(const char *name, const QByteArray &buffer, const std::function<void(const char *, qint64)> &addData)
+{
+    QElapsedTimer timer;
+    timer.start();
+    for (qint64 done = 0; done < totalSize; done += buffer.size()) {
+        addData(buffer.constData(), buffer.size());
+    }
+    const auto msecs = qMax<qint64>(1, timer.elapsed());
+    qDebug().noquote() << QStringLiteral("%1 %2 MB/s").arg(QString::fromLatin1(name), -28).arg(totalSize / 1000 / msecs);
+}
+
+void measureQt(const char *name, const QByteArray &buffer, QCryptographicHash::Algorithm algorithm)
+{
+    QCryptographicHash hash(algorithm);
+    measure(name, buffer, [&](const char *data, qint64 size) { hash.addData(QByteArrayView(data, size)); });
+}
+
+void measureOpenSsl(const char *name, const QByteArray &buffer, const QByteArray &type)
+{
+    ChecksumAlgorithms::OpenSslDigest digest(type);
+    if (!digest.isValid()) {
+        qDebug() << name << "not provided by OpenSSL";
+        return;
+    }
+    measure(name, buffer, [&](const char *data, qint64 size) { digest.addData(data, size); });
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QByteArray buffer(bufferSize, Qt::Uninitialized);
+    quint32 state = 1;
+    for (auto &byte : buffer) {
+        state = state * 1103515245 + 12345;
+        byte = static_cast<char>(state >> 16);
+    }
+
+    qDebug() << "Adler32 implementation:" << ChecksumAlgorithms::adler32Implementation();
+    qDebug() << "CRC32C implementation:" << ChecksumAlgorithms::crc32cImplementation();
+
+    quint32 adler = 1;
+    measure("Adler32 (zlib)", buffer, [&](const char *data, qint64 size) { adler = ChecksumAlgorithms::adler32Portable(adler, data, size); });
+    quint32 fastAdler = 1;
+    measure("Adler32", buffer, [&](const char *data, qint64 size) { fastAdler = ChecksumAlgorithms::adler32(fastAdler, data, size); });
+
+    quint32 crc = 0;
+    measure("CRC32C (portable)", buffer, [&](const char *data, qint64 size) { crc = ChecksumAlgorithms::crc32cPortable(crc, data, size); });
+    quint32 fastCrc = 0;
+    measure("CRC32C", buffer, [&](const char *data, qint64 size) { fastCrc = ChecksumAlgorithms::crc32c(fastCrc, data, size); });
+
+    ChecksumAlgorithms::XxHash64 xxHash;
+    measure("XXH64", buffer, [&](const char *data, qint64 size) { xxHash.addData(data, size); });
+
+    measureQt("MD5 (QCryptographicHash)", buffer, QCryptographicHash::Md5);
+    measureOpenSsl("MD5 (OpenSSL)", buffer, "MD5");
+    measureQt("SHA1 (QCryptographicHash)", buffer, QCryptographicHash::Sha1);
+    measureOpenSsl("SHA1 (OpenSSL)", buffer, "SHA1");
+    measureQt("SHA256 (QCryptographicHash)", buffer, QCryptographicHash::Sha256);
+    measureOpenSsl("SHA256 (OpenSSL)", buffer, "SHA256");
+
+    return (adler == fastAdler && crc == fastCrc) ? 0 : -1;
+}
@@ -0,0 +1,110 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include "csync_exclude.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QDebug>
+
+using namespace OCC;
+
+#define EXCLUDE_LIST_FILE SOURCEDIR "/../../sync-exclude.lst"
+
+// How often every path is matched in the timed runs
+constexpr int rounds = 200;
+
+QStringList fileNames()
+{
+    // Mostly ordinary names, with some of every kind the patterns exclude
+    QStringList names;
+    const QStringList extensions = { "txt", "docx", "jpg", "pdf", "tmp", "part", "md", "cpp", "swp", "tex.tmp", "💩", "out", "run.xml" };
+    for (int i = 0; i < 300; ++i) {
+        const auto &extension = extensions.at(i % extensions.size());
+        names.append(QStringLiteral("document %1.%2").arg(i).arg(extension));
+        names.append(QStringLiteral("IMG_%1.%2").arg(i * 7919).arg(extension));
+    }
+    names += QStringList{ "~$report.docx", ".~lock.report.odt#", "report.docx~", ".DS_Store", "Thumbs.db", "Desktop.ini", "._resource",
+        ".sync_0123456789ab.db", ".owncloudsync.log", "foo.textClipping", ".file.swo", ".Trash-1000", "пятницы.txt", "System Volume Information",
+        "~temp.tmp", "Icon\r", "line\nbreak", "ЖУРНАЛ.TXT", "𠜎𠜎𠜎" };
+    return names;
+}
+
+void matchAll(ExcludedFiles &excludedFiles, const QStringList &paths, ItemType type, QVector<CSYNC_EXCLUDE_TYPE> &results)
+{
+    results.clear();
+    for (const auto &path : paths) {
+        results.append(excludedFiles.traversalPatternMatch(path, type));
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    // The patterns of test/testexcludedfiles.cpp and enough generated ones for
+    // a list of the size of a customized sync-exclude.lst
+    ExcludedFiles excludedFiles;
+    excludedFiles.setWildcardsMatchSlash(false);
+    excludedFiles.addExcludeFilePath(EXCLUDE_LIST_FILE);
+    excludedFiles.addManualExclude("*.💩");
+    excludedFiles.addManualExclude("пятницы.*");
+    excludedFiles.addManualExclude("*/*.out");
+    excludedFiles.addManualExclude("latex*/*.run.xml");
+    excludedFiles.addManualExclude("latex/*/*.tex.tmp");
+    for (int i = 0; i < 60; ++i) {
+        excludedFiles.addManualExclude(QStringLiteral("*.generated%1").arg(i));
+        excludedFiles.addManualExclude(QStringLiteral("]cache%1-*").arg(i));
+        excludedFiles.addManualExclude(QStringLiteral("build%1/").arg(i));
+        excludedFiles.addManualExclude(QStringLiteral("backup?%1*.bak").arg(i));
+        excludedFiles.addManualExclude(QStringLiteral("[Ll]og%1.txt").arg(i));
+    }
+    if (!excludedFiles.reloadExcludeFiles()) {
+        qWarning() << "Could not load" << EXCLUDE_LIST_FILE;
+        return -1;
+    }
+
+    const auto names = fileNames();
+    QStringList paths;
+    for (const auto &name : names) {
+        paths.append(name);
+        paths.append(QString(QStringLiteral("latex/chapter/") + name));
+    }
+
+    // Both engines have to agree on every path, for files and directories
+    int mismatches = 0;
+    QVector<CSYNC_EXCLUDE_TYPE> regexResults;
+    QVector<CSYNC_EXCLUDE_TYPE> matcherResults;
+    for (const auto type : { ItemTypeFile, ItemTypeDirectory }) {
+        excludedFiles.setNameMatcherEnabled(false);
+        matchAll(excludedFiles, paths, type, regexResults);
+        excludedFiles.setNameMatcherEnabled(true);
+        matchAll(excludedFiles, paths, type, matcherResults);
+        for (int i = 0; i < paths.size(); ++i) {
+            if (regexResults.at(i) != matcherResults.at(i)) {
+                qWarning() << "Mismatch for" << paths.at(i) << type << "regex:" << regexResults.at(i) << "matcher:" << matcherResults.at(i);
+                ++mismatches;
+            }
+        }
+    }
+    qDebug() << "Compared" << paths.size() * 2 << "paths," << mismatches << "mismatches";
+
+    // Directories are not timed: matching them looks for .sync-exclude.lst files
+    for (const auto enabled : { false, true }) {
+        excludedFiles.setNameMatcherEnabled(enabled);
+        QElapsedTimer timer;
+        timer.start();
+        QVector<CSYNC_EXCLUDE_TYPE> results;
+        for (int round = 0; round < rounds; ++round) {
+            matchAll(excludedFiles, paths, ItemTypeFile, results);
+        }
+        const auto msecs = qMax<qint64>(1, timer.elapsed());
+        qDebug().noquote() << QStringLiteral("%1 %2 files/s").arg(QString::fromLatin1(enabled ? "Name matcher" : "Regular expressions"), -20).arg(qint64(rounds) * paths.size() * 1000 / msecs);
+    }
+
+    return mismatches == 0 ? 0 : -1;
+}
@@ -62,6 +62,14 @@ QWebSocket *FakeWebSocketServer::authenticateAccount(const OCC::AccountPtr accou
         return nullptr;
     }
 
+    // The client subscribes to the ids of changed files
+    if (textMessagesCount() < 3 && !waitForTextMessages()) {
+        return nullptr;
+    }
+    if (textMessage(2) != QStringLiteral("listen notify_file_id")) {
+        return nullptr;
+    }
+
     afterAuthentication();
 
     return socket;
@@ -336,7 +336,139 @@ FileInfo *FileInfo::findInvalidatingEtags(PathComponents pathComponents)
     return find(std::move(pathComponents), true);
 }
 
-FakePropfindReply::FakePropfindReply(FileInfo &remoteRootFileInfo, QNetworkAccessManager::Operation op, const QNetworkRequest &request, QObject *parent)
+namespace {
+
+void writeDavFileResponse(QXmlStreamWriter &xml, QIODevice &device, const QString &prefix, const FileInfo &fileInfo, const QByteArray &syncToken = {})
+{
+    const QString davUri { QStringLiteral("DAV:") };
+    const QString ocUri { QStringLiteral("http://owncloud.org/ns") };
+    const QString ncUri { QStringLiteral("http://nextcloud.org/ns") };
+
+    xml.writeStartElement(davUri, QStringLiteral("response"));
+
+    const auto url = OCC::Utility::trailingSlashPath(QString::fromUtf8(QUrl::toPercentEncoding(fileInfo.absolutePath(), "/")));
+    const auto href = OCC::Utility::concatUrlPath(prefix, url).path();
+    xml.writeTextElement(davUri, QStringLiteral("href"), href);
+    xml.writeStartElement(davUri, QStringLiteral("propstat"));
+    xml.writeStartElement(davUri, QStringLiteral("prop"));
+
+    if (fileInfo.isDir) {
+        xml.writeStartElement(davUri, QStringLiteral("resourcetype"));
+        xml.writeEmptyElement(davUri, QStringLiteral("collection"));
+        xml.writeEndElement(); // resourcetype
+
+        auto totalSize = 0;
+        for (const auto &child : fileInfo.children.values()) {
+            totalSize += child.size;
+        }
+        xml.writeTextElement(ocUri, QStringLiteral("size"), QString::number(totalSize));
+    } else
+        xml.writeEmptyElement(davUri, QStringLiteral("resourcetype"));
+
+    auto gmtDate = fileInfo.lastModified.toUTC();
+    auto stringDate = QLocale::c().toString(gmtDate, QStringLiteral("ddd, dd MMM yyyy HH:mm:ss 'GMT'"));
+    xml.writeTextElement(davUri, QStringLiteral("getlastmodified"), stringDate);
+    xml.writeTextElement(davUri, QStringLiteral("getcontentlength"), QString::number(fileInfo.size));
+    xml.writeTextElement(davUri, QStringLiteral("getetag"), QStringLiteral("\"%1\"").arg(QString::fromLatin1(fileInfo.etag)));
+    xml.writeTextElement(ocUri, QStringLiteral("permissions"), !fileInfo.permissions.isNull() ? QString(fileInfo.permissions.toString()) : fileInfo.isShared ? QStringLiteral("SRDNVCKW") : QStringLiteral("RDNVCKW"));
+    xml.writeTextElement(ocUri, QStringLiteral("share-permissions"), QString::number(static_cast<int>(OCC::SharePermissions(OCC::SharePermissionRead |
+                                                                                                                            OCC::SharePermissionUpdate |
+                                                                                                                            OCC::SharePermissionCreate |
+                                                                                                                            OCC::SharePermissionDelete |
+                                                                                                                            OCC::SharePermissionShare))));
+    xml.writeTextElement(ocUri, QStringLiteral("id"), QString::fromUtf8(fileInfo.fileId));
+    xml.writeTextElement(ocUri, QStringLiteral("fileid"), QString::fromUtf8(fileInfo.fileId));
+    xml.writeTextElement(ocUri, QStringLiteral("checksums"), QString::fromUtf8(fileInfo.checksums));
+    xml.writeTextElement(ocUri, QStringLiteral("privatelink"), href);
+    xml.writeTextElement(ncUri, QStringLiteral("lock-owner"), fileInfo.lockOwnerId);
+    xml.writeTextElement(ncUri, QStringLiteral("lock"), fileInfo.lockState == FileInfo::LockState::FileLocked ? QStringLiteral("1") : QStringLiteral("0"));
+    xml.writeTextElement(ncUri, QStringLiteral("lock-owner-type"), fileInfo.lockOwnerId);
+    xml.writeTextElement(ncUri, QStringLiteral("lock-owner-displayname"), fileInfo.lockOwnerId);
+    xml.writeTextElement(ncUri, QStringLiteral("lock-owner-editor"), fileInfo.lockOwnerId);
+    xml.writeTextElement(ncUri, QStringLiteral("lock-time"), QString::number(fileInfo.lockTime));
+    xml.writeTextElement(ncUri, QStringLiteral("lock-timeout"), QString::number(fileInfo.lockTimeout));
+    xml.writeTextElement(ncUri, QStringLiteral("is-encrypted"), fileInfo.isEncrypted ? QString::number(1) : QString::number(0));
+    if (!syncToken.isEmpty()) {
+        xml.writeTextElement(davUri, QStringLiteral("sync-token"), QString::fromUtf8(syncToken));
+    }
+    device.write(fileInfo.extraDavProperties);
+    xml.writeEndElement(); // prop
+    xml.writeTextElement(davUri, QStringLiteral("status"), QStringLiteral("HTTP/1.1 200 OK"));
+    xml.writeEndElement(); // propstat
+    xml.writeEndElement(); // response
+}
+
+bool differsForPropfind(const FileInfo &lhs, const FileInfo &rhs)
+{
+    return lhs.etag != rhs.etag || lhs.fileId != rhs.fileId || lhs.isDir != rhs.isDir || lhs.size != rhs.size
+        || lhs.lastModified != rhs.lastModified || lhs.permissions.toString() != rhs.permissions.toString()
+        || lhs.checksums != rhs.checksums || lhs.lockState != rhs.lockState || lhs.isEncrypted != rhs.isEncrypted;
+}
+
+// Members of current that are new or changed since the state since, and the ones removed since then
+void collectChanges(const FileInfo &current, const FileInfo *since, QVector<const FileInfo *> &changed, QVector<const FileInfo *> &removed)
+{
+    for (const auto &child : current.children) {
+        const auto sinceChild = since ? since->children.constFind(child.name) : QMap<QString, FileInfo>::const_iterator();
+        const auto known = since && sinceChild != since->children.cend();
+        if (!known || differsForPropfind(child, *sinceChild)) {
+            changed.push_back(&child);
+        }
+        if (child.isDir) {
+            collectChanges(child, known && sinceChild->isDir ? &*sinceChild : nullptr, changed, removed);
+        }
+    }
+    if (!since) {
+        return;
+    }
+    for (const auto &sinceChild : since->children) {
+        if (!current.children.contains(sinceChild.name)) {
+            removed.push_back(&sinceChild);
+        }
+    }
+}
+
+QByteArray syncCollectionPayload(FileInfo &remoteRootFileInfo, FileInfo &since, const QByteArray &syncToken, const QNetworkRequest &request)
+{
+    const QString fileName = getFilePathFromUrl(request.url());
+    const FileInfo *current = remoteRootFileInfo.find(fileName);
+    const FileInfo *sinceCurrent = since.find(fileName);
+    Q_ASSERT(current);
+    const QString prefix = request.url().path().left(request.url().path().size() - fileName.size());
+
+    QVector<const FileInfo *> changed;
+    QVector<const FileInfo *> removed;
+    collectChanges(*current, sinceCurrent, changed, removed);
+
+    const QString davUri { QStringLiteral("DAV:") };
+    QByteArray payload;
+    QBuffer buffer { &payload };
+    buffer.open(QIODevice::WriteOnly);
+    QXmlStreamWriter xml(&buffer);
+    xml.writeNamespace(davUri, QStringLiteral("d"));
+    xml.writeNamespace(QStringLiteral("http://owncloud.org/ns"), QStringLiteral("oc"));
+    xml.writeNamespace(QStringLiteral("http://nextcloud.org/ns"), QStringLiteral("nc"));
+    xml.writeStartDocument();
+    xml.writeStartElement(davUri, QStringLiteral("multistatus"));
+    for (const auto fileInfo : qAsConst(changed)) {
+        writeDavFileResponse(xml, buffer, prefix, *fileInfo);
+    }
+    for (const auto fileInfo : qAsConst(removed)) {
+        xml.writeStartElement(davUri, QStringLiteral("response"));
+        const auto url = QString::fromUtf8(QUrl::toPercentEncoding(fileInfo->absolutePath(), "/"));
+        xml.writeTextElement(davUri, QStringLiteral("href"), OCC::Utility::concatUrlPath(prefix, url).path());
+        xml.writeTextElement(davUri, QStringLiteral("status"), QStringLiteral("HTTP/1.1 404 Not Found"));
+        xml.writeEndElement(); // response
+    }
+    xml.writeTextElement(davUri, QStringLiteral("sync-token"), QString::fromUtf8(syncToken));
+    xml.writeEndElement(); // multistatus
+    xml.writeEndDocument();
+    return payload;
+}
+
+}
+
+FakePropfindReply::FakePropfindReply(FileInfo &remoteRootFileInfo, QNetworkAccessManager::Operation op, const QNetworkRequest &request, QObject *parent, const QByteArray &syncToken)
     : FakeReply { parent }
 {
     setRequest(request);
@@ -365,61 +497,9 @@ FakePropfindReply::FakePropfindReply(FileInfo &remoteRootFileInfo, QNetworkAcces
     xml.writeNamespace(ncUri, QStringLiteral("nc"));
     xml.writeStartDocument();
     xml.writeStartElement(davUri, QStringLiteral("multistatus"));
-    auto writeFileResponse = [&](const FileInfo &fileInfo) {
-        xml.writeStartElement(davUri, QStringLiteral("response"));
-
-        const auto url = OCC::Utility::trailingSlashPath(QString::fromUtf8(QUrl::toPercentEncoding(fileInfo.absolutePath(), "/")));
-        const auto href = OCC::Utility::concatUrlPath(prefix, url).path();
-        xml.writeTextElement(davUri, QStringLiteral("href"), href);
-        xml.writeStartElement(davUri, QStringLiteral("propstat"));
-        xml.writeStartElement(davUri, QStringLiteral("prop"));
-
-        if (fileInfo.isDir) {
-            xml.writeStartElement(davUri, QStringLiteral("resourcetype"));
-            xml.writeEmptyElement(davUri, QStringLiteral("collection"));
-            xml.writeEndElement(); // resourcetype
-
-            auto totalSize = 0;
-            for (const auto &child : fileInfo.children.values()) {
-                totalSize += child.size;
-            }
-            xml.writeTextElement(ocUri, QStringLiteral("size"), QString::number(totalSize));
-        } else
-            xml.writeEmptyElement(davUri, QStringLiteral("resourcetype"));
-
-        auto gmtDate = fileInfo.lastModified.toUTC();
-        auto stringDate = QLocale::c().toString(gmtDate, QStringLiteral("ddd, dd MMM yyyy HH:mm:ss 'GMT'"));
-        xml.writeTextElement(davUri, QStringLiteral("getlastmodified"), stringDate);
-        xml.writeTextElement(davUri, QStringLiteral("getcontentlength"), QString::number(fileInfo.size));
-        xml.writeTextElement(davUri, QStringLiteral("getetag"), QStringLiteral("\"%1\"").arg(QString::fromLatin1(fileInfo.etag)));
-        xml.writeTextElement(ocUri, QStringLiteral("permissions"), !fileInfo.permissions.isNull() ? QString(fileInfo.permissions.toString()) : fileInfo.isShared ? QStringLiteral("SRDNVCKW") : QStringLiteral("RDNVCKW"));
-        xml.writeTextElement(ocUri, QStringLiteral("share-permissions"), QString::number(static_cast<int>(OCC::SharePermissions(OCC::SharePermissionRead |
-                                                                                                                                OCC::SharePermissionUpdate |
-                                                                                                                                OCC::SharePermissionCreate |
-                                                                                                                                OCC::SharePermissionDelete |
-                                                                                                                                OCC::SharePermissionShare))));
-        xml.writeTextElement(ocUri, QStringLiteral("id"), QString::fromUtf8(fileInfo.fileId));
-        xml.writeTextElement(ocUri, QStringLiteral("fileid"), QString::fromUtf8(fileInfo.fileId));
-        xml.writeTextElement(ocUri, QStringLiteral("checksums"), QString::fromUtf8(fileInfo.checksums));
-        xml.writeTextElement(ocUri, QStringLiteral("privatelink"), href);
-        xml.writeTextElement(ncUri, QStringLiteral("lock-owner"), fileInfo.lockOwnerId);
-        xml.writeTextElement(ncUri, QStringLiteral("lock"), fileInfo.lockState == FileInfo::LockState::FileLocked ? QStringLiteral("1") : QStringLiteral("0"));
-        xml.writeTextElement(ncUri, QStringLiteral("lock-owner-type"), fileInfo.lockOwnerId);
-        xml.writeTextElement(ncUri, QStringLiteral("lock-owner-displayname"), fileInfo.lockOwnerId);
-        xml.writeTextElement(ncUri, QStringLiteral("lock-owner-editor"), fileInfo.lockOwnerId);
-        xml.writeTextElement(ncUri, QStringLiteral("lock-time"), QString::number(fileInfo.lockTime));
-        xml.writeTextElement(ncUri, QStringLiteral("lock-timeout"), QString::number(fileInfo.lockTimeout));
-        xml.writeTextElement(ncUri, QStringLiteral("is-encrypted"), fileInfo.isEncrypted ? QString::number(1) : QString::number(0));
-        buffer.write(fileInfo.extraDavProperties);
-        xml.writeEndElement(); // prop
-        xml.writeTextElement(davUri, QStringLiteral("status"), QStringLiteral("HTTP/1.1 200 OK"));
-        xml.writeEndElement(); // propstat
-        xml.writeEndElement(); // response
-    };
-
-    writeFileResponse(*fileInfo);
+    writeDavFileResponse(xml, buffer, prefix, *fileInfo, syncToken);
     foreach (const FileInfo &childFileInfo, fileInfo->children)
-        writeFileResponse(childFileInfo);
+        writeDavFileResponse(xml, buffer, prefix, childFileInfo);
     xml.writeEndElement(); // multistatus
     xml.writeEndDocument();
 
@@ -471,6 +551,12 @@ qint64 FakePropfindReply::readData(char *data, qint64 maxlen)
     return len;
 }
 
+FakeSyncCollectionReply::FakeSyncCollectionReply(FileInfo &remoteRootFileInfo, FileInfo &since, const QByteArray &syncToken, QNetworkAccessManager::Operation op, const QNetworkRequest &request, QObject *parent)
+    : FakePropfindReply { syncCollectionPayload(remoteRootFileInfo, since, syncToken, request), op, request, parent }
+{
+    open(QIODevice::ReadOnly);
+}
+
 FakePutReply::FakePutReply(FileInfo &remoteRootFileInfo, QNetworkAccessManager::Operation op, const QNetworkRequest &request, const QByteArray &putPayload, QObject *parent)
     : FakeReply { parent }
 {
@@ -1084,7 +1170,10 @@ QNetworkReply *FakeQNAM::createRequest(QNetworkAccessManager::Operation op, cons
         auto verb = newRequest.attribute(QNetworkRequest::CustomVerbAttribute).toString();
         if (verb == QLatin1String("PROPFIND")) {
             // Ignore outgoingData always returning something good enough, works for now.
-            reply = new FakePropfindReply { info, op, newRequest, this };
+            const auto isRoot = !isUpload && getFilePathFromUrl(newRequest.url()).isEmpty();
+            reply = new FakePropfindReply { info, op, newRequest, this, _syncCollectionEnabled && isRoot ? newSyncToken() : QByteArray() };
+        } else if (verb == QLatin1String("REPORT")) {
+            reply = syncCollectionReply(op, newRequest, outgoingData);
         } else if (verb == QLatin1String("GET") || op == QNetworkAccessManager::GetOperation) {
             reply = new FakeGetReply { info, op, newRequest, this };
         } else if (verb == QLatin1String("PUT") || op == QNetworkAccessManager::PutOperation) {
@@ -1117,6 +1206,32 @@ QNetworkReply *FakeQNAM::createRequest(QNetworkAccessManager::Operation op, cons
     return reply;
 }
 
+QByteArray FakeQNAM::newSyncToken()
+{
+    const auto syncToken = QByteArrayLiteral("http://example.com/ns/sync/") + QByteArray::number(++_lastSyncToken);
+    _syncTokenStates.insert(syncToken, _remoteRootFileInfo);
+    return syncToken;
+}
+
+QNetworkReply *FakeQNAM::syncCollectionReply(Operation op, const QNetworkRequest &request, QIODevice *outgoingData)
+{
+    QByteArray syncToken;
+    QXmlStreamReader reader(outgoingData->readAll());
+    while (!reader.atEnd()) {
+        if (reader.readNext() == QXmlStreamReader::StartElement && reader.name() == QLatin1String("sync-token")) {
+            syncToken = reader.readElementText().toUtf8();
+            break;
+        }
+    }
+
+    if (!_syncCollectionEnabled || !_syncTokenStates.contains(syncToken)) {
+        return new FakeErrorReply { op, request, this, 403,
+            QByteArrayLiteral("<?xml version=\"1.0\"?><d:error xmlns:d=\"DAV:\"><d:valid-sync-token/></d:error>") };
+    }
+    auto since = _syncTokenStates.value(syncToken);
+    return new FakeSyncCollectionReply { _remoteRootFileInfo, since, newSyncToken(), op, request, this };
+}
+
 QNetworkReply * FakeQNAM::overrideReplyWithError(QString fileName, QNetworkAccessManager::Operation op, QNetworkRequest newRequest)
 {
     QNetworkReply *reply = nullptr;
@@ -217,10 +217,10 @@ class FakePropfindReply : public FakeReply
 public:
     QByteArray payload;
 
-    explicit FakePropfindReply(FileInfo &remoteRootFileInfo, QNetworkAccessManager::Operation op, const QNetworkRequest &request, QObject *parent);
+    explicit FakePropfindReply(FileInfo &remoteRootFileInfo, QNetworkAccessManager::Operation op, const QNetworkRequest &request, QObject *parent, const QByteArray &syncToken = {});
     explicit FakePropfindReply(const QByteArray &replyContents, QNetworkAccessManager::Operation op, const QNetworkRequest &request, QObject *parent);
 
-    Q_INVOKABLE void respond();
+    Q_INVOKABLE virtual void respond();
 
     Q_INVOKABLE void respond404();
 
@@ -230,6 +230,14 @@ public:
     qint64 readData(char *data, qint64 maxlen) override;
 };
 
+// Answers a sync-collection REPORT with the differences between two states of the remote tree
+class FakeSyncCollectionReply : public FakePropfindReply
+{
+    Q_OBJECT
+public:
+    FakeSyncCollectionReply(FileInfo &remoteRootFileInfo, FileInfo &since, const QByteArray &syncToken, QNetworkAccessManager::Operation op, const QNetworkRequest &request, QObject *parent);
+};
+
 class FakePutReply : public FakeReply
 {
     Q_OBJECT
@@ -314,7 +322,7 @@ public:
 
     FakeGetReply(FileInfo &remoteRootFileInfo, QNetworkAccessManager::Operation op, const QNetworkRequest &request, QObject *parent);
 
-    Q_INVOKABLE void respond();
+    Q_INVOKABLE virtual void respond();
 
     void abort() override;
     [[nodiscard]] qint64 bytesAvailable() const override;
@@ -474,6 +482,10 @@ private:
     QHash<QString, int> _errorPaths;
     // monitor requests and optionally provide custom replies
     Override _override;
+    // remote state at each sync-token handed out, if sync-collection REPORTs are supported
+    bool _syncCollectionEnabled = false;
+    QHash<QByteArray, FileInfo> _syncTokenStates;
+    int _lastSyncToken = 0;
 
 public:
     FakeQNAM(FileInfo initialRoot);
@@ -484,12 +496,20 @@ public:
 
     void setOverride(const Override &override) { _override = override; }
 
+    // The root PROPFIND reports a sync-token that can be used for sync-collection REPORTs
+    void setSyncCollectionEnabled(bool enabled) { _syncCollectionEnabled = enabled; }
+    // Makes the handed out sync-tokens invalid, like a server that expired them
+    void forgetSyncTokens() { _syncTokenStates.clear(); }
+
     QJsonObject forEachReplyPart(QIODevice *outgoingData,
                                  const QString &contentType,
                                  std::function<QJsonObject(const QMap<QString, QByteArray> &)> replyFunction);
 
     QNetworkReply *overrideReplyWithError(QString fileName, Operation op, QNetworkRequest newRequest);
 
+    QByteArray newSyncToken();
+    QNetworkReply *syncCollectionReply(Operation op, const QNetworkRequest &request, QIODevice *outgoingData);
+
 protected:
     QNetworkReply *createRequest(Operation op, const QNetworkRequest &request,
         QIODevice *outgoingData = nullptr) override;
@@ -553,6 +573,8 @@ public:
     };
     ErrorList serverErrorPaths() { return {_fakeQnam}; }
     void setServerOverride(const FakeQNAM::Override &override) { _fakeQnam->setOverride(override); }
+    void setServerSyncCollectionEnabled(bool enabled) { _fakeQnam->setSyncCollectionEnabled(enabled); }
+    void forgetServerSyncTokens() { _fakeQnam->forgetSyncTokens(); }
     QJsonObject forEachReplyPart(QIODevice *outgoingData,
                                  const QString &contentType,
                                  std::function<QJsonObject(const QMap<QString, QByteArray>&)> replyFunction) {
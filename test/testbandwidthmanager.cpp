@@ -0,0 +1,237 @@
+/*
+   This software is in the public domain, furnished "as is", without technical
+   support, and with no warranty, express or implied, as to its usefulness for
+   any purpose.
+*/
+
+#include <QtTest>
+
+#include "account.h"
+#include "bandwidthmanager.h"
+#include "owncloudpropagator.h"
+#include "propagateupload.h"
+#include "tokenbucket.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+using namespace OCC;
+using namespace std::chrono_literals;
+
+class TestBandwidthManager : public QObject
+{
+    Q_OBJECT
+
+    QTemporaryDir _tempDir;
+    QString _filePath;
+
+    static constexpr qint64 fileSize = 192 * 1024;
+
+private slots:
+    void initTestCase()
+    {
+        OCC::Logger::instance()->setLogFlush(true);
+        OCC::Logger::instance()->setLogDebug(true);
+
+        QStandardPaths::setTestModeEnabled(true);
+
+        QVERIFY(_tempDir.isValid());
+        _filePath = _tempDir.filePath(QStringLiteral("data"));
+        QFile file(_filePath);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        QCOMPARE(file.write(QByteArray(fileSize, 'A')), fileSize);
+    }
+
+    void testUnlimitedBucket()
+    {
+        TokenBucket bucket;
+        QVERIFY(!bucket.isLimited());
+        QCOMPARE(bucket.take(10 * 1024 * 1024, 0ms), qint64(10 * 1024 * 1024));
+        QCOMPARE(bucket.take(5, 0ms), qint64(5));
+        QCOMPARE(bucket.bytesTaken(), qint64(10 * 1024 * 1024 + 5));
+        QVERIFY(bucket.timeUntilAvailable(1024 * 1024, 0ms) == 0ms);
+    }
+
+    void testCapacity()
+    {
+        QCOMPARE(TokenBucket(1000).capacity(), TokenBucket::minimumCapacity);
+        QCOMPARE(TokenBucket(1000 * 1000).capacity(), qint64(250 * 1000));
+    }
+
+    void testBurstAndRefill()
+    {
+        TokenBucket bucket(1000 * 1000);
+
+        // Starts full, but never gives more than the burst
+        QCOMPARE(bucket.take(1000 * 1000, 0ms), qint64(250 * 1000));
+        QCOMPARE(bucket.take(1, 0ms), qint64(0));
+        QVERIFY(bucket.timeUntilAvailable(10 * 1000, 0ms) == 10ms);
+
+        QCOMPARE(bucket.available(10ms), qint64(10 * 1000));
+        QCOMPARE(bucket.take(20 * 1000, 10ms), qint64(10 * 1000));
+
+        // Idle time is only credited up to the capacity
+        QCOMPARE(bucket.available(10s), bucket.capacity());
+        QCOMPARE(bucket.bytesTaken(), qint64(260 * 1000));
+    }
+
+    void testSetRate()
+    {
+        TokenBucket bucket;
+        bucket.setRate(100 * 1000, 0ms);
+        QVERIFY(bucket.isLimited());
+        QCOMPARE(bucket.available(0ms), qint64(25 * 1000));
+        QCOMPARE(bucket.take(25 * 1000, 0ms), qint64(25 * 1000));
+
+        // The tokens refilled at the old rate are kept
+        bucket.setRate(1000 * 1000, 100ms);
+        QCOMPARE(bucket.available(100ms), qint64(10 * 1000));
+        QCOMPARE(bucket.available(110ms), qint64(20 * 1000));
+
+        // A smaller capacity drops the excess tokens
+        bucket.setRate(1000, 10s);
+        QCOMPARE(bucket.available(10s), TokenBucket::minimumCapacity);
+
+        bucket.setRate(0, 10s);
+        QVERIFY(!bucket.isLimited());
+    }
+
+    void testAchievedRateOfParallelReaders_data()
+    {
+        QTest::addColumn<qint64>("rate");
+        QTest::addColumn<int>("readers");
+
+        QTest::newRow("100 kB/s, 1 reader") << qint64(100 * 1000) << 1;
+        QTest::newRow("100 kB/s, 8 readers") << qint64(100 * 1000) << 8;
+        QTest::newRow("50 MB/s, 6 readers") << qint64(50 * 1000 * 1000) << 6;
+    }
+
+    void testAchievedRateOfParallelReaders()
+    {
+        QFETCH(qint64, rate);
+        QFETCH(int, readers);
+
+        // Every reader asks for a 16 kB block every millisecond, for 10 seconds
+        TokenBucket bucket(rate);
+        std::vector<qint64> received(readers, 0);
+        const auto duration = 10000ms;
+        for (auto now = 0ms; now < duration; ++now) {
+            for (int i = 0; i < readers; ++i) {
+                const auto reader = (i + now.count()) % readers;
+                received[reader] += bucket.take(16 * 1024, now);
+            }
+        }
+
+        qint64 total = 0;
+        for (const auto bytes : received) {
+            QVERIFY(bytes > 0);
+            total += bytes;
+        }
+        const auto achieved = total * 1000 / duration.count();
+        const auto rates = QStringLiteral("configured %1 achieved %2 bytes/s").arg(rate).arg(achieved);
+        QCOMPARE(bucket.bytesTaken(), total);
+
+        // The only excess is the initial burst
+        QVERIFY2(total <= rate * duration.count() / 1000 + bucket.capacity(), qPrintable(rates));
+        QVERIFY2(achieved >= rate * 99 / 100, qPrintable(rates));
+    }
+
+    void testUnlimitedUploadDevices()
+    {
+        BandwidthManager manager;
+        UploadDevice device(_filePath, 0, fileSize, &manager);
+        QVERIFY(device.open(QIODevice::ReadOnly | QIODevice::Unbuffered));
+        QCOMPARE(qint64(device.readAll().size()), fileSize);
+
+        // A relative limit starts with measuring the unlimited throughput
+        manager.setUploadLimit(-50);
+        QVERIFY(manager.usingRelativeUploadLimit());
+        UploadDevice measuredDevice(_filePath, 0, fileSize, &manager);
+        QVERIFY(measuredDevice.open(QIODevice::ReadOnly | QIODevice::Unbuffered));
+        QCOMPARE(qint64(measuredDevice.readAll().size()), fileSize);
+    }
+
+    void testParallelUploadDevicesHonorLimit_data()
+    {
+        QTest::addColumn<int>("engines");
+
+        QTest::newRow("one engine") << 1;
+        QTest::newRow("two engines of one account") << 2;
+    }
+
+    void testParallelUploadDevicesHonorLimit()
+    {
+        QFETCH(int, engines);
+        const qint64 limit = 512 * 1024;
+        const int deviceCount = 4;
+
+        // The propagators of the folders of an account share its limit
+        const auto account = Account::create();
+        QSet<QString> bulkUploadBlackList;
+        std::vector<std::unique_ptr<OwncloudPropagator>> propagators;
+        for (int i = 0; i < engines; ++i) {
+            propagators.push_back(std::make_unique<OwncloudPropagator>(account, _tempDir.path(), QStringLiteral("/"), nullptr, bulkUploadBlackList));
+            propagators.back()->bandwidthManager()->setUploadLimit(limit);
+        }
+        QCOMPARE(propagators.front()->bandwidthManager(), propagators.back()->bandwidthManager());
+        QVERIFY(propagators.front()->bandwidthManager()->usingAbsoluteUploadLimit());
+
+        std::vector<std::unique_ptr<UploadDevice>> devices;
+        std::vector<qint64> progress(deviceCount, 0);
+        qint64 progressOfOthersAtFirstFinish = -1;
+        QByteArray buffer(16 * 1024, Qt::Uninitialized);
+
+        // Reads like QNAM does: until the device has nothing, then waits for readyRead()
+        auto pump = [&](int i) {
+            auto &device = devices[i];
+            while (!device->atEnd()) {
+                const auto read = device->read(buffer.data(), buffer.size());
+                if (read <= 0) {
+                    return;
+                }
+                progress[i] += read;
+            }
+            if (progressOfOthersAtFirstFinish < 0) {
+                progressOfOthersAtFirstFinish = fileSize * deviceCount;
+                for (int other = 0; other < deviceCount; ++other) {
+                    if (other != i) {
+                        progressOfOthersAtFirstFinish = qMin(progressOfOthersAtFirstFinish, progress[other]);
+                    }
+                }
+            }
+        };
+
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < deviceCount; ++i) {
+            devices.push_back(std::make_unique<UploadDevice>(_filePath, 0, fileSize, propagators[i % engines]->bandwidthManager()));
+            QVERIFY(devices.back()->open(QIODevice::ReadOnly | QIODevice::Unbuffered));
+            connect(devices.back().get(), &QIODevice::readyRead, this, [&pump, i] { pump(i); });
+        }
+        for (int i = 0; i < deviceCount; ++i) {
+            pump(i);
+        }
+
+        const auto allDone = [&] {
+            return std::all_of(progress.cbegin(), progress.cend(), [](qint64 bytes) { return bytes == fileSize; });
+        };
+        QTRY_VERIFY_WITH_TIMEOUT(allDone(), 20000);
+        const auto elapsed = qMax<qint64>(1, timer.elapsed());
+
+        // All the devices made progress at the same time
+        QVERIFY(progressOfOthersAtFirstFinish > 0);
+
+        // Everything but the initial burst is limited
+        const auto total = fileSize * deviceCount;
+        const auto burst = TokenBucket(limit).capacity();
+        const auto achieved = (total - burst) * 1000 / elapsed;
+        const auto rates = QStringLiteral("configured %1 achieved %2 bytes/s in %3 ms").arg(limit).arg(achieved).arg(elapsed);
+        QVERIFY2(achieved <= limit * 105 / 100, qPrintable(rates));
+        QVERIFY2(achieved >= limit / 2, qPrintable(rates));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestBandwidthManager)
+#include "testbandwidthmanager.moc"
@@ -0,0 +1,127 @@
+/*
+   This software is in the public domain, furnished "as is", without technical
+   support, and with no warranty, express or implied, as to its usefulness for
+   any purpose.
+*/
+
+#include <QtTest>
+
+#include "bulkuploadbatchcontroller.h"
+#include "logger.h"
+
+using namespace OCC;
+using namespace std::chrono_literals;
+
+class TestBulkUploadBatchController : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase()
+    {
+        OCC::Logger::instance()->setLogFlush(true);
+        OCC::Logger::instance()->setLogDebug(true);
+
+        QStandardPaths::setTestModeEnabled(true);
+    }
+
+    void testInitialBatch()
+    {
+        BulkUploadBatchController controller(10000000, 5000000, 100000000, 60s);
+        QCOMPARE(controller.batchFiles(), BulkUploadBatchController::defaultBatchFiles);
+        QCOMPARE(controller.batchBytes(), qint64(10000000));
+
+        BulkUploadBatchController clamped(1000, 5000000, 100000000, 60s);
+        QCOMPARE(clamped.batchBytes(), qint64(5000000));
+    }
+
+    void testFastBatchesGrow()
+    {
+        BulkUploadBatchController controller(10000000, 5000000, 100000000, 60s);
+
+        // 100 small files in half a second: far below the target duration
+        controller.addBatch(100, 500000, 500ms, 207);
+        QCOMPARE(controller.batchFiles(), (100 + BulkUploadBatchController::maximumBatchFiles) / 2);
+        QCOMPARE(controller.batchBytes(), qint64((10000000 + 60000000) / 2));
+
+        for (int i = 0; i < 20; ++i) {
+            controller.addBatch(controller.batchFiles(), 500000, 500ms, 207);
+        }
+        QCOMPARE(controller.batchFiles(), BulkUploadBatchController::maximumBatchFiles);
+        QVERIFY(controller.batchBytes() <= controller.maximumBytes());
+    }
+
+    void testSlowBatchesShrink()
+    {
+        BulkUploadBatchController controller(10000000, 1000000, 100000000, 60s);
+
+        // Twice the target duration: move half way towards half the size
+        controller.addBatch(100, 10000000, 120s, 200);
+        QCOMPARE(controller.batchFiles(), 75);
+        QCOMPARE(controller.batchBytes(), qint64(7500000));
+
+        for (int i = 0; i < 20; ++i) {
+            controller.addBatch(controller.batchFiles(), controller.batchBytes(), 600s, 200);
+        }
+        QCOMPARE(controller.batchFiles(), BulkUploadBatchController::minimumBatchFiles);
+        QCOMPARE(controller.batchBytes(), qint64(1000000));
+    }
+
+    void testCongestion()
+    {
+        BulkUploadBatchController controller(10000000, 1000000, 100000000, 60s);
+        controller.addBatch(100, 1000000, 10s, 503);
+        QCOMPARE(controller.batchFiles(), 50);
+        QCOMPARE(controller.batchBytes(), qint64(5000000));
+
+        controller.addBatch(50, 1000000, 10s, 429);
+        QCOMPARE(controller.batchFiles(), 25);
+        QCOMPARE(controller.batchBytes(), qint64(2500000));
+
+        // Errors of the files don't say anything about the batch size
+        controller.addBatch(25, 1000000, 10s, 400);
+        controller.addBatch(25, 1000000, 10s, 0);
+        QCOMPARE(controller.batchFiles(), 25);
+        QCOMPARE(controller.batchBytes(), qint64(2500000));
+        QCOMPARE(controller.uploadedFiles(), qint64(0));
+    }
+
+    void testRequestTooLarge()
+    {
+        BulkUploadBatchController controller(10000000, 1000000, 100000000, 60s);
+        controller.addBatch(100, 8000000, 1s, 413);
+        QCOMPARE(controller.maximumBytes(), qint64(4000000));
+        QCOMPARE(controller.batchBytes(), qint64(4000000));
+        QCOMPARE(controller.batchFiles(), 50);
+
+        // The limit of the server stays, however fast the batches are
+        for (int i = 0; i < 10; ++i) {
+            controller.addBatch(50, 4000000, 100ms, 200);
+        }
+        QCOMPARE(controller.batchBytes(), qint64(4000000));
+        QVERIFY(controller.batchFiles() > 50);
+    }
+
+    void testFixedBatchSize()
+    {
+        BulkUploadBatchController controller(10000000, 1000000, 100000000, 0ms);
+        controller.addBatch(100, 1000000, 100ms, 200);
+        controller.addBatch(100, 1000000, 100s, 200);
+        QCOMPARE(controller.batchFiles(), BulkUploadBatchController::defaultBatchFiles);
+        QCOMPARE(controller.batchBytes(), qint64(10000000));
+    }
+
+    void testFilesPerSecond()
+    {
+        BulkUploadBatchController controller(10000000, 1000000, 100000000, 60s);
+        QCOMPARE(controller.filesPerSecond(), 0.0);
+
+        controller.addBatch(100, 1000000, 500ms, 200);
+        controller.addBatch(300, 1000000, 1500ms, 200);
+        QCOMPARE(controller.uploadedFiles(), qint64(400));
+        QCOMPARE(controller.filesPerSecond(), 200.0);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestBulkUploadBatchController)
+#include "testbulkuploadbatchcontroller.moc"
@@ -6,12 +6,15 @@
  */
 
 #include <QtTest>
+#include <QCryptographicHash>
 #include <QDir>
 #include <QString>
 
 #include "common/checksums.h"
 #include "networkjobs.h"
+#include "common/checksumalgorithms.h"
 #include "common/checksumcalculator.h"
+#include "common/checksumthreadpool.h"
 #include "common/checksumconsts.h"
 #include "common/utility.h"
 #include "filesystem.h"
@@ -123,6 +126,75 @@ private slots:
         QCOMPARE(sSum, sum);
     }
 
+    void testChecksumAlgorithms_data()
+    {
+        QTest::addColumn<int>("size");
+        for (const auto size : {0, 1, 7, 8, 31, 32, 33, 100, 5552, 5553, 70000, 1000003}) {
+            QTest::newRow(QByteArray::number(size).constData()) << size;
+        }
+    }
+
+    void testChecksumAlgorithms()
+    {
+        QFETCH(int, size);
+        QByteArray data(size, Qt::Uninitialized);
+        quint32 state = 12345;
+        for (auto &byte : data) {
+            state = state * 1103515245 + 12345;
+            byte = static_cast<char>(state >> 16);
+        }
+
+        // The accelerated implementations agree with the portable ones
+        QCOMPARE(ChecksumAlgorithms::adler32(1, data.constData(), size), ChecksumAlgorithms::adler32Portable(1, data.constData(), size));
+        QCOMPARE(ChecksumAlgorithms::crc32c(0, data.constData(), size), ChecksumAlgorithms::crc32cPortable(0, data.constData(), size));
+
+        // Feeding the data in pieces gives the same result
+        ChecksumAlgorithms::XxHash64 whole;
+        whole.addData(data.constData(), size);
+        ChecksumAlgorithms::XxHash64 pieces;
+        auto crc = quint32(0);
+        auto adler = quint32(1);
+        for (int offset = 0, piece = 1; offset < size; offset += piece, piece = piece * 3 % 97 + 1) {
+            piece = qMin(piece, size - offset);
+            pieces.addData(data.constData() + offset, piece);
+            crc = ChecksumAlgorithms::crc32c(crc, data.constData() + offset, piece);
+            adler = ChecksumAlgorithms::adler32(adler, data.constData() + offset, piece);
+        }
+        QCOMPARE(pieces.result(), whole.result());
+        QCOMPARE(crc, ChecksumAlgorithms::crc32cPortable(0, data.constData(), size));
+        QCOMPARE(adler, ChecksumAlgorithms::adler32Portable(1, data.constData(), size));
+
+        // OpenSSL computes the same digests as Qt
+        const QVector<QPair<QByteArray, QCryptographicHash::Algorithm>> digests = {
+            {OCC::checkSumMD5C, QCryptographicHash::Md5},
+            {OCC::checkSumSHA1C, QCryptographicHash::Sha1},
+            {OCC::checkSumSHA2C, QCryptographicHash::Sha256},
+            {OCC::checkSumSHA3C, QCryptographicHash::Sha3_256},
+        };
+        for (const auto &digest : digests) {
+            ChecksumCalculator calculator(digest.first);
+            QVERIFY(calculator.addData(data.constData(), size));
+            QCOMPARE(calculator.result(), QCryptographicHash::hash(data, digest.second).toHex());
+        }
+    }
+
+    void testChecksumAlgorithmsKnownValues()
+    {
+        const auto checksum = [](const char *type, const QByteArray &data) {
+            ChecksumCalculator calculator{QByteArray(type)};
+            calculator.addData(data.constData(), data.size());
+            return calculator.result();
+        };
+        QCOMPARE(checksum(OCC::checkSumAdlerC, "Wikipedia"), QByteArray("11e60398"));
+        QCOMPARE(checksum(OCC::checkSumCrc32cC, ""), QByteArray("00000000"));
+        QCOMPARE(checksum(OCC::checkSumCrc32cC, "123456789"), QByteArray("e3069283"));
+        QCOMPARE(checksum(OCC::checkSumXxh64C, ""), QByteArray("ef46db3751d8e999"));
+        QCOMPARE(checksum(OCC::checkSumXxh64C, "abc"), QByteArray("44bc2cf5ad770999"));
+
+        QCOMPARE(findBestChecksum("ADLER32:1 CRC32C:2 XXH64:3"), QByteArray("XXH64:3"));
+        QCOMPARE(findBestChecksum("CRC32C:2 SHA1:4"), QByteArray("SHA1:4"));
+    }
+
     void testUploadChecksummingAdler() {
 #ifndef ZLIB_FOUND
         QSKIP("ZLIB not found.", SkipSingle);
@@ -223,6 +295,55 @@ private slots:
     }
 
 
+    void testChecksumThreadPool()
+    {
+        auto pool = ChecksumThreadPool::instance();
+        const auto previousMaxThreads = pool->maxThreadsPerDevice();
+        pool->setMaxThreadsPerDevice(1);
+        const auto before = pool->statistics();
+
+        QStringList files;
+        qint64 totalSize = 0;
+        for (int i = 0; i < 5; ++i) {
+            const auto file = QStringLiteral("%1/pool_%2.bin").arg(_root.path()).arg(i);
+            QVERIFY(writeRandomFile(file));
+            totalSize += QFileInfo(file).size();
+            files.append(file);
+        }
+        QVERIFY(!ChecksumThreadPool::deviceKey(files.first()).isEmpty());
+        QCOMPARE(ChecksumThreadPool::deviceKey(files.first()), ChecksumThreadPool::deviceKey(files.last()));
+
+        auto pending = files.size();
+        for (const auto &file : qAsConst(files)) {
+            auto computeChecksum = new ComputeChecksum(this);
+            computeChecksum->setChecksumType(OCC::checkSumSHA1C);
+            connect(computeChecksum, &ComputeChecksum::done, this, [&pending, file, computeChecksum](const QByteArray &type, const QByteArray &checksum) {
+                QCOMPARE(type, QByteArray(OCC::checkSumSHA1C));
+                QCOMPARE(checksum, ChecksumCalculator(file, OCC::checkSumSHA1C).calculate());
+                --pending;
+                computeChecksum->deleteLater();
+            });
+            computeChecksum->start(file);
+        }
+        QTRY_COMPARE(pending, 0);
+
+        const auto after = pool->statistics();
+        QCOMPARE(after.queued, 0);
+        QCOMPARE(after.running, 0);
+        QCOMPARE(after.peakRunningPerDevice, qMax(1, before.peakRunningPerDevice));
+        QCOMPARE(after.filesHashed - before.filesHashed, qint64(files.size()));
+        QCOMPARE(after.bytesHashed - before.bytesHashed, totalSize);
+
+        // Dropping a computation while it is queued or running is safe
+        auto canceled = new ComputeChecksum;
+        canceled->setChecksumType(OCC::checkSumSHA1C);
+        canceled->start(files.first());
+        delete canceled;
+        QTRY_COMPARE(pool->statistics().running + pool->statistics().queued, 0);
+
+        pool->setMaxThreadsPerDevice(previousMaxThreads);
+    }
+
     void cleanupTestCase() {
     }
 };
@@ -8,7 +8,9 @@
 #include "syncenginetestutils.h"
 
 #include <owncloudpropagator.h>
+#include <propagateupload.h>
 #include <syncengine.h>
+#include "common/checksums.h"
 
 #include <QtTest>
 #include <QTextCodec>
@@ -122,6 +124,137 @@ private slots:
         QCOMPARE(fakeFolder.uploadState().children.count(), 2); // the transfer was done with chunking
     }
 
+    void testParallelChunkUpload()
+    {
+        FakeFolder fakeFolder{FileInfo::A12_B12_C12_S12()};
+        fakeFolder.syncEngine().account()->setCapabilities({ { "dav", QVariantMap{ {"chunking", "1.0"} } } });
+        constexpr auto chunkSize = 5 * 1000 * 1000; // 5 MB
+        auto options = fakeFolder.syncEngine().syncOptions();
+        options.setMaxChunkSize(chunkSize);
+        options.setMinChunkSize(chunkSize);
+        options._initialChunkSize = chunkSize;
+        options._maxParallelChunkUploads = 3;
+        options._adaptiveTransferConcurrency = false;
+        fakeFolder.syncEngine().setSyncOptions(options);
+
+        auto chunksInFlight = 0;
+        auto maxChunksInFlight = 0;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *outgoingData) -> QNetworkReply * {
+            if (op != QNetworkAccessManager::PutOperation || !request.url().path().startsWith(sUploadUrl.path())) {
+                return nullptr;
+            }
+            auto reply = new FakePutReply(fakeFolder.uploadState(), op, request, outgoingData->readAll(), this);
+            ++chunksInFlight;
+            maxChunksInFlight = qMax(maxChunksInFlight, chunksInFlight);
+            connect(reply, &QNetworkReply::finished, this, [&chunksInFlight] { --chunksInFlight; });
+            return reply;
+        });
+
+        const auto size = 8 * chunkSize + 100;
+        fakeFolder.localModifier().insert("A/a0", size);
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(fakeFolder.currentRemoteState().find("A/a0")->size, size);
+        QCOMPARE(fakeFolder.uploadState().children.count(), 1); // the transfer was done with chunking
+        QCOMPARE(fakeFolder.uploadState().children.first().children.count(), 9);
+        QCOMPARE(chunksInFlight, 0);
+        QVERIFY(maxChunksInFlight > 1);
+        QVERIFY(maxChunksInFlight <= 3);
+
+        // Disabled by the server
+        fakeFolder.syncEngine().account()->setCapabilities({ { "dav", QVariantMap{ {"chunking", "1.0"}, {"chunkingParallelUploadDisabled", true} } } });
+        maxChunksInFlight = 0;
+        fakeFolder.localModifier().insert("B/b0", size);
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(maxChunksInFlight, 1);
+    }
+
+    void testChecksumWhileUploading_data()
+    {
+        QTest::addColumn<int>("parallelChunks");
+        QTest::newRow("sequential") << 1;
+        QTest::newRow("parallel") << 3;
+    }
+
+    void testChecksumWhileUploading()
+    {
+        QFETCH(int, parallelChunks);
+
+        FakeFolder fakeFolder{FileInfo::A12_B12_C12_S12()};
+        fakeFolder.syncEngine().account()->setCapabilities({ { "dav", QVariantMap{ { "chunking", "1.0" } } }, { "checksums", QVariantMap{ { "supportedTypes", QStringList() << "SHA1" } } } });
+        setChunkSize(fakeFolder.syncEngine(), 1 * 1000 * 1000);
+        auto options = fakeFolder.syncEngine().syncOptions();
+        options._checksumWhileUploading = true;
+        options._maxParallelChunkUploads = parallelChunks;
+        options._adaptiveTransferConcurrency = false;
+        fakeFolder.syncEngine().setSyncOptions(options);
+
+        QByteArray moveChecksumHeader;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            if (request.attribute(QNetworkRequest::CustomVerbAttribute).toString() == "MOVE") {
+                moveChecksumHeader = request.rawHeader("OC-Checksum");
+            }
+            return nullptr;
+        });
+
+        const auto expectedChecksum = [&](const QString &path) {
+            return makeChecksumHeader("SHA1", ComputeChecksum::computeNow(fakeFolder.localPath() + path, "SHA1"));
+        };
+
+        const int size = 10 * 1000 * 1000; // 10 MB
+        fakeFolder.localModifier().insert("A/a0", size);
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(fakeFolder.uploadState().children.count(), 1); // the transfer was done with chunking
+        QCOMPARE(moveChecksumHeader, expectedChecksum("A/a0"));
+        SyncJournalFileRecord record;
+        QVERIFY(fakeFolder.syncJournal().getFileRecord(QByteArray("A/a0"), &record));
+        QCOMPARE(record._checksumHeader, moveChecksumHeader);
+
+        // A resumed upload reads the part that is already on the server to complete the checksum
+        moveChecksumHeader.clear();
+        fakeFolder.uploadState().children.clear();
+        partialUpload(fakeFolder, "A/a3", size);
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(moveChecksumHeader, expectedChecksum("A/a3"));
+        QVERIFY(fakeFolder.syncJournal().getFileRecord(QByteArray("A/a3"), &record));
+        QCOMPARE(record._checksumHeader, moveChecksumHeader);
+    }
+
+    void testUploadChecksumOutOfOrder()
+    {
+        QTemporaryDir dir;
+        const auto filePath = dir.path() + QStringLiteral("/file");
+        QFile file(filePath);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        QByteArray content(3 * 1000 * 1000, Qt::Uninitialized);
+        for (auto i = 0; i < content.size(); ++i) {
+            content[i] = static_cast<char>(i * 7 % 251);
+        }
+        file.write(content);
+        file.close();
+
+        const auto expected = ComputeChecksum::computeNow(filePath, "SHA1");
+        const auto block = [&content](qint64 offset) { return content.constData() + offset; };
+
+        UploadChecksum checksum(filePath, "SHA1");
+        QVERIFY(checksum.isValid());
+        // Two chunks that are read alternately
+        checksum.addData(1000 * 1000, block(1000 * 1000), 1000);
+        checksum.addData(0, block(0), 1000);
+        QCOMPARE(checksum.hashedSize(), qint64(1000));
+        checksum.addData(1000, block(1000), 1000 * 1000 - 1000);
+        QCOMPARE(checksum.hashedSize(), qint64(1000 * 1000 + 1000));
+        // A rewound device sends data again
+        checksum.addData(0, block(0), 5000);
+        QCOMPARE(checksum.hashedSize(), qint64(1000 * 1000 + 1000));
+        // The gap before a block that was read ahead is read from disk in the end
+        checksum.addData(2 * 1000 * 1000, block(2 * 1000 * 1000), 1000);
+        QCOMPARE(checksum.finish(content.size()), expected);
+    }
+
     // Test resuming when there's a confusing chunk added
     void testResume1() {
         FakeFolder fakeFolder{FileInfo::A12_B12_C12_S12()};
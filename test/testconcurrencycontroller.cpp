@@ -0,0 +1,134 @@
+/*
+   This software is in the public domain, furnished "as is", without technical
+   support, and with no warranty, express or implied, as to its usefulness for
+   any purpose.
+*/
+
+#include <QtTest>
+
+#include "concurrencycontroller.h"
+#include "logger.h"
+
+using namespace OCC;
+using namespace std::chrono_literals;
+
+class TestConcurrencyController : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase()
+    {
+        OCC::Logger::instance()->setLogFlush(true);
+        OCC::Logger::instance()->setLogDebug(true);
+
+        QStandardPaths::setTestModeEnabled(true);
+    }
+
+    void testDefaultWindow()
+    {
+        QCOMPARE(ConcurrencyController::defaultWindow(0), 1);
+        QCOMPARE(ConcurrencyController::defaultWindow(1), 1);
+        QCOMPARE(ConcurrencyController::defaultWindow(4), 2);
+        QCOMPARE(ConcurrencyController::defaultWindow(6), 3);
+        QCOMPARE(ConcurrencyController::defaultWindow(20), 3);
+    }
+
+    void testBounds()
+    {
+        ConcurrencyController controller(10, 1, 6);
+        QCOMPARE(controller.window(), 6);
+
+        controller.setBounds(1, 2);
+        QCOMPARE(controller.window(), 2);
+
+        controller.setBounds(0, 0);
+        QCOMPARE(controller.minimumWindow(), 1);
+        QCOMPARE(controller.window(), 1);
+    }
+
+    void testAdditiveIncrease()
+    {
+        ConcurrencyController controller(3, 1, 20);
+
+        // Not saturated: no reason to grow
+        controller.addSample(1000000, 100ms, 200);
+        QCOMPARE(controller.evaluate(1s), ConcurrencyController::Decision::Hold);
+        QCOMPARE(controller.window(), 3);
+
+        // Saturated and the throughput did not get worse: grow by one per interval
+        for (int i = 0; i < 5; ++i) {
+            controller.addSample(1000000, 100ms, 200);
+            controller.markSaturated();
+            QCOMPARE(controller.evaluate(1s), ConcurrencyController::Decision::Increase);
+            QCOMPARE(controller.window(), 4 + i);
+        }
+
+        // Capped by the maximum
+        for (int i = 0; i < 20; ++i) {
+            controller.addSample(1000000, 100ms, 200);
+            controller.markSaturated();
+            controller.evaluate(1s);
+        }
+        QCOMPARE(controller.window(), 20);
+        QCOMPARE(controller.lastDecision(), ConcurrencyController::Decision::Hold);
+    }
+
+    void testThroughputDropHolds()
+    {
+        ConcurrencyController controller(3, 1, 20);
+        controller.addSample(1000000, 100ms, 200);
+        controller.markSaturated();
+        QCOMPARE(controller.evaluate(1s), ConcurrencyController::Decision::Increase);
+
+        // Throughput halved, latency stable: keep the window
+        controller.addSample(500000, 100ms, 200);
+        controller.markSaturated();
+        QCOMPARE(controller.evaluate(1s), ConcurrencyController::Decision::Hold);
+        QCOMPARE(controller.window(), 4);
+    }
+
+    void testCongestionDecrease()
+    {
+        QVERIFY(ConcurrencyController::isCongestionSignal(429));
+        QVERIFY(ConcurrencyController::isCongestionSignal(503));
+        QVERIFY(!ConcurrencyController::isCongestionSignal(404));
+        QVERIFY(!ConcurrencyController::isCongestionSignal(0));
+
+        ConcurrencyController controller(10, 1, 20);
+        controller.addSample(1000000, 100ms, 200);
+        controller.addSample(0, 100ms, 503);
+        QCOMPARE(controller.evaluate(1s), ConcurrencyController::Decision::Decrease);
+        QCOMPARE(controller.window(), 5);
+
+        controller.addSample(0, 100ms, 429);
+        QCOMPARE(controller.evaluate(1s), ConcurrencyController::Decision::Decrease);
+        QCOMPARE(controller.window(), 2);
+
+        // Never below the minimum
+        for (int i = 0; i < 5; ++i) {
+            controller.addSample(0, 100ms, 500);
+            controller.evaluate(1s);
+        }
+        QCOMPARE(controller.window(), 1);
+    }
+
+    void testLatencyDecrease()
+    {
+        ConcurrencyController controller(8, 1, 20);
+
+        // establish the baseline
+        controller.addSample(1000000, 100ms, 200);
+        controller.evaluate(1s);
+        QCOMPARE(controller.window(), 8);
+
+        // latency exploded and the throughput did not improve
+        controller.addSample(1000000, 1000ms, 200);
+        controller.markSaturated();
+        QCOMPARE(controller.evaluate(1s), ConcurrencyController::Decision::Decrease);
+        QCOMPARE(controller.window(), 6);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestConcurrencyController)
+#include "testconcurrencycontroller.moc"
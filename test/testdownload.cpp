@@ -39,6 +39,106 @@ public:
     }
 };
 
+/* A FakeGetReply that honours the Range header, optionally sending only 'truncateAfter' bytes */
+class RangedFakeGetReply : public FakeReply
+{
+    Q_OBJECT
+public:
+    const FileInfo *fileInfo;
+    char payload = 0;
+    qint64 size = 0;
+    qint64 truncateAfter = -1;
+    bool aborted = false;
+
+    RangedFakeGetReply(FileInfo &remoteRootFileInfo, QNetworkAccessManager::Operation op, const QNetworkRequest &request, QObject *parent)
+        : FakeReply{ parent }
+    {
+        setRequest(request);
+        setUrl(request.url());
+        setOperation(op);
+        open(QIODevice::ReadOnly);
+        fileInfo = remoteRootFileInfo.find(getFilePathFromUrl(request.url()));
+        Q_ASSERT(fileInfo);
+        QMetaObject::invokeMethod(this, &RangedFakeGetReply::respond, Qt::QueuedConnection);
+    }
+
+    Q_INVOKABLE void respond()
+    {
+        if (aborted) {
+            setError(OperationCanceledError, QStringLiteral("Operation Canceled"));
+            emit metaDataChanged();
+            emit finished();
+            return;
+        }
+        qint64 start = 0;
+        qint64 end = fileInfo->size - 1;
+        static const QRegularExpression rangeRx(QStringLiteral("bytes=(\\d+)-(\\d*)"));
+        const auto match = rangeRx.match(QString::fromUtf8(request().rawHeader("Range")));
+        if (match.hasMatch()) {
+            start = match.captured(1).toLongLong();
+            if (!match.captured(2).isEmpty()) {
+                end = qMin(end, match.captured(2).toLongLong());
+            }
+            setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 206);
+            setRawHeader("Content-Range", "bytes " + QByteArray::number(start) + '-' + QByteArray::number(end) + '/' + QByteArray::number(fileInfo->size));
+        } else {
+            setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 200);
+        }
+        payload = fileInfo->contentChar;
+        size = end - start + 1;
+        setHeader(QNetworkRequest::ContentLengthHeader, size);
+        if (truncateAfter >= 0) {
+            size = qMin(size, truncateAfter);
+        }
+        setRawHeader("OC-ETag", fileInfo->etag);
+        setRawHeader("ETag", fileInfo->etag);
+        setRawHeader("OC-FileId", fileInfo->fileId);
+        emit metaDataChanged();
+        if (bytesAvailable())
+            emit readyRead();
+        emit finished();
+    }
+
+    void abort() override
+    {
+        setError(OperationCanceledError, QStringLiteral("Operation Canceled"));
+        aborted = true;
+    }
+
+    [[nodiscard]] qint64 bytesAvailable() const override
+    {
+        if (aborted)
+            return 0;
+        return size + QIODevice::bytesAvailable();
+    }
+
+    qint64 readData(char *data, qint64 maxlen) override
+    {
+        qint64 len = std::min(size, maxlen);
+        std::fill_n(data, len, payload);
+        size -= len;
+        return len;
+    }
+};
+
+static void enableSegmentedDownloads(FakeFolder &fakeFolder, qint64 segmentSize)
+{
+    auto options = fakeFolder.syncEngine().syncOptions();
+    options._maxParallelDownloadSegments = 3;
+    options._downloadSegmentSize = segmentSize;
+    options._adaptiveTransferConcurrency = false;
+    fakeFolder.syncEngine().setSyncOptions(options);
+}
+
+// Holes of a preallocated file would be zeros
+static bool isCompletelyDownloaded(const FakeFolder &fakeFolder, const QString &path)
+{
+    QFile file(fakeFolder.localPath() + path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    return !file.readAll().contains('\0');
+}
 
 SyncFileItemPtr getItem(const QSignalSpy &spy, const QString &path)
 {
@@ -98,6 +198,111 @@ private slots:
         QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
     }
 
+    void testSegmentedDownload()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        fakeFolder.syncEngine().setIgnoreHiddenFiles(true);
+        constexpr qint64 segmentSize = 1000 * 1000;
+        enableSegmentedDownloads(fakeFolder, segmentSize);
+        const auto size = 7 * segmentSize + 123;
+        fakeFolder.remoteModifier().insert("A/a0", size);
+
+        QByteArrayList ranges;
+        auto segmentsInFlight = 0;
+        auto maxSegmentsInFlight = 0;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            if (op != QNetworkAccessManager::GetOperation || !request.url().path().endsWith("A/a0")) {
+                return nullptr;
+            }
+            ranges.append(request.rawHeader("Range"));
+            auto reply = new RangedFakeGetReply(fakeFolder.remoteModifier(), op, request, this);
+            ++segmentsInFlight;
+            maxSegmentsInFlight = qMax(maxSegmentsInFlight, segmentsInFlight);
+            connect(reply, &QNetworkReply::finished, this, [&segmentsInFlight] { --segmentsInFlight; });
+            return reply;
+        });
+
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QVERIFY(isCompletelyDownloaded(fakeFolder, "A/a0"));
+        QCOMPARE(ranges.size(), 8);
+        QVERIFY(ranges.contains("bytes=0-" + QByteArray::number(segmentSize - 1)));
+        QVERIFY(ranges.contains("bytes=" + QByteArray::number(7 * segmentSize) + '-' + QByteArray::number(size - 1)));
+        QVERIFY(maxSegmentsInFlight > 1);
+        QVERIFY(maxSegmentsInFlight <= 3);
+        QCOMPARE(fakeFolder.syncJournal().downloadInfoCount(), 0);
+
+        // Small files are still downloaded in one piece
+        ranges.clear();
+        fakeFolder.remoteModifier().insert("A/small", segmentSize);
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QVERIFY(ranges.isEmpty());
+    }
+
+    void testSegmentedDownloadResume()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        fakeFolder.syncEngine().setIgnoreHiddenFiles(true);
+        QSignalSpy completeSpy(&fakeFolder.syncEngine(), &OCC::SyncEngine::itemCompleted);
+        constexpr qint64 segmentSize = 1000 * 1000;
+        enableSegmentedDownloads(fakeFolder, segmentSize);
+        const auto size = 6 * segmentSize;
+        fakeFolder.remoteModifier().insert("A/a0", size);
+
+        // The third segment gets truncated
+        const QByteArray brokenRange = "bytes=" + QByteArray::number(2 * segmentSize) + '-' + QByteArray::number(3 * segmentSize - 1);
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            if (op != QNetworkAccessManager::GetOperation || !request.url().path().endsWith("A/a0")) {
+                return nullptr;
+            }
+            auto reply = new RangedFakeGetReply(fakeFolder.remoteModifier(), op, request, this);
+            if (request.rawHeader("Range") == brokenRange) {
+                reply->truncateAfter = segmentSize / 2;
+            }
+            return reply;
+        });
+
+        QVERIFY(!fakeFolder.syncOnce());
+        QCOMPARE(getItem(completeSpy, "A/a0")->_status, SyncFileItem::SoftError);
+        QVERIFY(fakeFolder.syncEngine().isAnotherSyncNeeded());
+        const auto info = fakeFolder.syncJournal().getDownloadInfo("A/a0");
+        QVERIFY(info._valid);
+        QVERIFY(info._segmented);
+        QVERIFY(!info._completedRanges.isEmpty());
+        QCOMPARE(info._completedRanges.first(), qMakePair(qint64(0), 2 * segmentSize));
+
+        // Resume: the completed segments are not requested again
+        QByteArrayList ranges;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            if (op != QNetworkAccessManager::GetOperation || !request.url().path().endsWith("A/a0")) {
+                return nullptr;
+            }
+            ranges.append(request.rawHeader("Range"));
+            return new RangedFakeGetReply(fakeFolder.remoteModifier(), op, request, this);
+        });
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QVERIFY(isCompletelyDownloaded(fakeFolder, "A/a0"));
+        QVERIFY(ranges.contains(brokenRange));
+        QVERIFY(!ranges.contains("bytes=0-" + QByteArray::number(segmentSize - 1)));
+        QVERIFY(ranges.size() < 6);
+    }
+
+    void testSegmentedDownloadWithoutRangeSupport()
+    {
+        // The default fake server ignores ranges: fall back to a single stream
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        fakeFolder.syncEngine().setIgnoreHiddenFiles(true);
+        constexpr qint64 segmentSize = 1000 * 1000;
+        enableSegmentedDownloads(fakeFolder, segmentSize);
+        fakeFolder.remoteModifier().insert("A/a0", 5 * segmentSize);
+
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QVERIFY(isCompletelyDownloaded(fakeFolder, "A/a0"));
+    }
+
     void testErrorMessage () {
         // This test's main goal is to test that the error string from the server is shown in the UI
 
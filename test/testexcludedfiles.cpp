@@ -544,6 +544,65 @@ private slots:
         QCOMPARE(check_file_traversal("e/foo/barA"), CSYNC_FILE_EXCLUDE_LIST);
     }
 
+    void check_csync_name_matcher()
+    {
+        setup_init();
+        excludedFiles->addManualExclude("]*.remove");
+        excludedFiles->addManualExclude("keep.remove");
+        excludedFiles->addManualExclude("dironly*/");
+        excludedFiles->addManualExclude("a?c*d");
+        excludedFiles->addManualExclude("*x*y*");
+        excludedFiles->addManualExclude("[abc]bracket");
+        excludedFiles->addManualExclude("[!abc]notbracket*");
+        excludedFiles->addManualExclude("open[bracket");
+        excludedFiles->addManualExclude("esc\\*aped\\?");
+        excludedFiles->addManualExclude("back\\slash\\z");
+        excludedFiles->addManualExclude("?𠜎");
+        excludedFiles->addManualExclude("Ünï*");
+        excludedFiles->addManualExclude("sub/deep*/trigger?");
+
+        const QStringList names = {
+            "a", "file.txt", "foo.tmp", "foo.TMP", "~$doc.docx", ".DS_Store", "Thumbs.db", "x.remove", "keep.remove",
+            "dironly", "dironlyX", "abcd", "aXcYYd", "acd", "ZxZyZ", "xy", "abracket", "dbracket", "dnotbracket",
+            "anotbracket", "open[bracket", "esc*aped?", "escXapedY", "back\\slash\\z", "X𠜎", "𠜎𠜎", "𠜎", "Ünïcode",
+            "ünïcode", "trigger1", "trigger", ".sync_1234.db", "foo.part", "line\nbreak", "carriage\rreturn", "Icon\r",
+            QString(), QStringLiteral("x.💩"), QStringLiteral("пятницы.txt"),
+        };
+
+        auto compare = [&]() {
+            for (const auto &name : names) {
+                for (const auto &path : { name, QString(QStringLiteral("sub/deepA/") + name) }) {
+                    for (const auto type : { ItemTypeFile, ItemTypeDirectory }) {
+                        excludedFiles->setNameMatcherEnabled(false);
+                        const auto expected = excludedFiles->traversalPatternMatch(path, type);
+                        excludedFiles->setNameMatcherEnabled(true);
+                        const auto actual = excludedFiles->traversalPatternMatch(path, type);
+                        if (actual != expected) {
+                            qWarning() << "Mismatch for" << path << type;
+                        }
+                        QCOMPARE(actual, expected);
+                    }
+                }
+            }
+        };
+        excludedFiles->setWildcardsMatchSlash(false);
+        compare();
+        excludedFiles->setWildcardsMatchSlash(true);
+        compare();
+
+        // Case insensitive file systems
+        ExcludeNameMatcher matcher(true);
+        matcher.addPattern("*.TMP", ExcludedFiles::convertToRegexpSyntax("*.TMP", false), ExcludeNameMatcher::Exclude);
+        matcher.addPattern("ÜNÏ?", ExcludedFiles::convertToRegexpSyntax("ÜNÏ?", false), ExcludeNameMatcher::ExcludeRemove);
+        matcher.addPattern("[xy]Z", ExcludedFiles::convertToRegexpSyntax("[xy]Z", false), ExcludeNameMatcher::Trigger);
+        matcher.finalize();
+        QCOMPARE(matcher.match(u"foo.tmp"), ExcludeNameMatcher::Exclude);
+        QCOMPARE(matcher.match(u"foo.tmpx"), ExcludeNameMatcher::NoMatch);
+        QCOMPARE(matcher.match(u"ünïx"), ExcludeNameMatcher::ExcludeRemove);
+        QCOMPARE(matcher.match(u"Xz"), ExcludeNameMatcher::Trigger);
+        QVERIFY(!ExcludeNameMatcher::canMatch(u"line\nbreak"));
+    }
+
     void check_csync_regex_translation()
     {
         setup();
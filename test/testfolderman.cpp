@@ -19,6 +19,8 @@
 #include "syncenginetestutils.h"
 #include "testhelper.h"
 
+#include <memory>
+
 using namespace OCC;
 
 static QByteArray fake400Response = R"(
@@ -33,6 +35,21 @@ bool itemDidCompleteSuccessfully(const ItemCompletedSpy &spy, const QString &pat
     return false;
 }
 
+// Adds remote files below directory whose downloads take delay milliseconds
+void addSlowDownloads(FakeFolder &fakeFolder, const QString &directory, int delay)
+{
+    fakeFolder.remoteModifier().mkdir(directory);
+    for (int i = 0; i < 3; ++i) {
+        fakeFolder.remoteModifier().insert(directory + QStringLiteral("/file%1").arg(i), 100);
+    }
+    fakeFolder.setServerOverride([&fakeFolder, delay](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+        if (op != QNetworkAccessManager::GetOperation) {
+            return nullptr;
+        }
+        return new DelayedReply<FakeGetReply>(delay, fakeFolder.remoteModifier(), op, request, &fakeFolder.syncEngine());
+    });
+}
+
 class TestFolderMan: public QObject
 {
     Q_OBJECT
@@ -250,6 +267,406 @@ private slots:
         OCC::AccountManager::instance()->deleteAccount(accountState);
     }
 
+    void testConcurrentFolderSyncs()
+    {
+        QTemporaryDir dir;
+        ConfigFile::setConfDir(dir.path()); // we don't want to pollute the user's config file
+
+        FakeFolder fakeFolderA{FileInfo{}};
+        FakeFolder fakeFolderB{FileInfo{}};
+        for (const auto fakeFolder : {&fakeFolderA, &fakeFolderB}) {
+            for (int i = 0; i < 5; ++i) {
+                fakeFolder->remoteModifier().insert(QStringLiteral("file%1").arg(i), 100);
+            }
+            // keeps both syncs running for a while
+            fakeFolder->setServerOverride([fakeFolder](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+                if (op != QNetworkAccessManager::GetOperation) {
+                    return nullptr;
+                }
+                return new DelayedReply<FakeGetReply>(100, fakeFolder->remoteModifier(), op, request, &fakeFolder->syncEngine());
+            });
+        }
+
+        const auto accountStateA = new FakeAccountState(fakeFolderA.account());
+        const auto accountStateB = new FakeAccountState(fakeFolderB.account());
+        auto folderDefA = folderDefinition(fakeFolderA.localPath());
+        folderDefA.targetPath = "";
+        auto folderDefB = folderDefinition(fakeFolderB.localPath());
+        folderDefB.targetPath = "";
+
+        const auto folderman = FolderMan::instance();
+        const auto folderA = folderman->addFolder(accountStateA, folderDefA);
+        const auto folderB = folderman->addFolder(accountStateB, folderDefB);
+        QVERIFY(folderA);
+        QVERIFY(folderB);
+
+        qRegisterMetaType<OCC::SyncResult>("SyncResult");
+        QSignalSpy folderASyncDone(folderA, &Folder::syncFinished);
+        QSignalSpy folderBSyncDone(folderB, &Folder::syncFinished);
+
+        folderman->_maxConcurrentSyncs = 2;
+        folderman->_scheduledFolders.clear();
+        folderman->_scheduledFolders.enqueue(folderA);
+        folderman->_scheduledFolders.enqueue(folderB);
+        folderman->slotStartScheduledFolderSync();
+
+        QCOMPARE(folderman->runningSyncFolders(), (QList<Folder *>{folderA, folderB}));
+        QVERIFY(folderman->scheduleQueue().isEmpty());
+
+        // both engines sync at the same time
+        QTRY_VERIFY(folderA->isSyncRunning() && folderB->isSyncRunning());
+
+        // a folder that is already syncing is not started again
+        folderman->_scheduledFolders.enqueue(folderA);
+        folderman->slotStartScheduledFolderSync();
+        QCOMPARE(folderman->runningSyncFolders(), (QList<Folder *>{folderA, folderB}));
+        folderman->_scheduledFolders.clear();
+
+        QTRY_VERIFY_WITH_TIMEOUT(!folderASyncDone.isEmpty() && !folderBSyncDone.isEmpty(), 10000);
+        QCOMPARE(folderASyncDone.count(), 1);
+        QCOMPARE(folderBSyncDone.count(), 1);
+        QVERIFY(folderman->runningSyncFolders().isEmpty());
+        QCOMPARE(fakeFolderA.currentLocalState(), fakeFolderA.currentRemoteState());
+        QCOMPARE(fakeFolderB.currentLocalState(), fakeFolderB.currentRemoteState());
+
+        folderman->removeFolder(folderA);
+        folderman->removeFolder(folderB);
+    }
+
+    void testForceSyncPreemptsOnlyOverlappingSyncs()
+    {
+        QTemporaryDir dir;
+        ConfigFile::setConfDir(dir.path()); // we don't want to pollute the user's config file
+
+        FakeFolder fakeFolderA{FileInfo{}};
+        FakeFolder fakeFolderB{FileInfo{}};
+        addSlowDownloads(fakeFolderA, QStringLiteral("A"), 2000);
+        addSlowDownloads(fakeFolderB, QStringLiteral("A"), 2000);
+        QTemporaryDir nestedDir;
+
+        const auto accountStateA = new FakeAccountState(fakeFolderA.account());
+        const auto accountStateB = new FakeAccountState(fakeFolderB.account());
+        auto folderDefA = folderDefinition(fakeFolderA.localPath());
+        folderDefA.targetPath = "A";
+        auto folderDefNested = folderDefinition(nestedDir.path());
+        folderDefNested.targetPath = "A/sub";
+        auto folderDefB = folderDefinition(fakeFolderB.localPath());
+        folderDefB.targetPath = "A";
+
+        const auto folderman = FolderMan::instance();
+        const auto folderA = folderman->addFolder(accountStateA, folderDefA);
+        const auto folderNested = folderman->addFolder(accountStateA, folderDefNested);
+        const auto folderB = folderman->addFolder(accountStateB, folderDefB);
+        QVERIFY(folderA);
+        QVERIFY(folderNested);
+        QVERIFY(folderB);
+
+        qRegisterMetaType<OCC::SyncResult>("SyncResult");
+        QSignalSpy folderASyncDone(folderA, &Folder::syncFinished);
+        QSignalSpy folderBSyncDone(folderB, &Folder::syncFinished);
+
+        folderman->_maxConcurrentSyncs = 3;
+        folderman->_scheduledFolders.clear();
+        folderman->_scheduledFolders.enqueue(folderA);
+        folderman->_scheduledFolders.enqueue(folderB);
+        folderman->slotStartScheduledFolderSync();
+        QTRY_VERIFY(folderA->isSyncRunning() && folderB->isSyncRunning());
+
+        // the nested folder can't sync next to A, the folder of the other account can
+        folderman->forceSyncForFolder(folderNested);
+        QCOMPARE(folderman->scheduleQueue().size(), 2);
+        QCOMPARE(folderman->scheduleQueue().first(), folderNested);
+        QCOMPARE(folderman->scheduleQueue().last(), folderA);
+        QTRY_COMPARE(folderASyncDone.count(), 1);
+        QVERIFY(folderB->isSyncRunning());
+        QVERIFY(folderBSyncDone.isEmpty());
+
+        folderman->setSyncEnabled(false);
+        for (const auto folder : {folderA, folderNested, folderB}) {
+            folder->slotTerminateSync();
+        }
+        QTRY_VERIFY(folderman->runningSyncFolders().isEmpty());
+        folderman->_scheduledFolders.clear();
+        folderman->setSyncEnabled(true);
+        folderman->removeFolder(folderA);
+        folderman->removeFolder(folderNested);
+        folderman->removeFolder(folderB);
+    }
+
+    void testForceSyncPreemptsOneSyncWhenAllSlotsAreTaken()
+    {
+        QTemporaryDir dir;
+        ConfigFile::setConfDir(dir.path()); // we don't want to pollute the user's config file
+
+        FakeFolder fakeFolderA{FileInfo{}};
+        FakeFolder fakeFolderB{FileInfo{}};
+        addSlowDownloads(fakeFolderA, QStringLiteral("A"), 2000);
+        addSlowDownloads(fakeFolderB, QStringLiteral("A"), 2000);
+        QTemporaryDir otherDir;
+
+        const auto accountStateA = new FakeAccountState(fakeFolderA.account());
+        const auto accountStateB = new FakeAccountState(fakeFolderB.account());
+        auto folderDefA = folderDefinition(fakeFolderA.localPath());
+        folderDefA.targetPath = "A";
+        auto folderDefOther = folderDefinition(otherDir.path());
+        folderDefOther.targetPath = "Other";
+        auto folderDefB = folderDefinition(fakeFolderB.localPath());
+        folderDefB.targetPath = "A";
+
+        const auto folderman = FolderMan::instance();
+        const auto folderA = folderman->addFolder(accountStateA, folderDefA);
+        const auto folderOther = folderman->addFolder(accountStateA, folderDefOther);
+        const auto folderB = folderman->addFolder(accountStateB, folderDefB);
+        QVERIFY(folderA);
+        QVERIFY(folderOther);
+        QVERIFY(folderB);
+
+        qRegisterMetaType<OCC::SyncResult>("SyncResult");
+        QSignalSpy folderASyncDone(folderA, &Folder::syncFinished);
+        QSignalSpy folderBSyncDone(folderB, &Folder::syncFinished);
+
+        folderman->_maxConcurrentSyncs = 2;
+        folderman->_scheduledFolders.clear();
+        folderman->_scheduledFolders.enqueue(folderA);
+        folderman->_scheduledFolders.enqueue(folderB);
+        folderman->slotStartScheduledFolderSync();
+        QTRY_VERIFY(folderA->isSyncRunning() && folderB->isSyncRunning());
+
+        // nothing overlaps, but one of the two syncs makes room for the folder
+        folderman->forceSyncForFolder(folderOther);
+        QCOMPARE(folderman->scheduleQueue().size(), 2);
+        QCOMPARE(folderman->scheduleQueue().first(), folderOther);
+        QTRY_COMPARE(folderASyncDone.count() + folderBSyncDone.count(), 1);
+        QTest::qWait(200);
+        QCOMPARE(folderASyncDone.count() + folderBSyncDone.count(), 1);
+
+        folderman->setSyncEnabled(false);
+        for (const auto folder : {folderA, folderOther, folderB}) {
+            folder->slotTerminateSync();
+        }
+        QTRY_VERIFY(folderman->runningSyncFolders().isEmpty());
+        folderman->_scheduledFolders.clear();
+        folderman->setSyncEnabled(true);
+        folderman->removeFolder(folderA);
+        folderman->removeFolder(folderOther);
+        folderman->removeFolder(folderB);
+    }
+
+    void testOwnChangesBurstSchedulesNoSync()
+    {
+        QTemporaryDir dir;
+        ConfigFile::setConfDir(dir.path()); // we don't want to pollute the user's config file
+
+        FakeFolder fakeFolder{FileInfo{}};
+        const auto accountState = new FakeAccountState(fakeFolder.account());
+        auto folderDef = folderDefinition(fakeFolder.localPath());
+        folderDef.targetPath = "";
+        const auto folder = FolderMan::instance()->addFolder(accountState, folderDef);
+        QVERIFY(folder);
+        folder->registerFolderWatcher();
+
+        QSignalSpy changedExternallySpy(folder, &Folder::watchedFileChangedExternally);
+        const auto changedExternally = [&changedExternallySpy] {
+            QStringList paths;
+            for (const auto &arguments : qAsConst(changedExternallySpy)) {
+                paths.append(arguments.first().toString());
+            }
+            return paths;
+        };
+        const auto writeFile = [](const QString &path) {
+            QFile file(path);
+            QVERIFY(file.open(QIODevice::WriteOnly));
+            file.write("content");
+        };
+
+        // wait until the watcher reports changes
+        const auto firstExternalFile = fakeFolder.localPath() + QStringLiteral("external1");
+        writeFile(firstExternalFile);
+        QTRY_VERIFY(changedExternally().contains(firstExternalFile));
+
+        // more entries than the folder watcher reports one by one, all written by the sync
+        const auto burstDir = fakeFolder.localPath() + QStringLiteral("burst");
+        const auto touch = [folder](const QString &path) {
+            QMetaObject::invokeMethod(&folder->syncEngine(), "slotAddTouchedFile", Qt::DirectConnection, Q_ARG(QString, path));
+        };
+        changedExternallySpy.clear();
+        touch(burstDir);
+        QVERIFY(QDir().mkdir(burstDir));
+        for (int i = 0; i < 100; ++i) {
+            const auto path = burstDir + QStringLiteral("/file%1").arg(i);
+            touch(path);
+            writeFile(path);
+        }
+
+        // the external change after the burst is reported, the burst isn't
+        const auto secondExternalFile = fakeFolder.localPath() + QStringLiteral("external2");
+        writeFile(secondExternalFile);
+        QTRY_VERIFY(changedExternally().contains(secondExternalFile));
+        QTest::qWait(500);
+        const auto paths = changedExternally();
+        for (const auto &path : paths) {
+            QVERIFY2(!path.startsWith(burstDir), qPrintable(path));
+        }
+
+        FolderMan::instance()->removeFolder(folder);
+    }
+
+    void testFileIdsPushNotificationSchedulesFolders()
+    {
+        QTemporaryDir dir;
+        ConfigFile::setConfDir(dir.path()); // we don't want to pollute the user's config file
+
+        FakeFolder fakeFolderA{FileInfo{}};
+        FakeFolder fakeFolderB{FileInfo{}};
+        const auto accountState = new FakeAccountState(fakeFolderA.account());
+        auto folderDefA = folderDefinition(fakeFolderA.localPath());
+        folderDefA.targetPath = "A";
+        auto folderDefB = folderDefinition(fakeFolderB.localPath());
+        folderDefB.targetPath = "B";
+
+        const auto folderman = FolderMan::instance();
+        const auto folderA = folderman->addFolder(accountState, folderDefA);
+        const auto folderB = folderman->addFolder(accountState, folderDefB);
+        QVERIFY(folderA);
+        QVERIFY(folderB);
+
+        SyncJournalFileRecord record;
+        record._path = "dir/file";
+        record._type = ItemTypeFile;
+        record._fileId = "00000901ocinstance";
+        record._remotePerm = RemotePermissions::fromDbValue("RW");
+        QVERIFY(folderA->journalDb()->setFileRecord(record));
+
+        // a known id only schedules the folder that has the file
+        folderman->_scheduledFolders.clear();
+        folderman->slotProcessFileIdsPushNotification(fakeFolderA.account().data(), {901});
+        QCOMPARE(folderman->scheduleQueue().size(), 1);
+        QCOMPARE(folderman->scheduleQueue().first(), folderA);
+
+        // an unknown id can be a new file in any folder of the account
+        folderman->_scheduledFolders.clear();
+        folderman->slotProcessFileIdsPushNotification(fakeFolderA.account().data(), {901, 902});
+        QCOMPARE(folderman->scheduleQueue().size(), 2);
+        QVERIFY(folderman->scheduleQueue().contains(folderA));
+        QVERIFY(folderman->scheduleQueue().contains(folderB));
+
+        folderman->_scheduledFolders.clear();
+        folderman->removeFolder(folderA);
+        folderman->removeFolder(folderB);
+    }
+
+    void testEtagJobsPerAccountLimit()
+    {
+        QTemporaryDir dir;
+        ConfigFile::setConfDir(dir.path()); // we don't want to pollute the user's config file
+
+        FakeFolder fakeFolder{FileInfo::A12_B12_C12_S12()};
+        fakeFolder.remoteModifier().mkdir("D");
+        QList<QPointer<QNetworkReply>> etagReplies;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            if (request.attribute(QNetworkRequest::CustomVerbAttribute).toString() == QStringLiteral("PROPFIND") && request.rawHeader("Depth") == "0") {
+                const auto reply = new FakeHangingReply(op, request, this);
+                etagReplies.append(reply);
+                return reply;
+            }
+            return nullptr;
+        });
+
+        const auto accountState = new FakeAccountState(fakeFolder.account());
+        const auto folderman = FolderMan::instance();
+        std::vector<std::unique_ptr<QTemporaryDir>> localDirs;
+        QList<Folder *> folders;
+        for (const auto remotePath : {"A", "B", "C", "S", "D"}) {
+            localDirs.push_back(std::make_unique<QTemporaryDir>());
+            auto folderDef = folderDefinition(localDirs.back()->path());
+            folderDef.targetPath = remotePath;
+            const auto folder = folderman->addFolder(accountState, folderDef);
+            QVERIFY(folder);
+            folders.append(folder);
+        }
+        for (const auto folder : qAsConst(folders)) {
+            folder->slotRunEtagJob();
+        }
+
+        // the account has at most 4 ETag requests running
+        QTRY_COMPARE(etagReplies.size(), 4);
+        QTest::qWait(100);
+        QCOMPARE(etagReplies.size(), 4);
+        const auto waitingFolder = std::find_if(folders.cbegin(), folders.cend(), [](Folder *folder) {
+            return folder->etagJob() && !folder->etagJob()->reply();
+        });
+        QVERIFY(waitingFolder != folders.cend());
+        const auto runningFolder = std::find_if(folders.cbegin(), folders.cend(), [](Folder *folder) {
+            return folder->etagJob() && folder->etagJob()->reply();
+        });
+        QVERIFY(runningFolder != folders.cend());
+
+        // a destroyed job makes room for the waiting one
+        delete (*runningFolder)->etagJob();
+        QTRY_COMPARE(etagReplies.size(), 5);
+        QVERIFY((*waitingFolder)->etagJob() && (*waitingFolder)->etagJob()->reply());
+
+        for (const auto &reply : qAsConst(etagReplies)) {
+            if (reply) {
+                reply->abort();
+            }
+        }
+        for (const auto folder : qAsConst(folders)) {
+            folderman->removeFolder(folder);
+        }
+    }
+
+    void testEtagJobsShareTheRequestOfTheSameRemoteFolder()
+    {
+        QTemporaryDir dir;
+        ConfigFile::setConfDir(dir.path()); // we don't want to pollute the user's config file
+
+        FakeFolder fakeFolder{FileInfo::A12_B12_C12_S12()};
+        QStringList etagRequests;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            if (request.attribute(QNetworkRequest::CustomVerbAttribute).toString() == QStringLiteral("PROPFIND") && request.rawHeader("Depth") == "0") {
+                auto path = getFilePathFromUrl(request.url());
+                if (path.endsWith(QLatin1Char('/'))) {
+                    path.chop(1);
+                }
+                etagRequests.append(path);
+            }
+            return nullptr;
+        });
+
+        const auto accountState = new FakeAccountState(fakeFolder.account());
+        const auto folderman = FolderMan::instance();
+        std::vector<std::unique_ptr<QTemporaryDir>> localDirs;
+        QList<Folder *> folders;
+        for (const auto remotePath : {"A", "A", "B"}) {
+            localDirs.push_back(std::make_unique<QTemporaryDir>());
+            auto folderDef = folderDefinition(localDirs.back()->path());
+            folderDef.targetPath = remotePath;
+            const auto folder = folderman->addFolder(accountState, folderDef);
+            QVERIFY(folder);
+            folders.append(folder);
+        }
+        std::vector<std::unique_ptr<QSignalSpy>> etagSpies;
+        for (const auto folder : qAsConst(folders)) {
+            folder->slotRunEtagJob();
+            QVERIFY(folder->etagJob());
+            etagSpies.push_back(std::make_unique<QSignalSpy>(folder->etagJob(), &RequestEtagJob::etagRetrieved));
+        }
+
+        // every folder gets the ETag, the folders of A from one request
+        QTRY_VERIFY(std::all_of(etagSpies.cbegin(), etagSpies.cend(), [](const std::unique_ptr<QSignalSpy> &spy) {
+            return spy->count() == 1;
+        }));
+        QCOMPARE(etagSpies[0]->first(), etagSpies[1]->first());
+        QCOMPARE(etagRequests.count(QStringLiteral("A")), 1);
+        QCOMPARE(etagRequests.count(QStringLiteral("B")), 1);
+
+        folderman->_scheduledFolders.clear();
+        for (const auto folder : qAsConst(folders)) {
+            folderman->removeFolder(folder);
+        }
+    }
+
     void testCheckPathValidityForNewFolder()
     {
 #ifdef Q_OS_WIN
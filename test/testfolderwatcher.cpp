@@ -98,7 +98,8 @@ class TestFolderWatcher : public QObject
     }
 
 #ifdef Q_OS_LINUX
-#define CHECK_WATCH_COUNT(n) QCOMPARE(_watcher->testLinuxWatchCount(), (n))
+// The watches below new folders are added asynchronously
+#define CHECK_WATCH_COUNT(n) QTRY_COMPARE(_watcher->testLinuxWatchCount(), (n))
 #else
 #define CHECK_WATCH_COUNT(n) do {} while (false)
 #endif
@@ -120,6 +121,8 @@ public:
         Utility::writeRandomFile( _rootPath+"/a2/renamefile");
         Utility::writeRandomFile( _rootPath+"/a1/movefile");
 
+        // The watch count checks are for the inotify watches
+        qputenv("OWNCLOUD_FANOTIFY_WATCHER", "0");
         _watcher.reset(new FolderWatcher);
         _watcher->init(_rootPath);
         _pathChangedSpy.reset(new QSignalSpy(_watcher.data(), &FolderWatcher::pathChanged));
@@ -272,6 +275,47 @@ private slots:
         QVERIFY(waitForPathChanged(dir));
     }
 
+    void testMoveInLargeTree()
+    {
+        // Created outside of the folder, so there are no watches yet
+        QTemporaryDir outside;
+        const QString tree(outside.path() + "/tree");
+        for (int i = 0; i < 20; ++i) {
+            for (int j = 0; j < 10; ++j) {
+                QDir(tree).mkpath(QStringLiteral("d%1/e%2").arg(i).arg(j));
+            }
+        }
+        mv(tree, _rootPath + "/tree");
+        QVERIFY(waitForPathChanged(_rootPath + "/tree"));
+
+        // Notifications from the whole tree arrive once the watches are added
+        CHECK_WATCH_COUNT(countFolders(_rootPath) + 1);
+        QString file(_rootPath + "/tree/d19/e9/file");
+        touch(file);
+        QVERIFY(waitForPathChanged(file));
+    }
+
+    void testCoalesceManyChanges()
+    {
+        const QString dir(_rootPath + "/many");
+        mkdir(dir);
+        QVERIFY(waitForPathChanged(dir));
+
+        QSignalSpy directorySpy(_watcher.data(), &FolderWatcher::directoryContentChanged);
+        const auto statistics = _watcher->coalescingStatistics();
+        for (int i = 0; i < 200; ++i) {
+            QFile file(dir + QStringLiteral("/file%1").arg(i));
+            QVERIFY(file.open(QIODevice::WriteOnly));
+        }
+
+        // One notification for the directory instead of one per file
+        QTRY_VERIFY(!directorySpy.isEmpty());
+        QCOMPARE(directorySpy.first().first().toString(), dir);
+        const auto newStatistics = _watcher->coalescingStatistics();
+        QVERIFY(newStatistics.receivedPaths - statistics.receivedPaths >= 200);
+        QVERIFY(newStatistics.emittedPaths - statistics.emittedPaths < 100);
+    }
+
     void testDetectLockFiles()
     {
         QStringList listOfOfficeFiles = {QString(_rootPath + "/document.docx"), QString(_rootPath + "/document.odt")};
@@ -386,6 +430,73 @@ private slots:
             rm(officeLockFile);
         }
     }
+
+    void testFanotifyMarksFileSystem()
+    {
+#ifdef Q_OS_LINUX
+        QTemporaryDir root;
+        QTemporaryDir outside;
+        QTemporaryDir other;
+        const auto rootPath = QDir(root.path()).canonicalPath();
+        const auto otherPath = QDir(other.path()).canonicalPath();
+        QDir(rootPath).mkpath("a/b/c");
+
+        qputenv("OWNCLOUD_FANOTIFY_WATCHER", "1");
+        FolderWatcher watcher;
+        watcher.init(rootPath);
+        // shares the mark of the file system with the first watcher
+        FolderWatcher otherWatcher;
+        otherWatcher.init(otherPath);
+        qputenv("OWNCLOUD_FANOTIFY_WATCHER", "0");
+        if (watcher.testLinuxWatchCount() != 1) {
+            QSKIP("Marking the file system with fanotify is not permitted");
+        }
+        QCOMPARE(otherWatcher.testLinuxWatchCount(), 1);
+        QSignalSpy pathChangedSpy(&watcher, &FolderWatcher::pathChanged);
+        QSignalSpy otherPathChangedSpy(&otherWatcher, &FolderWatcher::pathChanged);
+
+        // Changes in new sub folders are reported without adding watches
+        const QString outsideFile(outside.path() + "/outside");
+        const QString file(rootPath + "/a/b/c/new/file");
+        const QString otherFile(otherPath + "/file");
+        touch(outsideFile);
+        mkdir(rootPath + "/a/b/c/new");
+        touch(file);
+        touch(otherFile);
+
+        auto reported = [](const QSignalSpy &spy, const QString &path) {
+            for (const auto &args : spy) {
+                if (args.first().toString() == path)
+                    return true;
+            }
+            return false;
+        };
+        auto waitUntilReported = [&reported](QSignalSpy &spy, const QString &path) {
+            QElapsedTimer timer;
+            timer.start();
+            while (!reported(spy, path) && timer.elapsed() < 5000) {
+                spy.wait(200);
+            }
+            return reported(spy, path);
+        };
+        QVERIFY(waitUntilReported(pathChangedSpy, file));
+        QVERIFY(reported(pathChangedSpy, rootPath + "/a/b/c/new"));
+        QVERIFY(!reported(pathChangedSpy, outsideFile));
+        QVERIFY(!reported(pathChangedSpy, otherFile));
+        QVERIFY(waitUntilReported(otherPathChangedSpy, otherFile));
+        QVERIFY(!reported(otherPathChangedSpy, file));
+        QCOMPARE(watcher.testLinuxWatchCount(), 1);
+
+        // The paths cached for the renamed directory must not be used anymore
+        mv(rootPath + "/a/b", rootPath + "/a/moved");
+        const QString movedFile(rootPath + "/a/moved/c/new/file2");
+        touch(movedFile);
+        QVERIFY(waitUntilReported(pathChangedSpy, movedFile));
+        QVERIFY(!reported(pathChangedSpy, rootPath + "/a/b/c/new/file2"));
+#else
+        QSKIP("fanotify is only available on Linux");
+#endif
+    }
 };
 
 #ifdef Q_OS_MAC
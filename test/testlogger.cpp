@@ -0,0 +1,86 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+
+#include "logger.h"
+
+using namespace OCC;
+
+class TestLogger : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase()
+    {
+        OCC::Logger::instance()->setLogFlush(true);
+        OCC::Logger::instance()->setLogDebug(true);
+
+        QStandardPaths::setTestModeEnabled(true);
+    }
+
+    void testAsyncLogging()
+    {
+        constexpr int threadCount = 4;
+        constexpr int messageCount = 1000;
+
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const auto logFile = dir.filePath(QStringLiteral("async.log"));
+
+        auto logger = Logger::instance();
+        logger->setLogFile(logFile);
+        logger->setAsyncLogging(true);
+        QVERIFY(logger->isAsyncLogging());
+
+        QVector<QThread *> threads;
+        for (int thread = 0; thread < threadCount; ++thread) {
+            threads.append(QThread::create([logger, thread] {
+                for (int message = 0; message < messageCount; ++message) {
+                    logger->doLog(QtInfoMsg, QMessageLogContext(), QStringLiteral("async message %1 %2").arg(thread).arg(message));
+                }
+            }));
+        }
+        for (const auto thread : qAsConst(threads)) {
+            thread->start();
+        }
+        for (const auto thread : qAsConst(threads)) {
+            QVERIFY(thread->wait());
+        }
+        qDeleteAll(threads);
+
+        // Everything buffered is written when switching back
+        logger->setAsyncLogging(false);
+        QVERIFY(!logger->isAsyncLogging());
+        logger->setLogFile(QString());
+
+        QFile file(logFile);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        static const QRegularExpression messageRx(QStringLiteral("async message (\\d+) (\\d+)$"));
+        QVector<int> lastMessage(threadCount, -1);
+        int written = 0;
+        while (!file.atEnd()) {
+            const auto match = messageRx.match(QString::fromUtf8(file.readLine()).trimmed());
+            if (!match.hasMatch()) {
+                continue;
+            }
+            // The messages of each thread are in the order they were logged
+            const auto thread = match.captured(1).toInt();
+            const auto message = match.captured(2).toInt();
+            QVERIFY(message > lastMessage[thread]);
+            lastMessage[thread] = message;
+            ++written;
+        }
+        // The buffer of every thread is large enough for all its messages
+        QCOMPARE(logger->droppedLogMessages(), quint64(0));
+        QCOMPARE(written, threadCount * messageCount);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestLogger)
+#include "testlogger.moc"
@@ -130,6 +130,31 @@ private slots:
         QVERIFY(verifyCalledOnceWithAccount(filesChangedSpy, account));
     }
 
+    void testOnWebSocketTextMessageReceived_notifyFileIdMessage_emitFileIdsChanged()
+    {
+        FakeWebSocketServer fakeServer;
+        auto account = FakeWebSocketServer::createAccount();
+        const auto socket = fakeServer.authenticateAccount(account);
+        QVERIFY(socket);
+        QSignalSpy filesChangedSpy(account->pushNotifications(), &OCC::PushNotifications::filesChanged);
+        QSignalSpy fileIdsChangedSpy(account->pushNotifications(), &OCC::PushNotifications::fileIdsChanged);
+
+        socket->sendTextMessage("notify_file_id [42,1337]");
+
+        // fileIdsChanged signal should be emitted with the ids
+        QVERIFY(fileIdsChangedSpy.wait());
+        QCOMPARE(fileIdsChangedSpy.count(), 1);
+        QCOMPARE(fileIdsChangedSpy.at(0).at(0).value<OCC::Account *>(), account.data());
+        QCOMPARE(fileIdsChangedSpy.at(0).at(1).value<QList<qint64>>(), (QList<qint64>{42, 1337}));
+        QCOMPARE(filesChangedSpy.count(), 0);
+
+        // Messages without readable ids are treated like notify_file
+        socket->sendTextMessage("notify_file_id [\"abc\"]");
+        QVERIFY(filesChangedSpy.wait());
+        QVERIFY(verifyCalledOnceWithAccount(filesChangedSpy, account));
+        QCOMPARE(fileIdsChangedSpy.count(), 1);
+    }
+
     void testOnWebSocketTextMessageReceived_notifyActivityMessage_emitNotification()
     {
         FakeWebSocketServer fakeServer;
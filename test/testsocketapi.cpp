@@ -0,0 +1,154 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QLocalSocket>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "folderman.h"
+#include "configfile.h"
+#include "logger.h"
+#include "socketapi/socketapi.h"
+#include "syncenginetestutils.h"
+#include "testhelper.h"
+#include "theme.h"
+
+#include <memory>
+
+using namespace OCC;
+
+namespace {
+constexpr auto recordSeparator = QLatin1Char('\x1e');
+}
+
+class TestSocketApi : public QObject
+{
+    Q_OBJECT
+
+    QTemporaryDir _runtimeDir;
+    QTemporaryDir _confDir;
+    std::unique_ptr<FolderMan> _fm;
+
+    // Reads the lines sent by the socket API until one starts with the prefix
+    static QStringList readLinesUntil(QLocalSocket &socket, const QString &prefix)
+    {
+        QStringList lines;
+        QElapsedTimer timer;
+        timer.start();
+        while (timer.elapsed() < 5000) {
+            while (socket.canReadLine()) {
+                auto line = QString::fromUtf8(socket.readLine());
+                line.chop(1);
+                lines.append(line);
+                if (line.startsWith(prefix)) {
+                    return lines;
+                }
+            }
+            // the server runs in this thread
+            QTest::qWait(10);
+        }
+        return lines;
+    }
+
+private slots:
+    void initTestCase()
+    {
+        OCC::Logger::instance()->setLogFlush(true);
+        OCC::Logger::instance()->setLogDebug(true);
+
+        QStandardPaths::setTestModeEnabled(true);
+
+        // The socket is created in the runtime directory, away from a running client
+        QVERIFY(_runtimeDir.isValid());
+        qputenv("XDG_RUNTIME_DIR", _runtimeDir.path().toLocal8Bit());
+        ConfigFile::setConfDir(_confDir.path()); // we don't want to pollute the user's config file
+        _fm.reset(new FolderMan);
+    }
+
+    void testRetrieveFilesStatus()
+    {
+#ifndef Q_OS_LINUX
+        QSKIP("The socket path is only known on Linux");
+#endif
+        FakeFolder fakeFolder{FileInfo::A12_B12_C12_S12()};
+        const auto accountState = new FakeAccountState(fakeFolder.account());
+        auto folderDef = folderDefinition(fakeFolder.localPath());
+        folderDef.targetPath = "";
+        const auto folder = _fm->addFolder(accountState, folderDef);
+        QVERIFY(folder);
+        // no sync pushes statuses of its own
+        folder->setSyncPaused(true);
+        folder->syncEngine().excludedFiles().addManualExclude(QStringLiteral("*.excluded"));
+
+        SyncJournalFileRecord record;
+        record._path = "A/a1";
+        record._type = ItemTypeFile;
+        record._remotePerm = RemotePermissions::fromDbValue("RW");
+        QVERIFY(folder->journalDb()->setFileRecord(record));
+
+        QLocalSocket socket;
+        socket.connectToServer(_runtimeDir.path() + QLatin1Char('/') + Theme::instance()->appName() + QStringLiteral("/socket"));
+        QVERIFY(socket.waitForConnected(5000));
+
+        // One reply for all the requested names: known, unknown and excluded ones
+        const auto directory = folder->cleanPath() + QStringLiteral("/A");
+        const QStringList names{QStringLiteral("a1"), QStringLiteral("unknown"), QStringLiteral("file.excluded")};
+        socket.write(QString(QStringLiteral("RETRIEVE_FILES_STATUS:") + directory + recordSeparator + names.join(recordSeparator) + QLatin1Char('\n')).toUtf8());
+        auto lines = readLinesUntil(socket, QStringLiteral("FILES_STATUS:"));
+        QVERIFY(!lines.isEmpty());
+        QCOMPARE(lines.last(), QStringList({QStringLiteral("FILES_STATUS:") + directory, QStringLiteral("OK:a1"), QStringLiteral("NOP:unknown"), QStringLiteral("IGNORE:file.excluded")}).join(recordSeparator));
+
+        // Without names every entry of the directory is reported, but the excluded ones
+        fakeFolder.localModifier().insert(QStringLiteral("A/file.excluded"));
+        socket.write(QString(QStringLiteral("RETRIEVE_FILES_STATUS:") + directory + QLatin1Char('\n')).toUtf8());
+        lines = readLinesUntil(socket, QStringLiteral("FILES_STATUS:"));
+        QVERIFY(!lines.isEmpty());
+        auto records = lines.last().split(recordSeparator);
+        QCOMPARE(records.takeFirst(), QStringLiteral("FILES_STATUS:") + directory);
+        records.sort();
+        QCOMPARE(records, QStringList({QStringLiteral("NOP:a2"), QStringLiteral("OK:a1")}));
+
+        // The sync journals in the root of the folder are not listed either
+        QVERIFY(!QDir(folder->path()).entryList({QStringLiteral(".sync_*.db*")}, QDir::Files | QDir::Hidden).isEmpty());
+        socket.write(QString(QStringLiteral("RETRIEVE_FILES_STATUS:") + folder->cleanPath() + QLatin1Char('\n')).toUtf8());
+        lines = readLinesUntil(socket, QStringLiteral("FILES_STATUS:"));
+        QVERIFY(!lines.isEmpty());
+        records = lines.last().split(recordSeparator);
+        QCOMPARE(records.takeFirst(), QStringLiteral("FILES_STATUS:") + folder->cleanPath());
+        QStringList listedNames;
+        for (const auto &entry : qAsConst(records)) {
+            listedNames.append(entry.mid(entry.indexOf(QLatin1Char(':')) + 1));
+        }
+        listedNames.sort();
+        QCOMPARE(listedNames, QStringList({QStringLiteral("A"), QStringLiteral("B"), QStringLiteral("C"), QStringLiteral("S")}));
+
+        // Directories outside of the sync folders
+        socket.write(QString(QStringLiteral("RETRIEVE_FILES_STATUS:/nonexistent") + recordSeparator + QStringLiteral("file\n")).toUtf8());
+        lines = readLinesUntil(socket, QStringLiteral("FILES_STATUS:"));
+        QVERIFY(!lines.isEmpty());
+        QCOMPARE(lines.last(), QStringLiteral("FILES_STATUS:/nonexistent") + recordSeparator + QStringLiteral("NOP:file"));
+
+        // The status pushes of the monitored directory are coalesced: only the
+        // latest status of a path is sent, after the others that changed before it
+        const auto socketApi = _fm->socketApi();
+        socketApi->broadcastStatusPushMessage(directory + QStringLiteral("/a1"), SyncFileStatus(SyncFileStatus::StatusSync));
+        socketApi->broadcastStatusPushMessage(directory + QStringLiteral("/a2"), SyncFileStatus(SyncFileStatus::StatusSync));
+        socketApi->broadcastStatusPushMessage(directory + QStringLiteral("/a1"), SyncFileStatus(SyncFileStatus::StatusUpToDate));
+        // not monitored, no push
+        socketApi->broadcastStatusPushMessage(folder->cleanPath() + QStringLiteral("/B/b1"), SyncFileStatus(SyncFileStatus::StatusSync));
+        lines = readLinesUntil(socket, QStringLiteral("STATUS:OK:"));
+        QCOMPARE(lines, QStringList({QStringLiteral("STATUS:SYNC:") + directory + QStringLiteral("/a2"), QStringLiteral("STATUS:OK:") + directory + QStringLiteral("/a1")}));
+        QTest::qWait(300);
+        QVERIFY(!socket.canReadLine());
+
+        socket.disconnectFromServer();
+        _fm->removeFolder(folder);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestSocketApi)
+#include "testsocketapi.moc"
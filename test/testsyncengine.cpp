@@ -1053,6 +1053,37 @@ private slots:
         QCOMPARE(nPOST, 0);
     }
 
+    void testBulkUploadBatchesInParallel()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        fakeFolder.syncEngine().account()->setCapabilities({ { "dav", QVariantMap{ {"bulkupload", "1.0"} } } });
+
+        // Allows three batches in flight
+        SyncOptions syncOptions;
+        syncOptions._parallelNetworkJobs = 6;
+        syncOptions._adaptiveTransferConcurrency = false;
+        fakeFolder.syncEngine().setSyncOptions(syncOptions);
+
+        QVector<int> filesPerPost;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *outgoingData) -> QNetworkReply * {
+            const auto contentType = request.header(QNetworkRequest::ContentTypeHeader).toString();
+            if (op == QNetworkAccessManager::PostOperation && contentType.startsWith(QStringLiteral("multipart/related; boundary="))) {
+                const auto body = outgoingData->peek(outgoingData->bytesAvailable());
+                filesPerPost.append(body.count("X-File-Path"));
+            }
+            return nullptr;
+        });
+
+        for (int i = 0; i < 250; ++i) {
+            fakeFolder.localModifier().insert(QStringLiteral("A/small%1").arg(i), 10);
+        }
+
+        QVERIFY(fakeFolder.syncOnce());
+        std::sort(filesPerPost.begin(), filesPerPost.end());
+        QCOMPARE(filesPerPost, (QVector<int>{ 50, 100, 100 }));
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+    }
+
     /**
      * Checks whether subsequent large uploads are skipped after a 507 error
      */
@@ -1979,6 +2010,330 @@ private slots:
         QCOMPARE(fakeFolder.remoteModifier().find("folder2"), nullptr);
         QCOMPARE(fakeFolder.remoteModifier().find("file1"), nullptr);
     }
+
+    void testPipelinedPropagation()
+    {
+        FakeFolder fakeFolder{FileInfo::A12_B12_C12_S12()};
+        auto options = fakeFolder.syncEngine().syncOptions();
+        options._pipelinedPropagation = true;
+        fakeFolder.syncEngine().setSyncOptions(options);
+
+        fakeFolder.remoteModifier().insert("A/a3");
+        fakeFolder.remoteModifier().appendByte("B/b1");
+        fakeFolder.localModifier().insert("C/c3");
+        // these have to wait for the whole tree
+        fakeFolder.remoteModifier().rename("S/s1", "A/s1");
+        fakeFolder.localModifier().remove("B/b2");
+        fakeFolder.remoteModifier().insert("S/s3");
+
+        auto discoveryFinished = false;
+        connect(&fakeFolder.syncEngine(), &SyncEngine::aboutToPropagate, this, [&discoveryFinished] {
+            discoveryFinished = true;
+        });
+        // the propagation must be announced before the first item completes
+        auto progressStatus = ProgressInfo::Starting;
+        connect(&fakeFolder.syncEngine(), &SyncEngine::transmissionProgress, this, [&progressStatus](const ProgressInfo &progress) {
+            progressStatus = progress.status();
+        });
+        QList<ProgressInfo::Status> progressStatusOnCompletion;
+        connect(&fakeFolder.syncEngine(), &SyncEngine::itemCompleted, this, [&](const SyncFileItemPtr &item) {
+            if (!item->isDirectory()) {
+                progressStatusOnCompletion.append(progressStatus);
+            }
+        });
+        QStringList transfersDuringDiscovery;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            const auto path = getFilePathFromUrl(request.url());
+            if ((op == QNetworkAccessManager::GetOperation || op == QNetworkAccessManager::PutOperation) && !discoveryFinished) {
+                transfersDuringDiscovery.append(path);
+            }
+            // keep the discovery busy with S while A, B and C are complete
+            if (request.attribute(QNetworkRequest::CustomVerbAttribute).toString() == QStringLiteral("PROPFIND") && path == QStringLiteral("S")) {
+                return new DelayedReply<FakePropfindReply>(500, fakeFolder.remoteModifier(), op, request, &fakeFolder.syncEngine());
+            }
+            return nullptr;
+        });
+
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QVERIFY(transfersDuringDiscovery.contains(QStringLiteral("A/a3")));
+        QVERIFY(transfersDuringDiscovery.contains(QStringLiteral("B/b1")));
+        QVERIFY(transfersDuringDiscovery.contains(QStringLiteral("C/c3")));
+        QVERIFY(!fakeFolder.currentRemoteState().find("S/s1"));
+        QVERIFY(!fakeFolder.currentRemoteState().find("B/b2"));
+        QVERIFY(!progressStatusOnCompletion.isEmpty());
+        for (const auto status : progressStatusOnCompletion) {
+            QCOMPARE(status, ProgressInfo::Propagation);
+        }
+    }
+
+    void testPipelinedPropagationDoesNotDelayTheOtherJobs()
+    {
+        FakeFolder fakeFolder{FileInfo::A12_B12_C12_S12()};
+        auto options = fakeFolder.syncEngine().syncOptions();
+        options._pipelinedPropagation = true;
+        fakeFolder.syncEngine().setSyncOptions(options);
+
+        SyncJournalFileRecord recordBefore;
+        QVERIFY(fakeFolder.syncJournal().getFileRecord(QByteArrayLiteral("A"), &recordBefore) && recordBefore.isValid());
+
+        // a3 is propagated during the discovery and takes long, s3 has to wait for the whole tree
+        fakeFolder.remoteModifier().insert("A/a3");
+        fakeFolder.remoteModifier().insert("S/s3");
+
+        QStringList completedFiles;
+        QByteArray etagOfAWhenA3Completed;
+        connect(&fakeFolder.syncEngine(), &SyncEngine::itemCompleted, this, [&](const SyncFileItemPtr &item) {
+            if (!item->isDirectory()) {
+                completedFiles.append(item->_file);
+            }
+            if (item->_file == QStringLiteral("A/a3")) {
+                SyncJournalFileRecord record;
+                QVERIFY(fakeFolder.syncJournal().getFileRecord(QByteArrayLiteral("A"), &record));
+                etagOfAWhenA3Completed = record._etag;
+            }
+        });
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            const auto path = getFilePathFromUrl(request.url());
+            if (op == QNetworkAccessManager::GetOperation && path == QStringLiteral("A/a3")) {
+                return new DelayedReply<FakeGetReply>(1500, fakeFolder.remoteModifier(), op, request, &fakeFolder.syncEngine());
+            }
+            if (request.attribute(QNetworkRequest::CustomVerbAttribute).toString() == QStringLiteral("PROPFIND") && path == QStringLiteral("S")) {
+                return new DelayedReply<FakePropfindReply>(500, fakeFolder.remoteModifier(), op, request, &fakeFolder.syncEngine());
+            }
+            return nullptr;
+        });
+
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(completedFiles, QStringList({QStringLiteral("S/s3"), QStringLiteral("A/a3")}));
+
+        // the new etag of A is only stored once a3 is done
+        QCOMPARE(etagOfAWhenA3Completed, recordBefore._etag);
+        SyncJournalFileRecord record;
+        QVERIFY(fakeFolder.syncJournal().getFileRecord(QByteArrayLiteral("A"), &record) && record.isValid());
+        QVERIFY(record._etag != recordBefore._etag);
+    }
+
+    void testPipelinedPropagationWaitsForRemoveAllFilesPrompt()
+    {
+        FakeFolder fakeFolder{FileInfo::A12_B12_C12_S12()};
+        auto options = fakeFolder.syncEngine().syncOptions();
+        options._pipelinedPropagation = true;
+        fakeFolder.syncEngine().setSyncOptions(options);
+        ConfigFile().setPromptDeleteFiles(true);
+
+        // everything is removed on the server, but a changed file of the unchanged A
+        const auto initialState = fakeFolder.currentLocalState();
+        fakeFolder.remoteModifier().appendByte("A/a1");
+        fakeFolder.remoteModifier().remove("A/a2");
+        fakeFolder.remoteModifier().remove("B");
+        fakeFolder.remoteModifier().remove("C");
+        fakeFolder.remoteModifier().remove("S");
+
+        // the user takes a while to cancel
+        int aboutToRemoveAllFilesCalled = 0;
+        connect(&fakeFolder.syncEngine(), &SyncEngine::aboutToRemoveAllFiles, this, [&](SyncFileItem::Direction, std::function<void(bool)> callback) {
+            ++aboutToRemoveAllFilesCalled;
+            QTimer::singleShot(300, &fakeFolder.syncEngine(), [callback] {
+                callback(true);
+            });
+        });
+        QStringList transfers;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            if (op == QNetworkAccessManager::GetOperation || op == QNetworkAccessManager::PutOperation) {
+                transfers.append(getFilePathFromUrl(request.url()));
+            }
+            return nullptr;
+        });
+
+        QVERIFY(!fakeFolder.syncOnce());
+        QCOMPARE(aboutToRemoveAllFilesCalled, 1);
+        QVERIFY(transfers.isEmpty());
+        QCOMPARE(fakeFolder.currentLocalState(), initialState);
+    }
+
+    void testPipelinedPropagationErrorKeepsDirectoryEtag()
+    {
+        FakeFolder fakeFolder{FileInfo::A12_B12_C12_S12()};
+        auto options = fakeFolder.syncEngine().syncOptions();
+        options._pipelinedPropagation = true;
+        fakeFolder.syncEngine().setSyncOptions(options);
+
+        SyncJournalFileRecord recordBefore;
+        QVERIFY(fakeFolder.syncJournal().getFileRecord(QByteArrayLiteral("A"), &recordBefore) && recordBefore.isValid());
+
+        fakeFolder.remoteModifier().insert("A/a3");
+        fakeFolder.remoteModifier().insert("A/a4");
+        fakeFolder.serverErrorPaths().append("A/a3", 503);
+
+        auto discoveryFinished = false;
+        connect(&fakeFolder.syncEngine(), &SyncEngine::aboutToPropagate, this, [&discoveryFinished] {
+            discoveryFinished = true;
+        });
+        QStringList transfersDuringDiscovery;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            const auto path = getFilePathFromUrl(request.url());
+            if (op == QNetworkAccessManager::GetOperation && !discoveryFinished) {
+                transfersDuringDiscovery.append(path);
+            }
+            if (request.attribute(QNetworkRequest::CustomVerbAttribute).toString() == QStringLiteral("PROPFIND") && path == QStringLiteral("S")) {
+                return new DelayedReply<FakePropfindReply>(500, fakeFolder.remoteModifier(), op, request, &fakeFolder.syncEngine());
+            }
+            return nullptr;
+        });
+
+        QVERIFY(!fakeFolder.syncOnce());
+        QVERIFY(transfersDuringDiscovery.contains(QStringLiteral("A/a4")));
+
+        // The failed file must be discovered again: the etag of A is unchanged
+        SyncJournalFileRecord record;
+        QVERIFY(fakeFolder.syncJournal().getFileRecord(QByteArrayLiteral("A"), &record) && record.isValid());
+        QCOMPARE(record._etag, recordBefore._etag);
+
+        fakeFolder.serverErrorPaths().clear();
+        QVERIFY(fakeFolder.syncJournal().wipeErrorBlacklist() != -1);
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+    }
+
+    void testRemoteDeltaDiscovery()
+    {
+        FakeFolder fakeFolder{FileInfo::A12_B12_C12_S12()};
+        fakeFolder.setServerSyncCollectionEnabled(true);
+        auto options = fakeFolder.syncEngine().syncOptions();
+        options._remoteDeltaDiscovery = true;
+        fakeFolder.syncEngine().setSyncOptions(options);
+
+        QStringList propfinds;
+        auto reports = 0;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            const auto verb = request.attribute(QNetworkRequest::CustomVerbAttribute).toString();
+            if (verb == QStringLiteral("PROPFIND")) {
+                propfinds.append(getFilePathFromUrl(request.url()));
+            } else if (verb == QStringLiteral("REPORT")) {
+                ++reports;
+            }
+            return nullptr;
+        });
+        const auto syncToken = [&fakeFolder] {
+            return fakeFolder.syncJournal().keyValueStoreGetByteArray(QStringLiteral("remote_sync_token"));
+        };
+
+        // Without a sync-token the tree is walked, the token of the root is remembered
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(reports, 0);
+        QVERIFY(!syncToken().isEmpty());
+
+        // Changes in known directories are applied without listing them
+        fakeFolder.remoteModifier().appendByte("A/a1");
+        fakeFolder.remoteModifier().insert("B/b3");
+        fakeFolder.remoteModifier().remove("C/c1");
+        fakeFolder.remoteModifier().rename("S/s1", "S/s3");
+        propfinds.clear();
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(reports, 1);
+        QCOMPARE(propfinds, QStringList{QString()});
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+
+        // New directories are listed
+        fakeFolder.remoteModifier().mkdir("D");
+        fakeFolder.remoteModifier().insert("D/d1");
+        fakeFolder.remoteModifier().rename("B", "E");
+        propfinds.clear();
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(reports, 2);
+        QVERIFY(propfinds.contains(QStringLiteral("D")));
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+
+        // A failed item keeps the token, so that the next delta reports it again
+        const auto tokenBeforeError = syncToken();
+        fakeFolder.remoteModifier().appendByte("A/a2");
+        fakeFolder.serverErrorPaths().append("A/a2", 500);
+        QVERIFY(!fakeFolder.syncOnce());
+        QCOMPARE(syncToken(), tokenBeforeError);
+        fakeFolder.serverErrorPaths().clear();
+        QVERIFY(fakeFolder.syncJournal().wipeErrorBlacklist() != -1);
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QVERIFY(syncToken() != tokenBeforeError);
+    }
+
+    void testRemoteDeltaDiscoveryInvalidToken()
+    {
+        FakeFolder fakeFolder{FileInfo::A12_B12_C12_S12()};
+        fakeFolder.setServerSyncCollectionEnabled(true);
+        auto options = fakeFolder.syncEngine().syncOptions();
+        options._remoteDeltaDiscovery = true;
+        fakeFolder.syncEngine().setSyncOptions(options);
+        QVERIFY(fakeFolder.syncOnce());
+
+        QStringList propfinds;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            if (request.attribute(QNetworkRequest::CustomVerbAttribute).toString() == QStringLiteral("PROPFIND")) {
+                propfinds.append(getFilePathFromUrl(request.url()));
+            }
+            return nullptr;
+        });
+
+        // The server rejects the token: the changed directories are listed as usual
+        fakeFolder.forgetServerSyncTokens();
+        fakeFolder.remoteModifier().appendByte("C/c2");
+        QVERIFY(fakeFolder.syncOnce());
+        QVERIFY(propfinds.contains(QStringLiteral("C")));
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+
+        // The walk stored a new token
+        fakeFolder.remoteModifier().appendByte("C/c2");
+        propfinds.clear();
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(propfinds, QStringList{QString()});
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+    }
+
+    void testParallelNetworkJobsChangedDuringSync()
+    {
+        FakeFolder fakeFolder{FileInfo{}};
+        fakeFolder.remoteModifier().mkdir("A");
+        for (int i = 0; i < 10; ++i) {
+            fakeFolder.remoteModifier().insert(QStringLiteral("A/a%1").arg(i), 1000 * 1000);
+        }
+
+        auto limitOnNextGet = false;
+        auto runningGets = 0;
+        auto maximumRunningGets = 0;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            if (op != QNetworkAccessManager::GetOperation) {
+                return nullptr;
+            }
+            if (limitOnNextGet) {
+                // what happens when another folder starts syncing
+                limitOnNextGet = false;
+                fakeFolder.syncEngine().setParallelNetworkJobs(1);
+            }
+            const auto reply = new DelayedReply<FakeGetReply>(50, fakeFolder.remoteModifier(), op, request, &fakeFolder.syncEngine());
+            maximumRunningGets = qMax(maximumRunningGets, ++runningGets);
+            connect(reply, &QNetworkReply::finished, this, [&runningGets] {
+                --runningGets;
+            });
+            return reply;
+        });
+
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QVERIFY(maximumRunningGets > 1);
+
+        // The downloads after the first one run one after the other
+        fakeFolder.remoteModifier().mkdir("B");
+        for (int i = 0; i < 10; ++i) {
+            fakeFolder.remoteModifier().insert(QStringLiteral("B/b%1").arg(i), 1000 * 1000);
+        }
+        limitOnNextGet = true;
+        maximumRunningGets = 0;
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(maximumRunningGets, 1);
+    }
 };
 
 QTEST_GUILESS_MAIN(TestSyncEngine)
@@ -415,6 +415,49 @@ private slots:
         QCOMPARE(fakeFolder.syncEngine().syncFileStatusTracker().fileStatus("A/a"), SyncFileStatus(SyncFileStatus::StatusUpToDate));
     }
 
+    void parentsWarningStatusFollowsErrorCount() {
+        FakeFolder fakeFolder{FileInfo::A12_B12_C12_S12()};
+        fakeFolder.localModifier().mkdir("A/sub");
+        fakeFolder.localModifier().insert("A/sub/s1");
+        fakeFolder.serverErrorPaths().append("A/a1");
+        fakeFolder.serverErrorPaths().append("A/sub/s1");
+        fakeFolder.localModifier().appendByte("A/a1");
+        StatusPushSpy statusSpy(fakeFolder.syncEngine());
+
+        fakeFolder.syncOnce();
+        verifyThatPushMatchesPull(fakeFolder, statusSpy);
+        QCOMPARE(statusSpy.statusOf(""), SyncFileStatus(SyncFileStatus::StatusWarning));
+        QCOMPARE(statusSpy.statusOf("A"), SyncFileStatus(SyncFileStatus::StatusWarning));
+        QCOMPARE(statusSpy.statusOf("A/sub"), SyncFileStatus(SyncFileStatus::StatusWarning));
+        QCOMPARE(statusSpy.statusOf("A/a1"), SyncFileStatus(SyncFileStatus::StatusError));
+        QCOMPARE(statusSpy.statusOf("A/sub/s1"), SyncFileStatus(SyncFileStatus::StatusError));
+        QCOMPARE(fakeFolder.syncEngine().syncFileStatusTracker().fileStatus("B"), SyncFileStatus(SyncFileStatus::StatusUpToDate));
+        statusSpy.clear();
+
+        // A still has an error below it once A/a1 is fixed
+        fakeFolder.serverErrorPaths().clear();
+        fakeFolder.syncEngine().journal()->wipeErrorBlacklistEntry("A/a1");
+        fakeFolder.syncOnce();
+        verifyThatPushMatchesPull(fakeFolder, statusSpy);
+        QCOMPARE(statusSpy.statusOf("A/a1"), SyncFileStatus(SyncFileStatus::StatusUpToDate));
+        QCOMPARE(fakeFolder.syncEngine().syncFileStatusTracker().fileStatus(""), SyncFileStatus(SyncFileStatus::StatusWarning));
+        QCOMPARE(fakeFolder.syncEngine().syncFileStatusTracker().fileStatus("A"), SyncFileStatus(SyncFileStatus::StatusWarning));
+        QCOMPARE(fakeFolder.syncEngine().syncFileStatusTracker().fileStatus("A/sub"), SyncFileStatus(SyncFileStatus::StatusWarning));
+        QCOMPARE(fakeFolder.syncEngine().syncFileStatusTracker().fileStatus("A/sub/s1"), SyncFileStatus(SyncFileStatus::StatusError));
+        statusSpy.clear();
+
+        // The last error going away clears the warning of every parent
+        fakeFolder.syncEngine().journal()->wipeErrorBlacklistEntry("A/sub/s1");
+        fakeFolder.syncOnce();
+        verifyThatPushMatchesPull(fakeFolder, statusSpy);
+        QCOMPARE(statusSpy.statusOf(""), SyncFileStatus(SyncFileStatus::StatusUpToDate));
+        QCOMPARE(statusSpy.statusOf("A"), SyncFileStatus(SyncFileStatus::StatusUpToDate));
+        QCOMPARE(statusSpy.statusOf("A/sub"), SyncFileStatus(SyncFileStatus::StatusUpToDate));
+        QCOMPARE(statusSpy.statusOf("A/sub/s1"), SyncFileStatus(SyncFileStatus::StatusUpToDate));
+
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+    }
+
     // Even for status pushes immediately following each other, macOS
     // can sometimes have 1s delays between updates, so make sure that
     // children are marked as OK before their parents do.
@@ -475,6 +518,43 @@ private slots:
         QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
     }
 
+    void pipelinedItemsKeepSymmetricSyncCounts() {
+        FakeFolder fakeFolder{FileInfo::A12_B12_C12_S12()};
+        auto options = fakeFolder.syncEngine().syncOptions();
+        options._pipelinedPropagation = true;
+        fakeFolder.syncEngine().setSyncOptions(options);
+
+        fakeFolder.remoteModifier().insert("A/a3");
+        fakeFolder.remoteModifier().insert("S/s3");
+        // keep the discovery busy with S until A/a3 is downloaded
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            if (request.attribute(QNetworkRequest::CustomVerbAttribute).toString() == QStringLiteral("PROPFIND")
+                && getFilePathFromUrl(request.url()) == QStringLiteral("S")) {
+                return new DelayedReply<FakePropfindReply>(500, fakeFolder.remoteModifier(), op, request, &fakeFolder.syncEngine());
+            }
+            return nullptr;
+        });
+        StatusPushSpy statusSpy(fakeFolder.syncEngine());
+
+        fakeFolder.scheduleSync();
+        fakeFolder.execUntilBeforePropagation();
+        verifyThatPushMatchesPull(fakeFolder, statusSpy);
+        // A/a3 was completed during the discovery and must not be marked as syncing again
+        QCOMPARE(statusSpy.statusOf("A/a3"), SyncFileStatus(SyncFileStatus::StatusUpToDate));
+        QCOMPARE(statusSpy.statusOf("A"), SyncFileStatus(SyncFileStatus::StatusUpToDate));
+        QCOMPARE(statusSpy.statusOf("S/s3"), SyncFileStatus(SyncFileStatus::StatusSync));
+        QCOMPARE(statusSpy.statusOf("S"), SyncFileStatus(SyncFileStatus::StatusSync));
+        statusSpy.clear();
+
+        fakeFolder.execUntilFinished();
+        verifyThatPushMatchesPull(fakeFolder, statusSpy);
+        QCOMPARE(statusSpy.statusOf(""), SyncFileStatus(SyncFileStatus::StatusUpToDate));
+        QCOMPARE(statusSpy.statusOf("S/s3"), SyncFileStatus(SyncFileStatus::StatusUpToDate));
+        QCOMPARE(fakeFolder.syncEngine().syncFileStatusTracker().fileStatus("A"), SyncFileStatus(SyncFileStatus::StatusUpToDate));
+
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+    }
+
     void renameError() {
         // when rename has failed - the old file name must be restored
         FakeFolder fakeFolder{FileInfo::A12_B12_C12_S12()};
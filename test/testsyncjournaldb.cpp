@@ -8,6 +8,7 @@
 
 #include <sqlite3.h>
 
+#include "common/checksums.h"
 #include "common/syncjournaldb.h"
 #include "common/syncjournalfilerecord.h"
 #include "logger.h"
@@ -130,6 +131,195 @@ private slots:
         }
     }
 
+    void testWriteBehind()
+    {
+        _db.setWriteBehindEnabled(true);
+        QVERIFY(_db.isWriteBehindEnabled());
+
+        auto makeRecord = [](const QByteArray &path) {
+            SyncJournalFileRecord record;
+            record._path = path;
+            record._type = ItemTypeFile;
+            record._remotePerm = RemotePermissions::fromDbValue("RW");
+            record._modtime = 1700000000;
+            record._etag = "etag-" + path;
+            record._fileId = "id-" + path;
+            return record;
+        };
+
+        // Queued records can be read back right away
+        for (int i = 0; i < 2000; ++i) {
+            const auto record = makeRecord("writebehind/file" + QByteArray::number(i));
+            QVERIFY(_db.setFileRecord(record));
+            SyncJournalFileRecord storedRecord;
+            QVERIFY(_db.getFileRecord(record._path, &storedRecord));
+            QVERIFY(storedRecord == record);
+        }
+
+        // A queued deletion hides the record
+        QVERIFY(_db.deleteFileRecord("writebehind/file0"));
+        SyncJournalFileRecord deletedRecord;
+        QVERIFY(_db.getFileRecord(QByteArrayLiteral("writebehind/file0"), &deletedRecord));
+        QVERIFY(!deletedRecord.isValid());
+
+        // Other reads see everything that was queued before
+        int count = 0;
+        QVERIFY(_db.getFilesBelowPath("writebehind", [&](const SyncJournalFileRecord &) { ++count; }));
+        QCOMPARE(count, 1999);
+
+        // The last write of a path wins
+        auto record = makeRecord("writebehind/file1");
+        record._etag = "changed";
+        QVERIFY(_db.setFileRecord(record));
+        QVERIFY(_db.setFileRecord(makeRecord("writebehind/file0")));
+
+        // Lookups by inode or file id see the queued changes, also the ones
+        // that take the key from a record that is already written
+        record = makeRecord("writebehind/file2");
+        record._inode = 4242;
+        QVERIFY(_db.setFileRecord(record));
+        SyncJournalFileRecord inodeRecord;
+        QVERIFY(_db.getFileRecordByInode(4242, &inodeRecord));
+        QCOMPARE(inodeRecord._path, record._path);
+        record._inode = 4243;
+        record._fileId = "id-changed";
+        QVERIFY(_db.setFileRecord(record));
+        QVERIFY(_db.getFileRecordByInode(4242, &inodeRecord));
+        QVERIFY(!inodeRecord.isValid());
+        QVERIFY(_db.getFileRecordByInode(4243, &inodeRecord));
+        QCOMPARE(inodeRecord._path, record._path);
+        count = 0;
+        QVERIFY(_db.getFileRecordsByFileId("id-writebehind/file2", [&](const SyncJournalFileRecord &) { ++count; }));
+        QCOMPARE(count, 0);
+        QVERIFY(_db.getFileRecordsByFileId("id-changed", [&](const SyncJournalFileRecord &) { ++count; }));
+        QCOMPARE(count, 1);
+
+        QVERIFY(_db.setWriteBehindEnabled(false));
+        QVERIFY(!_db.isWriteBehindEnabled());
+
+        SyncJournalFileRecord storedRecord;
+        QVERIFY(_db.getFileRecord(QByteArrayLiteral("writebehind/file1"), &storedRecord));
+        QCOMPARE(storedRecord._etag, QByteArrayLiteral("changed"));
+        QVERIFY(_db.getFileRecord(QByteArrayLiteral("writebehind/file0"), &storedRecord));
+        QVERIFY(storedRecord.isValid());
+        QVERIFY(_db.getFileRecord(QByteArrayLiteral("writebehind/file1999"), &storedRecord));
+        QVERIFY(storedRecord == makeRecord("writebehind/file1999"));
+
+        QVERIFY(_db.deleteFileRecord("writebehind", true));
+    }
+
+    void testMetadataSnapshot()
+    {
+        auto makeEntry = [&](const QByteArray &path, ItemType type, quint64 inode, const QByteArray &fileId) {
+            SyncJournalFileRecord record;
+            record._path = path;
+            record._type = type;
+            record._inode = inode;
+            record._fileId = fileId;
+            record._etag = "etag";
+            record._remotePerm = RemotePermissions::fromDbValue("RW");
+            record._checksumHeader = "SHA1:abc";
+            QVERIFY(_db.setFileRecord(record));
+        };
+        auto listFiles = [&](const QByteArray &path) {
+            QByteArrayList paths;
+            [[maybe_unused]] const auto result = _db.listFilesInPath(path, [&](const SyncJournalFileRecord &record) { paths.append(record._path); });
+            return paths;
+        };
+        auto fileIdPaths = [&](const QByteArray &fileId) {
+            QByteArrayList paths;
+            [[maybe_unused]] const auto result = _db.getFileRecordsByFileId(fileId, [&](const SyncJournalFileRecord &record) { paths.append(record._path); });
+            std::sort(paths.begin(), paths.end());
+            return paths;
+        };
+
+        makeEntry("snap", ItemTypeDirectory, 100, "id100");
+        makeEntry("snap/a", ItemTypeFile, 101, "id101");
+        makeEntry("snap/a b", ItemTypeFile, 102, "id102");
+        makeEntry("snap/a.txt", ItemTypeFile, 103, "shared");
+        makeEntry("snap/sub", ItemTypeDirectory, 104, "id104");
+        makeEntry("snap/sub/file", ItemTypeFile, 105, "shared");
+        makeEntry("snap/sub/deeper/file", ItemTypeFile, 106, "id106"); // no record for the parent
+
+        const auto expectedList = listFiles("snap");
+        const auto expectedRoot = listFiles("");
+        SyncJournalFileRecord expectedRecord;
+        QVERIFY(_db.getFileRecord(QByteArrayLiteral("snap/sub/file"), &expectedRecord));
+
+        _db.setMetadataSnapshotEnabled(true);
+
+        // Same answers as SQLite, including the order
+        QCOMPARE(listFiles("snap"), expectedList);
+        QCOMPARE(listFiles(""), expectedRoot);
+        QCOMPARE(listFiles("snap/sub/deeper"), QByteArrayList{"snap/sub/deeper/file"});
+        QCOMPARE(listFiles("snap/sub/missing"), QByteArrayList{});
+        SyncJournalFileRecord record;
+        QVERIFY(_db.getFileRecord(QByteArrayLiteral("snap/sub/file"), &record));
+        QVERIFY(record == expectedRecord);
+        QVERIFY(_db.getFileRecord(QByteArrayLiteral("snap/sub/deeper"), &record));
+        QVERIFY(!record.isValid());
+        QVERIFY(_db.getFileRecordByInode(104, &record));
+        QCOMPARE(record._path, QByteArrayLiteral("snap/sub"));
+        QVERIFY(_db.getFileRecordByInode(0, &record));
+        QVERIFY(!record.isValid());
+        QCOMPARE(fileIdPaths("shared"), (QByteArrayList{"snap/a.txt", "snap/sub/file"}));
+
+        // Writes are reflected
+        makeEntry("snap/new", ItemTypeFile, 107, "shared");
+        QCOMPARE(fileIdPaths("shared"), (QByteArrayList{"snap/a.txt", "snap/new", "snap/sub/file"}));
+        QVERIFY(_db.updateLocalMetadata("snap/new", 42, 43, 108, {}));
+        QVERIFY(_db.getFileRecordByInode(108, &record));
+        QCOMPARE(record._path, QByteArrayLiteral("snap/new"));
+        QCOMPARE(record._fileSize, qint64(43));
+        QVERIFY(_db.getFileRecordByInode(107, &record));
+        QVERIFY(!record.isValid());
+
+        QVERIFY(_db.deleteFileRecord("snap/sub", true));
+        QCOMPARE(fileIdPaths("shared"), (QByteArrayList{"snap/a.txt", "snap/new"}));
+        QCOMPARE(listFiles("snap/sub/deeper"), QByteArrayList{});
+        QVERIFY(_db.getFileRecordByInode(106, &record));
+        QVERIFY(!record.isValid());
+
+        // Bulk updates are picked up as well
+        _db.schedulePathForRemoteDiscovery(QByteArrayLiteral("snap"));
+        QVERIFY(_db.getFileRecord(QByteArrayLiteral("snap"), &record));
+        QCOMPARE(record._etag, QByteArrayLiteral("_invalid_"));
+        QVERIFY(_db.getFileRecord(QByteArrayLiteral("snap/a"), &record));
+        QCOMPARE(record._etag, QByteArrayLiteral("etag"));
+
+        makeEntry("snap/other", ItemTypeDirectory, 109, "id109");
+        makeEntry("snap/other/virtual", ItemTypeVirtualFile, 110, "id110");
+        _db.avoidRenamesOnNextSync("snap/new");
+        QCOMPARE(fileIdPaths("shared"), QByteArrayList{"snap/a.txt"});
+        QVERIFY(_db.getFileRecordByInode(108, &record));
+        QVERIFY(!record.isValid());
+        _db.markVirtualFileForDownloadRecursively("snap/other");
+        QVERIFY(_db.getFileRecord(QByteArrayLiteral("snap/other/virtual"), &record));
+        QCOMPARE(record._type, ItemTypeVirtualFileDownload);
+        QVERIFY(_db.getFileRecord(QByteArrayLiteral("snap/other"), &record));
+        QCOMPARE(record._etag, QByteArrayLiteral("_invalid_"));
+        makeEntry("snap/other", ItemTypeDirectory, 109, "id109");
+        _db.forceRemoteDiscoveryNextSync();
+        QVERIFY(_db.getFileRecord(QByteArrayLiteral("snap/other"), &record));
+        QCOMPARE(record._etag, QByteArrayLiteral("_invalid_"));
+
+        // The snapshot was updated in place to what SQLite has
+        QVector<SyncJournalFileRecord> snapshotRecords;
+        const auto snapshotList = listFiles("snap");
+        for (const auto &path : snapshotList + listFiles("snap/other")) {
+            QVERIFY(_db.getFileRecord(path, &record));
+            snapshotRecords.append(record);
+        }
+        _db.setMetadataSnapshotEnabled(false);
+        QCOMPARE(listFiles("snap"), snapshotList);
+        for (const auto &snapshotRecord : qAsConst(snapshotRecords)) {
+            QVERIFY(_db.getFileRecord(snapshotRecord._path, &record));
+            QVERIFY(record == snapshotRecord);
+        }
+
+        QVERIFY(_db.deleteFileRecord("snap", true));
+    }
+
     void testDownloadInfo()
     {
         using Info = SyncJournalDb::DownloadInfo;
@@ -172,6 +362,68 @@ private slots:
         QVERIFY(!wipedRecord._valid);
     }
 
+    void testChecksumCache()
+    {
+        using Key = ChecksumCacheKey;
+        const auto filePath = _tempDir.path() + "/checksumcache.txt";
+        auto writeFile = [&](const QByteArray &data) {
+            QFile file(filePath);
+            QVERIFY(file.open(QFile::WriteOnly | QFile::Truncate));
+            file.write(data);
+        };
+        writeFile("some content");
+
+        const auto key = Key::fromFile(filePath);
+        QVERIFY(key.isValid());
+        QCOMPARE(key._size, qint64(12));
+        QVERIFY(!Key::fromFile(_tempDir.path() + "/nonexistent").isValid());
+        QVERIFY(!Key::fromFile(_tempDir.path()).isValid());
+
+        const auto statistics = _db.checksumCacheStatistics();
+        QVERIFY(_db.getCachedChecksum(key, "SHA1").isEmpty());
+        _db.setCachedChecksum(key, "SHA1", "cachedsha1");
+        QCOMPARE(_db.getCachedChecksum(key, "SHA1"), QByteArray("cachedsha1"));
+        QVERIFY(_db.getCachedChecksum(key, "MD5").isEmpty());
+
+        // Any difference in the key is a miss
+        auto changedKey = key;
+        ++changedKey._size;
+        QVERIFY(_db.getCachedChecksum(changedKey, "SHA1").isEmpty());
+        changedKey = key;
+        ++changedKey._ctime;
+        QVERIFY(_db.getCachedChecksum(changedKey, "SHA1").isEmpty());
+
+        QCOMPARE(_db.checksumCacheStatistics()._hits, statistics._hits + 1);
+        QCOMPARE(_db.checksumCacheStatistics()._misses, statistics._misses + 4);
+
+        // computeNow() prefers the cache over reading the file
+        QCOMPARE(ComputeChecksum::computeNow(filePath, "SHA1", &_db), QByteArray("cachedsha1"));
+        const auto realChecksum = ComputeChecksum::computeNow(filePath, "SHA1");
+        QVERIFY(realChecksum != "cachedsha1");
+
+        // ... and stores what it computed
+        writeFile("other content");
+        QCOMPARE(ComputeChecksum::computeNow(filePath, "SHA1", &_db), ComputeChecksum::computeNow(filePath, "SHA1"));
+        QCOMPARE(_db.getCachedChecksum(Key::fromFile(filePath), "SHA1"), ComputeChecksum::computeNow(filePath, "SHA1"));
+
+        // Entries of inodes that are not in the metadata are stale
+        const auto newKey = Key::fromFile(filePath);
+        SyncJournalFileRecord record;
+        record._path = "checksumcache.txt";
+        record._inode = newKey._inode;
+        record._type = ItemTypeFile;
+        record._etag = "789789";
+        record._fileId = "checksumcacheid";
+        QVERIFY(_db.setFileRecord(record));
+        Key staleKey;
+        staleKey._inode = newKey._inode + 1;
+        _db.setCachedChecksum(staleKey, "SHA1", "stale");
+        _db.deleteStaleChecksumCacheEntries();
+        QVERIFY(_db.getCachedChecksum(staleKey, "SHA1").isEmpty());
+        QVERIFY(!_db.getCachedChecksum(newKey, "SHA1").isEmpty());
+        QVERIFY(_db.deleteFileRecord("checksumcache.txt"));
+    }
+
     void testNumericId()
     {
         SyncJournalFileRecord record;
@@ -273,6 +525,73 @@ private slots:
         QCOMPARE(getEtag("foodir/sub"), initialEtag);
     }
 
+    void testScheduleFileIdsForRemoteDiscovery()
+    {
+        const auto invalidEtag = QByteArray("_invalid_");
+        auto makeEntry = [&](const QByteArray &path, ItemType type, const QByteArray &fileId) {
+            SyncJournalFileRecord record;
+            record._path = path;
+            record._type = type;
+            record._etag = "etag";
+            record._fileId = fileId;
+            record._remotePerm = RemotePermissions::fromDbValue("RW");
+            QVERIFY(_db.setFileRecord(record));
+        };
+        auto getEtag = [&](const QByteArray &path) {
+            SyncJournalFileRecord record;
+            [[maybe_unused]] const auto result = _db.getFileRecord(path, &record);
+            return record._etag;
+        };
+
+        makeEntry("pushdir", ItemTypeDirectory, "00000701ocinstance");
+        makeEntry("pushdir/file", ItemTypeFile, "00000702ocinstance");
+        makeEntry("pushdir/subdir", ItemTypeDirectory, "00000703ocinstance");
+        makeEntry("pushdir/subdir/file", ItemTypeFile, "123456789ocinstance");
+        makeEntry("pushdir/otherdir", ItemTypeDirectory, "00007020ocinstance");
+        makeEntry("pushfile", ItemTypeFile, "00000704ocinstance");
+
+        // A file schedules its directory, unknown ids are not returned
+        QCOMPARE(_db.scheduleFileIdsForRemoteDiscovery({702, 704, 705}), (QSet<qint64>{702, 704}));
+        QCOMPARE(getEtag("pushdir"), invalidEtag);
+        QCOMPARE(getEtag("pushdir/subdir"), QByteArray("etag"));
+        QCOMPARE(getEtag("pushdir/otherdir"), QByteArray("etag"));
+
+        // Ids that don't fit into 8 digits and directories
+        QCOMPARE(_db.scheduleFileIdsForRemoteDiscovery({123456789, 7020}), (QSet<qint64>{123456789, 7020}));
+        QCOMPARE(getEtag("pushdir/subdir"), invalidEtag);
+        QCOMPARE(getEtag("pushdir/otherdir"), invalidEtag);
+
+        QCOMPARE(_db.scheduleFileIdsForRemoteDiscovery({12345678}), QSet<qint64>());
+        _db.clearEtagStorageFilter();
+    }
+
+    void testFileIdForNumericFileId()
+    {
+        auto makeEntry = [&](const QByteArray &path, const QByteArray &fileId) {
+            SyncJournalFileRecord record;
+            record._path = path;
+            record._type = ItemTypeFile;
+            record._fileId = fileId;
+            record._remotePerm = RemotePermissions::fromDbValue("RW");
+            QVERIFY(_db.setFileRecord(record));
+        };
+
+        makeEntry("numericid/padded", "00000801ocinstance");
+        makeEntry("numericid/noinstance", "00000802");
+        makeEntry("numericid/long", "987654321ocinstance");
+        makeEntry("numericid/digitsuffix", "000008031");
+
+        QCOMPARE(_db.fileIdForNumericFileId(801), QByteArray("00000801ocinstance"));
+        QCOMPARE(_db.fileIdForNumericFileId(802), QByteArray("00000802"));
+        QCOMPARE(_db.fileIdForNumericFileId(987654321), QByteArray("987654321ocinstance"));
+
+        // The id must not just be a prefix of a longer one
+        QCOMPARE(_db.fileIdForNumericFileId(80), QByteArray());
+        QCOMPARE(_db.fileIdForNumericFileId(803), QByteArray());
+        QCOMPARE(_db.fileIdForNumericFileId(98765432), QByteArray());
+        QCOMPARE(_db.fileIdForNumericFileId(804), QByteArray());
+    }
+
     void testRecursiveDelete()
     {
         auto makeEntry = [&](const QByteArray &path) {
@@ -0,0 +1,130 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+
+#include "syncrunfilelog.h"
+#include "logger.h"
+
+using namespace OCC;
+
+class TestSyncRunFileLog : public QObject
+{
+    Q_OBJECT
+
+    static QString writeLog(const QString &folderPath, bool buffered, SyncRunFileLog::Format format)
+    {
+        SyncRunFileLog log;
+        log.setBuffered(buffered);
+        log.setFormat(format);
+        log.start(folderPath);
+
+        SyncFileItem download;
+        download._file = QStringLiteral("A/a1.txt");
+        download._instruction = CSYNC_INSTRUCTION_NEW;
+        download._direction = SyncFileItem::Down;
+        download._status = SyncFileItem::Success;
+        download._modtime = 1700000000;
+        download._size = 1234;
+        download._etag = "\"etag\"";
+        download._fileId = "00000042ocabcdef";
+        download._responseTimeStamp = "Mon, 16 Oct 2026 12:34:56 GMT";
+        log.logItem(download);
+
+        log.logLap(QStringLiteral("Propagation starts"));
+
+        SyncFileItem rename;
+        rename._file = QStringLiteral("B/old, \"name\".txt");
+        rename._renameTarget = QStringLiteral("B/new name.txt");
+        rename._instruction = CSYNC_INSTRUCTION_RENAME;
+        rename._direction = SyncFileItem::Up;
+        rename._status = SyncFileItem::NormalError;
+        rename._errorString = QStringLiteral("Server replied \"403 Forbidden\",\nnot allowed");
+        rename._httpErrorCode = 403;
+        rename._requestId = "request-id";
+        log.logItem(rename);
+
+        // Not logged at all
+        SyncFileItem directory;
+        directory._file = QStringLiteral("C");
+        directory._direction = SyncFileItem::None;
+        log.logItem(directory);
+
+        log.finish();
+        return log.fileName();
+    }
+
+    static QByteArray readFile(const QString &fileName)
+    {
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            return {};
+        }
+        return file.readAll();
+    }
+
+    // The durations differ from run to run
+    static QByteArray withoutDurations(QByteArray log)
+    {
+        static const QRegularExpression durations(QStringLiteral("[0-9T:-]+Z \\(last step: \\d+ msec, total: \\d+ msec\\)|started [0-9T:-]+Z"));
+        return QString::fromUtf8(log).replace(durations, QStringLiteral("<time>")).toUtf8();
+    }
+
+private slots:
+    void initTestCase()
+    {
+        OCC::Logger::instance()->setLogFlush(true);
+        OCC::Logger::instance()->setLogDebug(true);
+
+        QStandardPaths::setTestModeEnabled(true);
+        QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).removeRecursively();
+    }
+
+    void testBufferedTextLog()
+    {
+        const auto unbuffered = readFile(writeLog(QStringLiteral("/tmp/unbuffered/"), false, SyncRunFileLog::Text));
+        const auto buffered = readFile(writeLog(QStringLiteral("/tmp/buffered/"), true, SyncRunFileLog::Text));
+        QVERIFY(unbuffered.startsWith("/tmp/unbuffered/\n# timestamp | duration | file |"));
+        const auto downloadLine = QStringLiteral("12:34:56||A/a1.txt|%1|%2|1700000000|\"etag\"|1234|00000042ocabcdef|%3|")
+                                      .arg(static_cast<int>(CSYNC_INSTRUCTION_NEW))
+                                      .arg(static_cast<int>(SyncFileItem::Down))
+                                      .arg(static_cast<int>(SyncFileItem::Success));
+        QVERIFY(unbuffered.contains(downloadLine.toUtf8()));
+        QCOMPARE(unbuffered.count("#=#=#=# Syncrun"), 2);
+        QCOMPARE(withoutDurations(buffered).mid(buffered.indexOf('\n')), withoutDurations(unbuffered).mid(unbuffered.indexOf('\n')));
+    }
+
+    void testCompactLog()
+    {
+        const auto textFileName = writeLog(QStringLiteral("/tmp/compact/"), false, SyncRunFileLog::Text);
+        const auto compactFileName = writeLog(QStringLiteral("/tmp/compact/"), true, SyncRunFileLog::Compact);
+        QVERIFY(compactFileName.endsWith(QStringLiteral("compact_sync.csv")));
+
+        QFile compactFile(compactFileName);
+        QVERIFY(compactFile.open(QIODevice::ReadOnly));
+        const auto compact = compactFile.readAll();
+        const auto downloadRecord = QStringLiteral("\nI,12:34:56,,A/a1.txt,%1,%2,1700000000,\"\"\"etag\"\"\",1234,00000042ocabcdef,%3,")
+                                        .arg(static_cast<int>(CSYNC_INSTRUCTION_NEW))
+                                        .arg(static_cast<int>(SyncFileItem::Down))
+                                        .arg(static_cast<int>(SyncFileItem::Success));
+        QVERIFY(compact.contains(downloadRecord.toUtf8()));
+
+        const auto converted = SyncRunFileLog::compactLogToText(compact);
+        QCOMPARE(withoutDurations(converted), withoutDurations(readFile(textFileName)));
+
+        // A second run is appended to the same file
+        QCOMPARE(writeLog(QStringLiteral("/tmp/compact/"), false, SyncRunFileLog::Compact), compactFileName);
+        QFile appendedFile(compactFileName);
+        QVERIFY(appendedFile.open(QIODevice::ReadOnly));
+        const auto appended = SyncRunFileLog::compactLogToText(appendedFile.readAll());
+        QCOMPARE(appended.count("#=#=#=# Syncrun finished"), 2);
+        QCOMPARE(appended.count("# timestamp | duration"), 1);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestSyncRunFileLog)
+#include "testsyncrunfilelog.moc"
@@ -622,6 +622,129 @@ private slots:
         QVERIFY(_subdirs.size() == 1);
     }
 
+    void testParserIncremental() {
+        const QByteArray testXml = "<?xml version='1.0' encoding='utf-8'?>"
+              "<d:multistatus xmlns:d=\"DAV:\" xmlns:s=\"http://sabredav.org/ns\" xmlns:oc=\"http://owncloud.org/ns\">"
+              "<d:response>"
+              "<d:href>/%C3%A4/</d:href>"
+              "<d:propstat>"
+              "<d:prop>"
+              "<oc:size>121780</oc:size>"
+              "<d:resourcetype><d:collection/></d:resourcetype>"
+              "</d:prop>"
+              "<d:status>HTTP/1.1 200 OK</d:status>"
+              "</d:propstat>"
+              "</d:response>"
+              "<d:response>"
+              "<d:href>/%C3%A4/sub%20dir/</d:href>"
+              "<d:propstat>"
+              "<d:prop>"
+              "<oc:fileid>42</oc:fileid>"
+              "<d:resourcetype><d:collection/></d:resourcetype>"
+              "</d:prop>"
+              "<d:status>HTTP/1.1 200 OK</d:status>"
+              "</d:propstat>"
+              "</d:response>"
+              "<d:response>"
+              "<d:href>/%C3%A4/\xC3\xA4 &amp; b.pdf</d:href>"
+              "<d:propstat>"
+              "<d:prop>"
+              "<d:getetag>\"2fa2f0d9ed49ea0c3e409d49e652dea0\"</d:getetag>"
+              "<d:resourcetype/>"
+              "</d:prop>"
+              "<d:status>HTTP/1.1 200 OK</d:status>"
+              "</d:propstat>"
+              "</d:response>"
+              "</d:multistatus>";
+
+        QMap<QString, QString> lastProperties;
+        LsColXMLParser parser;
+        connect( &parser, &LsColXMLParser::directoryListingSubfolders,
+                 this, &TestXmlParse::slotDirectoryListingSubFolders );
+        connect( &parser, &LsColXMLParser::directoryListingIterated,
+                 this, &TestXmlParse::slotDirectoryListingIterated );
+        connect( &parser, &LsColXMLParser::directoryListingIterated,
+                 this, [&](const QString &, const QMap<QString, QString> &properties) { lastProperties = properties; });
+        connect( &parser, &LsColXMLParser::finishedWithoutError,
+                 this, &TestXmlParse::slotFinishedSuccessfully );
+
+        // Chunks split tags, entities and utf8 sequences
+        QHash <QString, ExtraFolderInfo> sizes;
+        parser.startParsing(&sizes, QString::fromUtf8("/ä"));
+        auto itemsAtHalf = -1;
+        for (int i = 0; i < testXml.size(); i += 3) {
+            QVERIFY(parser.addData(testXml.mid(i, 3)));
+            if (itemsAtHalf < 0 && i >= testXml.size() / 2) {
+                itemsAtHalf = _items.size();
+            }
+        }
+        // entries arrive before the document is complete
+        QVERIFY(itemsAtHalf >= 1);
+        QCOMPARE(_items.size(), 3);
+        QVERIFY(!_success);
+        QVERIFY(_subdirs.isEmpty());
+
+        QVERIFY(parser.finish());
+        QVERIFY(_success);
+        QCOMPARE(_items, (QStringList{QString::fromUtf8("/ä"), QString::fromUtf8("/ä/sub dir"), QString::fromUtf8("/ä/ä & b.pdf")}));
+        QCOMPARE(_subdirs, (QStringList{QString::fromUtf8("/ä/"), QString::fromUtf8("/ä/sub dir/")}));
+        QCOMPARE(sizes.value(QString::fromUtf8("/ä/")).size, qint64(121780));
+        QCOMPARE(sizes.value(QString::fromUtf8("/ä/sub dir/")).fileId, QByteArrayLiteral("42"));
+        QCOMPARE(lastProperties.value("getetag"), QStringLiteral("\"2fa2f0d9ed49ea0c3e409d49e652dea0\""));
+        QCOMPARE(lastProperties.value("resourcetype"), QString());
+
+        // A truncated document is an error
+        init();
+        parser.startParsing(&sizes, QString::fromUtf8("/ä"));
+        QVERIFY(parser.addData(testXml.left(testXml.size() - 10)));
+        QVERIFY(!parser.finish());
+        QVERIFY(!_success);
+    }
+
+    void testParserSyncCollection() {
+        const QByteArray testXml = "<?xml version='1.0' encoding='utf-8'?>"
+              "<d:multistatus xmlns:d=\"DAV:\" xmlns:oc=\"http://owncloud.org/ns\">"
+              "<d:response>"
+              "<d:href>/files/A/a1</d:href>"
+              "<d:propstat>"
+              "<d:prop>"
+              "<d:getetag>\"etag1\"</d:getetag>"
+              "<d:sync-token>not the token of the report</d:sync-token>"
+              "</d:prop>"
+              "<d:status>HTTP/1.1 200 OK</d:status>"
+              "</d:propstat>"
+              "</d:response>"
+              "<d:response>"
+              "<d:href>/files/B/b1</d:href>"
+              "<d:status>HTTP/1.1 404 Not Found</d:status>"
+              "</d:response>"
+              "<d:sync-token>http://example.com/ns/sync/5</d:sync-token>"
+              "</d:multistatus>";
+
+        QStringList removed;
+        QByteArray syncToken;
+        QMap<QString, QString> properties;
+        LsColXMLParser parser;
+        connect( &parser, &LsColXMLParser::directoryListingIterated,
+                 this, &TestXmlParse::slotDirectoryListingIterated );
+        connect( &parser, &LsColXMLParser::directoryListingIterated,
+                 this, [&](const QString &, const QMap<QString, QString> &props) { properties = props; });
+        connect( &parser, &LsColXMLParser::directoryListingRemoved,
+                 this, [&](const QString &name) { removed.append(name); });
+        connect( &parser, &LsColXMLParser::syncTokenReceived,
+                 this, [&](const QByteArray &token) { syncToken = token; });
+        connect( &parser, &LsColXMLParser::finishedWithoutError,
+                 this, &TestXmlParse::slotFinishedSuccessfully );
+
+        QHash <QString, ExtraFolderInfo> sizes;
+        QVERIFY(parser.parse(testXml, &sizes, QStringLiteral("/files")));
+        QVERIFY(_success);
+        QCOMPARE(_items, QStringList{QStringLiteral("/files/A/a1")});
+        QCOMPARE(removed, QStringList{QStringLiteral("/files/B/b1")});
+        QCOMPARE(syncToken, QByteArrayLiteral("http://example.com/ns/sync/5"));
+        QCOMPARE(properties.value("sync-token"), QStringLiteral("not the token of the report"));
+    }
+
 };
 
     QTEST_GUILESS_MAIN(TestXmlParse)